@@ -1,16 +1,25 @@
 #include "MRE57.h"
 #ifndef MRIOEXTRAS_NO_E57
 #include <MRMesh/MRBox.h>
+#include <MRMesh/MRFinally.h>
 #include <MRMesh/MRIOFormatsRegistry.h>
 #include <MRMesh/MRObjectPoints.h>
+#include <MRMesh/MRParallelFor.h>
 #include <MRMesh/MRPointCloud.h>
 #include <MRMesh/MRProgressCallback.h>
 #include <MRMesh/MRStringConvert.h>
 #include <MRMesh/MRQuaternion.h>
 #include <MRMesh/MRTimer.h>
 #include <MRPch/MRFmt.h>
+#include <MRPch/MRTBB.h>
 
+#include <algorithm>
+#include <atomic>
 #include <climits>
+#include <condition_variable>
+#include <mutex>
+#include <numeric>
+#include <thread>
 
 #pragma warning(push)
 #pragma warning(disable: 4251) // class needs to have dll-interface to be used by clients of another class
@@ -25,186 +34,394 @@
 namespace MR::PointsLoad
 {
 
-Expected<std::vector<NamedCloud>> fromSceneE57File( const std::filesystem::path& file, const E57LoadSettings & settings )
+namespace
 {
-    MR_TIMER
-    std::vector<NamedCloud> res;
-    std::optional<AffineXf3d> xf0; // returned transformation of the first not-empty cloud
-    if ( settings.identityXf )
-        xf0.emplace();
 
-    try
-    {
+/// XML parser of e57 library is initialized and terminated with each reader, which is not thread-safe,
+/// so only one file is read at a time (the scans of the file are read in parallel threads)
+std::mutex cE57Mutex;
+
+std::unique_ptr<e57::Reader> openReader( const std::filesystem::path& file )
+{
 #ifdef MR_OLD_E57
-        e57::Reader eReader( utf8string( file ) );
+    return std::make_unique<e57::Reader>( utf8string( file ) );
 #else
-        e57::Reader eReader( utf8string( file ), {} );
+    return std::make_unique<e57::Reader>( utf8string( file ), e57::ReaderOptions{} );
 #endif
-        const auto numScans = eReader.GetData3DCount();
-        res.resize( numScans );
-        for ( int scanIndex = 0; scanIndex < numScans; ++scanIndex )
+}
+
+/// readers of the same file for parallel threads, each reader is used by one thread at a time;
+/// all readers are opened and closed in the thread that owns the pool, since XML parser initialization in e57 library is not thread-safe
+class ReaderPool
+{
+public:
+    explicit ReaderPool( std::filesystem::path file ) : file_( std::move( file ) ) {}
+
+    /// opens more readers to have given number of them in the pool; must be called from the owning thread only
+    void open( size_t count )
+    {
+        std::lock_guard lock( mutex_ );
+        while ( numOpened_ < count )
         {
-            auto sp = subprogress( settings.progress, float( scanIndex ) / numScans, float( scanIndex + 1 ) / numScans );
-            auto & nc = res[scanIndex];
-            e57::Data3D scanHeader;
-            eReader.ReadData3D( scanIndex, scanHeader );
-            nc.name = scanHeader.name;
-            const AffineXf3d e57Xf(
-                Quaterniond( scanHeader.pose.rotation.w, scanHeader.pose.rotation.x, scanHeader.pose.rotation.y, scanHeader.pose.rotation.z ),
-                Vector3d( scanHeader.pose.translation.x, scanHeader.pose.translation.y, scanHeader.pose.translation.z )
-            );
-            const bool sphericalCoords = scanHeader.pointFields.sphericalRangeField
-                && scanHeader.pointFields.sphericalAzimuthField
-                && scanHeader.pointFields.sphericalElevationField;
-            assert( sphericalCoords || ( scanHeader.pointFields.cartesianXField
-                && scanHeader.pointFields.cartesianYField
-                && scanHeader.pointFields.cartesianZField ) );
-
-            std::optional<AffineXf3d> aXf; // will be applied to all points
-            if ( settings.identityXf )
-                aXf = e57Xf;
-            else if ( settings.combineAllObjects && xf0 )
-                aXf = xf0->inverse() * e57Xf;
-
-            if ( !aXf )
-            {
-                if ( sphericalCoords )
-                    aXf = AffineXf3d();
-                else
-                {
-                    const auto& bounds = scanHeader.cartesianBounds;
-                    const Box3d box {
-                        { bounds.xMinimum, bounds.yMinimum, bounds.zMinimum },
-                        { bounds.xMaximum, bounds.yMaximum, bounds.zMaximum },
-                    };
-                    if ( box.valid() )
-                    {
-                        if ( box.contains( Vector3d() ) ) // if zero of space is within bounding box (e.g. the position of camera capturing 360 degrees around),
-                            aXf = AffineXf3d();           // then keep point coordinates as is
-                        else
-                            aXf = AffineXf3d::translation( -box.center() ); // otherwise shift all points for the center of bounding box to receive zero coordinates
-                    }
-                }
-            }
+            free_.push_back( openReader( file_ ) );
+            ++numOpened_;
+        }
+    }
 
-            int64_t nColumn = 0;
-            int64_t nRow = 0;
-            int64_t nPointsSize = 0;
-            int64_t nGroupsSize = 0;
-            int64_t nCountSize = 0;
-            bool bColumnIndex = false;
+    /// returns a free reader, waiting for it if all readers are in use
+    std::unique_ptr<e57::Reader> acquire()
+    {
+        std::unique_lock lock( mutex_ );
+        assert( numOpened_ > 0 );
+        freeCv_.wait( lock, [&] { return !free_.empty(); } );
+        auto res = std::move( free_.back() );
+        free_.pop_back();
+        return res;
+    }
 
-            if ( !eReader.GetData3DSizes( scanIndex, nRow, nColumn, nPointsSize, nGroupsSize, nCountSize, bColumnIndex) )
-                return MR::unexpected( std::string( "GetData3DSizes failed during reading of " + utf8string( file ) ) );
+    /// returns the reader in the pool after its use
+    void release( std::unique_ptr<e57::Reader> reader )
+    {
+        {
+            std::lock_guard lock( mutex_ );
+            free_.push_back( std::move( reader ) );
+        }
+        freeCv_.notify_one();
+    }
 
-            if ( nPointsSize > INT_MAX )
-                return MR::unexpected( fmt::format( "Too many points {} in {}.\nMaximum supported is {}.", nPointsSize, utf8string( file ), INT_MAX ) );
+private:
+    std::filesystem::path file_;
+    std::mutex mutex_;
+    std::condition_variable freeCv_;
+    std::vector<std::unique_ptr<e57::Reader>> free_;
+    size_t numOpened_ = 0;
+};
 
-            // how many points to read in a time
-            const int64_t nSize = std::min( nPointsSize, int64_t( 1024 ) * 128 );
+/// the information from the header of a scan needed to read its points
+struct E57Scan
+{
+    int index = 0;
+    std::string name;
+    AffineXf3d e57Xf;
+    bool sphericalCoords = false;
+    bool hasColors = false;
+    int64_t numPoints = 0;
+    std::optional<AffineXf3d> aXf; ///< will be applied to all points, if not known from the header then it is found from the first point
+};
+
+Expected<E57Scan> readScanHeader( e57::Reader& reader, int scanIndex, bool identityXf, const std::filesystem::path& file )
+{
+    E57Scan res;
+    res.index = scanIndex;
+    e57::Data3D scanHeader;
+    reader.ReadData3D( scanIndex, scanHeader );
+    res.name = scanHeader.name;
+    res.e57Xf = AffineXf3d(
+        Quaterniond( scanHeader.pose.rotation.w, scanHeader.pose.rotation.x, scanHeader.pose.rotation.y, scanHeader.pose.rotation.z ),
+        Vector3d( scanHeader.pose.translation.x, scanHeader.pose.translation.y, scanHeader.pose.translation.z )
+    );
+    res.sphericalCoords = scanHeader.pointFields.sphericalRangeField
+        && scanHeader.pointFields.sphericalAzimuthField
+        && scanHeader.pointFields.sphericalElevationField;
+    assert( res.sphericalCoords || ( scanHeader.pointFields.cartesianXField
+        && scanHeader.pointFields.cartesianYField
+        && scanHeader.pointFields.cartesianZField ) );
+    res.hasColors = scanHeader.pointFields.colorRedField
+        && scanHeader.pointFields.colorGreenField
+        && scanHeader.pointFields.colorBlueField;
+
+    if ( identityXf )
+        res.aXf = res.e57Xf;
+    else if ( res.sphericalCoords )
+        res.aXf = AffineXf3d();
+    else
+    {
+        const auto& bounds = scanHeader.cartesianBounds;
+        const Box3d box {
+            { bounds.xMinimum, bounds.yMinimum, bounds.zMinimum },
+            { bounds.xMaximum, bounds.yMaximum, bounds.zMaximum },
+        };
+        if ( box.valid() )
+        {
+            if ( box.contains( Vector3d() ) ) // if zero of space is within bounding box (e.g. the position of camera capturing 360 degrees around),
+                res.aXf = AffineXf3d();       // then keep point coordinates as is
+            else
+                res.aXf = AffineXf3d::translation( -box.center() ); // otherwise shift all points for the center of bounding box to receive zero coordinates
+        }
+    }
+
+    int64_t nColumn = 0;
+    int64_t nRow = 0;
+    int64_t nGroupsSize = 0;
+    int64_t nCountSize = 0;
+    bool bColumnIndex = false;
+
+    if ( !reader.GetData3DSizes( scanIndex, nRow, nColumn, res.numPoints, nGroupsSize, nCountSize, bColumnIndex) )
+        return MR::unexpected( std::string( "GetData3DSizes failed during reading of " + utf8string( file ) ) );
+
+    if ( res.numPoints > INT_MAX )
+        return MR::unexpected( fmt::format( "Too many points {} in {}.\nMaximum supported is {}.", res.numPoints, utf8string( file ), INT_MAX ) );
+
+    return res;
+}
+
+/// accumulates the number of points read by all threads, and reports the progress from the thread of the caller only
+struct ParallelProgress
+{
+    ProgressCallback cb;
+    size_t totalPoints = 0;
+    std::thread::id callingThreadId = std::this_thread::get_id();
+    std::atomic<size_t> pointsRead{ 0 };
+    std::atomic<bool> canceled{ false };
+
+    /// returns false if the operation was canceled
+    bool add( size_t numPoints )
+    {
+        const auto read = pointsRead.fetch_add( numPoints, std::memory_order_relaxed ) + numPoints;
+        if ( cb && std::this_thread::get_id() == callingThreadId && !cb( float( read ) / float( totalPoints ) ) )
+            canceled = true;
+        return !canceled;
+    }
+};
+
+#ifdef MR_OLD_E57
+using ColorChannel = uint8_t;
+#else
+using ColorChannel = uint16_t;
+#endif
+
+/// the arrays filled by one read of compressed vector
+struct E57Block
+{
+    std::vector<double> c0, c1, c2; ///< cartesian x, y, z or spherical range, azimuth, elevation
+    std::vector<ColorChannel> rs, gs, bs;
+};
+
+/// reads all points of the scan: while the reader decodes next block of the points, the previous block is converted in other threads
+/// \return false if the operation was canceled
+bool readScanPoints( e57::Reader& reader, E57Scan& scan, NamedCloud& nc, ParallelProgress& progress )
+{
+    MR_TIMER
+    auto & cloud = nc.cloud;
+    auto & colors = nc.colors;
+    if ( scan.numPoints <= 0 )
+        return true;
 
-    #ifdef MR_OLD_E57
-            e57::Data3DPointsData_d buffers;
-    #else
-            e57::Data3DPointsDouble buffers;
-    #endif
+    // how many points to read in a time
+    const int64_t nSize = std::min( scan.numPoints, int64_t( 1024 ) * 128 );
 
-            std::vector<double> xs, ys, zs;
-            std::vector<double> rgs, azs, els;
-            if ( sphericalCoords )
+#ifdef MR_OLD_E57
+    e57::Data3DPointsData_d buffers;
+#else
+    e57::Data3DPointsDouble buffers;
+#endif
+
+    E57Block block;
+    block.c0.resize( nSize );
+    block.c1.resize( nSize );
+    block.c2.resize( nSize );
+    if ( scan.sphericalCoords )
+    {
+        buffers.sphericalRange = block.c0.data();
+        buffers.sphericalAzimuth = block.c1.data();
+        buffers.sphericalElevation = block.c2.data();
+    }
+    else
+    {
+        buffers.cartesianX = block.c0.data();
+        buffers.cartesianY = block.c1.data();
+        buffers.cartesianZ = block.c2.data();
+    }
+
+    std::vector<int8_t> invalidColors;
+    block.rs.resize( nSize );
+    block.gs.resize( nSize );
+    block.bs.resize( nSize );
+    buffers.colorRed = block.rs.data();
+    buffers.colorGreen = block.gs.data();
+    buffers.colorBlue = block.bs.data();
+    invalidColors.resize( nSize );
+    buffers.isColorInvalid = invalidColors.data();
+
+    e57::CompressedVectorReader dataReader = reader.SetUpData3DPointsData( scan.index, nSize, buffers );
+
+    const auto numPoints = size_t( scan.numPoints );
+    cloud.points.resizeNoInit( numPoints );
+    bool hasInputColors = false;
+    AffineXf3d xf;
+    E57Block converted; // the copy of the block being converted
+    tbb::task_group convertTask;
+    const auto convert = [&] ( size_t offset, size_t size )
+    {
+        ParallelFor( size_t( 0 ), size, [&] ( size_t i )
+        {
+            Vector3d p;
+            if ( scan.sphericalCoords )
             {
-                rgs.resize( nSize );
-                azs.resize( nSize );
-                els.resize( nSize );
-                buffers.sphericalRange = rgs.data();
-                buffers.sphericalAzimuth = azs.data();
-                buffers.sphericalElevation = els.data();
+                const auto r = converted.c0[i];
+                const auto a = converted.c1[i];
+                const auto e = converted.c2[i];
+                p.x = r * std::cos( e ) * std::cos( a );
+                p.y = r * std::cos( e ) * std::sin( a );
+                p.z = r * std::sin( e );
             }
             else
-            {
-                xs.resize( nSize );
-                ys.resize( nSize );
-                zs.resize( nSize );
-                buffers.cartesianX = xs.data();
-                buffers.cartesianY = ys.data();
-                buffers.cartesianZ = zs.data();
-            }
+                p = Vector3d( converted.c0[i], converted.c1[i], converted.c2[i] );
+            const VertId v( offset + i );
+            cloud.points[v] = Vector3f( xf( p ) );
+            if ( hasInputColors )
+                colors[v] = Color( converted.rs[i], converted.gs[i], converted.bs[i] );
+        } );
+    };
+
+    size_t numRead = 0;
+    unsigned long size = 0;
+    bool keepGoing = true;
+    while ( ( size = dataReader.read() ) > 0 )
+    {
+        size = (unsigned long)std::min( size_t( size ), numPoints - numRead );
+        if ( numRead == 0 )
+        {
+            hasInputColors = invalidColors.front() == 0;
+            if ( hasInputColors )
+                colors.resizeNoInit( numPoints );
+            if ( !scan.aXf )
+                scan.aXf = AffineXf3d::translation( { -block.c0[0], -block.c1[0], -block.c2[0] } );
+            xf = *scan.aXf;
+        }
+        convertTask.wait();
+        if ( !progress.add( size ) )
+        {
+            keepGoing = false;
+            break;
+        }
+        const auto copyFirst = [size] ( auto& to, const auto& from )
+        {
+            to.assign( from.begin(), from.begin() + size );
+        };
+        copyFirst( converted.c0, block.c0 );
+        copyFirst( converted.c1, block.c1 );
+        copyFirst( converted.c2, block.c2 );
+        if ( hasInputColors )
+        {
+            copyFirst( converted.rs, block.rs );
+            copyFirst( converted.gs, block.gs );
+            copyFirst( converted.bs, block.bs );
+        }
+        convertTask.run( [&convert, numRead, size] { convert( numRead, size ); } );
+        numRead += size;
+        if ( numRead == numPoints )
+            break;
+    }
+    convertTask.wait();
+    dataReader.close();
+
+    assert( !keepGoing || numRead == numPoints );
+    cloud.points.resize( numRead );
+    if ( hasInputColors )
+        colors.resize( numRead );
+    cloud.validPoints.resize( cloud.points.size(), true );
+    return keepGoing;
+}
 
-    #ifdef MR_OLD_E57
-            std::vector<uint8_t> rs, gs, bs;
-    #else
-            std::vector<uint16_t> rs, gs, bs;
-    #endif
-            std::vector<int8_t> invalidColors;
-            rs.resize( nSize );
-            gs.resize( nSize );
-            bs.resize( nSize );
-            buffers.colorRed = rs.data();
-            buffers.colorGreen = gs.data();
-            buffers.colorBlue = bs.data();
-            invalidColors.resize( nSize );
-            buffers.isColorInvalid = invalidColors.data();
-
-            e57::CompressedVectorReader dataReader = eReader.SetUpData3DPointsData( scanIndex, nSize, buffers );
-
-            auto & cloud = nc.cloud;
-            auto & colors = nc.colors;
-            cloud.points.reserve( nPointsSize );
-            unsigned long size = 0;
-            bool hasInputColors = false;
-            while ( ( size = dataReader.read() ) > 0 )
-            {
-                reportProgress( sp, float( cloud.points.size() ) / nPointsSize );
-                if ( cloud.points.empty() )
-                {
-                    hasInputColors = invalidColors.front() == 0;
-                    if ( hasInputColors )
-                        colors.reserve( nPointsSize );
-                }
-                if ( !aXf )
-                {
-                    aXf = AffineXf3d::translation(
-                    {
-                        -buffers.cartesianX[0],
-                        -buffers.cartesianY[0],
-                        -buffers.cartesianZ[0],
-                    } );
-                }
-                for ( unsigned long i = 0; i < size; ++i )
-                {
-                    Vector3d p;
-                    if ( sphericalCoords )
-                    {
-                        const auto r = buffers.sphericalRange[i];
-                        const auto a = buffers.sphericalAzimuth[i];
-                        const auto e = buffers.sphericalElevation[i];
-                        p.x = r * std::cos( e ) * std::cos( a );
-                        p.y = r * std::cos( e ) * std::sin( a );
-                        p.z = r * std::sin( e );
-                    }
-                    else
-                        p = Vector3d( buffers.cartesianX[i], buffers.cartesianY[i], buffers.cartesianZ[i] );
-                    cloud.points.emplace_back( Vector3f( (*aXf)( p ) ) );
-                    if ( hasInputColors )
-                    {
-                        colors.emplace_back(
-                            buffers.colorRed[i],
-                            buffers.colorGreen[i],
-                            buffers.colorBlue[i]
-                        );
-                    }
-                }
-            }
+} //anonymous namespace
+
+Expected<std::vector<E57ScanInfo>> readScansInfoE57File( const std::filesystem::path& file )
+{
+    MR_TIMER
+    std::vector<E57ScanInfo> res;
+    try
+    {
+        std::unique_lock lock( cE57Mutex );
+        auto reader = openReader( file );
+        const auto numScans = reader->GetData3DCount();
+        res.reserve( numScans );
+        for ( int scanIndex = 0; scanIndex < numScans; ++scanIndex )
+        {
+            auto scan = readScanHeader( *reader, scanIndex, false, file );
+            if ( !scan )
+                return unexpected( std::move( scan.error() ) );
+            res.push_back( {
+                .name = std::move( scan->name ),
+                .pose = AffineXf3f( scan->e57Xf ),
+                .numPoints = size_t( scan->numPoints ),
+                .hasColors = scan->hasColors
+            } );
+        }
+    }
+    catch( const e57::E57Exception & e )
+    {
+        return MR::unexpected( fmt::format( "Error '{}' during reading of {}",
+            e57::Utilities::errorCodeToString( e.errorCode() ), utf8string( file ) ) );
+    }
+    return res;
+}
+
+Expected<std::vector<NamedCloud>> fromSceneE57File( const std::filesystem::path& file, const E57LoadSettings & settings )
+{
+    MR_TIMER
+    std::vector<NamedCloud> res;
+    std::vector<E57Scan> scans;
 
-            assert( cloud.points.size() == (size_t)nPointsSize );
-            cloud.validPoints.resize( cloud.points.size(), true );
+    try
+    {
+        std::unique_lock lock( cE57Mutex ); // locked till all readers of the pool are closed
+        ReaderPool pool( file );
+        pool.open( 1 );
+        auto headerReader = pool.acquire();
+        const auto numScans = headerReader->GetData3DCount();
+        std::vector<int> scanIndices = settings.scans;
+        if ( scanIndices.empty() )
+        {
+            scanIndices.resize( numScans );
+            std::iota( scanIndices.begin(), scanIndices.end(), 0 );
+        }
 
-            dataReader.close();
-            nc.xf = ( settings.identityXf || !aXf ) ? AffineXf3f() :
-                AffineXf3f( e57Xf * aXf->inverse() );
-            if ( !xf0 && aXf )
-                xf0 = e57Xf * aXf->inverse();
+        scans.reserve( scanIndices.size() );
+        size_t totalPoints = 0;
+        for ( auto scanIndex : scanIndices )
+        {
+            if ( scanIndex < 0 || scanIndex >= numScans )
+                return MR::unexpected( fmt::format( "No scan #{} in {}", scanIndex, utf8string( file ) ) );
+            auto scan = readScanHeader( *headerReader, scanIndex, settings.identityXf, file );
+            if ( !scan )
+                return unexpected( std::move( scan.error() ) );
+            totalPoints += size_t( scan->numPoints );
+            scans.push_back( std::move( *scan ) );
         }
+        pool.release( std::move( headerReader ) );
+
+        res.resize( scans.size() );
+        for ( size_t i = 0; i < scans.size(); ++i )
+            res[i].name = scans[i].name;
+
+        // start from the largest scans for better balance of threads
+        std::vector<size_t> order( scans.size() );
+        std::iota( order.begin(), order.end(), size_t( 0 ) );
+        std::stable_sort( order.begin(), order.end(), [&] ( size_t a, size_t b ) { return scans[a].numPoints > scans[b].numPoints; } );
+
+        // one reader per thread
+        pool.open( std::min( order.size(), size_t( tbb::this_task_arena::max_concurrency() ) ) );
+        ParallelProgress progress{ .cb = settings.progress, .totalPoints = totalPoints };
+        // isolation prevents a thread waiting in nested parallel loop from taking another scan,
+        // and this thread waiting for the loop does not take a task reading another file, which would wait for locked cE57Mutex
+        tbb::this_task_arena::isolate( [&]
+        {
+            ParallelFor( size_t( 0 ), order.size(), [&] ( size_t k )
+            {
+                if ( progress.canceled )
+                    return;
+                const auto i = order[k];
+                tbb::this_task_arena::isolate( [&]
+                {
+                    auto reader = pool.acquire();
+                    MR_FINALLY{ pool.release( std::move( reader ) ); }; // even on exception, so other threads do not wait forever
+                    readScanPoints( *reader, scans[i], res[i], progress );
+                } );
+            } );
+        } );
+        if ( progress.canceled )
+            return unexpectedOperationCanceled();
     }
     catch( const e57::E57Exception & e )
     {
@@ -212,9 +429,42 @@ Expected<std::vector<NamedCloud>> fromSceneE57File( const std::filesystem::path&
             e57::Utilities::errorCodeToString( e.errorCode() ), utf8string( file ) ) );
     }
 
+    std::optional<AffineXf3d> xf0; // returned transformation of the first not-empty cloud
+    size_t xf0Scan = 0;
+    if ( settings.identityXf )
+        xf0.emplace();
+    for ( size_t i = 0; i < scans.size(); ++i )
+    {
+        const auto& aXf = scans[i].aXf;
+        res[i].xf = ( settings.identityXf || !aXf ) ? AffineXf3f() :
+            AffineXf3f( scans[i].e57Xf * aXf->inverse() );
+        if ( !xf0 && aXf )
+        {
+            xf0 = scans[i].e57Xf * aXf->inverse();
+            xf0Scan = i;
+        }
+    }
+
     if ( !settings.combineAllObjects || res.size() <= 1 )
         return res;
 
+    // each scan was read in its own coordinates, now transform them in the coordinates of the first not-empty cloud
+    if ( !settings.identityXf && xf0 )
+    {
+        const auto xf0Inv = xf0->inverse();
+        for ( size_t i = 0; i < scans.size(); ++i )
+        {
+            if ( i == xf0Scan || !scans[i].aXf )
+                continue;
+            const auto toCommon = xf0Inv * scans[i].e57Xf * scans[i].aXf->inverse();
+            auto& points = res[i].cloud.points;
+            ParallelFor( points, [&] ( VertId v )
+            {
+                points[v] = Vector3f( toCommon( Vector3d( points[v] ) ) );
+            } );
+        }
+    }
+
     size_t totalPoints = 0;
     bool keepColors = true;
 
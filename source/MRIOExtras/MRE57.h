@@ -13,6 +13,7 @@
 
 #include <filesystem>
 #include <string>
+#include <vector>
 
 namespace MR::PointsLoad
 {
@@ -25,6 +26,9 @@ struct E57LoadSettings
     /// true => return only identity transforms, applying them to points
     bool identityXf = false;
 
+    /// if not empty, then only the scans with these indices (see readScansInfoE57File) are loaded in given order
+    std::vector<int> scans;
+
     /// progress report and cancellation
     ProgressCallback progress;
 };
@@ -38,6 +42,19 @@ struct NamedCloud
     VertColors colors;
 };
 
+/// the information about a scan in e57 file available without reading its points
+struct E57ScanInfo
+{
+    std::string name;
+    AffineXf3f pose;
+    size_t numPoints = 0;
+    bool hasColors = false;
+};
+
+/// reads only the headers of all scans in e57 file, e.g. to select the scans for loading
+MRIOEXTRAS_API Expected<std::vector<E57ScanInfo>> readScansInfoE57File( const std::filesystem::path& file );
+
+/// the scans are read in parallel threads each having its own reader of the file
 MRIOEXTRAS_API Expected<std::vector<NamedCloud>> fromSceneE57File( const std::filesystem::path& file,
                                                                    const E57LoadSettings & settings = {} );
 
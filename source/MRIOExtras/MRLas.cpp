@@ -4,11 +4,22 @@
 #include "MRMesh/MRBox.h"
 #include "MRMesh/MRColor.h"
 #include "MRMesh/MRIOFormatsRegistry.h"
+#include "MRMesh/MRIOParsing.h"
+#include "MRMesh/MRMappedFileRegion.h"
+#include "MRMesh/MRParallelFor.h"
 #include "MRMesh/MRPointCloud.h"
 #include "MRMesh/MRPointsLoadSettings.h"
 #include "MRMesh/MRProgressCallback.h"
 #include "MRMesh/MRStringConvert.h"
+#include "MRMesh/MRTimer.h"
+#include "MRMesh/MRUniqueTemporaryFolder.h"
+#include "MRMesh/MRGTest.h"
 #include "MRPch/MRFmt.h"
+#include "MRPch/MRTBB.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
 
 #if _MSC_VER >= 1937 // Visual Studio 2022 version 17.7
 #pragma warning( push )
@@ -16,6 +27,7 @@
 #endif
 #include <lazperf/lazperf.hpp>
 #include <lazperf/readers.hpp>
+#include <lazperf/writers.hpp>
 #if _MSC_VER >= 1937 // Visual Studio 2022 version 17.7
 #pragma warning( pop )
 #endif
@@ -173,8 +185,9 @@ LasPoint getPoint( const char* buf, int )
 
 uint8_t getClassification( const char* buf, int format )
 {
+    // in formats 0-5, the upper 3 bits of the classification byte are synthetic, key-point and withheld flags
     if ( 0 <= format && format <= 5 )
-        return reinterpret_cast<const LasPoint0*>( buf )->classification;
+        return reinterpret_cast<const LasPoint0*>( buf )->classification & 0x1F;
     else if ( 6 <= format && format <= 10 )
         return reinterpret_cast<const LasPoint6*>( buf )->classification;
     else
@@ -229,6 +242,8 @@ std::optional<ColorChannels> getColorChannels( const char* buf, int format )
 }
 
 using namespace MR;
+using PointsLoad::LasLoadParams;
+using PointsLoad::LasPortionCallback;
 
 // default LAS classification palette
 constexpr std::array<Color, 19> lasDefaultPalette = {
@@ -263,10 +278,88 @@ Color getColor( uint8_t classification )
         return Color::black();
 }
 
-Expected<PointCloud> process( lazperf::reader::basic_file& reader, const PointsLoadSettings& settings )
+/// points decoded from a portion of LAS file
+struct LasPortion
 {
-    const auto pointCount = reader.pointCount();
+    PointCloud cloud; ///< only points and normals are filled
+    VertColors colorsLo; ///< lower bytes of 16-bit color channels or the colors of classifications
+    VertColors colorsHi; ///< upper bytes of 16-bit color channels or the colors of classifications
+    bool colors16 = false; ///< true if upper bytes of some color channels are not zero
+};
+
+/// converts point records of LAS file into MeshLib points, skipping the points not passing the filter
+struct LasDecoder
+{
+    int pointFormat = 0;
+    size_t recordLength = 0;
+    bool hasNormals = false;
+    bool needColors = false;
+    Vector3d scale;
+    Vector3d offset; ///< including the shift of the points returned in settings.outXf
+    std::optional<Box3d> box; ///< filter box shifted the same as the points
+    size_t decimation = 1;
+    std::optional<std::array<bool, 256>> classifications;
+
+    /// decodes the point record having given index in the file, and appends the point to the portion if it passes the filter
+    void decode( const char* buf, size_t index, LasPortion& portion ) const;
+};
+
+void LasDecoder::decode( const char* buf, size_t index, LasPortion& portion ) const
+{
+    if ( index % decimation != 0 )
+        return;
+    if ( classifications && !( *classifications )[getClassification( buf, pointFormat )] )
+        return;
+
+    const auto point = getPoint( buf, pointFormat );
+    const Vector3d pos {
+        point.x * scale.x + offset.x,
+        point.y * scale.y + offset.y,
+        point.z * scale.z + offset.z,
+    };
+    if ( box && !box->contains( pos ) )
+        return;
+    portion.cloud.points.emplace_back( pos );
+
+    if ( hasNormals )
+    {
+        Vector3d normal;
+        std::memcpy( &normal.x, buf + LasPointSize[pointFormat], 3 * sizeof( double ) );
+        portion.cloud.normals.push_back( Vector3f( normal ) );
+    }
+
+    if ( !needColors )
+        return;
+    if ( hasColorChannels( pointFormat ) )
+    {
+        const auto colorChannels = *getColorChannels( buf, pointFormat );
+        // LAS stores color data in 16-bit per channel format, but most programs use 8-bit per channel.
+        // Some of them convert color values to the 16-bit format (by multiplying by 256), some save them as is.
+        // We have to support both approaches.
+        const Color colorLo {
+            colorChannels.red % 0x100,
+            colorChannels.green % 0x100,
+            colorChannels.blue % 0x100,
+        };
+        const Color colorHi {
+            colorChannels.red >> 8,
+            colorChannels.green >> 8,
+            colorChannels.blue >> 8,
+        };
+        portion.colors16 |= ( colorHi.r || colorHi.g || colorHi.b );
+        portion.colorsLo.emplace_back( colorLo );
+        portion.colorsHi.emplace_back( colorHi );
+    }
+    else
+    {
+        const auto color = getColor( getClassification( buf, pointFormat ) );
+        portion.colorsLo.emplace_back( color );
+        portion.colorsHi.emplace_back( color );
+    }
+}
 
+Expected<LasDecoder> makeDecoder( lazperf::reader::basic_file& reader, const LasLoadParams& params, const PointsLoadSettings& settings )
+{
     const auto& header = reader.header();
     const auto pointFormat = header.pointFormat();
     if ( pointFormat < 0 || pointFormat > 10 )
@@ -298,18 +391,14 @@ Expected<PointCloud> process( lazperf::reader::basic_file& reader, const PointsL
         return unexpected( fmt::format( "Too short LAS point+normal record length {} for point format {}, expected length {}",
             header.point_record_length, pointFormat, LasPointSize[pointFormat] + 3 * sizeof( double ) ) );
 
-    PointCloud result;
-    result.points.reserve( pointCount );
-    if ( settings.colors )
-        settings.colors->reserve( pointCount );
-    if ( hasNormals )
-        result.normals.reserve( pointCount );
-
-    Vector3d offset {
-        header.offset.x,
-        header.offset.y,
-        header.offset.z,
-    };
+    LasDecoder res;
+    res.pointFormat = pointFormat;
+    res.recordLength = header.point_record_length;
+    res.hasNormals = hasNormals;
+    res.needColors = settings.colors != nullptr;
+    res.scale = { header.scale.x, header.scale.y, header.scale.z };
+    res.offset = { header.offset.x, header.offset.y, header.offset.z };
+    res.box = params.box;
     if ( settings.outXf )
     {
         const Box3d box {
@@ -318,89 +407,281 @@ Expected<PointCloud> process( lazperf::reader::basic_file& reader, const PointsL
         };
         const auto center = box.center();
         *settings.outXf = AffineXf3f::translation( Vector3f( center ) );
-        offset -= center;
+        res.offset -= center;
+        if ( res.box )
+            res.box = Box3d( res.box->min - center, res.box->max - center );
+    }
+    res.decimation = size_t( std::max( 1, params.decimation ) );
+    if ( !params.classifications.empty() )
+    {
+        res.classifications.emplace();
+        res.classifications->fill( false );
+        for ( auto c : params.classifications )
+            ( *res.classifications )[c] = true;
     }
+    return res;
+}
 
-    auto colorsHave16Bits = false;
-    std::optional<VertColors> colorsHi;
-    if ( settings.colors )
-        colorsHi.emplace();
+/// the range of points in LAZ file, which are compressed independently from other points
+struct LazChunk
+{
+    size_t firstPoint = 0;
+    size_t numPoints = 0;
+    const char* data = nullptr;
+};
 
-    std::vector<char> buf( header.point_record_length, '\0' );
-    for ( auto i = 0; i < pointCount; ++i )
+/// reads the table of chunks of LAZ file located in memory;
+/// returns empty vector if the file is not compressed by chunks or the table cannot be read, so the points must be decompressed sequentially
+std::vector<LazChunk> readLazChunkTable( lazperf::reader::basic_file& reader, const char* data, size_t size )
+{
+    // https://downloads.rapidlasso.de/doc/LAZ_Specification_1.4_R1.pdf
+    // compressor (u16), coder (u16), version major (u8), version minor (u8), revision (u16), options (u32), chunk size (u32), ...
+    const auto lazVlr = reader.vlrData( "laszip encoded", 22204 );
+    if ( lazVlr.size() < 16 )
+        return {};
+    uint16_t compressor = 0;
+    std::memcpy( &compressor, lazVlr.data(), sizeof( compressor ) );
+    if ( compressor != 2 && compressor != 3 ) // neither pointwise chunked nor layered chunked
+        return {};
+    uint32_t chunkSize = 0;
+    std::memcpy( &chunkSize, lazVlr.data() + 12, sizeof( chunkSize ) );
+    const bool variableChunks = chunkSize == std::numeric_limits<uint32_t>::max();
+    if ( chunkSize == 0 )
+        return {};
+
+    // the compressed points start from the offset of the chunk table
+    const size_t pointsStart = reader.header().point_offset;
+    if ( pointsStart + sizeof( int64_t ) > size )
+        return {};
+    int64_t tableOffset = 0;
+    std::memcpy( &tableOffset, data + pointsStart, sizeof( tableOffset ) );
+    if ( tableOffset == -1 ) // the offset was unknown to the compressor when it started writing, so it is written in the end of the file
+        std::memcpy( &tableOffset, data + size - sizeof( tableOffset ), sizeof( tableOffset ) );
+    if ( tableOffset < int64_t( pointsStart + sizeof( int64_t ) ) || size_t( tableOffset ) + 2 * sizeof( uint32_t ) > size )
+        return {};
+
+    uint32_t version = 0, numChunks = 0;
+    std::memcpy( &version, data + tableOffset, sizeof( version ) );
+    std::memcpy( &numChunks, data + tableOffset + sizeof( version ), sizeof( numChunks ) );
+    if ( version != 0 || numChunks == 0 )
+        return {};
+
+    std::vector<lazperf::chunk> entries;
+    size_t pos = size_t( tableOffset ) + 2 * sizeof( uint32_t );
+    try
     {
-        if ( i % 4096 == 0 )
-            reportProgress( settings.callback, (float)i / (float)pointCount );
-
-        reader.readPoint( buf.data() );
-        const auto point = getPoint( buf.data(), pointFormat );
-        const Vector3d pos {
-            point.x * header.scale.x + offset.x,
-            point.y * header.scale.y + offset.y,
-            point.z * header.scale.z + offset.z,
-        };
-        result.points.emplace_back( pos );
+        entries = lazperf::decompress_chunk_table( [&] ( unsigned char* buf, size_t len )
+        {
+            if ( pos + len > size )
+                throw std::runtime_error( "truncated chunk table" );
+            std::memcpy( buf, data + pos, len );
+            pos += len;
+        }, numChunks, variableChunks );
+    }
+    catch ( const std::exception& )
+    {
+        return {};
+    }
 
-        if ( settings.colors )
+    // the table stores the number of points (for variable chunks) and the compressed size of each chunk
+    const size_t pointCount = reader.pointCount();
+    std::vector<LazChunk> res;
+    res.reserve( entries.size() );
+    size_t firstPoint = 0;
+    size_t chunkStart = pointsStart + sizeof( int64_t );
+    for ( const auto& entry : entries )
+    {
+        const size_t numPoints = variableChunks ? size_t( entry.count ) : std::min( size_t( chunkSize ), pointCount - std::min( pointCount, firstPoint ) );
+        res.push_back( { firstPoint, numPoints, data + chunkStart } );
+        firstPoint += numPoints;
+        chunkStart += size_t( entry.offset );
+    }
+    if ( firstPoint != pointCount || chunkStart > size_t( tableOffset ) )
+        return {};
+    return res;
+}
+
+/// receives next batch of decoded portions in the order of the file, returns false to stop decoding
+using LasBatchCallback = std::function<bool( std::vector<LasPortion>& batch )>;
+
+/// decodes portions of points (in parallel threads if requested), and passes them by batches in the order of the file to (onBatch);
+/// (decodePortion) is called as decodePortion( portionIndex, LasPortion& )
+template <typename D>
+Expected<void> decodePortions( size_t numPortions, bool parallel, D&& decodePortion, const LasBatchCallback& onBatch, const ProgressCallback& cb )
+{
+    // the number of portions decoded together, limiting the memory occupied by the points not passed yet to (onBatch)
+    const size_t batchSize = parallel ? 4 * size_t( tbb::this_task_arena::max_concurrency() ) : 1;
+    std::vector<LasPortion> batch;
+    for ( size_t first = 0; first < numPortions; first += batchSize )
+    {
+        const auto last = std::min( numPortions, first + batchSize );
+        batch.clear();
+        batch.resize( last - first );
+        ParallelFor( first, last, [&] ( size_t i )
+        {
+            decodePortion( i, batch[i - first] );
+        } );
+        if ( !onBatch( batch ) )
+            return {};
+        if ( !reportProgress( cb, float( last ) / float( numPortions ) ) )
+            return unexpectedOperationCanceled();
+    }
+    return {};
+}
+
+/// decodes all points of the file and passes them by batches of portions to (onBatch);
+/// if the file is located in memory (data != nullptr), then uncompressed records and independent LAZ chunks are decoded in parallel
+Expected<void> decodeLas( lazperf::reader::basic_file& reader, const char* data, size_t size, const LasDecoder& decoder,
+    const LasBatchCallback& onBatch, const ProgressCallback& cb )
+{
+    MR_TIMER
+
+    const size_t pointCount = reader.pointCount();
+    const size_t recordLength = decoder.recordLength;
+    constexpr size_t portionSize = 1 << 16;
+    const size_t numPortions = ( pointCount + portionSize - 1 ) / portionSize;
+    if ( data )
+    {
+        if ( reader.vlrData( "laszip encoded", 22204 ).empty() )
         {
-            if ( hasColorChannels( pointFormat ) )
+            // uncompressed records are decoded directly from memory
+            const size_t pointsStart = reader.header().point_offset;
+            if ( pointsStart + pointCount * recordLength <= size )
             {
-                const auto colorChannels = *getColorChannels( buf.data(), pointFormat );
-                // LAS stores color data in 16-bit per channel format, but most programs use 8-bit per channel.
-                // Some of them convert color values to the 16-bit format (by multiplying by 256), some save them as is.
-                // We have to support both approaches.
-                const Color colorLo {
-                    colorChannels.red % 0x100,
-                    colorChannels.green % 0x100,
-                    colorChannels.blue % 0x100,
-                };
-                const Color colorHi {
-                    colorChannels.red >> 8,
-                    colorChannels.green >> 8,
-                    colorChannels.blue >> 8,
-                };
-                colorsHave16Bits |= ( colorHi.r || colorHi.g || colorHi.b );
-                settings.colors->emplace_back( colorLo );
-                colorsHi->emplace_back( colorHi );
+                return decodePortions( numPortions, true, [&] ( size_t i, LasPortion& portion )
+                {
+                    const auto last = std::min( pointCount, ( i + 1 ) * portionSize );
+                    for ( auto n = i * portionSize; n < last; ++n )
+                        decoder.decode( data + pointsStart + n * recordLength, n, portion );
+                }, onBatch, cb );
             }
-            else
+        }
+        else if ( const auto chunks = readLazChunkTable( reader, data, size ); !chunks.empty() )
+        {
+            const int extraBytes = int( recordLength - LasPointSize[decoder.pointFormat] );
+            return decodePortions( chunks.size(), true, [&] ( size_t i, LasPortion& portion )
             {
-                const auto color = getColor( getClassification( buf.data(), pointFormat ) );
-                settings.colors->emplace_back( color );
-                colorsHi->emplace_back( color );
-            }
+                const auto& chunk = chunks[i];
+                lazperf::reader::chunk_decompressor decompressor( decoder.pointFormat, extraBytes, chunk.data );
+                std::vector<char> buf( recordLength, '\0' );
+                for ( size_t n = 0; n < chunk.numPoints; ++n )
+                {
+                    decompressor.decompress( buf.data() );
+                    decoder.decode( buf.data(), chunk.firstPoint + n, portion );
+                }
+            }, onBatch, cb );
+        }
+    }
+
+    std::vector<char> buf( recordLength, '\0' );
+    return decodePortions( numPortions, false, [&] ( size_t i, LasPortion& portion )
+    {
+        const auto last = std::min( pointCount, ( i + 1 ) * portionSize );
+        for ( auto n = i * portionSize; n < last; ++n )
+        {
+            reader.readPoint( buf.data() );
+            decoder.decode( buf.data(), n, portion );
+        }
+    }, onBatch, cb );
+}
+
+Expected<PointCloud> loadLas( lazperf::reader::basic_file& reader, const char* data, size_t size, const LasLoadParams& params, const PointsLoadSettings& settings )
+{
+    const auto decoder = makeDecoder( reader, params, settings );
+    if ( !decoder )
+        return unexpected( decoder.error() );
+
+    PointCloud result;
+    VertColors colorsHi;
+    if ( settings.colors )
+        settings.colors->clear();
+    if ( !params.box && params.classifications.empty() )
+    {
+        const auto maxPoints = ( reader.pointCount() + decoder->decimation - 1 ) / decoder->decimation;
+        result.points.reserve( maxPoints );
+        if ( decoder->hasNormals )
+            result.normals.reserve( maxPoints );
+        if ( settings.colors )
+        {
+            settings.colors->reserve( maxPoints );
+            colorsHi.reserve( maxPoints );
+        }
+    }
 
-            if ( hasNormals )
+    auto colorsHave16Bits = false;
+    auto res = decodeLas( reader, data, size, *decoder, [&] ( std::vector<LasPortion>& batch )
+    {
+        const auto append = [] ( auto& to, const auto& from )
+        {
+            to.vec_.insert( to.vec_.end(), from.vec_.begin(), from.vec_.end() );
+        };
+        for ( const auto& portion : batch )
+        {
+            append( result.points, portion.cloud.points );
+            append( result.normals, portion.cloud.normals );
+            if ( settings.colors )
             {
-                Vector3d normal;
-                std::memcpy( &normal.x, buf.data() + LasPointSize[pointFormat], 3 * sizeof( double ) );
-                result.normals.push_back( Vector3f( normal ) );
+                append( *settings.colors, portion.colorsLo );
+                append( colorsHi, portion.colorsHi );
+                colorsHave16Bits |= portion.colors16;
             }
         }
-    }
+        return true;
+    }, settings.callback );
+    if ( !res )
+        return unexpected( std::move( res.error() ) );
 
     if ( settings.colors && colorsHave16Bits )
-    {
-        std::swap( *settings.colors, *colorsHi );
-        colorsHi.reset();
-    }
+        std::swap( *settings.colors, colorsHi );
 
     result.validPoints.resize( result.points.size(), true );
 
     return result;
 }
 
-}
-
-namespace MR::PointsLoad
+Expected<void> loadLasByPortions( lazperf::reader::basic_file& reader, const char* data, size_t size,
+    const LasPortionCallback& onPortion, const LasLoadParams& params, const PointsLoadSettings& settings )
 {
+    const auto decoder = makeDecoder( reader, params, settings );
+    if ( !decoder )
+        return unexpected( decoder.error() );
 
-Expected<PointCloud> fromLas( const std::filesystem::path& file, const PointsLoadSettings& settings )
+    // the format of colors is selected once by the first batch of decoded points, and then it is the same for all portions
+    std::optional<bool> colorsHave16Bits;
+    return decodeLas( reader, data, size, *decoder, [&] ( std::vector<LasPortion>& batch )
+    {
+        if ( !colorsHave16Bits )
+            colorsHave16Bits = std::any_of( batch.begin(), batch.end(), [] ( const LasPortion& portion ) { return portion.colors16; } );
+        for ( auto& portion : batch )
+        {
+            portion.cloud.validPoints.resize( portion.cloud.points.size(), true );
+            if ( !onPortion( std::move( portion.cloud ), std::move( *colorsHave16Bits ? portion.colorsHi : portion.colorsLo ) ) )
+                return false;
+        }
+        return true;
+    }, settings.callback );
+}
+
+/// opens LAS file, mapping it in memory if possible, and calls f( reader, data, size ) converting LAZperf exceptions in errors;
+/// data is nullptr if the file is not mapped
+template <typename F>
+auto openLas( const std::filesystem::path& file, F&& f ) -> decltype( f( std::declval<lazperf::reader::basic_file&>(), (const char*)nullptr, size_t( 0 ) ) )
 {
     try
     {
+        std::error_code ec;
+        const auto fileSize = std::filesystem::file_size( file, ec );
+        if ( !ec && fileSize > 0 )
+        {
+            if ( auto region = MappedFileRegion::map( file, 0, fileSize ) )
+            {
+                // the reader never modifies the buffer
+                lazperf::reader::mem_file reader( const_cast<char*>( ( *region )->data() ), ( *region )->size() );
+                return f( reader, ( *region )->data(), ( *region )->size() );
+            }
+        }
         lazperf::reader::named_file reader( utf8string( file ) );
-        return process( reader, settings );
+        return f( reader, nullptr, 0 );
     }
     catch ( const std::exception& exc )
     {
@@ -408,12 +689,27 @@ Expected<PointCloud> fromLas( const std::filesystem::path& file, const PointsLoa
     }
 }
 
+}
+
+namespace MR::PointsLoad
+{
+
+Expected<PointCloud> fromLas( const std::filesystem::path& file, const PointsLoadSettings& settings )
+{
+    return fromLas( file, LasLoadParams{}, settings );
+}
+
 Expected<PointCloud> fromLas( std::istream& in, const PointsLoadSettings& settings )
 {
+    MR_TIMER
+
+    auto buf = readCharBuffer( in );
+    if ( !buf )
+        return unexpected( std::move( buf.error() ) );
     try
     {
-        lazperf::reader::generic_file reader( in );
-        return process( reader, settings );
+        lazperf::reader::mem_file reader( buf->data(), buf->size() );
+        return loadLas( reader, buf->data(), buf->size(), {}, settings );
     }
     catch ( const std::exception& exc )
     {
@@ -421,8 +717,116 @@ Expected<PointCloud> fromLas( std::istream& in, const PointsLoadSettings& settin
     }
 }
 
+Expected<PointCloud> fromLas( const std::filesystem::path& file, const LasLoadParams& params, const PointsLoadSettings& settings )
+{
+    MR_TIMER
+
+    return openLas( file, [&] ( lazperf::reader::basic_file& reader, const char* data, size_t size )
+    {
+        return loadLas( reader, data, size, params, settings );
+    } );
+}
+
+Expected<void> fromLasByPortions( const std::filesystem::path& file, const LasPortionCallback& onPortion,
+    const LasLoadParams& params, const PointsLoadSettings& settings )
+{
+    MR_TIMER
+
+    return openLas( file, [&] ( lazperf::reader::basic_file& reader, const char* data, size_t size )
+    {
+        return loadLasByPortions( reader, data, size, onPortion, params, settings );
+    } );
+}
+
 MR_ADD_POINTS_LOADER( IOFilter( "LAS (.las)", "*.las" ), fromLas )
 MR_ADD_POINTS_LOADER( IOFilter( "LASzip (.laz)", "*.laz" ), fromLas )
 
+TEST( MRIOExtras, LasLoadParams )
+{
+    // LAZ file with small chunks to be decompressed in parallel, its colors are 16-bit
+    UniqueTemporaryFolder folder( {} );
+    const auto path = folder / "points.laz";
+    const int numPoints = 1000;
+    {
+        lazperf::writer::named_file::config config( { 0.01, 0.01, 0.01 }, { 0, 0, 0 }, 100 );
+        config.pdrf = 2;
+        lazperf::writer::named_file writer( utf8string( path ), config );
+        for ( int i = 0; i < numPoints; ++i )
+        {
+            LasPoint2 point{};
+            point.x = i * 100;
+            point.y = ( i % 10 ) * 100;
+            point.z = 0;
+            // some points have withheld flag
+            point.classification = uint8_t( i % 3 | ( i % 7 == 0 ? 0x80 : 0 ) );
+            point.red = uint16_t( ( i % 256 ) << 8 );
+            point.green = 0;
+            point.blue = 0xFFFF;
+            writer.writePoint( ( const char* )&point );
+        }
+        writer.close();
+    }
+
+    VertColors colors;
+    auto all = fromLas( path, LasLoadParams{}, { .colors = &colors } );
+    ASSERT_TRUE( all.has_value() );
+    ASSERT_EQ( all->points.size(), size_t( numPoints ) );
+    ASSERT_EQ( colors.size(), size_t( numPoints ) );
+    for ( int i = 0; i < numPoints; ++i )
+    {
+        EXPECT_EQ( all->points[VertId( i )], Vector3f( float( i ), float( i % 10 ), 0 ) );
+        EXPECT_EQ( colors[VertId( i )], Color( i % 256, 0, 255 ) );
+    }
+
+    // the points passing the filter are loaded in the order of the file
+    auto expectFiltered = [&] ( const LasLoadParams& params, auto&& passes )
+    {
+        std::vector<int> expected;
+        for ( int i = 0; i < numPoints; ++i )
+            if ( passes( i ) )
+                expected.push_back( i );
+
+        auto filtered = fromLas( path, params );
+        ASSERT_TRUE( filtered.has_value() );
+        ASSERT_EQ( filtered->points.size(), expected.size() );
+        for ( size_t k = 0; k < expected.size(); ++k )
+            EXPECT_EQ( filtered->points[VertId( k )].x, float( expected[k] ) );
+
+        // loading by portions gives the same points and all portions have 16-bit colors
+        std::vector<Vector3f> points;
+        VertColors portionColors;
+        auto res = fromLasByPortions( path, [&] ( PointCloud&& cloud, VertColors&& c )
+        {
+            EXPECT_EQ( cloud.points.size(), c.size() );
+            EXPECT_EQ( cloud.validPoints.count(), cloud.points.size() );
+            points.insert( points.end(), cloud.points.vec_.begin(), cloud.points.vec_.end() );
+            portionColors.vec_.insert( portionColors.vec_.end(), c.vec_.begin(), c.vec_.end() );
+            return true;
+        }, params, { .colors = &colors } );
+        ASSERT_TRUE( res.has_value() );
+        ASSERT_EQ( points.size(), expected.size() );
+        for ( size_t k = 0; k < expected.size(); ++k )
+        {
+            EXPECT_EQ( points[k], filtered->points[VertId( k )] );
+            EXPECT_EQ( portionColors[VertId( k )], Color( expected[k] % 256, 0, 255 ) );
+        }
+    };
+    expectFiltered( { .box = Box3d( { 99.5, -1, -1 }, { 199.5, 9, 1 } ) }, [] ( int i ) { return i >= 100 && i < 200; } );
+    expectFiltered( { .classifications = { 1 } }, [] ( int i ) { return i % 3 == 1; } );
+    expectFiltered( { .decimation = 10 }, [] ( int i ) { return i % 10 == 0; } );
+    expectFiltered( { .box = Box3d( { 0, 0, -1 }, { 1000, 4.5, 1 } ), .classifications = { 0, 2 }, .decimation = 2 },
+        [] ( int i ) { return i % 10 <= 4 && i % 3 != 1 && i % 2 == 0; } );
+
+    // loading by portions stops when the callback returns false
+    int numPortions = 0;
+    auto stopped = fromLasByPortions( path, [&] ( PointCloud&&, VertColors&& )
+    {
+        ++numPortions;
+        return false;
+    } );
+    EXPECT_TRUE( stopped.has_value() );
+    EXPECT_EQ( numPortions, 1 );
+}
+
 } // namespace MR::PointsLoad
 #endif
@@ -4,10 +4,13 @@
 #ifndef MRIOEXTRAS_NO_LAS
 #include "exports.h"
 
+#include <MRMesh/MRBox.h>
 #include <MRMesh/MRExpected.h>
 #include <MRMesh/MRPointsLoadSettings.h>
 
 #include <filesystem>
+#include <functional>
+#include <optional>
 
 namespace MR
 {
@@ -15,10 +18,37 @@ namespace MR
 namespace PointsLoad
 {
 
+/// the filter applied to the points of .las file during their decoding
+struct LasLoadParams
+{
+    /// if set, only the points inside this box are loaded; the box is given in the coordinates of the file (before the shift returned in settings.outXf)
+    std::optional<Box3d> box;
+
+    /// if not empty, only the points with these classification values are loaded
+    std::vector<uint8_t> classifications;
+
+    /// only each (decimation)-th point of the file is loaded, 1 means all points
+    int decimation = 1;
+};
+
+/// receives next portion of points loaded from .las file (in the order of the file) together with their colors if they were requested;
+/// returns false to stop loading
+using LasPortionCallback = std::function<bool( PointCloud&& points, VertColors&& colors )>;
+
 /// loads from .las file
 MRIOEXTRAS_API Expected<PointCloud> fromLas( const std::filesystem::path& file, const PointsLoadSettings& settings = {} );
 MRIOEXTRAS_API Expected<PointCloud> fromLas( std::istream& in, const PointsLoadSettings& settings = {} );
 
+/// loads from .las or .laz file only the points passing given filter;
+/// the chunks of LAZ files are decompressed in parallel threads
+MRIOEXTRAS_API Expected<PointCloud> fromLas( const std::filesystem::path& file, const LasLoadParams& params, const PointsLoadSettings& settings = {} );
+
+/// loads the points passing given filter from .las or .laz file portion by portion, passing each portion to (onPortion) instead of collecting all points in memory;
+/// settings.colors is used only as a flag that colors are requested;
+/// 16-bit colors are recognized by the first batch of decoded points (many portions), and the same format is used for all portions of the file
+MRIOEXTRAS_API Expected<void> fromLasByPortions( const std::filesystem::path& file, const LasPortionCallback& onPortion,
+    const LasLoadParams& params = {}, const PointsLoadSettings& settings = {} );
+
 } // namespace PointsLoad
 
 } // namespace MR
@@ -18,6 +18,9 @@ public:
     /// creates tree for given mesh or its part
     [[nodiscard]] MRMESH_API explicit AABBTree( const MeshPart & mp );
 
+    /// creates tree from given nodes (e.g. loaded from a file), which must form valid tree for the mesh
+    [[nodiscard]] explicit AABBTree( NodeVec nodes ) { nodes_ = std::move( nodes ); }
+
     AABBTree() = default;
     AABBTree( AABBTree && ) noexcept = default;
     AABBTree & operator =( AABBTree && ) noexcept = default;
@@ -0,0 +1,251 @@
+#pragma once
+
+#include "MRVector3.h"
+#include "MRId.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace MR
+{
+
+/// \addtogroup AABBTreeGroup
+/// \{
+
+/// coordinates of several triangles stored component-wise (structure of arrays),
+/// so that the distances to all of them can be computed together by vectorized instructions
+struct TriangleBatch4
+{
+    static constexpr int capacity = 4;
+
+    /// unused lanes keep degenerate triangles in the origin
+    alignas( 16 ) float ax[capacity] = {}, ay[capacity] = {}, az[capacity] = {};
+    alignas( 16 ) float bx[capacity] = {}, by[capacity] = {}, bz[capacity] = {};
+    alignas( 16 ) float cx[capacity] = {}, cy[capacity] = {}, cz[capacity] = {};
+
+    /// the faces of the triangles, only first (size) elements are used
+    FaceId faces[capacity];
+    /// any additional float per triangle, e.g. the distance to its bounding box
+    float keys[capacity] = {};
+
+    /// the number of triangles in the batch
+    int size = 0;
+
+    [[nodiscard]] bool empty() const { return size == 0; }
+    [[nodiscard]] bool full() const { return size == capacity; }
+    void clear() { size = 0; }
+
+    /// appends one more triangle in the batch
+    void push( FaceId f, const Vector3f & a, const Vector3f & b, const Vector3f & c, float key = 0 )
+    {
+        assert( size < capacity );
+        ax[size] = a.x; ay[size] = a.y; az[size] = a.z;
+        bx[size] = b.x; by[size] = b.y; bz[size] = b.z;
+        cx[size] = c.x; cy[size] = c.y; cz[size] = c.z;
+        faces[size] = f;
+        keys[size] = key;
+        ++size;
+    }
+};
+
+/// computes squared distances from point p to all triangles of the batch in float precision (distSq),
+/// and the lower bounds of the exact squared distances (minDistSq), which consider the rounding errors of float computations;
+/// the errors grow with the ill-conditioning of a triangle (e.g. a sliver), and for a degenerate triangle the lower bound is zero,
+/// so only minDistSq can be used to skip the triangles surely farther than some distance;
+/// the results for the lanes in [batch.size, capacity) are undefined
+inline void distanceSqToTriangles( const Vector3f & p, const TriangleBatch4 & batch, float * distSq, float * minDistSq );
+
+namespace TriangleBatchDetail
+{
+
+/// the multiplier of FLT_EPSILON in the bound of the absolute error of the distance computed by distanceSqToTriangles,
+/// it exceeds the sum of the errors of all operations in the kernel with a margin
+constexpr float cErrorFactor = 16;
+
+/// given the lengths of triangle edges (lab, lac) from vertex a, the distance from a to the point (lap)
+/// and the computed doubled squared area of the triangle (area2Sq = va + vb + vc),
+/// returns the bound of the absolute error of the distance computed in float precision
+inline float distanceErrorBound( float lab, float lac, float lap, float area2Sq )
+{
+    // the magnitude of all dot products in the kernel,
+    // the errors of va, vb, vc are proportional to its square, and the errors of barycentric coordinates are divided by area2Sq
+    const float l = lab + lac;
+    const float m = l * ( lap + l );
+    if ( !( area2Sq > 0 ) )
+        return FLT_MAX;
+    return cErrorFactor * FLT_EPSILON * ( m * m * l / area2Sq + lap + l );
+}
+
+/// returns the lower bound of the squared distance given the computed one and its absolute error bound
+inline float minDistanceSq( float distSq, float err )
+{
+    const float d = std::sqrt( distSq ) - err;
+    return d > 0 ? d * d : 0.0f; // also zero for NaN
+}
+
+} //namespace TriangleBatchDetail
+
+/// the same as distanceSqToTriangles, but without any hardware specific instructions, one triangle at a time
+inline void distanceSqToTrianglesScalar( const Vector3f & p, const TriangleBatch4 & batch, float * distSq, float * minDistSq )
+{
+    for ( int i = 0; i < TriangleBatch4::capacity; ++i )
+    {
+        const Vector3f a( batch.ax[i], batch.ay[i], batch.az[i] );
+        const Vector3f ab = Vector3f( batch.bx[i], batch.by[i], batch.bz[i] ) - a;
+        const Vector3f ac = Vector3f( batch.cx[i], batch.cy[i], batch.cz[i] ) - a;
+        const Vector3f ap = p - a;
+
+        // the same as in closestPointInTriangle, but all regions are evaluated without branches
+        const float d1 = dot( ab, ap );
+        const float d2 = dot( ac, ap );
+        const float d3 = d1 - dot( ab, ab );
+        const float d4 = d2 - dot( ab, ac );
+        const float d5 = d1 - dot( ab, ac );
+        const float d6 = d2 - dot( ac, ac );
+        const float va = d3 * d6 - d5 * d4;
+        const float vb = d5 * d2 - d1 * d6;
+        const float vc = d1 * d4 - d3 * d2;
+
+        // closest point is a + s * ab + t * ac
+        const float denom = 1 / ( va + vb + vc );
+        float s = vb * denom, t = vc * denom; //#0
+        if ( va <= 0 )
+        {
+            const float v = std::clamp( ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) ), 0.0f, 1.0f );
+            s = 1 - v; t = v; //#6
+        }
+        if ( vb <= 0 && d2 >= 0 && d6 <= 0 )
+        {
+            s = 0; t = d2 / ( d2 - d6 ); //#5
+        }
+        if ( vc <= 0 && d1 >= 0 && d3 <= 0 )
+        {
+            s = d1 / ( d1 - d3 ); t = 0; //#4
+        }
+        if ( d6 >= 0 && d5 <= d6 )
+        {
+            s = 0; t = 1; //#3
+        }
+        if ( d3 >= 0 && d4 <= d3 )
+        {
+            s = 1; t = 0; //#2
+        }
+        if ( d1 <= 0 && d2 <= 0 )
+        {
+            s = 0; t = 0; //#1
+        }
+        distSq[i] = ( ap - s * ab - t * ac ).lengthSq();
+        const float err = TriangleBatchDetail::distanceErrorBound( ab.length(), ac.length(), ap.length(), va + vb + vc );
+        minDistSq[i] = TriangleBatchDetail::minDistanceSq( distSq[i], err );
+    }
+}
+
+/* CPU(X86_64) - AMD64 / Intel64 / x86_64 64-bit */
+#if defined(__x86_64__) || defined(_M_X64)
+
+inline void distanceSqToTriangles( const Vector3f & p, const TriangleBatch4 & batch, float * distSq, float * minDistSq )
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps( 1.0f );
+
+    // selects b where mask is set, and a otherwise
+    auto select = []( __m128 a, __m128 b, __m128 mask )
+    {
+        return _mm_or_ps( _mm_andnot_ps( mask, a ), _mm_and_ps( mask, b ) );
+    };
+
+    const __m128 ax = _mm_load_ps( batch.ax ), ay = _mm_load_ps( batch.ay ), az = _mm_load_ps( batch.az );
+    const __m128 abx = _mm_sub_ps( _mm_load_ps( batch.bx ), ax );
+    const __m128 aby = _mm_sub_ps( _mm_load_ps( batch.by ), ay );
+    const __m128 abz = _mm_sub_ps( _mm_load_ps( batch.bz ), az );
+    const __m128 acx = _mm_sub_ps( _mm_load_ps( batch.cx ), ax );
+    const __m128 acy = _mm_sub_ps( _mm_load_ps( batch.cy ), ay );
+    const __m128 acz = _mm_sub_ps( _mm_load_ps( batch.cz ), az );
+    const __m128 apx = _mm_sub_ps( _mm_set1_ps( p.x ), ax );
+    const __m128 apy = _mm_sub_ps( _mm_set1_ps( p.y ), ay );
+    const __m128 apz = _mm_sub_ps( _mm_set1_ps( p.z ), az );
+
+    auto dot = []( __m128 x0, __m128 y0, __m128 z0, __m128 x1, __m128 y1, __m128 z1 )
+    {
+        return _mm_add_ps( _mm_add_ps( _mm_mul_ps( x0, x1 ), _mm_mul_ps( y0, y1 ) ), _mm_mul_ps( z0, z1 ) );
+    };
+
+    const __m128 abab = dot( abx, aby, abz, abx, aby, abz );
+    const __m128 abac = dot( abx, aby, abz, acx, acy, acz );
+    const __m128 acac = dot( acx, acy, acz, acx, acy, acz );
+    const __m128 d1 = dot( abx, aby, abz, apx, apy, apz );
+    const __m128 d2 = dot( acx, acy, acz, apx, apy, apz );
+    const __m128 d3 = _mm_sub_ps( d1, abab );
+    const __m128 d4 = _mm_sub_ps( d2, abac );
+    const __m128 d5 = _mm_sub_ps( d1, abac );
+    const __m128 d6 = _mm_sub_ps( d2, acac );
+    const __m128 va = _mm_sub_ps( _mm_mul_ps( d3, d6 ), _mm_mul_ps( d5, d4 ) );
+    const __m128 vb = _mm_sub_ps( _mm_mul_ps( d5, d2 ), _mm_mul_ps( d1, d6 ) );
+    const __m128 vc = _mm_sub_ps( _mm_mul_ps( d1, d4 ), _mm_mul_ps( d3, d2 ) );
+
+    // closest point is a + s * ab + t * ac, the regions are applied in the reverse order of closestPointInTriangle
+    const __m128 denom = _mm_div_ps( one, _mm_add_ps( _mm_add_ps( va, vb ), vc ) );
+    __m128 s = _mm_mul_ps( vb, denom ); //#0
+    __m128 t = _mm_mul_ps( vc, denom );
+
+    const __m128 d43 = _mm_sub_ps( d4, d3 );
+    const __m128 v6 = _mm_min_ps( _mm_max_ps( _mm_div_ps( d43, _mm_add_ps( d43, _mm_sub_ps( d5, d6 ) ) ), zero ), one );
+    const __m128 m6 = _mm_cmple_ps( va, zero );
+    s = select( s, _mm_sub_ps( one, v6 ), m6 ); //#6
+    t = select( t, v6, m6 );
+
+    const __m128 m5 = _mm_and_ps( _mm_cmple_ps( vb, zero ), _mm_and_ps( _mm_cmpge_ps( d2, zero ), _mm_cmple_ps( d6, zero ) ) );
+    s = select( s, zero, m5 ); //#5
+    t = select( t, _mm_div_ps( d2, _mm_sub_ps( d2, d6 ) ), m5 );
+
+    const __m128 m4 = _mm_and_ps( _mm_cmple_ps( vc, zero ), _mm_and_ps( _mm_cmpge_ps( d1, zero ), _mm_cmple_ps( d3, zero ) ) );
+    s = select( s, _mm_div_ps( d1, _mm_sub_ps( d1, d3 ) ), m4 ); //#4
+    t = select( t, zero, m4 );
+
+    const __m128 m3 = _mm_and_ps( _mm_cmpge_ps( d6, zero ), _mm_cmple_ps( d5, d6 ) );
+    s = select( s, zero, m3 ); //#3
+    t = select( t, one, m3 );
+
+    const __m128 m2 = _mm_and_ps( _mm_cmpge_ps( d3, zero ), _mm_cmple_ps( d4, d3 ) );
+    s = select( s, one, m2 ); //#2
+    t = select( t, zero, m2 );
+
+    const __m128 m1 = _mm_and_ps( _mm_cmple_ps( d1, zero ), _mm_cmple_ps( d2, zero ) );
+    s = _mm_andnot_ps( m1, s ); //#1
+    t = _mm_andnot_ps( m1, t );
+
+    // vector from the closest point to p
+    const __m128 qpx = _mm_sub_ps( apx, _mm_add_ps( _mm_mul_ps( s, abx ), _mm_mul_ps( t, acx ) ) );
+    const __m128 qpy = _mm_sub_ps( apy, _mm_add_ps( _mm_mul_ps( s, aby ), _mm_mul_ps( t, acy ) ) );
+    const __m128 qpz = _mm_sub_ps( apz, _mm_add_ps( _mm_mul_ps( s, abz ), _mm_mul_ps( t, acz ) ) );
+    const __m128 dSq = dot( qpx, qpy, qpz, qpx, qpy, qpz );
+    _mm_storeu_ps( distSq, dSq );
+
+    // lower bound of the distance: see TriangleBatchDetail::distanceErrorBound
+    const __m128 l = _mm_add_ps( _mm_sqrt_ps( abab ), _mm_sqrt_ps( acac ) );
+    const __m128 lap = _mm_sqrt_ps( dot( apx, apy, apz, apx, apy, apz ) );
+    const __m128 m = _mm_mul_ps( l, _mm_add_ps( lap, l ) );
+    const __m128 area2Sq = _mm_add_ps( _mm_add_ps( va, vb ), vc );
+    const __m128 err = _mm_mul_ps( _mm_set1_ps( TriangleBatchDetail::cErrorFactor * FLT_EPSILON ),
+        _mm_add_ps( _mm_div_ps( _mm_mul_ps( _mm_mul_ps( m, m ), l ), area2Sq ), _mm_add_ps( lap, l ) ) );
+    // the bound is infinite for degenerate triangles (area2Sq <= 0) and NaN area
+    const __m128 wellDefined = _mm_cmpgt_ps( area2Sq, zero );
+    // _mm_max_ps returns the second argument if the first one is NaN
+    const __m128 d = _mm_max_ps( _mm_sub_ps( _mm_sqrt_ps( dSq ), err ), zero );
+    _mm_storeu_ps( minDistSq, _mm_and_ps( wellDefined, _mm_mul_ps( d, d ) ) );
+}
+
+#else
+inline void distanceSqToTriangles( const Vector3f & p, const TriangleBatch4 & batch, float * distSq, float * minDistSq )
+{
+    distanceSqToTrianglesScalar( p, batch, distSq, minDistSq );
+}
+#endif
+
+/// \}
+
+} //namespace MR
@@ -2,10 +2,18 @@
 #include "MRVector3.h"
 #include "MRColor.h"
 #include "MRString.h"
+#include "MRProgressCallback.h"
+#include "MRGTest.h"
+#include "MRPch/MRFmt.h"
 #include "MRPch/MRTBB.h"
 
 #include <boost/spirit/home/x3.hpp>
 
+#include <charconv>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
 // helper macro to make code cleaner
 #define floatT real_parser<T>{}
 
@@ -32,6 +40,146 @@ Expected<void> readFromStream( std::istream& in, T& out )
     return {};
 }
 
+/// exactly representable powers of ten in double
+constexpr double cPow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool isDigit( char c )
+{
+    return unsigned( c - '0' ) < 10;
+}
+
+/// parses floating-point number in plain decimal notation at the beginning of [p, end) by Clinger's fast path:
+/// if the decimal significand and the power of ten are both exactly representable in double,
+/// then one multiplication or division gives correctly rounded result;
+/// returns the pointer after the number, or nullptr if the number is not of that kind
+template <typename T>
+const char* parseFloatFast( const char* p, const char* end, T& res )
+{
+    bool negative = false;
+    if ( p != end && ( *p == '-' || *p == '+' ) )
+    {
+        negative = *p == '-';
+        ++p;
+    }
+
+    std::uint64_t significand = 0;
+    int numDigits = 0; // significant digits in significand, leading zeros are not counted
+    int exp10 = 0;
+    bool anyDigit = false;
+    for ( ; p != end && isDigit( *p ); ++p )
+    {
+        significand = significand * 10 + ( *p - '0' );
+        numDigits += significand != 0;
+        anyDigit = true;
+    }
+    if ( p != end && *p == '.' )
+    {
+        for ( ++p; p != end && isDigit( *p ); ++p )
+        {
+            significand = significand * 10 + ( *p - '0' );
+            numDigits += significand != 0;
+            --exp10;
+            anyDigit = true;
+        }
+    }
+    // 19 decimal digits always fit in 64 bits
+    if ( !anyDigit || numDigits > 19 )
+        return nullptr;
+
+    if ( p != end && ( *p == 'e' || *p == 'E' ) )
+    {
+        ++p;
+        bool negativeExp = false;
+        if ( p != end && ( *p == '-' || *p == '+' ) )
+        {
+            negativeExp = *p == '-';
+            ++p;
+        }
+        if ( p == end || !isDigit( *p ) )
+            return nullptr;
+        int e = 0;
+        for ( ; p != end && isDigit( *p ); ++p )
+            if ( e < 100000 )
+                e = e * 10 + ( *p - '0' );
+        exp10 += negativeExp ? -e : e;
+    }
+
+    double d = 0;
+    if ( significand != 0 )
+    {
+        if ( significand > ( std::uint64_t( 1 ) << 53 ) || exp10 < -22 || exp10 > 22 )
+            return nullptr;
+        d = double( significand );
+        d = exp10 < 0 ? d / cPow10[-exp10] : d * cPow10[exp10];
+        if constexpr ( std::is_same_v<T, float> )
+        {
+            // second rounding from double to float can be wrong only if the double is exactly in the middle between two floats
+            std::uint64_t bits;
+            std::memcpy( &bits, &d, sizeof( d ) );
+            if ( ( bits & 0x1FFFFFFF ) == 0x10000000 )
+                return nullptr;
+        }
+    }
+    res = T( negative ? -d : d );
+    return p;
+}
+
+/// parses floating-point number at the beginning of [p, end), returns the pointer after the number or nullptr on failure
+template <typename T>
+const char* parseFloat( const char* p, const char* end, T& res )
+{
+    if ( auto q = parseFloatFast( p, end, res ) )
+        return q;
+    // rare cases: too many digits, too large exponents, infinities and NaNs
+#if __cpp_lib_to_chars >= 201611L
+    {
+        // correctly rounded conversion, but without leading plus
+        auto q = p;
+        if ( q != end && *q == '+' && q + 1 != end && *( q + 1 ) != '-' )
+            ++q;
+        const auto [ptr, ec] = std::from_chars( q, end, res );
+        if ( ec == std::errc() )
+            return ptr;
+    }
+#endif
+    using namespace boost::spirit::x3;
+    if ( parse( p, end, floatT, res ) )
+        return p;
+    return nullptr;
+}
+
+inline bool isSpace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline bool isTextSeparator( char c )
+{
+    return isSpace( c ) || c == ',' || c == ';';
+}
+
+/// parses up to maxCount floating-point numbers each preceded by any number of separators,
+/// returns the number of parsed values, and p is moved after the last of them
+template <typename T, typename IsSeparator>
+int parseFloats( const char*& p, const char* end, T* values, int maxCount, IsSeparator isSeparator )
+{
+    int n = 0;
+    for ( ; n < maxCount; ++n )
+    {
+        auto q = p;
+        while ( q != end && isSeparator( *q ) )
+            ++q;
+        q = parseFloat( q, end, values[n] );
+        if ( !q )
+            break;
+        p = q;
+    }
+    return n;
+}
+
 } // namespace
 
 namespace MR
@@ -59,9 +207,15 @@ std::vector<size_t> splitByLines( const char* data, size_t size )
             std::vector<size_t> group;
             const auto begin = i * groupSize;
             const auto end = std::min( ( i + 1 ) * groupSize, size );
-            for ( auto ci = begin; ci < end; ci++ )
-                if ( data[ci] == '\n' )
-                    group.emplace_back( ci + 1 );
+            // memchr is vectorized in all standard libraries
+            for ( auto ci = begin; ci < end; )
+            {
+                const auto* nl = (const char*)std::memchr( data + ci, '\n', end - ci );
+                if ( !nl )
+                    break;
+                ci = nl - data + 1;
+                group.emplace_back( ci );
+            }
             groups[i] = std::move( group );
         } );
     }
@@ -121,57 +275,122 @@ Expected<Buffer<char>> readCharBuffer( std::istream& in )
     return buf;
 }
 
-template <typename T>
-Expected<void> parseTextCoordinate( const std::string_view& str, Vector3<T>& v, Vector3<T>* n, Color* c )
+Expected<void> readByLineChunks( std::istream& in,
+    const std::function<Expected<void>( const char* data, size_t size, const ProgressCallback& chunkCb )>& processChunk,
+    const ProgressCallback& cb, size_t chunkSize )
 {
-    using namespace boost::spirit::x3;
-
-    int vi = 0;
-    const auto coord = [&] ( auto& ctx ) { v[vi++] = _attr( ctx ); };
-    int ni = 0;
-    const auto normal = [&] ( auto& ctx ) { if ( n ) ( *n )[ni++] = _attr( ctx ); };
-    int ci = 0;
-    const auto color = [&] ( auto& ctx ) { if ( c ) ( *c )[ci++] = uint8_t( _attr( ctx ) ); };
+    const auto streamSize = getStreamSize( in );
+    if ( !in )
+        return unexpected( std::string( "File read error" ) );
+    chunkSize = std::max( chunkSize, size_t( 1 ) );
 
-    const auto spaceRule = ( ascii::space | ',' | ';' );
-    const auto coordRule = ( floatT[coord] >> floatT[coord] >> floatT[coord] );
-    const auto normalRule = ( floatT[normal] >> floatT[normal] >> floatT[normal] );
-    const auto colorRule = ( floatT[color] >> floatT[color] >> floatT[color] );
+    // appends up to chunkSize bytes from the stream to buf
+    auto readMore = [&] ( std::vector<char>& buf )
+    {
+        const auto oldSize = buf.size();
+        buf.resize( oldSize + chunkSize );
+        in.read( buf.data() + oldSize, (std::streamsize)chunkSize );
+        buf.resize( oldSize + size_t( in.gcount() ) );
+    };
 
-    bool r;
-    if ( c != nullptr )
+    // all stream reads are made in the calling thread (e.g. Python streams can be read only with GIL held),
+    // and only processChunk of the previous chunk is executed in parallel task;
+    // the task records the progress of the chunk, which is reported to cb from the calling thread
+    std::vector<char> curr, processing;
+    tbb::task_group group;
+    Expected<void> processRes;
+    std::atomic<float> progress{ 0.0f };
+    std::atomic<bool> canceled{ false };
+    auto reportProcessed = [&]
     {
-        r = phrase_parse(
-            str.begin(),
-            str.end(),
-            ( coordRule >> -( normalRule >> -colorRule ) ),
-            spaceRule
-        );
-    }
-    else if ( n != nullptr )
+        if ( !reportProgress( cb, progress.load( std::memory_order_relaxed ) ) )
+            canceled.store( true, std::memory_order_relaxed );
+    };
+    // waits for the processing of the previous chunk
+    auto finishProcessing = [&] () -> Expected<void>
     {
-        r = phrase_parse(
-            str.begin(),
-            str.end(),
-            ( coordRule >> -normalRule ),
-            spaceRule
-        );
-    }
-    else
+        group.wait();
+        if ( !processRes )
+            return processRes;
+        reportProcessed();
+        if ( canceled )
+            return unexpectedOperationCanceled();
+        return {};
+    };
+
+    readMore( curr );
+    size_t processedBytes = 0;
+    while ( !curr.empty() )
     {
-        r = phrase_parse(
-            str.begin(),
-            str.end(),
-            coordRule,
-            spaceRule
-        );
+        const bool eof = in.eof();
+        if ( !eof && in.fail() )
+        {
+            group.wait();
+            return unexpected( std::string( "File read error" ) );
+        }
+
+        // the chunk ends after the last complete line, the rest is moved to the next chunk
+        size_t chunkEnd = curr.size();
+        if ( !eof )
+        {
+            while ( chunkEnd > 0 && curr[chunkEnd - 1] != '\n' )
+                --chunkEnd;
+            if ( chunkEnd == 0 )
+            {
+                // the line is longer than the chunk
+                readMore( curr );
+                continue;
+            }
+        }
+
+        if ( auto res = finishProcessing(); !res )
+            return res;
+        std::swap( curr, processing );
+        curr.assign( processing.begin() + chunkEnd, processing.end() );
+        processing.resize( chunkEnd );
+
+        const auto chunkBegin = float( processedBytes ) / streamSize;
+        processedBytes += chunkEnd;
+        const auto chunkCb = subprogress( [&] ( float v )
+        {
+            progress.store( v, std::memory_order_relaxed );
+            return !canceled.load( std::memory_order_relaxed );
+        }, chunkBegin, float( processedBytes ) / streamSize );
+        group.run( [&, chunkCb]
+        {
+            processRes = processChunk( processing.data(), processing.size(), chunkCb );
+            progress.store( float( processedBytes ) / streamSize, std::memory_order_relaxed );
+        } );
+
+        if ( !eof )
+        {
+            readMore( curr );
+            reportProcessed();
+        }
     }
-    if ( !r )
+    return finishProcessing();
+}
+
+template <typename T>
+Expected<void> parseTextCoordinate( const std::string_view& str, Vector3<T>& v, Vector3<T>* n, Color* c )
+{
+    const char* p = str.data();
+    const char* const end = p + str.size();
+    T values[9];
+    const int count = parseFloats( p, end, values, c ? 9 : n ? 6 : 3, isTextSeparator );
+    if ( count < 3 )
         return unexpected( "Failed to parse coord" );
 
-    // explicitly set alpha value if color is present
-    if ( c != nullptr && ci == 3 )
+    v = Vector3<T>( values[0], values[1], values[2] );
+    if ( n && count >= 6 )
+        *n = Vector3<T>( values[3], values[4], values[5] );
+    if ( c && count == 9 )
+    {
+        for ( int i = 0; i < 3; ++i )
+            ( *c )[i] = uint8_t( values[6 + i] );
+        // explicitly set alpha value if color is present
         c->a = 255;
+    }
 
     return {};
 }
@@ -179,62 +398,42 @@ Expected<void> parseTextCoordinate( const std::string_view& str, Vector3<T>& v,
 template <typename T>
 Expected<void> parseObjCoordinate( const std::string_view& str, Vector3<T>& v, Vector3<T>* c )
 {
-    using namespace boost::spirit::x3;
-
-    int i = 0;
-    auto coord = [&] ( auto& ctx ) { v[i++] = _attr( ctx ); };
-    int j = 0;
-    auto color = [&] ( auto& ctx ) { if ( c ) ( *c )[j++] = _attr( ctx ); };
-
-    bool r;
-    if ( c != nullptr )
-    {
-        r = phrase_parse(
-            str.begin(),
-            str.end(),
-            ( 'v' >> floatT[coord] >> floatT[coord] >> floatT[coord] >> -( floatT[color] >> floatT[color] >> floatT[color] ) ),
-            ascii::space
-        );
-    }
-    else
-    {
-        r = phrase_parse(
-            str.begin(),
-            str.end(),
-            ( 'v' >> floatT[coord] >> floatT[coord] >> floatT[coord] ),
-            ascii::space
-        );
-    }
-    if ( !r )
+    const char* p = str.data();
+    const char* const end = p + str.size();
+    while ( p != end && isSpace( *p ) )
+        ++p;
+    T values[6];
+    const int count = ( p != end && *p == 'v' ) ? parseFloats( ++p, end, values, c ? 6 : 3, isSpace ) : 0;
+    if ( count < 3 )
         return unexpected( "Failed to parse vertex: " + std::string( trimRight( str.substr( 0, MaxErrorStringLen ) ) ) );
 
+    v = Vector3<T>( values[0], values[1], values[2] );
+    if ( c && count == 6 )
+        *c = Vector3<T>( values[3], values[4], values[5] );
+
     return {};
 }
 
 template<typename T>
 Expected<void> parsePtsCoordinate( const std::string_view& str, Vector3<T>& v, Color& c )
 {
-    using namespace boost::spirit::x3;
-
-    int i = 0;
-    auto coord = [&] ( auto& ctx ){ v[i++] = _attr( ctx ); };
-    auto skip_pos = [&] ( auto& ){ i++;};
-    auto col = [&] ( auto& ctx ) { ((uint8_t*)&c)[i++ -4] = _attr( ctx ); };
-
-    using uint8_type = uint_parser<uint8_t>;
-    constexpr uint8_type uint8_ = {};
-    bool r = phrase_parse(
-        str.begin(),
-        str.end(),
-        ( 
-            floatT[coord] >> floatT[coord] >> floatT[coord] >>
-            double_[skip_pos] >> 
-            uint8_[col] >> uint8_[col] >> uint8_[col] ),
-        ascii::space
-    );
+    const char* p = str.data();
+    const char* const end = p + str.size();
+    T coords[3];
+    double intensity;
+    bool r = parseFloats( p, end, coords, 3, isSpace ) == 3 && parseFloats( p, end, &intensity, 1, isSpace ) == 1;
+    for ( int i = 0; r && i < 3; ++i )
+    {
+        while ( p != end && isSpace( *p ) )
+            ++p;
+        const auto [ptr, ec] = std::from_chars( p, end, c[i] );
+        r = ec == std::errc();
+        p = ptr;
+    }
     if ( !r )
         return unexpected( "Failed to parse vertex: " + std::string( trimRight( str.substr( 0, MaxErrorStringLen ) ) ) );
 
+    v = Vector3<T>( coords[0], coords[1], coords[2] );
     return {};
 }
 
@@ -258,12 +457,9 @@ Expected<void> parseSingleNumber( const std::string_view& str, T& num )
     }
     else
     {
-        r = phrase_parse(
-            str.begin(),
-            str.end(),
-            ( floatT[coord] ),
-            ascii::space
-        );
+        const char* p = str.data();
+        const char* const end = p + str.size();
+        r = parseFloats( p, end, &num, 1, isSpace ) == 1;
     }
 
     if ( !r )
@@ -349,4 +545,106 @@ template Expected<void> parseObjCoordinate<double>( const std::string_view& str,
 template Expected<void> parseAscCoordinate<float>( const std::string_view& str, Vector3f& v, Vector3f* n, Color* c );
 template Expected<void> parseAscCoordinate<double>( const std::string_view& str, Vector3d& v, Vector3d* n, Color* c );
 
-}
\ No newline at end of file
+TEST( MRMesh, ParseTextCoordinate )
+{
+    // the numbers taking fast path
+    std::vector<const char*> numbers = { "0", "-0.0", "1", "+2.5", "-3.25e2", "0.1", "1234.5678", ".5", "5.", "1E-5", "16777217", "0.30000001192092896" };
+#if __cpp_lib_to_chars >= 201611L
+    // the numbers passed to correctly rounding general parser
+    numbers.insert( numbers.end(), { "123456789012345678901234567890", "1e-30", "3.4e38", "0.000000000000000000000000123", "9007199254740993" } );
+#endif
+    for ( const char* str : numbers )
+    {
+        Vector3d v;
+        EXPECT_TRUE( parseTextCoordinate( fmt::format( "{0}, {0}; {0}", str ), v ).has_value() ) << str;
+        const double expected = std::strtod( str, nullptr );
+        EXPECT_EQ( v, Vector3d::diagonal( expected ) ) << str;
+
+        Vector3f vf;
+        EXPECT_TRUE( parseTextCoordinate( fmt::format( "{0} {0} {0}", str ), vf ).has_value() ) << str;
+        EXPECT_EQ( vf.x, float( expected ) ) << str;
+    }
+
+    Vector3f v, n;
+    Color c;
+    EXPECT_TRUE( parseTextCoordinate( "1 2 3 0 0 1 10 20 30\r\n", v, &n, &c ).has_value() );
+    EXPECT_EQ( v, Vector3f( 1, 2, 3 ) );
+    EXPECT_EQ( n, Vector3f( 0, 0, 1 ) );
+    EXPECT_EQ( c, Color( 10, 20, 30 ) );
+    EXPECT_FALSE( parseTextCoordinate( "1 2 abc", v ).has_value() );
+
+    EXPECT_TRUE( parseObjCoordinate( " v 1.5 -2 3e1 0.5 0.25 1", v, &n ).has_value() );
+    EXPECT_EQ( v, Vector3f( 1.5f, -2, 30 ) );
+    EXPECT_EQ( n, Vector3f( 0.5f, 0.25f, 1 ) );
+    EXPECT_FALSE( parseObjCoordinate( "vn 1 2 3", v ).has_value() );
+
+    EXPECT_TRUE( parsePtsCoordinate( "1 2 3 -100 255 0 7", v, c ).has_value() );
+    EXPECT_EQ( v, Vector3f( 1, 2, 3 ) );
+    EXPECT_EQ( c.r, 255 );
+    EXPECT_EQ( c.b, 7 );
+    EXPECT_FALSE( parsePtsCoordinate( "1 2 3 -100 256 0 7", v, c ).has_value() );
+}
+
+TEST( MRMesh, ReadByLineChunks )
+{
+    std::string text;
+    for ( int i = 0; i < 1000; ++i )
+        text += std::string( i % 37, 'x' ) + '\n';
+    text += "last line without end";
+
+    // the buffer of the stream remembers whether it was read from any other thread except the calling one
+    struct CheckedBuf : std::stringbuf
+    {
+        using std::stringbuf::stringbuf;
+        std::thread::id callingThread = std::this_thread::get_id();
+        std::atomic<bool> otherThread{ false };
+        std::streamsize xsgetn( char* s, std::streamsize n ) override
+        {
+            if ( std::this_thread::get_id() != callingThread )
+                otherThread = true;
+            return std::stringbuf::xsgetn( s, n );
+        }
+    };
+
+    for ( size_t chunkSize : { 1, 10, 100, 100000 } )
+    {
+        CheckedBuf buf( text );
+        std::istream in( &buf );
+        std::string joined;
+        float lastProgress = 0;
+        auto res = readByLineChunks( in, [&] ( const char* data, size_t size, const ProgressCallback& chunkCb ) -> Expected<void>
+        {
+            const std::string_view chunk( data, size );
+            // each chunk ends on line boundary except for the last one
+            if ( joined.size() + size < text.size() )
+            {
+                EXPECT_EQ( chunk.back(), '\n' );
+            }
+            joined += chunk;
+            reportProgress( chunkCb, 0.5f );
+            return {};
+        }, [&] ( float v )
+        {
+            EXPECT_GE( v, lastProgress );
+            lastProgress = v;
+            return true;
+        }, chunkSize );
+        EXPECT_TRUE( res.has_value() );
+        EXPECT_EQ( joined, text );
+        EXPECT_FALSE( buf.otherThread );
+        EXPECT_NEAR( lastProgress, 1.0f, 1e-6f );
+    }
+
+    // cancellation stops the reading
+    std::istringstream in( text );
+    int numChunks = 0;
+    auto res = readByLineChunks( in, [&] ( const char*, size_t, const ProgressCallback& ) -> Expected<void>
+    {
+        ++numChunks;
+        return {};
+    }, [] ( float ) { return false; }, 100 );
+    EXPECT_FALSE( res.has_value() );
+    EXPECT_LT( numChunks, 10 );
+}
+
+}
@@ -20,6 +20,14 @@ MRMESH_API Expected<std::string> readString( std::istream& in );
 // reads input stream to monolith char block
 MR_BIND_IGNORE MRMESH_API Expected<Buffer<char>> readCharBuffer( std::istream& in );
 
+// reads input stream by chunks of about chunkSize bytes each ending on line boundary, and calls processChunk for each of them,
+// so the memory needed for the text does not depend on the stream size; the chunk data is valid only during the call;
+// the next chunk is read from the stream in the calling thread while the previous one is processed in a parallel task;
+// chunkCb given to processChunk maps the progress of processing the chunk in the range of the chunk in the whole stream, and it is reported to cb from the calling thread
+MR_BIND_IGNORE MRMESH_API Expected<void> readByLineChunks( std::istream& in,
+    const std::function<Expected<void>( const char* data, size_t size, const ProgressCallback& chunkCb )>& processChunk,
+    const ProgressCallback& cb = {}, size_t chunkSize = ( size_t( 1 ) << 26 ) );
+
 // read coordinates to `v` separated by space
 template<typename T>
 Expected<void> parseTextCoordinate( const std::string_view& str, Vector3<T>& v, Vector3<T>* n = nullptr, Color* c = nullptr );
@@ -1,6 +1,10 @@
 #include "MRIdentifyVertices.h"
 #include "MRParallelFor.h"
 #include "MRTimer.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <algorithm>
+#include <numeric>
 
 namespace MR
 {
@@ -63,6 +67,250 @@ void VertexIdentifier::addTriangles( const std::vector<Triangle3f> & buffer )
     }
 }
 
+namespace
+{
+
+/// triangle corner with the bits of its coordinates
+struct CornerRecord
+{
+    std::uint32_t key[3];
+    std::uint32_t corner;
+
+    bool sameKey( const CornerRecord & b ) const
+    {
+        return key[0] == b.key[0] && key[1] == b.key[1] && key[2] == b.key[2];
+    }
+};
+
+/// the number of bits in one digit of radix sort
+constexpr int cDigitBits = 16;
+constexpr size_t cNumBuckets = size_t( 1 ) << cDigitBits;
+
+/// splits [0, size) on approximately equal blocks
+struct Blocks
+{
+    size_t size = 0;
+    size_t blockSize = 0;
+    size_t num = 0;
+
+    explicit Blocks( size_t size ) : size( size )
+    {
+        // several blocks per thread for load balancing, but not too many to limit the memory for histograms
+        const size_t maxNum = 4 * size_t( tbb::this_task_arena::max_concurrency() );
+        blockSize = std::max( ( size + maxNum - 1 ) / maxNum, size_t( 1 ) << 16 );
+        num = ( size + blockSize - 1 ) / blockSize;
+    }
+    size_t begin( size_t b ) const { return b * blockSize; }
+    size_t end( size_t b ) const { return std::min( size, ( b + 1 ) * blockSize ); }
+};
+
+/// one pass of stable LSD radix sort of the records from (src) to (dst) by given digit of the key;
+/// returns false if all records have the same digit and nothing was done
+bool radixSortPass( const std::vector<CornerRecord> & src, std::vector<CornerRecord> & dst, int word, int shift,
+    const Blocks & blocks, std::vector<std::uint32_t> & hist )
+{
+    const auto digit = [word, shift] ( const CornerRecord & r )
+    {
+        return ( r.key[word] >> shift ) & ( cNumBuckets - 1 );
+    };
+
+    // hist[b * cNumBuckets + d] is the number of records with digit d in block b, and then the position of the first of them in dst
+    hist.assign( blocks.num * cNumBuckets, 0 );
+    ParallelFor( size_t( 0 ), blocks.num, [&] ( size_t b )
+    {
+        auto * h = hist.data() + b * cNumBuckets;
+        for ( size_t i = blocks.begin( b ); i < blocks.end( b ); ++i )
+            ++h[digit( src[i] )];
+    } );
+
+    if ( std::count( hist.begin(), hist.begin() + cNumBuckets, std::uint32_t( blocks.end( 0 ) ) ) == 1 )
+    {
+        // check whether all records have the same digit as the first one
+        const auto d0 = digit( src[0] );
+        bool allSame = true;
+        for ( size_t b = 0; allSame && b < blocks.num; ++b )
+            allSame = hist[b * cNumBuckets + d0] == blocks.end( b ) - blocks.begin( b );
+        if ( allSame )
+            return false;
+    }
+
+    std::vector<std::uint32_t> totals( cNumBuckets );
+    ParallelFor( size_t( 0 ), cNumBuckets, [&] ( size_t d )
+    {
+        std::uint32_t sum = 0;
+        for ( size_t b = 0; b < blocks.num; ++b )
+            sum += hist[b * cNumBuckets + d];
+        totals[d] = sum;
+    } );
+    std::exclusive_scan( totals.begin(), totals.end(), totals.begin(), std::uint32_t( 0 ) );
+    ParallelFor( size_t( 0 ), cNumBuckets, [&] ( size_t d )
+    {
+        std::uint32_t pos = totals[d];
+        for ( size_t b = 0; b < blocks.num; ++b )
+        {
+            const auto n = hist[b * cNumBuckets + d];
+            hist[b * cNumBuckets + d] = pos;
+            pos += n;
+        }
+    } );
+
+    ParallelFor( size_t( 0 ), blocks.num, [&] ( size_t b )
+    {
+        auto * h = hist.data() + b * cNumBuckets;
+        for ( size_t i = blocks.begin( b ); i < blocks.end( b ); ++i )
+            dst[h[digit( src[i] )]++] = src[i];
+    } );
+    return true;
+}
+
+} //anonymous namespace
+
+bool identifyVertices( const std::vector<Triangle3f> & soup, Triangulation & t, VertCoords & points, const ProgressCallback & cb )
+{
+    MR_TIMER
+    const size_t numCorners = 3 * soup.size();
+    if ( numCorners >= std::numeric_limits<std::uint32_t>::max() )
+    {
+        // corner indices do not fit in the records, so use slower hash map
+        VertexIdentifier vi;
+        vi.reserve( soup.size() );
+        vi.addTriangles( soup );
+        t = vi.takeTriangulation();
+        points = vi.takePoints();
+        return reportProgress( cb, 1.0f );
+    }
+
+    std::vector<CornerRecord> records( numCorners );
+    ParallelFor( size_t( 0 ), soup.size(), [&] ( size_t f )
+    {
+        for ( int k = 0; k < 3; ++k )
+        {
+            auto & r = records[3 * f + k];
+            static_assert( sizeof( r.key ) == sizeof( Vector3f ) );
+            std::memcpy( r.key, &soup[f][k], sizeof( Vector3f ) );
+            r.corner = std::uint32_t( 3 * f + k );
+        }
+    } );
+    if ( !reportProgress( cb, 0.1f ) )
+        return false;
+
+    // sort the records by their keys, and among equal keys by increasing corner due to stability of the sort
+    const Blocks blocks( numCorners );
+    {
+        std::vector<CornerRecord> tmp( numCorners );
+        std::vector<std::uint32_t> hist;
+        int pass = 0;
+        for ( int word = 2; word >= 0; --word )
+        {
+            for ( int shift = 0; shift < 32; shift += cDigitBits )
+            {
+                if ( numCorners > 0 && radixSortPass( records, tmp, word, shift, blocks, hist ) )
+                    records.swap( tmp );
+                if ( !reportProgress( cb, 0.1f + 0.6f * float( ++pass ) / ( 3 * 32 / cDigitBits ) ) )
+                    return false;
+            }
+        }
+    }
+
+    // firstCorner[c] is the first corner in the soup with the same coordinates as corner c
+    std::vector<std::uint32_t> firstCorner( numCorners );
+    {
+        // the first corner of the last group starting in each block, or the one from previous blocks
+        std::vector<std::uint32_t> carry( blocks.num );
+        ParallelFor( size_t( 0 ), blocks.num, [&] ( size_t b )
+        {
+            carry[b] = std::numeric_limits<std::uint32_t>::max();
+            for ( size_t i = blocks.end( b ); i-- > blocks.begin( b ); )
+            {
+                if ( i == 0 || !records[i].sameKey( records[i - 1] ) )
+                {
+                    carry[b] = records[i].corner;
+                    break;
+                }
+            }
+        } );
+        for ( size_t b = 1; b < blocks.num; ++b )
+            if ( carry[b] == std::numeric_limits<std::uint32_t>::max() )
+                carry[b] = carry[b - 1];
+
+        ParallelFor( size_t( 0 ), blocks.num, [&] ( size_t b )
+        {
+            std::uint32_t first = b > 0 ? carry[b - 1] : 0;
+            for ( size_t i = blocks.begin( b ); i < blocks.end( b ); ++i )
+            {
+                if ( i == 0 || !records[i].sameKey( records[i - 1] ) )
+                    first = records[i].corner;
+                firstCorner[records[i].corner] = first;
+            }
+        } );
+    }
+    records = {};
+    if ( !reportProgress( cb, 0.8f ) )
+        return false;
+
+    // number the vertices in the order of their first corners
+    std::vector<std::uint32_t> blockVerts( blocks.num + 1 );
+    ParallelFor( size_t( 0 ), blocks.num, [&] ( size_t b )
+    {
+        std::uint32_t n = 0;
+        for ( size_t c = blocks.begin( b ); c < blocks.end( b ); ++c )
+            n += firstCorner[c] == c;
+        blockVerts[b + 1] = n;
+    } );
+    std::partial_sum( blockVerts.begin(), blockVerts.end(), blockVerts.begin() );
+
+    t.resize( soup.size() );
+    points.resizeNoInit( blockVerts.back() );
+    const auto corner = [&t] ( size_t c ) -> VertId & { return t[FaceId( c / 3 )][c % 3]; };
+    ParallelFor( size_t( 0 ), blocks.num, [&] ( size_t b )
+    {
+        auto v = VertId( blockVerts[b] );
+        for ( size_t c = blocks.begin( b ); c < blocks.end( b ); ++c )
+        {
+            if ( firstCorner[c] != c )
+                continue;
+            points[v] = soup[c / 3][c % 3];
+            corner( c ) = v++;
+        }
+    } );
+    ParallelFor( size_t( 0 ), numCorners, [&] ( size_t c )
+    {
+        if ( firstCorner[c] != c )
+            corner( c ) = corner( firstCorner[c] );
+    } );
+    return reportProgress( cb, 1.0f );
+}
+
+TEST( MRMesh, IdentifyVertices )
+{
+    // the soup is large enough for several blocks in radix sort
+    std::vector<Triangle3f> soup;
+    const int n = 150;
+    for ( int i = 0; i < n; ++i )
+        for ( int j = 0; j < n; ++j )
+        {
+            const Vector3f p00( float( i ), float( j ), float( ( i * j ) % 7 ) - 3.5f );
+            const Vector3f p10( float( i + 1 ), float( j ), float( ( ( i + 1 ) * j ) % 7 ) - 3.5f );
+            const Vector3f p01( float( i ), float( j + 1 ), float( ( i * ( j + 1 ) ) % 7 ) - 3.5f );
+            const Vector3f p11( float( i + 1 ), float( j + 1 ), float( ( ( i + 1 ) * ( j + 1 ) ) % 7 ) - 3.5f );
+            soup.push_back( { p00, p10, p11 } );
+            soup.push_back( { p00, p11, p01 } );
+        }
+
+    VertexIdentifier vi;
+    vi.reserve( soup.size() );
+    vi.addTriangles( soup );
+    const auto expectedT = vi.takeTriangulation();
+    const auto expectedPoints = vi.takePoints();
+    EXPECT_EQ( expectedPoints.size(), ( n + 1 ) * ( n + 1 ) );
+
+    Triangulation t;
+    VertCoords points;
+    EXPECT_TRUE( identifyVertices( soup, t, points ) );
+    EXPECT_EQ( t, expectedT );
+    EXPECT_EQ( points, expectedPoints );
+}
+
 } //namespace MeshBuilder
 
 } //namespace MR
@@ -4,6 +4,7 @@
 #include "MRVector3.h"
 #include "MRVector.h"
 #include "MRphmap.h"
+#include "MRProgressCallback.h"
 #include <cstring>
 
 namespace MR
@@ -52,6 +53,14 @@ private:
     VertCoords points_;
 };
 
+/// identifies vertices with bit-wise equal coordinates in whole triangle soup at once (as VertexIdentifier does it chunk by chunk):
+/// all triangle corners are sorted by the bits of their coordinates using parallel radix sort, which scales better than the hash map on huge soups;
+/// the vertices get ids in the order of their first appearance in the soup, the same as in VertexIdentifier
+/// \param t receives the triangulation with vertex ids
+/// \param points receives the coordinates of unique points in the order of vertex ids
+/// \return false if the operation was canceled
+MRMESH_API bool identifyVertices( const std::vector<Triangle3f> & soup, Triangulation & t, VertCoords & points, const ProgressCallback & cb = {} );
+
 } //namespace MeshBuilder
 
 } //namespace MR
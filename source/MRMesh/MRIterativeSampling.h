@@ -9,6 +9,7 @@ namespace MR
 
 /// performs sampling of cloud points by iteratively removing one point with minimal metric (describing distance to the closest point and previous nearby removals),
 /// thus allowing stopping at any given number of samples;
+/// the removal is sequential, so for big clouds consider parallel pointFarthestSampling from MRPoissonDiskSampling.h;
 /// returns std::nullopt if it was terminated by the callback
 MRMESH_API std::optional<VertBitSet> pointIterativeSampling( const PointCloud& cloud, int numSamples, const ProgressCallback & cb = {} );
 
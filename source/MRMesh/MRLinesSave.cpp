@@ -7,7 +7,9 @@
 #include "MRStreamOperators.h"
 #include "MRProgressReadWrite.h"
 #include "MRPch/MRFmt.h"
+#include <algorithm>
 #include <fstream>
+#include <iterator>
 
 namespace MR
 {
@@ -58,31 +60,34 @@ Expected<void> toPts( const Polyline3& polyline, const std::filesystem::path& fi
 
 Expected<void> toPts( const Polyline3& polyline, std::ostream& out, const SaveSettings & settings )
 {
-    float pointsNum{ 0.f };
-    auto contours = polyline.contours();
-    for ( const auto& contour : contours )
-        pointsNum += contour.size();
+    MR_TIMER
+    const auto contours = polyline.contours();
 
-    int pointIndex = 0;
+    // the index of the first point of each contour among all points
+    std::vector<size_t> contourStarts;
+    contourStarts.reserve( contours.size() + 1 );
+    contourStarts.push_back( 0 );
     for ( const auto& contour : contours )
+        contourStarts.push_back( contourStarts.back() + contour.size() );
+
+    if ( !writeTextByBlocks( out, contourStarts.back(), [&] ( size_t i, std::string& text )
     {
-        out << "BEGIN_Polyline\n";
-        for ( auto v : contour )
+        const size_t c = std::upper_bound( contourStarts.begin(), contourStarts.end(), i ) - contourStarts.begin() - 1;
+        const size_t j = i - contourStarts[c];
+        if ( j == 0 )
+            text += "BEGIN_Polyline\n";
+        auto saveVertex = [&]( auto && p )
         {
-            auto saveVertex = [&]( auto && p )
-            {
-                out << fmt::format( "{} {} {}\n", p.x, p.y, p.z );
-            };
-            if ( settings.xf )
-                saveVertex( applyDouble( settings.xf, v ) );
-            else
-                saveVertex( v );
-            ++pointIndex;
-            if ( settings.progress && !( pointIndex & 0x3FF ) && !settings.progress( float( pointIndex ) / pointsNum ) )
-                return unexpectedOperationCanceled();
-        }
-        out << "END_Polyline\n";
-    }
+            fmt::format_to( std::back_inserter( text ), "{} {} {}\n", p.x, p.y, p.z );
+        };
+        if ( settings.xf )
+            saveVertex( applyDouble( settings.xf, contours[c][j] ) );
+        else
+            saveVertex( contours[c][j] );
+        if ( j + 1 == contours[c].size() )
+            text += "END_Polyline\n";
+    }, settings.progress ) )
+        return unexpectedOperationCanceled();
 
     if ( !out )
         return unexpected( std::string( "Error saving in PTS-format" ) );
@@ -0,0 +1,77 @@
+#include "MRMappedFileRegion.h"
+#include "MRStringConvert.h"
+#include "MRPch/MRFmt.h"
+#include "MRPch/MRWinapi.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace MR
+{
+
+Expected<std::shared_ptr<const MappedFileRegion>> MappedFileRegion::map( const std::filesystem::path& file, size_t offset, size_t size )
+{
+    if ( size == 0 )
+        return unexpected( "Nothing to map in file " + utf8string( file ) );
+
+    std::error_code ec;
+    const auto fileSize = std::filesystem::file_size( file, ec );
+    if ( ec )
+        return unexpected( "Cannot get size of file " + utf8string( file ) );
+    if ( offset + size > fileSize )
+        return unexpected( fmt::format( "File {} is too short: {} bytes expected, {} bytes present", utf8string( file ), offset + size, fileSize ) );
+
+    std::shared_ptr<MappedFileRegion> res( new MappedFileRegion );
+#ifdef _WIN32
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo( &sysInfo );
+    const size_t viewOffset = offset - offset % sysInfo.dwAllocationGranularity;
+    res->viewSize_ = size + ( offset - viewOffset );
+
+    HANDLE hFile = CreateFileW( file.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( hFile == INVALID_HANDLE_VALUE )
+        return unexpected( "Cannot open file for reading " + utf8string( file ) );
+    HANDLE hMapping = CreateFileMappingW( hFile, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    CloseHandle( hFile );
+    if ( !hMapping )
+        return unexpected( "Cannot create mapping of file " + utf8string( file ) );
+    // the view keeps the mapping alive after closing its handle
+    res->view_ = MapViewOfFile( hMapping, FILE_MAP_READ, DWORD( uint64_t( viewOffset ) >> 32 ), DWORD( viewOffset & 0xFFFFFFFF ), res->viewSize_ );
+    CloseHandle( hMapping );
+    if ( !res->view_ )
+        return unexpected( "Cannot map file " + utf8string( file ) );
+#else
+    const size_t pageSize = size_t( sysconf( _SC_PAGESIZE ) );
+    const size_t viewOffset = offset - offset % pageSize;
+    res->viewSize_ = size + ( offset - viewOffset );
+
+    const int fd = open( file.c_str(), O_RDONLY );
+    if ( fd < 0 )
+        return unexpected( "Cannot open file for reading " + utf8string( file ) );
+    // the mapping stays valid after closing the file descriptor
+    void* view = mmap( nullptr, res->viewSize_, PROT_READ, MAP_SHARED, fd, off_t( viewOffset ) );
+    close( fd );
+    if ( view == MAP_FAILED )
+        return unexpected( "Cannot map file " + utf8string( file ) );
+    res->view_ = view;
+#endif
+    res->data_ = ( const char* )res->view_ + ( offset - viewOffset );
+    res->size_ = size;
+    return res;
+}
+
+MappedFileRegion::~MappedFileRegion()
+{
+    if ( !view_ )
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile( view_ );
+#else
+    munmap( view_, viewSize_ );
+#endif
+}
+
+} //namespace MR
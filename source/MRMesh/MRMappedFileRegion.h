@@ -0,0 +1,40 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRExpected.h"
+#include <filesystem>
+#include <memory>
+
+namespace MR
+{
+
+/// read-only region of a file mapped in the address space of the process:
+/// the pages are read from the disk by the operating system on first access, and can be evicted from memory when not used
+class MappedFileRegion
+{
+public:
+    /// maps (size) bytes of given file starting from (offset)
+    [[nodiscard]] MRMESH_API static Expected<std::shared_ptr<const MappedFileRegion>> map( const std::filesystem::path& file, size_t offset, size_t size );
+
+    MRMESH_API ~MappedFileRegion();
+    MappedFileRegion( const MappedFileRegion& ) = delete;
+    MappedFileRegion& operator =( const MappedFileRegion& ) = delete;
+
+    /// the first mapped byte of the file, corresponding to (offset) given in map
+    [[nodiscard]] const char* data() const { return data_; }
+
+    /// the number of mapped bytes
+    [[nodiscard]] size_t size() const { return size_; }
+
+private:
+    MappedFileRegion() = default;
+
+    /// the beginning of the mapping, aligned on the boundary required by the operating system
+    void* view_ = nullptr;
+    size_t viewSize_ = 0;
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} //namespace MR
@@ -1223,6 +1223,14 @@ const AABBTree & Mesh::getAABBTree() const
     return res;
 }
 
+void Mesh::setAABBTree( AABBTree && tree )
+{
+    assert( tree.numLeaves() == topology.numValidFaces() );
+    AABBTreeOwner_.reset();
+    dipolesOwner_.reset();
+    AABBTreeOwner_.getOrCreate( [&tree] { return std::move( tree ); } );
+}
+
 const AABBTreePoints & Mesh::getAABBTreePoints() const 
 { 
     const auto & res = AABBTreePointsOwner_.getOrCreate( [this]{ return AABBTreePoints( *this ); } );
@@ -459,6 +459,10 @@ struct [[nodiscard]] Mesh
     /// returns cached aabb-tree for this mesh, but does not create it if it did not exist
     [[nodiscard]] const AABBTree * getAABBTreeNotCreate() const { return AABBTreeOwner_.get(); }
 
+    /// replaces cached aabb-tree for this mesh with given one (e.g. loaded from a file together with the mesh),
+    /// which must be built for current mesh geometry and topology
+    MRMESH_API void setAABBTree( AABBTree && tree );
+
     /// returns cached aabb-tree for points of this mesh, creating it if it did not exist in a thread-safe manner
     MRMESH_API const AABBTreePoints & getAABBTreePoints() const;
 
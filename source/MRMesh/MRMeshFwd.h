@@ -127,6 +127,8 @@ class ViewportMask;
 struct UnorientedTriangle;
 struct SomeLocalTriangulations;
 struct AllLocalTriangulations;
+struct PointNeighborsSettings;
+struct PointNeighbors;
 
 using EdgePath = std::vector<EdgeId>;
 using EdgeLoop = std::vector<EdgeId>;
@@ -8,6 +8,9 @@
 #include "MRIOFormatsRegistry.h"
 #include "MRStringConvert.h"
 #include "MRMeshLoadObj.h"
+#include "MRMrmesh2.h"
+#include "MRMappedFileRegion.h"
+#include "MRPly.h"
 #include "MRObjectMesh.h"
 #include "MRObjectsAccess.h"
 #include "MRColor.h"
@@ -19,6 +22,7 @@
 #include "MRPch/MRTBB.h"
 
 #include <array>
+#include <cstring>
 #include <future>
 
 namespace MR
@@ -123,12 +127,20 @@ Expected<Mesh> fromMrmesh( const std::filesystem::path& file, const MeshLoadSett
     if ( !in )
         return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
 
+    if ( isMrmesh2( in ) )
+    {
+        in.close();
+        return fromMrmesh2( file, settings );
+    }
+
     return addFileNameInError( fromMrmesh( in, settings ), file );
 }
 
 Expected<Mesh> fromMrmesh( std::istream& in, const MeshLoadSettings& settings /*= {}*/ )
 {
     MR_TIMER
+    if ( isMrmesh2( in ) )
+        return fromMrmesh2( in, settings );
 
     Mesh mesh;
     auto readRes = mesh.topology.read( in, subprogress( settings.callback, 0.f, 0.5f) );
@@ -324,13 +336,88 @@ Expected<Mesh> fromObj( std::istream& in, const MeshLoadSettings& settings /*= {
     return std::move( r.mesh );
 }
 
+namespace
+{
+
+#pragma pack(push, 1)
+struct StlTriangle
+{
+    Vector3f normal;
+    Vector3f vert[3];
+    std::uint16_t attr;
+};
+#pragma pack(pop)
+static_assert( sizeof( StlTriangle ) == 50, "check your padding" );
+
+/// makes mesh from the triangles of binary STL located in memory
+Expected<Mesh> fromBinaryStlTriangles( const char* data, std::uint32_t numTris, const MeshLoadSettings& settings )
+{
+    MR_TIMER
+    std::vector<Triangle3f> soup( numTris );
+    if ( !ParallelFor( size_t( 0 ), soup.size(), [&] ( size_t i )
+    {
+        // the triangles in the file are not aligned
+        std::memcpy( soup[i].data(), data + i * sizeof( StlTriangle ) + offsetof( StlTriangle, vert ), sizeof( StlTriangle::vert ) );
+    }, subprogress( settings.callback, 0.0f, 0.2f ) ) )
+        return unexpectedOperationCanceled();
+
+    Triangulation t;
+    VertCoords points;
+    if ( !MeshBuilder::identifyVertices( soup, t, points, subprogress( settings.callback, 0.2f, 0.5f ) ) )
+        return unexpectedOperationCanceled();
+    soup = {};
+
+    std::vector<MeshBuilder::VertDuplication> dups;
+    const auto res = Mesh::fromTrianglesDuplicatingNonManifoldVertices( std::move( points ), t,
+        settings.duplicatedVertexCount ? &dups : nullptr, { .skippedFaceCount = settings.skippedFaceCount } );
+    if ( settings.duplicatedVertexCount )
+        *settings.duplicatedVertexCount = int( dups.size() );
+    if ( !reportProgress( settings.callback, 1.0f ) )
+        return unexpectedOperationCanceled();
+    return res;
+}
+
+/// loads binary STL by memory mapping the file, without file name in the error
+Expected<Mesh> fromMappedBinaryStl( const std::filesystem::path& file, const MeshLoadSettings& settings )
+{
+    MR_TIMER
+    constexpr size_t cHeaderSize = 80 + sizeof( std::uint32_t );
+    std::error_code ec;
+    const auto fileSize = std::filesystem::file_size( file, ec );
+    if ( ec )
+        return unexpected( std::string( "Cannot get size of file " ) + utf8string( file ) );
+    if ( fileSize < cHeaderSize )
+        return unexpected( std::string( "Error reading the number of triangles from STL-file" ) );
+
+    auto region = MappedFileRegion::map( file, 0, fileSize );
+    if ( !region )
+        return unexpected( std::move( region.error() ) );
+    const char* data = ( *region )->data();
+
+    std::uint32_t numTris;
+    std::memcpy( &numTris, data + 80, sizeof( numTris ) );
+    if ( fileSize - cHeaderSize < sizeof( StlTriangle ) * size_t( numTris ) )
+        return unexpected( std::string( "Binary STL-file is too short" ) );
+
+    return fromBinaryStlTriangles( data + cHeaderSize, numTris, settings );
+}
+
+} //anonymous namespace
+
 Expected<MR::Mesh> fromAnyStl( const std::filesystem::path& file, const MeshLoadSettings& settings /*= {}*/ )
 {
+    auto resBin = fromMappedBinaryStl( file, settings );
+    if ( resBin.has_value() || resBin.error() == stringOperationCanceled() )
+        return resBin;
+
     std::ifstream in( file, std::ifstream::binary );
     if ( !in )
         return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
 
-    return addFileNameInError( fromAnyStl( in, settings ), file );
+    auto resAsc = fromASCIIStl( in, settings );
+    if ( resAsc.has_value() )
+        return resAsc;
+    return unexpected( resBin.error() + '\n' + resAsc.error() + ": " + utf8string( file ) );
 }
 
 Expected<MR::Mesh> fromAnyStl( std::istream& in, const MeshLoadSettings& settings /*= {}*/ )
@@ -349,11 +436,7 @@ Expected<MR::Mesh> fromAnyStl( std::istream& in, const MeshLoadSettings& setting
 
 Expected<Mesh> fromBinaryStl( const std::filesystem::path & file, const MeshLoadSettings& settings /*= {}*/ )
 {
-    std::ifstream in( file, std::ifstream::binary );
-    if ( !in )
-        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
-
-    return addFileNameInError( fromBinaryStl( in, settings ), file );
+    return addFileNameInError( fromMappedBinaryStl( file, settings ), file );
 }
 
 Expected<Mesh> fromBinaryStl( std::istream& in, const MeshLoadSettings& settings /*= {}*/ )
@@ -375,16 +458,6 @@ Expected<Mesh> fromBinaryStl( std::istream& in, const MeshLoadSettings& settings
     MeshBuilder::VertexIdentifier vi;
     vi.reserve( numTris );
 
-    #pragma pack(push, 1)
-    struct StlTriangle
-    {
-        Vector3f normal;
-        Vector3f vert[3];
-        std::uint16_t attr;
-    };
-    #pragma pack(pop)
-    static_assert( sizeof( StlTriangle ) == 50, "check your padding" );
-
     const auto itemsInBuffer = std::min( numTris, 32768u );
     std::vector<StlTriangle> buffer( itemsInBuffer ), nextBuffer( itemsInBuffer );
     std::vector<Triangle3f> chunk( itemsInBuffer );
@@ -544,16 +617,63 @@ Expected<Mesh> fromASCIIStl( std::istream& in, const MeshLoadSettings& settings
     return res;
 }
 
-Expected<Mesh> fromPly( const std::filesystem::path& file, const MeshLoadSettings& settings /*= {}*/ )
+namespace
 {
-    std::ifstream in( file, std::ifstream::binary );
-    if ( !in )
-        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
 
-    return addFileNameInError( fromPly( in, settings ), file );
+/// loads mesh from PLY located in memory by parallel reader;
+/// returns nullopt if the layout of the file is not supported by it, and the sequential reader must be used
+Expected<std::optional<Mesh>> fromPlyParallel( const char* data, size_t size, const MeshLoadSettings& settings )
+{
+    PlyData ply;
+    const auto read = readPlyParallel( data, size, {
+        .normals = settings.normals != nullptr,
+        .colors = settings.colors != nullptr,
+        .uvCoords = settings.uvCoords != nullptr,
+        .faces = true,
+        .callback = subprogress( settings.callback, 0.0f, 0.3f )
+    }, ply );
+    if ( !read )
+        return unexpected( read.error() );
+    if ( !*read )
+        return std::optional<Mesh>{};
+
+    Mesh res;
+    res.points = std::move( ply.points );
+    if ( !ply.tris.empty() )
+    {
+        bool isCanceled = false;
+        const auto buildCb = subprogress( settings.callback, 0.3f, 1.0f );
+        ProgressCallback partedProgressCb = buildCb ? [&buildCb, &isCanceled] ( float v )
+        {
+            const bool res = buildCb( v );
+            isCanceled |= !res;
+            return res;
+        } : buildCb;
+
+        int mySkippedFaceCount = 0;
+        res.topology = MeshBuilder::fromTriangles( ply.tris, { .skippedFaceCount = settings.skippedFaceCount ? &mySkippedFaceCount : nullptr }, partedProgressCb );
+        if ( isCanceled )
+            return unexpectedOperationCanceled();
+        if ( res.topology.lastValidVert() + 1 > res.points.size() )
+            return unexpected( "vertex id is larger than total point coordinates" );
+        if ( settings.skippedFaceCount )
+            *settings.skippedFaceCount += mySkippedFaceCount;
+    }
+
+    if ( settings.normals && !ply.normals.empty() )
+        *settings.normals = std::move( ply.normals );
+    if ( settings.colors && !ply.colors.empty() )
+        *settings.colors = std::move( ply.colors );
+    if ( settings.uvCoords && !ply.uvCoords.empty() )
+        *settings.uvCoords = std::move( ply.uvCoords );
+
+    if ( !reportProgress( settings.callback, 1.0f ) )
+        return unexpectedOperationCanceled();
+    return res;
 }
 
-Expected<Mesh> fromPly( std::istream& in, const MeshLoadSettings& settings /*= {}*/ )
+/// loads mesh from PLY by sequential reader supporting any layout of the file
+Expected<Mesh> fromPlySequential( std::istream& in, const MeshLoadSettings& settings )
 {
     MR_TIMER
 
@@ -595,6 +715,12 @@ Expected<Mesh> fromPly( std::istream& in, const MeshLoadSettings& settings /*= {
                 colorsBuffer.resize( 3 * numVerts );
                 reader.extract_properties( indecies, 3, miniply::PLYPropertyType::UChar, colorsBuffer.data() );
             }
+            if ( settings.uvCoords && reader.find_texcoord( indecies ) )
+            {
+                Timer t( "extractUVCoords" );
+                settings.uvCoords->resize( numVerts );
+                reader.extract_properties( indecies, 2, miniply::PLYPropertyType::Float, settings.uvCoords->data() );
+            }
             const float progress = float( in.tellg() - posStart ) / streamSize;
             if ( !reportProgress( settings.callback, progress ) )
                 return unexpectedOperationCanceled();
@@ -666,6 +792,54 @@ Expected<Mesh> fromPly( std::istream& in, const MeshLoadSettings& settings /*= {
     return res;
 }
 
+} //anonymous namespace
+
+Expected<Mesh> fromPly( const std::filesystem::path& file, const MeshLoadSettings& settings /*= {}*/ )
+{
+    MR_TIMER
+
+    std::error_code ec;
+    const auto fileSize = std::filesystem::file_size( file, ec );
+    if ( !ec && fileSize > 0 )
+    {
+        if ( auto region = MappedFileRegion::map( file, 0, fileSize ) )
+        {
+            auto res = fromPlyParallel( ( *region )->data(), ( *region )->size(), settings );
+            if ( !res )
+                return unexpected( res.error() + ": " + utf8string( file ) );
+            if ( *res )
+                return std::move( **res );
+        }
+    }
+
+    std::ifstream in( file, std::ifstream::binary );
+    if ( !in )
+        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+
+    return addFileNameInError( fromPlySequential( in, settings ), file );
+}
+
+Expected<Mesh> fromPly( std::istream& in, const MeshLoadSettings& settings /*= {}*/ )
+{
+    MR_TIMER
+
+    const auto posStart = in.tellg();
+    {
+        auto buf = readCharBuffer( in );
+        if ( !buf )
+            return unexpected( std::move( buf.error() ) );
+        auto res = fromPlyParallel( buf->data(), buf->size(), settings );
+        if ( !res )
+            return unexpected( std::move( res.error() ) );
+        if ( *res )
+            return std::move( **res );
+    }
+
+    in.clear();
+    in.seekg( posStart );
+    return fromPlySequential( in, settings );
+}
+
 Expected<Mesh> fromDxf( const std::filesystem::path& path, const MeshLoadSettings& settings /*= {}*/ )
 {
     std::ifstream in( path, std::ifstream::binary );
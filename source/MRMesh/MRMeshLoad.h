@@ -83,10 +83,10 @@ namespace MeshLoad
 /// \ingroup IOGroup
 /// \{
 
-/// loads mesh from file in internal MeshLib format
+/// loads mesh from file in internal MeshLib format of any version, the file of version 2 is memory mapped (see fromMrmesh2)
 MRMESH_API Expected<Mesh> fromMrmesh( const std::filesystem::path& file, const MeshLoadSettings& settings = {} );
 
-/// loads mesh from stream in internal MeshLib format;
+/// loads mesh from stream in internal MeshLib format of any version;
 /// important on Windows: in stream must be open in binary mode
 MRMESH_API Expected<Mesh> fromMrmesh( std::istream& in, const MeshLoadSettings& settings = {} );
 
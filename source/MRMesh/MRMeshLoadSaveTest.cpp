@@ -2,7 +2,17 @@
 #include "MRMeshSave.h"
 #include "MRMesh.h"
 #include "MRBox.h"
+#include "MRColor.h"
+#include "MRCube.h"
+#include "MRUniqueTemporaryFolder.h"
 #include "MRGTest.h"
+#include "MRPointCloud.h"
+#include "MRPointsLoad.h"
+#include "MRPointsSave.h"
+#include "MRProgressReadWrite.h"
+#include "MRPch/MRFmt.h"
+
+#include <fstream>
 
 namespace MR
 {
@@ -74,6 +84,204 @@ TEST(MRMesh, LoadSave)
     EXPECT_EQ( loadRes->points.size(), 5 );
     EXPECT_EQ( loadRes->topology.numValidVerts(), 5 );
     EXPECT_EQ( loadRes->topology.numValidFaces(), 6 );
+
+    // memory mapped binary STL file gives the same mesh as the stream, and ASCII STL file is recognized too
+    UniqueTemporaryFolder folder( {} );
+    const auto binPath = folder / "binary.stl";
+    EXPECT_TRUE( MeshSave::toBinaryStl( *loadRes, binPath ).has_value() );
+    auto mappedRes = MeshLoad::fromAnyStl( binPath );
+    ASSERT_TRUE( mappedRes.has_value() );
+    EXPECT_EQ( mappedRes->topology, loadRes->topology );
+    EXPECT_EQ( mappedRes->points, loadRes->points );
+
+    const auto asciiPath = folder / "ascii.stl";
+    EXPECT_TRUE( MeshSave::toAsciiStl( *loadRes, asciiPath ).has_value() );
+    auto asciiRes = MeshLoad::fromAnyStl( asciiPath );
+    ASSERT_TRUE( asciiRes.has_value() );
+    EXPECT_EQ( asciiRes->topology.numValidFaces(), 6 );
+}
+
+TEST(MRMesh, WriteTextByBlocks)
+{
+    // many small blocks to have several batches written while the next ones are formatted
+    constexpr size_t numRecords = 100000;
+    std::string expected;
+    for ( size_t i = 0; i < numRecords; ++i )
+        if ( i % 3 != 0 )
+            expected += fmt::format( "{} {}\n", i, 0.1f * i );
+
+    std::ostringstream out;
+    EXPECT_TRUE( writeTextByBlocks( out, numRecords, [] ( size_t i, std::string& text )
+    {
+        if ( i % 3 != 0 )
+            fmt::format_to( std::back_inserter( text ), "{} {}\n", i, 0.1f * i );
+    }, {}, 7 ) );
+    EXPECT_EQ( out.str(), expected );
+
+    int numCalls = 0;
+    EXPECT_FALSE( writeTextByBlocks( out, numRecords, [] ( size_t, std::string& text ) { text += "x"; }, [&] ( float ) { return ++numCalls < 2; }, 7 ) );
+}
+
+TEST(MRMesh, LoadPointsText)
+{
+    std::istringstream text(
+        "# comment\n"
+        "1 2 3 0 0 1 255 0 0\n"
+        "4,5,6,0,1,0,0,255,0\n"
+        "\n"
+        "7 8 9 1 0 0 0 0 255\n" );
+    VertColors colors;
+    auto cloud = PointsLoad::fromText( text, { .colors = &colors } );
+    ASSERT_TRUE( cloud.has_value() ) << cloud.error();
+    EXPECT_EQ( cloud->validPoints.count(), 3 );
+    EXPECT_EQ( cloud->points[2_v], Vector3f( 4, 5, 6 ) );
+    EXPECT_EQ( cloud->normals[4_v], Vector3f( 1, 0, 0 ) );
+    EXPECT_EQ( colors[4_v], Color( 0, 0, 255 ) );
+
+    std::istringstream pts(
+        "3\n"
+        "0 0 0 0 0 0 0\n"
+        "1 1 1 0 10 20 30\n"
+        "2 3 4 0 40 50 60\n" );
+    auto ptsCloud = PointsLoad::fromPts( pts, { .colors = &colors } );
+    ASSERT_TRUE( ptsCloud.has_value() );
+    ASSERT_EQ( ptsCloud->points.size(), 2 );
+    EXPECT_EQ( ptsCloud->points[1_v], Vector3f( 1, 2, 3 ) );
+    EXPECT_EQ( colors[1_v].g, 50 );
+}
+
+TEST(MRMesh, LoadSavePly)
+{
+    const Mesh cube = makeCube();
+    VertNormals normals( cube.points.size() );
+    VertColors colors( cube.points.size() );
+    VertUVCoords uvs( cube.points.size() );
+    for ( auto v : cube.topology.getValidVerts() )
+    {
+        normals[v] = cube.points[v].normalized();
+        colors[v] = Color( 10 * int( v ), 255 - int( v ), 128 );
+        uvs[v] = UVCoord( 0.1f * int( v ), 1.0f - 0.1f * int( v ) );
+    }
+
+    // binary file written in parallel is read by parallel reader both from file and from stream
+    UniqueTemporaryFolder folder( {} );
+    const auto path = folder / "cube.ply";
+    EXPECT_TRUE( MeshSave::toPly( cube, path, { .colors = &colors, .uvMap = &uvs, .normals = &normals } ).has_value() );
+    std::ifstream in( path, std::ifstream::binary );
+    std::stringstream ss;
+    ss << in.rdbuf();
+    for ( int i = 0; i < 2; ++i )
+    {
+        VertNormals loadedNormals;
+        VertColors loadedColors;
+        VertUVCoords loadedUVs;
+        const MeshLoadSettings settings{ .colors = &loadedColors, .uvCoords = &loadedUVs, .normals = &loadedNormals };
+        auto loadRes = i == 0 ? MeshLoad::fromPly( path, settings ) : MeshLoad::fromPly( ss, settings );
+        ASSERT_TRUE( loadRes.has_value() );
+        EXPECT_EQ( loadRes->topology, cube.topology );
+        EXPECT_EQ( loadRes->points, cube.points );
+        EXPECT_EQ( loadedNormals, normals );
+        EXPECT_EQ( loadedColors, colors );
+        EXPECT_EQ( loadedUVs, uvs );
+    }
+
+    // point cloud with normals and colors
+    PointCloud cloud;
+    cloud.points = cube.points;
+    cloud.normals = normals;
+    cloud.validPoints.resize( cloud.points.size(), true );
+    cloud.validPoints.reset( 3_v );
+    std::stringstream cloudStream;
+    EXPECT_TRUE( PointsSave::toPly( cloud, cloudStream, { .colors = &colors } ).has_value() );
+    VertColors cloudColors;
+    auto cloudRes = PointsLoad::fromPly( cloudStream, { .colors = &cloudColors } );
+    ASSERT_TRUE( cloudRes.has_value() );
+    ASSERT_EQ( cloudRes->points.size(), cloud.points.size() - 1 );
+    ASSERT_EQ( cloudRes->normals.size(), cloud.points.size() - 1 );
+    ASSERT_EQ( cloudColors.size(), cloud.points.size() - 1 );
+    EXPECT_EQ( cloudRes->points[3_v], cloud.points[4_v] );
+    EXPECT_EQ( cloudRes->normals[3_v], cloud.normals[4_v] );
+    EXPECT_EQ( cloudColors[3_v], colors[4_v] );
+
+    // ASCII file with extra properties and elements
+    std::string ascii =
+        "ply\n"
+        "format ascii 1.0\n"
+        "comment test\n"
+        "element material 1\n"
+        "property uchar ambient\n"
+        "element vertex 4\n"
+        "property float x\nproperty float y\nproperty float z\n"
+        "property int flags\n"
+        "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+        "element face 2\n"
+        "property list uchar int vertex_indices\n"
+        "property int faceFlags\n"
+        "end_header\n"
+        "7\n"
+        "0 0 0 1 255 0 0\n"
+        "1 0 0 1 0 255 0\n"
+        "1 1 0 1 0 0 255\n"
+        "0 1 0 1 1 2 3\n"
+        "3 0 1 2 5\n"
+        "3 0 2 3 5\n";
+    std::istringstream asciiIn( ascii );
+    VertColors asciiColors;
+    auto asciiRes = MeshLoad::fromPly( asciiIn, { .colors = &asciiColors } );
+    ASSERT_TRUE( asciiRes.has_value() );
+    EXPECT_EQ( asciiRes->topology.numValidFaces(), 2 );
+    EXPECT_EQ( asciiRes->points.size(), 4 );
+    EXPECT_EQ( asciiRes->points[2_v], Vector3f( 1, 1, 0 ) );
+    ASSERT_EQ( asciiColors.size(), 4 );
+    EXPECT_EQ( asciiColors[1_v], Color( 0, 255, 0 ) );
+
+    // a quad is not supported by parallel reader, and it is triangulated by sequential one
+    std::string quad =
+        "ply\n"
+        "format ascii 1.0\n"
+        "element vertex 4\n"
+        "property float x\nproperty float y\nproperty float z\n"
+        "element face 1\n"
+        "property list uchar int vertex_indices\n"
+        "end_header\n"
+        "0 0 0\n1 0 0\n1 1 0\n0 1 0\n"
+        "4 0 1 2 3\n";
+    std::istringstream quadIn( quad );
+    auto quadRes = MeshLoad::fromPly( quadIn );
+    ASSERT_TRUE( quadRes.has_value() );
+    EXPECT_EQ( quadRes->topology.numValidFaces(), 2 );
+
+    // vertex indices out of range are rejected both in ASCII and in binary files
+    for ( int badIndex : { 3, -1 } )
+    {
+        std::istringstream badAsciiIn(
+            "ply\n"
+            "format ascii 1.0\n"
+            "element vertex 3\n"
+            "property float x\nproperty float y\nproperty float z\n"
+            "element face 1\n"
+            "property list uchar int vertex_indices\n"
+            "end_header\n"
+            "0 0 0\n1 0 0\n1 1 0\n"
+            "3 0 1 " + std::to_string( badIndex ) + "\n" );
+        EXPECT_FALSE( MeshLoad::fromPly( badAsciiIn ).has_value() );
+
+        std::string badBinary =
+            "ply\n"
+            "format binary_little_endian 1.0\n"
+            "element vertex 3\n"
+            "property float x\nproperty float y\nproperty float z\n"
+            "element face 1\n"
+            "property list uchar int vertex_indices\n"
+            "end_header\n";
+        const float coords[9] = { 0, 0, 0, 1, 0, 0, 1, 1, 0 };
+        badBinary.append( ( const char* )coords, sizeof( coords ) );
+        badBinary.push_back( 3 );
+        const int indices[3] = { 0, 1, badIndex };
+        badBinary.append( ( const char* )indices, sizeof( indices ) );
+        std::istringstream badBinaryIn( badBinary );
+        EXPECT_FALSE( MeshLoad::fromPly( badBinaryIn ).has_value() );
+    }
 }
 
 } //namespace MR
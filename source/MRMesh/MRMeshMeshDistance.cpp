@@ -8,8 +8,14 @@
 #include "MRRegionBoundary.h"
 #include "MRBitSetParallelFor.h"
 #include "MRRingIterator.h"
+#include "MRMeshProject.h"
+#include "MRParallelFor.h"
+#include "MRTorus.h"
 #include "MRGTest.h"
 #include "MRPch/MRTBB.h"
+#include <atomic>
+#include <mutex>
+#include <optional>
 
 namespace MR
 {
@@ -264,44 +270,170 @@ MeshMeshSignedDistanceResult findSignedDistance( const MeshPart & a, const MeshP
     return (signedRes.signedDist > 0.0f) ? MeshMeshSignedDistanceResult{res.a, res.b, 0.0f} : signedRes;
 }
 
-MRMESH_API float findMaxDistanceSqOneWay( const MeshPart& a, const MeshPart& b, const AffineXf3f* rigidB2A, float maxDistanceSq )
+MeshMeshMaxDistanceResult findMaxDistanceOneWay( const MeshPart& a, const MeshPart& b, const AffineXf3f* rigidB2A, float maxDistanceSq, float relTolerance )
 {
     MR_TIMER;
+    assert( relTolerance >= 0 );
 
-    const auto& bMeshVerts = b.mesh.points;
-    auto vertBitSet = getIncidentVerts( b.mesh.topology, b.mesh.topology.getFaceIds( b.region ) );
-    if ( !vertBitSet.any() )
-        return 0.0f;
+    MeshMeshMaxDistanceResult res;
+    const AABBTree& bTree = b.mesh.getAABBTree();
+    a.mesh.getAABBTree(); // to build it before parallel region
+    if ( bTree.nodes().empty() )
+        return res;
 
-    return tbb::parallel_reduce
-    (
-        tbb::blocked_range( vertBitSet.find_first(), vertBitSet.find_last() + 1 ),
-        0.0f, 
-        [&] ( const tbb::blocked_range<VertId>& range, float init )
-        {
-        for ( VertId i = range.begin(); i < range.end(); ++i )
+    NodeBitSet bNodes;
+    if ( b.region )
+        bNodes = bTree.getNodesFromLeaves( *b.region );
+    auto validNode = [&]( NodeId n ) { return !b.region || bNodes.test( n ); };
+
+    const float tolFactor = 1 + relTolerance;
+    // the copy of res.distSq for reading without locking
+    std::atomic<float> bestDistSq{ 0.0f };
+    std::mutex resMutex;
+
+    // returns true if a point with given upper bound on its distance to A-mesh can increase the result enough
+    auto canImprove = [&]( float upDist )
+    {
+        const auto currSq = bestDistSq.load( std::memory_order_relaxed );
+        return currSq < maxDistanceSq && sqr( upDist ) > currSq * sqr( tolFactor );
+    };
+
+    auto processVert = [&]( VertId v, FaceId bFace )
+    {
+        const auto currSq = bestDistSq.load( std::memory_order_relaxed );
+        if ( currSq >= maxDistanceSq )
+            return;
+        const auto loDistLimitSq = currSq * sqr( tolFactor );
+        const auto proj = findProjection( rigidB2A ? ( *rigidB2A )( b.mesh.points[v] ) : b.mesh.points[v], a, maxDistanceSq, nullptr, loDistLimitSq );
+        if ( proj.distSq <= loDistLimitSq )
+            return;
+        std::lock_guard lock( resMutex );
+        if ( proj.distSq <= res.distSq )
+            return;
+        res.a = proj.proj;
+        res.b = PointOnFace{ bFace, b.mesh.points[v] };
+        res.distSq = proj.distSq;
+        bestDistSq.store( proj.distSq, std::memory_order_relaxed );
+    };
+
+    struct SubTask
+    {
+        NodeId n;
+        float upDist; ///< upper bound on the distance from any point inside the node's box to A-mesh
+    };
+
+    // finds the upper bound for a child node, given the bound of its parent
+    auto getSubTask = [&]( NodeId n, float parentUpDist )
+    {
+        SubTask s{ n, parentUpDist };
+        if ( !canImprove( parentUpDist ) )
+            return s;
+        const auto & box = bTree[n].box;
+        const float radius = 0.5f * box.diagonal();
+        const auto center = rigidB2A ? ( *rigidB2A )( box.center() ) : box.center();
+        // the search for the closest point to the center stops as soon as it proves that the node cannot improve the result
+        const float thresholdDist = std::sqrt( bestDistSq.load( std::memory_order_relaxed ) ) * tolFactor;
+        const float loDistLimitSq = thresholdDist > radius ? sqr( thresholdDist - radius ) : 0.0f;
+        const auto centerDistSq = findProjection( center, a, maxDistanceSq, nullptr, loDistLimitSq ).distSq;
+        s.upDist = std::min( parentUpDist, std::sqrt( centerDistSq ) + radius );
+        return s;
+    };
+
+    // descends the subtree of given node, processing the nodes with larger bound first
+    auto processSubtree = [&]( const SubTask & root )
+    {
+        std::vector<SubTask> subtasks{ root };
+        while ( !subtasks.empty() )
         {
-            if ( !vertBitSet.test( i ) )
+            const auto s = subtasks.back();
+            subtasks.pop_back();
+            if ( !canImprove( s.upDist ) )
+                continue;
+
+            const auto & node = bTree[s.n];
+            if ( node.leaf() )
+            {
+                const auto bFace = node.leafId();
+                for ( auto v : b.mesh.topology.getTriVerts( bFace ) )
+                    processVert( v, bFace );
                 continue;
+            }
 
-            auto distSq = findProjection( rigidB2A ? (*rigidB2A)( bMeshVerts[i] ) : bMeshVerts[i], a, maxDistanceSq ).distSq;
-            if ( distSq > init )
-                init = distSq;
-        }           
+            std::optional<SubTask> s1, s2;
+            if ( validNode( node.l ) )
+                s1 = getSubTask( node.l, s.upDist );
+            if ( validNode( node.r ) )
+                s2 = getSubTask( node.r, s.upDist );
+            if ( s1 && s2 && s1->upDist > s2->upDist )
+                std::swap( s1, s2 );
+            // add task with larger bound last to descend there first
+            if ( s1 )
+                subtasks.push_back( *s1 );
+            if ( s2 )
+                subtasks.push_back( *s2 );
+        }
+    };
 
-        return  init;
-        }, 
-        [] ( float a, float b ) -> float
+    // sequentially subdivide full task on smaller subtasks for parallel processing
+    std::vector<SubTask> subtasks, nextSubtasks;
+    if ( validNode( bTree.rootNodeId() ) )
+        subtasks.push_back( { bTree.rootNodeId(), FLT_MAX } );
+    for ( int i = 0; i < 8; ++i ) // 8 -> will produce at most 2^8 subtasks
+    {
+        nextSubtasks.clear();
+        for ( const auto & s : subtasks )
         {
-            return a > b ? a : b;
+            const auto & node = bTree[s.n];
+            if ( node.leaf() )
+            {
+                nextSubtasks.push_back( s );
+                continue;
+            }
+            if ( validNode( node.l ) )
+                nextSubtasks.push_back( { node.l, FLT_MAX } );
+            if ( validNode( node.r ) )
+                nextSubtasks.push_back( { node.r, FLT_MAX } );
         }
-    );
+        subtasks.swap( nextSubtasks );
+    }
+
+    // the subtasks with larger bounds are processed first to find large distances early and prune more
+    ParallelFor( subtasks, [&]( size_t i )
+    {
+        subtasks[i] = getSubTask( subtasks[i].n, FLT_MAX );
+    } );
+    std::sort( subtasks.begin(), subtasks.end(), []( const SubTask & x, const SubTask & y ) { return x.upDist > y.upDist; } );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, subtasks.size(), 1 ), [&]( const tbb::blocked_range<size_t>& range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+            processSubtree( subtasks[i] );
+    } );
+
+    return res;
 }
 
-float findMaxDistanceSq( const MeshPart& a, const MeshPart& b, const AffineXf3f* rigidB2A, float maxDistanceSq )
+MeshMeshMaxDistanceResult findMaxDistance( const MeshPart& a, const MeshPart& b, const AffineXf3f* rigidB2A, float maxDistanceSq, float relTolerance )
 {
+    MR_TIMER;
+    auto resAB = findMaxDistanceOneWay( a, b, rigidB2A, maxDistanceSq, relTolerance );
+    if ( resAB.distSq >= maxDistanceSq )
+        return resAB;
+
     std::unique_ptr<AffineXf3f> rigidA2B = rigidB2A ? std::make_unique<AffineXf3f>( rigidB2A->inverse() ) : nullptr;
-    return std::max( findMaxDistanceSqOneWay( a, b, rigidB2A, maxDistanceSq ), findMaxDistanceSqOneWay( b, a, rigidA2B.get(), maxDistanceSq ) );
+    auto resBA = findMaxDistanceOneWay( b, a, rigidA2B.get(), maxDistanceSq, relTolerance );
+    if ( resBA.distSq <= resAB.distSq )
+        return resAB;
+    return { .a = resBA.b, .b = resBA.a, .distSq = resBA.distSq };
+}
+
+float findMaxDistanceSqOneWay( const MeshPart& a, const MeshPart& b, const AffineXf3f* rigidB2A, float maxDistanceSq )
+{
+    return findMaxDistanceOneWay( a, b, rigidB2A, maxDistanceSq ).distSq;
+}
+
+float findMaxDistanceSq( const MeshPart& a, const MeshPart& b, const AffineXf3f* rigidB2A, float maxDistanceSq )
+{
+    return findMaxDistance( a, b, rigidB2A, maxDistanceSq ).distSq;
 }
 
 TEST(MRMesh, MeshDistance) 
@@ -322,4 +454,32 @@ TEST(MRMesh, MeshDistance)
     EXPECT_TRUE( dist12 > 0.9f && dist12 < 1.0f );
 }
 
+TEST( MRMesh, MeshMaxDistance )
+{
+    const auto torus = makeTorus( 1.0f, 0.3f, 32, 16 );
+    const auto bigTorus = makeTorus( 1.0f, 0.4f, 24, 12 );
+    const auto xf = AffineXf3f::translation( Vector3f( 0.05f, 0, 0.02f ) );
+
+    // reference: the projection of all vertices
+    float refDistSq = 0;
+    for ( auto v : bigTorus.topology.getValidVerts() )
+        refDistSq = std::max( refDistSq, findProjection( xf( bigTorus.points[v] ), torus ).distSq );
+
+    const auto res = findMaxDistanceOneWay( torus, bigTorus, &xf );
+    EXPECT_NEAR( res.distSq, refDistSq, 1e-6f );
+    EXPECT_TRUE( res.a.face.valid() );
+    EXPECT_TRUE( res.b.face.valid() );
+    EXPECT_NEAR( ( res.a.point - xf( res.b.point ) ).lengthSq(), res.distSq, 1e-5f );
+    EXPECT_EQ( findMaxDistanceSqOneWay( torus, bigTorus, &xf ), res.distSq );
+
+    const float relTolerance = 0.1f;
+    const auto approx = findMaxDistanceOneWay( torus, bigTorus, &xf, FLT_MAX, relTolerance );
+    EXPECT_LE( approx.distSq, refDistSq );
+    EXPECT_GE( approx.distSq * sqr( 1 + relTolerance ), refDistSq );
+
+    const auto twoWay = findMaxDistance( torus, bigTorus, &xf );
+    EXPECT_GE( twoWay.distSq, res.distSq );
+    EXPECT_EQ( findMaxDistanceSq( torus, bigTorus, &xf ), twoWay.distSq );
+}
+
 } //namespace MR
@@ -30,6 +30,15 @@ struct MeshMeshSignedDistanceResult
 };
 using MeshSignedDistanceResult [[deprecated]] = MeshMeshSignedDistanceResult;
 
+struct MeshMeshMaxDistanceResult
+{
+    /// the witness points of the maximal distance from meshes A and B respectively, each in the space of its mesh:
+    /// one point is a mesh vertex, and the other one is its projection on the other mesh (invalid if no projection was found within the limit)
+    PointOnFace a, b;
+    /// squared distance between a and b
+    float distSq = 0;
+};
+
 /**
  * \brief computes minimal distance between two meshes or two mesh regions
  * \param rigidB2A rigid transformation from B-mesh space to A mesh space, nullptr considered as identity transformation
@@ -53,6 +62,26 @@ MRMESH_API MeshMeshSignedDistanceResult findSignedDistance( const MeshPart & a,
  */
 MRMESH_API float findMaxDistanceSqOneWay( const MeshPart& a, const MeshPart& b, const AffineXf3f* rigidB2A = nullptr, float maxDistanceSq = FLT_MAX );
 
+/**
+ * \brief finds the B-mesh vertex with the maximal distance to A-mesh by a parallel branch-and-bound descent of B-mesh AABB tree:
+ *        the nodes of B-tree which points are surely not farther from A-mesh than the current maximum are skipped
+ * \param rigidB2A rigid transformation from B-mesh space to A mesh space, nullptr considered as identity transformation
+ * \param maxDistanceSq upper limit on the positive distance in question, if the real distance is larger than the function exists returning maxDistanceSq
+ * \param relTolerance if positive then the search can stop earlier returning the distance at least 1/(1+relTolerance) of the maximal one
+ */
+MRMESH_API MeshMeshMaxDistanceResult findMaxDistanceOneWay( const MeshPart& a, const MeshPart& b, const AffineXf3f* rigidB2A = nullptr,
+    float maxDistanceSq = FLT_MAX, float relTolerance = 0 );
+
+/**
+ * \brief finds the witness points of the Hausdorff distance between two meshes, that is
+          the maximum of distances from each mesh vertex to the other mesh (in both directions)
+ * \param rigidB2A rigid transformation from B-mesh space to A mesh space, nullptr considered as identity transformation
+ * \param maxDistanceSq upper limit on the positive distance in question, if the real distance is larger than the function exists returning maxDistanceSq
+ * \param relTolerance if positive then the search can stop earlier returning the distance at least 1/(1+relTolerance) of the maximal one
+ */
+MRMESH_API MeshMeshMaxDistanceResult findMaxDistance( const MeshPart& a, const MeshPart& b, const AffineXf3f* rigidB2A = nullptr,
+    float maxDistanceSq = FLT_MAX, float relTolerance = 0 );
+
 /**
  * \brief returns the squared Hausdorff distance between two meshes, that is
           the maximum of squared distances from each mesh vertex to the other mesh (in both directions)
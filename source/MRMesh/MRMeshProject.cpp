@@ -2,9 +2,12 @@
 #include "MRAABBTree.h"
 #include "MRMesh.h"
 #include "MRClosestPointInTriangle.h"
+#include "MRClosestPointInTriangleBatch.h"
 #include "MRBall.h"
 #include "MRTimer.h"
 #include "MRMatrix3Decompose.h"
+#include "MRGTest.h"
+#include <random>
 
 namespace MR
 {
@@ -45,8 +48,63 @@ MeshProjectionResult findProjectionSubtree( const Vector3f & pt, const MeshPart
         return SubTask( n, distSq );
     };
 
+    // the leaves are collected in the batch to compute the distances to their triangles together
+    TriangleBatch4 batch;
+
+    // returns true if the search shall be stopped
+    auto processBatch = [&]()
+    {
+        float distSq[TriangleBatch4::capacity], minDistSq[TriangleBatch4::capacity];
+        distanceSqToTriangles( pt, batch, distSq, minDistSq );
+        int order[TriangleBatch4::capacity];
+        for ( int i = 0; i < batch.size; ++i )
+        {
+            order[i] = i;
+            if ( !( distSq[i] >= 0 ) ) // NaN for degenerate triangle
+                distSq[i] = 0;
+        }
+        std::sort( order, order + batch.size, [&]( int x, int y ) { return distSq[x] < distSq[y]; } );
+
+        bool stop = false;
+        for ( int j = 0; j < batch.size; ++j )
+        {
+            const int i = order[j];
+            // float-precision distances are only good to skip the triangles, which are surely farther than current result
+            if ( batch.keys[i] >= res.distSq || minDistSq[i] >= res.distSq )
+                continue;
+            const auto face = batch.faces[i];
+            const Vector3f a( batch.ax[i], batch.ay[i], batch.az[i] );
+            const Vector3f b( batch.bx[i], batch.by[i], batch.bz[i] );
+            const Vector3f c( batch.cx[i], batch.cy[i], batch.cz[i] );
+
+            // compute the closest point in double-precision, because float might be not enough
+            const auto [projD, baryD] = closestPointInTriangle( Vector3d( pt ), Vector3d( a ), Vector3d( b ), Vector3d( c ) );
+            const Vector3f proj( projD );
+            const MeshProjectionResult candidate
+            {
+                .proj = PointOnFace{ face, proj },
+                .mtp = MeshTriPoint{ mp.mesh.topology.edgeWithLeft( face ), TriPointf( baryD ) },
+                .distSq = ( proj - pt ).lengthSq()
+            };
+            if ( validProjections && !validProjections( candidate ) )
+                continue;
+            if ( candidate.distSq < res.distSq )
+            {
+                res = candidate;
+                if ( res.distSq <= loDistLimitSq )
+                {
+                    stop = true;
+                    break;
+                }
+            }
+        }
+        batch.clear();
+        return stop;
+    };
+
     addSubTask( getSubTask( tree.rootNodeId() ) );
 
+    bool stopped = false;
     while( stackSize > 0 )
     {
         const auto s = subtasks[--stackSize];
@@ -69,27 +127,16 @@ MeshProjectionResult findProjectionSubtree( const Vector3f & pt, const MeshPart
                 b = (*xf)( b );
                 c = (*xf)( c );
             }
-            
-            // compute the closest point in double-precision, because float might be not enough
-            const auto [projD, baryD] = closestPointInTriangle( Vector3d( pt ), Vector3d( a ), Vector3d( b ), Vector3d( c ) );
-            const Vector3f proj( projD );
-            const MeshProjectionResult candidate
-            {
-                .proj = PointOnFace{ face, proj },
-                .mtp = MeshTriPoint{ mp.mesh.topology.edgeWithLeft( face ), TriPointf( baryD ) },
-                .distSq = ( proj - pt ).lengthSq()
-            };
-            if ( validProjections && !validProjections( candidate ) )
-                continue;
-            if ( candidate.distSq < res.distSq )
-            {
-                res = candidate;
-                if ( res.distSq <= loDistLimitSq )
-                    break;
-            }
+            batch.push( face, a, b, c, s.distSq );
+            if ( batch.full() && ( stopped = processBatch() ) )
+                break;
             continue;
         }
-        
+
+        // until the first projection is found, there is no upper bound to prune the nodes
+        if ( !batch.empty() && !res.proj.face && ( stopped = processBatch() ) )
+            break;
+
         auto s1 = getSubTask( node.l );
         auto s2 = getSubTask( node.r );
         // add task with smaller distance last to descend there first
@@ -104,6 +151,8 @@ MeshProjectionResult findProjectionSubtree( const Vector3f & pt, const MeshPart
             addSubTask( s2 );
         }
     }
+    if ( !stopped && !batch.empty() )
+        processBatch();
 
     return res;
 }
@@ -224,4 +273,102 @@ std::optional<SignedDistanceToMeshResult> findSignedDistance( const Vector3f & p
     return res;
 }
 
+TEST( MRMesh, DistanceSqToTriangles )
+{
+    std::mt19937 gen( 0 );
+    std::uniform_real_distribution<float> distr( -1.0f, 1.0f );
+    auto rnd = [&]() { return Vector3f( distr( gen ), distr( gen ), distr( gen ) ); };
+    // 0 - well-shaped triangles, 1 - slivers, 2 - needles, 3 - tiny triangles far from the origin
+    for ( int kind = 0; kind < 4; ++kind )
+    for ( int n = 0; n < 1000; ++n )
+    {
+        TriangleBatch4 batch;
+        Vector3f tris[TriangleBatch4::capacity][3];
+        for ( auto & t : tris )
+        {
+            t[0] = rnd(); t[1] = rnd(); t[2] = rnd();
+            if ( kind == 1 ) // third vertex is almost on the line of first two
+                t[2] = t[0] + ( 0.5f + 0.5f * distr( gen ) ) * ( t[1] - t[0] ) + 1e-5f * rnd();
+            else if ( kind == 2 ) // second and third vertices are almost coincident
+                t[2] = t[1] + 1e-5f * rnd();
+            else if ( kind == 3 )
+            {
+                const auto shift = 100.0f * rnd();
+                for ( auto & v : t )
+                    v = shift + 1e-3f * v;
+            }
+            batch.push( FaceId( batch.size ), t[0], t[1], t[2] );
+        }
+        const auto p = kind == 3 ? tris[0][0] + 1e-3f * rnd() : 2.0f * rnd();
+        float distSq[TriangleBatch4::capacity], minDistSq[TriangleBatch4::capacity];
+        float distSqScalar[TriangleBatch4::capacity], minDistSqScalar[TriangleBatch4::capacity];
+        distanceSqToTriangles( p, batch, distSq, minDistSq );
+        distanceSqToTrianglesScalar( p, batch, distSqScalar, minDistSqScalar );
+        for ( int i = 0; i < TriangleBatch4::capacity; ++i )
+        {
+            const auto [proj, bary] = closestPointInTriangle( Vector3d( p ), Vector3d( tris[i][0] ), Vector3d( tris[i][1] ), Vector3d( tris[i][2] ) );
+            const auto refDistSq = ( proj - Vector3d( p ) ).lengthSq();
+            // the lower bounds must hold for any triangle
+            EXPECT_LE( minDistSq[i], refDistSq * ( 1 + 1e-6 ) );
+            EXPECT_LE( minDistSqScalar[i], refDistSq * ( 1 + 1e-6 ) );
+            if ( kind == 0 )
+            {
+                EXPECT_NEAR( distSq[i], refDistSq, 1e-5f * ( 1 + refDistSq ) );
+                EXPECT_NEAR( distSqScalar[i], refDistSq, 1e-5f * ( 1 + refDistSq ) );
+            }
+        }
+    }
+}
+
+TEST( MRMesh, FindProjectionSlivers )
+{
+    // each query point is near a separate thin triangle and a bit farther from a well-shaped one,
+    // so skipping the thin triangle because of rounding errors finds the wrong projection
+    std::mt19937 gen( 0 );
+    std::uniform_real_distribution<float> distr( -1.0f, 1.0f );
+    auto rnd = [&]() { return Vector3f( distr( gen ), distr( gen ), distr( gen ) ); };
+    const int n = 1000;
+    std::vector<Vector3f> points, queries;
+    Triangulation t;
+    for ( int i = 0; i < n; ++i )
+    {
+        const auto a = rnd();
+        const auto b = a + 0.1f * rnd();
+        const auto c = a + ( 0.5f + 0.5f * distr( gen ) ) * ( b - a ) + 1e-6f * rnd();
+        const auto q = 0.5f * ( a + b ) + 1e-4f * rnd();
+        queries.push_back( q );
+        const VertId v( (int)points.size() );
+        points.push_back( a );
+        points.push_back( b );
+        points.push_back( c );
+        t.push_back( { v, v + 1, v + 2 } );
+        points.push_back( q + Vector3f( 2e-3f, 0, 0 ) );
+        points.push_back( q + Vector3f( 0, 2e-3f, 0 ) );
+        points.push_back( q + Vector3f( 0, 0, 2e-3f ) );
+        t.push_back( { v + 3, v + 4, v + 5 } );
+    }
+    const auto mesh = Mesh::fromTriangles( std::move( points ), t );
+
+    auto exactDistSq = [&]( const Vector3f & p, FaceId f )
+    {
+        Vector3f a, b, c;
+        mesh.getTriPoints( f, a, b, c );
+        const auto [proj, bary] = closestPointInTriangle( Vector3d( p ), Vector3d( a ), Vector3d( b ), Vector3d( c ) );
+        return ( proj - Vector3d( p ) ).lengthSq();
+    };
+
+    for ( const auto & p : queries )
+    {
+        const auto res = findProjection( p, mesh );
+        ASSERT_TRUE( res.proj.face.valid() );
+
+        // exhaustive search in double precision
+        double refDistSq = DBL_MAX;
+        for ( auto f : mesh.topology.getValidFaces() )
+            refDistSq = std::min( refDistSq, exactDistSq( p, f ) );
+        // the found triangle can be worse than the closest one only by the rounding of the projection point to float
+        EXPECT_NEAR( std::sqrt( exactDistSq( p, res.proj.face ) ), std::sqrt( refDistSq ), 1e-6 );
+    }
+}
+
 } //namespace MR
@@ -10,6 +10,9 @@
 #include "MRMeshTexture.h"
 #include "MRImageSave.h"
 
+#include <cstring>
+#include <iterator>
+
 namespace MR
 {
 
@@ -66,39 +69,34 @@ Expected<void> toOff( const Mesh& mesh, std::ostream& out, const SaveSettings &
     const int numPolygons = mesh.topology.numValidFaces();
 
     out << "OFF\n" << numPoints << ' ' << numPolygons << " 0\n\n";
-    int numSaved = 0;
-    for ( VertId i{ 0 }; i <= lastVertId; ++i )
+    if ( !writeTextByBlocks( out, size_t( lastVertId + 1 ), [&] ( size_t i, std::string& text )
     {
-        if ( settings.saveValidOnly && !mesh.topology.hasVert( i ) )
-            continue;
+        const VertId v( i );
+        if ( settings.saveValidOnly && !mesh.topology.hasVert( v ) )
+            return;
         auto saveVertex = [&]( auto && p )
         {
-            out << fmt::format( "{} {} {}\n", p.x, p.y, p.z );
+            fmt::format_to( std::back_inserter( text ), "{} {} {}\n", p.x, p.y, p.z );
         };
         if ( settings.xf )
-            saveVertex( applyDouble( settings.xf, mesh.points[i] ) );
+            saveVertex( applyDouble( settings.xf, mesh.points[v] ) );
         else
-            saveVertex( mesh.points[i] );
-        ++numSaved;
-        if ( settings.progress && !( numSaved & 0x3FF ) && !settings.progress( float( numSaved ) / numPoints * 0.5f ) )
-            return unexpectedOperationCanceled();
-    }
+            saveVertex( mesh.points[v] );
+    }, subprogress( settings.progress, 0.0f, 0.5f ) ) )
+        return unexpectedOperationCanceled();
     out << '\n';
 
-    const float facesNum = float( mesh.topology.edgePerFace().size() );
-    size_t faceIndex = 0;
-    for ( const auto& e : mesh.topology.edgePerFace() )
+    const auto& edgePerFace = mesh.topology.edgePerFace();
+    if ( !writeTextByBlocks( out, edgePerFace.size(), [&] ( size_t i, std::string& text )
     {
-        ++faceIndex;
-        if ( settings.progress && !( faceIndex & 0x3FF ) && !settings.progress( float( faceIndex ) / facesNum * 0.5f + 0.5f ) )
-            return unexpectedOperationCanceled();
+        const auto e = edgePerFace[FaceId( i )];
         if ( !e.valid() )
-            continue;
-
+            return;
         VertId a, b, c;
         mesh.topology.getLeftTriVerts( e, a, b, c );
-        out << fmt::format( "3 {} {} {}\n", vertRenumber( a ), vertRenumber( b ), vertRenumber( c ) );
-    }
+        fmt::format_to( std::back_inserter( text ), "3 {} {} {}\n", vertRenumber( a ), vertRenumber( b ), vertRenumber( c ) );
+    }, subprogress( settings.progress, 0.5f, 1.0f ) ) )
+        return unexpectedOperationCanceled();
 
     if ( !out )
         return unexpected( std::string( "Error saving in OFF-format" ) );
@@ -144,77 +142,65 @@ Expected<void> toObj( const Mesh & mesh, std::ostream & out, const SaveSettings
         out << fmt::format( "mtllib {}.mtl\n", settings.materialName );
 
     const VertRenumber vertRenumber( mesh.topology.getValidVerts(), settings.saveValidOnly );
-    const int numPoints = vertRenumber.sizeVerts();
     const VertId lastVertId = mesh.topology.lastValidVert();
 
-    int numSaved = 0;
-    auto sb = subprogress( settings.progress, 0.0f, settings.uvMap ? 0.35f : 0.5f );
-    for ( VertId i{ 0 }; i <= lastVertId; ++i )
+    if ( !writeTextByBlocks( out, size_t( lastVertId + 1 ), [&] ( size_t i, std::string& text )
     {
-        if ( settings.saveValidOnly && !mesh.topology.hasVert( i ) )
-            continue;
-
+        const VertId v( i );
+        if ( settings.saveValidOnly && !mesh.topology.hasVert( v ) )
+            return;
         auto saveVertex = [&]( auto && p )
         {
             if ( settings.colors )
             {
-                const auto c = (Vector4f)( *settings.colors )[i];
-                out << fmt::format( "v {} {} {} {} {} {}\n", p.x, p.y, p.z, c[0], c[1], c[2] );
+                const auto c = (Vector4f)( *settings.colors )[v];
+                fmt::format_to( std::back_inserter( text ), "v {} {} {} {} {} {}\n", p.x, p.y, p.z, c[0], c[1], c[2] );
             }
             else
             {
-                out << fmt::format( "v {} {} {}\n", p.x, p.y, p.z );
+                fmt::format_to( std::back_inserter( text ), "v {} {} {}\n", p.x, p.y, p.z );
             }
         };
         if ( settings.xf )
-            saveVertex( applyDouble( settings.xf, mesh.points[i] ) );
+            saveVertex( applyDouble( settings.xf, mesh.points[v] ) );
         else
-            saveVertex( mesh.points[i] );
-        ++numSaved;
-        if ( settings.progress && !( numSaved & 0x3FF ) && !sb( float( numSaved ) / numPoints ) )
-            return unexpectedOperationCanceled();
-    }
+            saveVertex( mesh.points[v] );
+    }, subprogress( settings.progress, 0.0f, settings.uvMap ? 0.35f : 0.5f ) ) )
+        return unexpectedOperationCanceled();
 
     if ( settings.uvMap )
     {
-        numSaved = 0;
-        sb = subprogress( settings.progress, 0.35f, 0.7f );
-        for ( VertId i{ 0 }; i <= lastVertId; ++i )
+        if ( !writeTextByBlocks( out, size_t( lastVertId + 1 ), [&] ( size_t i, std::string& text )
         {
-            if ( settings.saveValidOnly && !mesh.topology.hasVert( i ) )
-                continue;
-            const auto& uv = ( *settings.uvMap )[i];
-            out << fmt::format( "vt {} {}\n", uv.x, uv.y );
-            ++numSaved;
-            if ( settings.progress && !( numSaved & 0x3FF ) && !sb( float( numSaved ) / numPoints ) )
-                return unexpectedOperationCanceled();
-        }
+            const VertId v( i );
+            if ( settings.saveValidOnly && !mesh.topology.hasVert( v ) )
+                return;
+            const auto& uv = ( *settings.uvMap )[v];
+            fmt::format_to( std::back_inserter( text ), "vt {} {}\n", uv.x, uv.y );
+        }, subprogress( settings.progress, 0.35f, 0.7f ) ) )
+            return unexpectedOperationCanceled();
         out << "usemtl Texture\n";
     }
 
-    sb = subprogress( settings.progress, settings.uvMap ? 0.7f : 0.5f, 1.0f );
-    const float facesNum = float( mesh.topology.edgePerFace().size() );
-    size_t faceIndex = 0;
-    for ( const auto& e : mesh.topology.edgePerFace() )
+    const auto& edgePerFace = mesh.topology.edgePerFace();
+    if ( !writeTextByBlocks( out, edgePerFace.size(), [&] ( size_t i, std::string& text )
     {
-        ++faceIndex;
-        if ( settings.progress && !( faceIndex & 0x3FF ) && !sb( faceIndex / facesNum ) )
-            return unexpectedOperationCanceled();
+        const auto e = edgePerFace[FaceId( i )];
         if ( !e.valid() )
-            continue;
-
+            return;
         VertId a, b, c;
         mesh.topology.getLeftTriVerts( e, a, b, c );
         Vector3i values( vertRenumber( a ) + firstVertId, vertRenumber( b ) + firstVertId, vertRenumber( c ) + firstVertId );
         if ( settings.uvMap )
-            out << fmt::format( "f {}/{} {}/{} {}/{}\n",
+            fmt::format_to( std::back_inserter( text ), "f {}/{} {}/{} {}/{}\n",
                 values.x, values.x,
                 values.y, values.y,
                 values.z, values.z );
         else
-            out << fmt::format( "f {} {} {}\n",
+            fmt::format_to( std::back_inserter( text ), "f {} {} {}\n",
                 values.x, values.y, values.z );
-    }
+    }, subprogress( settings.progress, settings.uvMap ? 0.7f : 0.5f, 1.0f ) ) )
+        return unexpectedOperationCanceled();
 
     if ( !out )
         return unexpected( std::string( "Error saving in OBJ-format" ) );
@@ -322,21 +308,22 @@ Expected<void> toAsciiStl( const Mesh& mesh, std::ostream& out, const SaveSettin
 
     static const char* solid_name = "MeshInspector.com";
     out << "solid " << solid_name << "\n";
-    auto notDegenTris = getNotDegenTris( mesh );
-    const float trisNum = float( notDegenTris.count() );
-    int trisIndex = 0;
-    for ( auto f : notDegenTris )
+    const auto notDegenTris = getNotDegenTris( mesh );
+    if ( !writeTextByBlocks( out, notDegenTris.size(), [&] ( size_t i, std::string& text )
     {
+        const FaceId f( i );
+        if ( !notDegenTris.test( f ) )
+            return;
         VertId a, b, c;
         mesh.topology.getTriVerts( f, a, b, c );
         assert( a.valid() && b.valid() && c.valid() );
         auto saveVertex = [&]( auto && ap, auto && bp, auto && cp )
         {
             const auto normal = cross( bp - ap, cp - ap ).normalized();
-            out << "" << fmt::format( "facet normal {} {} {}\n", normal.x, normal.y, normal.z );
-            out << "outer loop\n";
+            fmt::format_to( std::back_inserter( text ), "facet normal {} {} {}\n", normal.x, normal.y, normal.z );
+            text += "outer loop\n";
             for ( const auto & p : { ap, bp, cp } )
-                out << fmt::format( "vertex {} {} {}\n", p.x, p.y, p.z );
+                fmt::format_to( std::back_inserter( text ), "vertex {} {} {}\n", p.x, p.y, p.z );
         };
         if ( settings.xf )
             saveVertex( applyDouble( settings.xf, mesh.points[a] ),
@@ -344,12 +331,10 @@ Expected<void> toAsciiStl( const Mesh& mesh, std::ostream& out, const SaveSettin
                         applyDouble( settings.xf, mesh.points[c] ) );
         else
             saveVertex( mesh.points[a], mesh.points[b], mesh.points[c] );
-        out << "endloop\n";
-        out << "endfacet\n";
-        if ( settings.progress && !( trisIndex & 0x3FF ) && !settings.progress( trisIndex / trisNum ) )
-            return unexpectedOperationCanceled();
-        ++trisIndex;
-    }
+        text += "endloop\n";
+        text += "endfacet\n";
+    }, settings.progress ) )
+        return unexpectedOperationCanceled();
     out << "endsolid " << solid_name << "\n";
 
     if ( !out )
@@ -375,44 +360,70 @@ Expected<void> toPly( const Mesh & mesh, std::ostream & out, const SaveSettings
     const VertRenumber vertRenumber( mesh.topology.getValidVerts(), settings.saveValidOnly );
     const int numPoints = vertRenumber.sizeVerts();
     const VertId lastVertId = mesh.topology.lastValidVert();
+    const bool saveNormals = settings.normals && settings.normals->size() > lastVertId;
     const bool saveColors = settings.colors && settings.colors->size() > lastVertId;
+    const bool saveUVCoords = settings.uvMap && settings.uvMap->size() > lastVertId;
 
     out << "ply\nformat binary_little_endian 1.0\ncomment MeshInspector.com\n"
         "element vertex " << numPoints << "\nproperty float x\nproperty float y\nproperty float z\n";
+    if ( saveNormals )
+        out << "property float nx\nproperty float ny\nproperty float nz\n";
     if ( saveColors )
         out << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+    if ( saveUVCoords )
+        out << "property float texture_u\nproperty float texture_v\n";
 
     const auto fLast = mesh.topology.lastValidFace();
     const auto numSaveFaces = settings.rearrangeTriangles ? mesh.topology.numValidFaces() : int( fLast + 1 );
     out <<  "element face " << numSaveFaces << "\nproperty list uchar int vertex_indices\nend_header\n";
 
     static_assert( sizeof( Vector3f ) == 12, "wrong size of Vector3f" );
-#pragma pack(push, 1)
-    struct PlyColor
+    static_assert( sizeof( UVCoord ) == 8, "wrong size of UVCoord" );
+
+    // the ids of saved vertices and faces in the order of saving
+    std::vector<VertId> savedVerts;
+    if ( settings.saveValidOnly )
     {
-        unsigned char r = 0, g = 0, b = 0;
-    };
-#pragma pack(pop)
-    static_assert( sizeof( PlyColor ) == 3, "check your padding" );
+        savedVerts.reserve( numPoints );
+        for ( auto v : mesh.topology.getValidVerts() )
+            savedVerts.push_back( v );
+    }
+    std::vector<FaceId> savedFaces;
+    if ( settings.rearrangeTriangles )
+    {
+        savedFaces.reserve( numSaveFaces );
+        for ( auto f : mesh.topology.getValidFaces() )
+            savedFaces.push_back( f );
+    }
 
     // write vertices
-    int numSaved = 0;
-    for ( VertId i{ 0 }; i <= lastVertId; ++i )
+    Matrix3d normXf;
+    if ( settings.xf )
+        normXf = settings.xf->A.inverse().transposed();
+    const size_t vertRowSize = 12 + ( saveNormals ? 12 : 0 ) + ( saveColors ? 3 : 0 ) + ( saveUVCoords ? 8 : 0 );
+    if ( !writeRowsByBlocks( out, numPoints, vertRowSize, [&] ( size_t row, char* dst )
     {
-        if ( settings.saveValidOnly && !mesh.topology.hasVert( i ) )
-            continue;
-        const Vector3f p = applyFloat( settings.xf, mesh.points[i] );
-        out.write( ( const char* )&p, 12 );
-        if ( settings.colors )
+        const VertId v = settings.saveValidOnly ? savedVerts[row] : VertId( row );
+        const Vector3f p = applyFloat( settings.xf, mesh.points[v] );
+        std::memcpy( dst, &p, 12 );
+        dst += 12;
+        if ( saveNormals )
         {
-            const auto c = ( *settings.colors )[i];
-            PlyColor pc{ .r = c.r, .g = c.g, .b = c.b };
-            out.write( ( const char* )&pc, 3 );
+            const Vector3f n = applyFloat( settings.xf ? &normXf : nullptr, ( *settings.normals )[v] );
+            std::memcpy( dst, &n, 12 );
+            dst += 12;
         }
-        ++numSaved;
-        if ( settings.progress && !( numSaved & 0x3FF ) && !settings.progress( float( numSaved ) / numPoints * 0.5f ) )
-            return unexpectedOperationCanceled();
-    }
+        if ( saveColors )
+        {
+            const auto c = ( *settings.colors )[v];
+            *dst++ = char( c.r );
+            *dst++ = char( c.g );
+            *dst++ = char( c.b );
+        }
+        if ( saveUVCoords )
+            std::memcpy( dst, &( *settings.uvMap )[v], 8 );
+    }, subprogress( settings.progress, 0.0f, 0.5f ) ) )
+        return unexpectedOperationCanceled();
 
     // write triangles
     #pragma pack(push, 1)
@@ -424,10 +435,10 @@ Expected<void> toPly( const Mesh & mesh, std::ostream & out, const SaveSettings
     #pragma pack(pop)
     static_assert( sizeof( PlyTriangle ) == 13, "check your padding" );
 
-    PlyTriangle tri;
-    int savedFaces = 0;
-    for ( FaceId f{0}; f <= fLast; ++f )
+    if ( !writeRowsByBlocks( out, numSaveFaces, sizeof( PlyTriangle ), [&] ( size_t row, char* dst )
     {
+        const FaceId f = settings.rearrangeTriangles ? savedFaces[row] : FaceId( row );
+        PlyTriangle tri;
         if ( mesh.topology.hasFace( f ) )
         {
             VertId vs[3];
@@ -435,15 +446,11 @@ Expected<void> toPly( const Mesh & mesh, std::ostream & out, const SaveSettings
             for ( int i = 0; i < 3; ++i )
                 tri.v[i] = vertRenumber( vs[i] );
         }
-        else if ( !settings.rearrangeTriangles )
-            tri.v[0] = tri.v[1] = tri.v[2] = 0;
         else
-            continue;
-        out.write( (const char *)&tri, sizeof( PlyTriangle ) );
-        ++savedFaces;
-        if ( settings.progress && !( savedFaces & 0x3FF ) && !settings.progress( float( savedFaces ) / numSaveFaces * 0.5f + 0.5f ) )
-            return unexpectedOperationCanceled();
-    }
+            tri.v[0] = tri.v[1] = tri.v[2] = 0;
+        std::memcpy( dst, &tri, sizeof( PlyTriangle ) );
+    }, subprogress( settings.progress, 0.5f, 1.0f ) ) )
+        return unexpectedOperationCanceled();
 
     if ( !out )
         return unexpected( std::string( "Error saving in PLY-format" ) );
@@ -2260,6 +2260,40 @@ Expected<void> MeshTopology::read( std::istream & s, ProgressCallback callback )
 }
 
 
+bool MeshTopology::writeHalfEdges( std::ostream & s, ProgressCallback callback ) const
+{
+    static_assert( sizeof( HalfEdgeRecord ) == 4 * sizeof( int ) );
+    return writeByBlocks( s, (const char*)edges_.data(), edges_.size() * sizeof( HalfEdgeRecord ), callback );
+}
+
+Expected<void> MeshTopology::readFromMemory( const char* halfEdges, size_t numEdges, const char* edgePerVertex, size_t numVerts,
+    const char* edgePerFace, size_t numFaces, ProgressCallback callback )
+{
+    MR_TIMER
+    updateValids_ = false;
+
+    edges_.resizeNoInit( numEdges );
+    if ( !copyByBlocks( halfEdges, (char*)edges_.data(), numEdges * sizeof( HalfEdgeRecord ), subprogress( callback, 0.0f, 0.5f ) ) )
+        return unexpectedOperationCanceled();
+
+    edgePerVertex_.resizeNoInit( numVerts );
+    if ( !copyByBlocks( edgePerVertex, (char*)edgePerVertex_.data(), numVerts * sizeof( EdgeId ), subprogress( callback, 0.5f, 0.6f ) ) )
+        return unexpectedOperationCanceled();
+
+    edgePerFace_.resizeNoInit( numFaces );
+    if ( !copyByBlocks( edgePerFace, (char*)edgePerFace_.data(), numFaces * sizeof( EdgeId ), subprogress( callback, 0.6f, 0.7f ) ) )
+        return unexpectedOperationCanceled();
+
+    if ( !computeValidsFromEdges( subprogress( callback, 0.7f, 0.8f ) ) )
+        return unexpectedOperationCanceled();
+
+    if ( !checkValidity() )
+        return unexpected( std::string( "Data is invalid" ) );
+    if ( !reportProgress( callback, 1.0f ) )
+        return unexpectedOperationCanceled();
+    return {};
+}
+
 bool MeshTopology::checkValidity( ProgressCallback cb, bool allVerts ) const
 {
     MR_TIMER
@@ -475,6 +475,16 @@ public:
     /// \return text of error if any
     MRMESH_API Expected<void> read( std::istream& s, ProgressCallback callback = {} );
 
+    /// saves only the records of all half-edges in binary stream without their number: 4 integers (next, prev, org, left) per record
+    /// \return false if the operation was canceled
+    MRMESH_API bool writeHalfEdges( std::ostream & s, ProgressCallback callback = {} ) const;
+
+    /// loads from the arrays in memory having the same binary layout as produced by writeHalfEdges(), edgePerVertex() and edgePerFace(),
+    /// e.g. from the sections of memory mapped file, copying them in parallel threads
+    /// \return text of error if any
+    MRMESH_API Expected<void> readFromMemory( const char* halfEdges, size_t numEdges, const char* edgePerVertex, size_t numVerts,
+        const char* edgePerFace, size_t numFaces, ProgressCallback callback = {} );
+
     /// compare that two topologies are exactly the same
     [[nodiscard]] MRMESH_API bool operator ==( const MeshTopology & b ) const;
 
@@ -0,0 +1,411 @@
+#include "MRMrmesh2.h"
+#include "MRMesh.h"
+#include "MRAABBTree.h"
+#include "MRMappedFileRegion.h"
+#include "MRProgressReadWrite.h"
+#include "MRIOParsing.h"
+#include "MRStringConvert.h"
+#include "MRParallelFor.h"
+#include "MRTimer.h"
+#include "MRCube.h"
+#include "MRMeshSave.h"
+#include "MRMeshNormals.h"
+#include "MRMeshLoad.h"
+#include "MRUniqueTemporaryFolder.h"
+#include "MRGTest.h"
+#include "MRPch/MRFmt.h"
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace MR
+{
+
+namespace
+{
+
+constexpr char cSignature[8] = { 'M', 'R', 'M', 'E', 'S', 'H', 'v', '2' };
+
+/// the beginning of each section in the file is aligned on this boundary
+constexpr size_t cSectionAlignment = 4096;
+
+enum class SectionKind : uint32_t
+{
+    HalfEdges = 1,
+    EdgePerVertex,
+    EdgePerFace,
+    Points,
+    AABBTreeNodes,
+    VertNormals
+};
+
+struct Header
+{
+    char signature[8] = {};
+    uint32_t numSections = 0;
+    uint32_t reserved = 0;
+};
+static_assert( sizeof( Header ) == 16 );
+
+struct Section
+{
+    SectionKind kind = {};
+    uint32_t elemSize = 0;
+    uint64_t offset = 0; ///< from the beginning of the header
+    uint64_t count = 0;
+};
+static_assert( sizeof( Section ) == 24 );
+
+size_t alignUp( size_t pos )
+{
+    return ( pos + cSectionAlignment - 1 ) / cSectionAlignment * cSectionAlignment;
+}
+
+constexpr size_t cHalfEdgeRecordSize = 4 * sizeof( int );
+
+/// checks that the nodes of AABB tree loaded from a file can be safely used with the mesh:
+/// all references are within the arrays, children nodes always follow their parent, so no cycles are possible,
+/// and each valid face of the mesh is referenced by exactly one leaf
+bool isValidTree( const AABBTree::NodeVec & nodes, const MeshTopology & topology )
+{
+    MR_TIMER
+    const auto numFaces = topology.numValidFaces();
+    if ( nodes.size() != ( numFaces > 0 ? 2 * size_t( numFaces ) - 1 : 0 ) )
+        return false;
+    std::atomic<bool> valid{ true };
+    ParallelFor( nodes, [&] ( NodeId n )
+    {
+        const auto & node = nodes[n];
+        const bool ok = node.leaf()
+            ? topology.hasFace( node.leafId() )
+            : node.l > n && node.r > n && node.l < nodes.endId() && node.r < nodes.endId();
+        if ( !ok )
+            valid.store( false, std::memory_order_relaxed );
+    } );
+    if ( !valid )
+        return false;
+
+    FaceBitSet seenFaces( topology.faceSize() );
+    for ( const auto & node : nodes )
+    {
+        if ( node.leaf() && seenFaces.test_set( node.leafId() ) )
+            return false;
+    }
+    return seenFaces.count() == size_t( numFaces );
+}
+
+/// loads mesh from .mrmesh of version 2 located in memory
+Expected<Mesh> loadFromMemory( const char * data, size_t size, const MeshLoadSettings & settings )
+{
+    MR_TIMER
+    Header header;
+    if ( size < sizeof( Header ) )
+        return unexpected( std::string( "Mrmesh-file is too short" ) );
+    std::memcpy( &header, data, sizeof( Header ) );
+    if ( std::memcmp( header.signature, cSignature, sizeof( cSignature ) ) != 0 )
+        return unexpected( std::string( "Not a mrmesh-file of version 2" ) );
+    if ( sizeof( Header ) + size_t( header.numSections ) * sizeof( Section ) > size )
+        return unexpected( std::string( "Mrmesh-file is too short for the table of sections" ) );
+
+    struct SectionView
+    {
+        const char * data = nullptr;
+        size_t count = 0;
+    };
+    SectionView halfEdges, edgePerVertex, edgePerFace, points, treeNodes, normals;
+    bool hasTopology[3] = {};
+    bool hasPoints = false;
+    for ( uint32_t i = 0; i < header.numSections; ++i )
+    {
+        Section section;
+        std::memcpy( &section, data + sizeof( Header ) + i * sizeof( Section ), sizeof( Section ) );
+        if ( section.offset > size || section.elemSize == 0 || section.count > ( size - section.offset ) / section.elemSize )
+            return unexpected( fmt::format( "Section #{} of mrmesh-file is out of file bounds", i ) );
+
+        SectionView view{ data + section.offset, size_t( section.count ) };
+        auto assign = [&] ( SectionView & target, size_t elemSize ) -> Expected<void>
+        {
+            if ( section.elemSize != elemSize )
+                return unexpected( fmt::format( "Section #{} of mrmesh-file has wrong element size {}", i, section.elemSize ) );
+            target = view;
+            return {};
+        };
+        Expected<void> res;
+        switch ( section.kind )
+        {
+        case SectionKind::HalfEdges:
+            res = assign( halfEdges, cHalfEdgeRecordSize );
+            hasTopology[0] = true;
+            break;
+        case SectionKind::EdgePerVertex:
+            res = assign( edgePerVertex, sizeof( EdgeId ) );
+            hasTopology[1] = true;
+            break;
+        case SectionKind::EdgePerFace:
+            res = assign( edgePerFace, sizeof( EdgeId ) );
+            hasTopology[2] = true;
+            break;
+        case SectionKind::Points:
+            res = assign( points, sizeof( Vector3f ) );
+            hasPoints = true;
+            break;
+        case SectionKind::AABBTreeNodes:
+            res = assign( treeNodes, sizeof( AABBTree::Node ) );
+            break;
+        case SectionKind::VertNormals:
+            res = assign( normals, sizeof( Vector3f ) );
+            break;
+        default:
+            break; // unknown section from newer version
+        }
+        if ( !res )
+            return unexpected( std::move( res.error() ) );
+    }
+    if ( !hasTopology[0] || !hasTopology[1] || !hasTopology[2] || !hasPoints )
+        return unexpected( std::string( "Mrmesh-file misses obligatory sections" ) );
+
+    Mesh mesh;
+    auto readRes = mesh.topology.readFromMemory( halfEdges.data, halfEdges.count, edgePerVertex.data, edgePerVertex.count,
+        edgePerFace.data, edgePerFace.count, subprogress( settings.callback, 0.0f, 0.7f ) );
+    if ( !readRes )
+    {
+        std::string error = readRes.error();
+        if ( error != stringOperationCanceled() )
+            error = "Error reading topology from mrmesh - file:\n" + error;
+        return unexpected( error );
+    }
+
+    mesh.points.resizeNoInit( points.count );
+    if ( !copyByBlocks( points.data, ( char* )mesh.points.data(), points.count * sizeof( Vector3f ), subprogress( settings.callback, 0.7f, 0.8f ) ) )
+        return unexpectedOperationCanceled();
+
+    if ( settings.normals && normals.data )
+    {
+        settings.normals->resizeNoInit( normals.count );
+        if ( !copyByBlocks( normals.data, ( char* )settings.normals->data(), normals.count * sizeof( Vector3f ), subprogress( settings.callback, 0.8f, 0.85f ) ) )
+            return unexpectedOperationCanceled();
+    }
+
+    // the tree is optional, so the mesh is loaded even if the tree is not suitable
+    if ( treeNodes.data && mesh.points.size() >= size_t( mesh.topology.lastValidVert() + 1 ) )
+    {
+        AABBTree::NodeVec nodes;
+        nodes.resize( treeNodes.count );
+        if ( !copyByBlocks( treeNodes.data, ( char* )nodes.data(), treeNodes.count * sizeof( AABBTree::Node ), subprogress( settings.callback, 0.85f, 1.0f ) ) )
+            return unexpectedOperationCanceled();
+        if ( isValidTree( nodes, mesh.topology ) )
+            mesh.setAABBTree( AABBTree( std::move( nodes ) ) );
+    }
+
+    if ( !reportProgress( settings.callback, 1.0f ) )
+        return unexpectedOperationCanceled();
+    return mesh;
+}
+
+} //anonymous namespace
+
+namespace MeshSave
+{
+
+Expected<void> toMrmesh2( const Mesh & mesh, const std::filesystem::path & file, const SaveSettings & settings )
+{
+    std::ofstream out( file, std::ofstream::binary );
+    if ( !out )
+        return unexpected( std::string( "Cannot open file for writing " ) + utf8string( file ) );
+
+    return toMrmesh2( mesh, out, settings );
+}
+
+Expected<void> toMrmesh2( const Mesh & mesh, std::ostream & out, const SaveSettings & settings )
+{
+    MR_TIMER
+    const auto numPoints = size_t( mesh.topology.lastValidVert() + 1 );
+    VertCoords pointsBuf;
+    const auto & xfVerts = transformPoints( mesh.points, mesh.topology.getValidVerts(), settings.xf, pointsBuf );
+
+    VertNormals normalsBuf;
+    const VertNormals * normals = nullptr;
+    if ( settings.normals )
+    {
+        Matrix3d normXf;
+        if ( settings.xf )
+            normXf = settings.xf->A.inverse().transposed();
+        normals = &transformNormals( *settings.normals, mesh.topology.getValidVerts(), settings.xf ? &normXf : nullptr, normalsBuf );
+    }
+
+    // the tree is built for original coordinates of the points
+    const AABBTree * tree = settings.xf ? nullptr : &mesh.getAABBTree();
+
+    struct SectionData
+    {
+        Section section;
+        const char * data = nullptr; ///< null for half-edge records, which are written by the topology
+    };
+    std::vector<SectionData> sections;
+    auto addSection = [&] ( SectionKind kind, const void * data, size_t elemSize, size_t count )
+    {
+        sections.push_back( { Section{ kind, uint32_t( elemSize ), 0, count }, ( const char* )data } );
+    };
+    addSection( SectionKind::HalfEdges, nullptr, cHalfEdgeRecordSize, mesh.topology.edgeSize() );
+    addSection( SectionKind::EdgePerVertex, mesh.topology.edgePerVertex().data(), sizeof( EdgeId ), mesh.topology.edgePerVertex().size() );
+    addSection( SectionKind::EdgePerFace, mesh.topology.edgePerFace().data(), sizeof( EdgeId ), mesh.topology.edgePerFace().size() );
+    addSection( SectionKind::Points, xfVerts.data(), sizeof( Vector3f ), numPoints );
+    if ( tree )
+        addSection( SectionKind::AABBTreeNodes, tree->nodes().data(), sizeof( AABBTree::Node ), tree->nodes().size() );
+    if ( normals )
+        addSection( SectionKind::VertNormals, normals->data(), sizeof( Vector3f ), std::min( numPoints, normals->size() ) );
+
+    size_t pos = sizeof( Header ) + sections.size() * sizeof( Section );
+    size_t totalBytes = 0;
+    for ( auto & s : sections )
+    {
+        pos = alignUp( pos );
+        s.section.offset = pos;
+        pos += s.section.count * s.section.elemSize;
+        totalBytes += s.section.count * s.section.elemSize;
+    }
+
+    Header header;
+    std::memcpy( header.signature, cSignature, sizeof( cSignature ) );
+    header.numSections = uint32_t( sections.size() );
+    out.write( ( const char* )&header, sizeof( Header ) );
+    for ( const auto & s : sections )
+        out.write( ( const char* )&s.section, sizeof( Section ) );
+
+    pos = sizeof( Header ) + sections.size() * sizeof( Section );
+    size_t writtenBytes = 0;
+    const std::vector<char> padding( cSectionAlignment, 0 );
+    for ( const auto & s : sections )
+    {
+        out.write( padding.data(), s.section.offset - pos );
+        const size_t bytes = s.section.count * s.section.elemSize;
+        auto sp = subprogress( settings.progress, float( writtenBytes ) / totalBytes, float( writtenBytes + bytes ) / totalBytes );
+        const bool written = s.data ? writeByBlocks( out, s.data, bytes, sp ) : mesh.topology.writeHalfEdges( out, sp );
+        if ( !written )
+            return unexpectedOperationCanceled();
+        pos = s.section.offset + bytes;
+        writtenBytes += bytes;
+    }
+
+    if ( !out )
+        return unexpected( std::string( "Error saving in Mrmesh-format" ) );
+
+    reportProgress( settings.progress, 1.f );
+    return {};
+}
+
+} //namespace MeshSave
+
+namespace MeshLoad
+{
+
+bool isMrmesh2( std::istream & in )
+{
+    const auto posStart = in.tellg();
+    char signature[sizeof( cSignature )] = {};
+    in.read( signature, sizeof( signature ) );
+    const bool res = in && std::memcmp( signature, cSignature, sizeof( cSignature ) ) == 0;
+    in.clear();
+    in.seekg( posStart );
+    return res;
+}
+
+Expected<Mesh> fromMrmesh2( const std::filesystem::path & file, const MeshLoadSettings & settings )
+{
+    std::error_code ec;
+    const auto fileSize = std::filesystem::file_size( file, ec );
+    if ( ec )
+        return unexpected( std::string( "Cannot get size of file " ) + utf8string( file ) );
+
+    return MappedFileRegion::map( file, 0, fileSize ).and_then( [&] ( std::shared_ptr<const MappedFileRegion> && region )
+    {
+        return addFileNameInError( loadFromMemory( region->data(), region->size(), settings ), file );
+    } );
+}
+
+Expected<Mesh> fromMrmesh2( std::istream & in, const MeshLoadSettings & settings )
+{
+    MR_TIMER
+    const auto size = getStreamSize( in );
+    if ( size < 0 )
+        return unexpected( std::string( "Cannot get the size of mrmesh-stream" ) );
+    std::vector<char> data( size );
+    if ( !readByBlocks( in, data.data(), data.size(), subprogress( settings.callback, 0.0f, 0.5f ) ) )
+        return unexpectedOperationCanceled();
+    if ( !in )
+        return unexpected( std::string( "Error reading mrmesh-file" ) );
+
+    return loadFromMemory( data.data(), data.size(), { .normals = settings.normals, .callback = subprogress( settings.callback, 0.5f, 1.0f ) } );
+}
+
+} //namespace MeshLoad
+
+TEST( MRMesh, Mrmesh2 )
+{
+    auto mesh = makeCube();
+    VertNormals normals = computePerVertNormals( mesh );
+    const auto box = mesh.getAABBTree().getBoundingBox();
+
+    std::stringstream ss;
+    ASSERT_TRUE( MeshSave::toMrmesh2( mesh, ss, { .normals = &normals } ).has_value() );
+    ASSERT_TRUE( MeshLoad::isMrmesh2( ss ) );
+    // the sections are aligned on memory pages
+    EXPECT_GT( ss.str().size(), cSectionAlignment * 5 );
+
+    VertNormals loadedNormals;
+    auto loaded = MeshLoad::fromMrmesh2( ss, { .normals = &loadedNormals } );
+    ASSERT_TRUE( loaded.has_value() );
+    EXPECT_EQ( loaded->topology, mesh.topology );
+    EXPECT_EQ( loaded->points, mesh.points );
+    EXPECT_EQ( loadedNormals, normals );
+    // the tree is loaded from the stream and not rebuilt
+    ASSERT_NE( loaded->getAABBTreeNotCreate(), nullptr );
+    EXPECT_EQ( loaded->getAABBTreeNotCreate()->nodes().size(), mesh.getAABBTree().nodes().size() );
+    EXPECT_EQ( loaded->getAABBTreeNotCreate()->getBoundingBox(), box );
+
+    // file is memory mapped by common loader of .mrmesh
+    UniqueTemporaryFolder folder( {} );
+    const auto path = folder / "cube.mrmesh";
+    ASSERT_TRUE( MeshSave::toMrmesh2( mesh, path ).has_value() );
+    auto mapped = MeshLoad::fromMrmesh( path );
+    ASSERT_TRUE( mapped.has_value() );
+    EXPECT_EQ( mapped->topology, mesh.topology );
+    EXPECT_EQ( mapped->points, mesh.points );
+    EXPECT_NE( mapped->getAABBTreeNotCreate(), nullptr );
+
+    // trailing invalid vertices are not saved, and the tree is still loaded
+    auto meshTrailing = mesh;
+    meshTrailing.topology.vertResize( meshTrailing.topology.vertSize() + 2 );
+    meshTrailing.points.resize( meshTrailing.topology.vertSize() );
+    std::stringstream ssTrailing;
+    ASSERT_TRUE( MeshSave::toMrmesh2( meshTrailing, ssTrailing ).has_value() );
+    auto loadedTrailing = MeshLoad::fromMrmesh2( ssTrailing );
+    ASSERT_TRUE( loadedTrailing.has_value() );
+    EXPECT_EQ( loadedTrailing->points, mesh.points );
+    EXPECT_NE( loadedTrailing->getAABBTreeNotCreate(), nullptr );
+
+    // .mrmesh of version 1 is not recognized as version 2
+    std::stringstream ss1;
+    ASSERT_TRUE( MeshSave::toMrmesh( mesh, ss1 ).has_value() );
+    EXPECT_FALSE( MeshLoad::isMrmesh2( ss1 ) );
+
+    // corrupted table of sections is detected
+    auto str = ss.str();
+    str[sizeof( Header ) + offsetof( Section, count ) + 7] = char( 0xFF );
+    std::stringstream ss2( str );
+    EXPECT_FALSE( MeshLoad::fromMrmesh2( ss2 ).has_value() );
+
+    // a tree referencing some face twice and missing another one is rejected
+    auto nodes = mesh.getAABBTree().nodes();
+    EXPECT_TRUE( isValidTree( nodes, mesh.topology ) );
+    std::vector<NodeId> leaves;
+    for ( NodeId n{ 0 }; n < nodes.endId(); ++n )
+        if ( nodes[n].leaf() )
+            leaves.push_back( n );
+    ASSERT_GE( leaves.size(), 2 );
+    nodes[leaves[1]].setLeafId( nodes[leaves[0]].leafId() );
+    EXPECT_FALSE( isValidTree( nodes, mesh.topology ) );
+}
+
+} //namespace MR
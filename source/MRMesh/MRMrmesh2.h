@@ -0,0 +1,56 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRExpected.h"
+#include "MRMeshLoadSettings.h"
+#include "MRSaveSettings.h"
+#include <filesystem>
+#include <istream>
+#include <ostream>
+
+namespace MR
+{
+
+/// .mrmesh format of version 2 starts with a signature and the table of sections, followed by the sections themselves:
+/// half-edge records, edge per vertex, edge per face, points, and optional nodes of AABB tree and vertex normals;
+/// each section is a raw array of values (exactly as they are stored in memory) beginning on the boundary of memory page,
+/// so the loading from a memory mapped file consists only in parallel copying of the arrays without any parsing;
+/// the sections of unknown kinds are skipped by the loader to permit future extensions
+
+namespace MeshSave
+{
+
+/// \addtogroup MeshSaveGroup
+/// \{
+
+/// saves in internal file format of version 2 together with AABB tree of the mesh (building it if necessary),
+/// so the first spatial query after loading does not need to build the tree;
+/// if settings.xf is given then the tree is not saved;
+/// SaveSettings::saveValidOnly = true is ignored
+MRMESH_API Expected<void> toMrmesh2( const Mesh & mesh, const std::filesystem::path & file, const SaveSettings & settings = {} );
+MRMESH_API Expected<void> toMrmesh2( const Mesh & mesh, std::ostream & out, const SaveSettings & settings = {} );
+
+/// \}
+
+} // namespace MeshSave
+
+namespace MeshLoad
+{
+
+/// \addtogroup MeshLoadGroup
+/// \{
+
+/// returns true if the stream from current position contains .mrmesh of version 2, the position in the stream is not changed
+[[nodiscard]] MRMESH_API bool isMrmesh2( std::istream & in );
+
+/// loads mesh from file in internal format of version 2 by memory mapping it, together with AABB tree if it is present in the file
+MRMESH_API Expected<Mesh> fromMrmesh2( const std::filesystem::path & file, const MeshLoadSettings & settings = {} );
+
+/// loads mesh from stream in internal format of version 2, together with AABB tree if it is present in the stream
+MRMESH_API Expected<Mesh> fromMrmesh2( std::istream & in, const MeshLoadSettings & settings = {} );
+
+/// \}
+
+} // namespace MeshLoad
+
+} // namespace MR
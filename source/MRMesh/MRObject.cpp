@@ -3,16 +3,161 @@
 #include "MRSerializer.h"
 #include "MRStringConvert.h"
 #include "MRHeapBytes.h"
+#include "MRDirectory.h"
+#include "MRFinally.h"
+#include "MRTimer.h"
 #include "MRPch/MRJson.h"
 #include "MRPch/MRSpdlog.h"
+#include "MRPch/MRTBB.h"
 #include "MRGTest.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
+#include <functional>
+#include <mutex>
 
 namespace MR
 {
 
 MR_ADD_CLASS_FACTORY( Object )
 
+namespace
+{
+
+/// the number of pending models of all objects
+std::atomic<size_t> sNumPendingModels{ 0 };
+
+/// the models serialized in memory by serializeModel_ called from serializeRecursive in this thread
+thread_local std::vector<std::future<Expected<SerializedModelFile>>>* tMemoryModels = nullptr;
+
+} // anonymous namespace
+
+/// everything needed to load the model of the object postponed by lazy deserialization
+struct Object::PendingModel
+{
+    PendingModel() { ++sNumPendingModels; }
+    ~PendingModel() { --sNumPendingModels; }
+
+    std::string typeName;        ///< the type of the object to create for loading
+    std::filesystem::path path;  ///< model file name without extension
+    Json::Value fields;          ///< all fields of the object except for its children
+    std::optional<Box3f> box;    ///< bounding box of the object saved in the scene
+    std::shared_ptr<const void> folder; ///< keeps the files of the model alive
+
+    /// loads the object with the model once: either in the calling thread or waits for the loading started by another thread
+    const Expected<std::shared_ptr<Object>>& load( const ProgressCallback& progressCb )
+    {
+        std::call_once( loadFlag_, [&]
+        {
+            MR_TIMER;
+            auto obj = createObject( typeName );
+            if ( !obj )
+            {
+                loaded_ = unexpected( "Unknown object type " + typeName );
+                return;
+            }
+            auto res = obj->deserializeModel_( path, progressCb );
+            if ( !res.has_value() )
+            {
+                loaded_ = unexpected( std::move( res.error() ) );
+                return;
+            }
+            obj->deserializeFields_( fields );
+            loaded_ = std::move( obj );
+        } );
+        loadFinished_ = true;
+        return loaded_;
+    }
+
+    /// returns true if the loading was finished (successfully or not), so load() returns immediately
+    bool isLoaded() const { return loadFinished_; }
+
+    /// copies all files of the model in given path without extension
+    Expected<void> copyFiles( const std::filesystem::path& newPath ) const
+    {
+        const auto stem = utf8string( path.filename() );
+        std::error_code ec;
+        for ( auto entry : Directory{ path.parent_path(), ec } )
+        {
+            if ( !entry.is_regular_file( ec ) )
+                continue;
+            // the model files start from the unique key of the object, e.g. "0_Mesh.ctm" or "1_Voxels_W10_H10_S10_V1_1_1_G0_F.raw"
+            const auto name = utf8string( entry.path().filename() );
+            if ( name.size() <= stem.size() || !name.starts_with( stem ) || ( name[stem.size()] != '.' && name[stem.size()] != '_' ) )
+                continue;
+            const auto newName = utf8string( newPath.filename() ) + name.substr( stem.size() );
+            if ( !std::filesystem::copy_file( entry.path(), newPath.parent_path() / pathFromUtf8( newName ), std::filesystem::copy_options::overwrite_existing, ec ) )
+                return unexpected( "Cannot copy file " + utf8string( entry.path() ) );
+        }
+        if ( ec )
+            return unexpected( "Cannot read directory " + utf8string( path.parent_path() ) );
+        return {};
+    }
+
+    std::atomic<bool> warned{ false }; ///< the access to the model before its loading was already logged
+    std::atomic<bool> prefetchQueued{ false }; ///< the loading was already queued in background
+
+private:
+    std::once_flag loadFlag_;
+    Expected<std::shared_ptr<Object>> loaded_;
+    std::atomic<bool> loadFinished_{ false };
+};
+
+namespace
+{
+
+/// the queue of loading pending models in background by few threads not to occupy all cores
+class PrefetchQueue
+{
+public:
+    static PrefetchQueue& instance()
+    {
+        // the queue is never destroyed: waiting for its threads during static destruction hangs on library unloading in Windows,
+        // so the running tasks shall be awaited by explicit stopAndWait call
+        static auto queue = new PrefetchQueue;
+        return *queue;
+    }
+
+    void enqueue( std::function<void()> task )
+    {
+        {
+            std::lock_guard lock( mutex_ );
+            ++numTasks_;
+        }
+        arena_.enqueue( [this, task = std::move( task )]
+        {
+            if ( !stopping_ )
+                task();
+            std::lock_guard lock( mutex_ );
+            if ( --numTasks_ == 0 )
+                allDone_.notify_all();
+        } );
+    }
+
+    /// skips the tasks not started yet including the ones enqueued later, and waits for the running ones
+    void stopAndWait()
+    {
+        stopping_ = true;
+        std::unique_lock lock( mutex_ );
+        allDone_.wait( lock, [this] { return numTasks_ == 0; } );
+    }
+
+private:
+    PrefetchQueue() = default;
+
+    static constexpr int cMaxThreads = 2;
+    // one slot is reserved for a master thread, which never joins the arena, so at most cMaxThreads workers execute the tasks;
+    // on a single core, the arena has no workers, but enqueued tasks are still executed by a worker created on demand
+    tbb::task_arena arena_{ std::min( cMaxThreads + 1, tbb::this_task_arena::max_concurrency() ) };
+    std::atomic<bool> stopping_{ false };
+    std::mutex mutex_;
+    std::condition_variable allDone_;
+    size_t numTasks_ = 0;
+};
+
+} // anonymous namespace
+
 ObjectChildrenHolder::ObjectChildrenHolder( ObjectChildrenHolder && b ) noexcept
     : children_( std::move( b.children_ ) )
     , bastards_( std::move( b.bastards_ ) )
@@ -422,6 +567,18 @@ Expected<std::future<Expected<void>>> Object::serializeModel_( const std::filesy
     return {};
 }
 
+bool Object::canSerializeModelToMemory_()
+{
+    return tMemoryModels != nullptr;
+}
+
+void Object::addModelSerializedToMemory_( std::future<Expected<SerializedModelFile>> model )
+{
+    assert( tMemoryModels );
+    if ( tMemoryModels )
+        tMemoryModels->push_back( std::move( model ) );
+}
+
 void Object::serializeFields_( Json::Value& root ) const
 {
     root["Name"] = name_;
@@ -523,7 +680,8 @@ std::vector<std::string> Object::getInfoLines() const
     return res;
 }
 
-Expected<std::vector<std::future<Expected<void>>>> Object::serializeRecursive( const std::filesystem::path& path, Json::Value& root, int childId ) const
+Expected<std::vector<std::future<Expected<void>>>> Object::serializeRecursive( const std::filesystem::path& path, Json::Value& root, int childId,
+    std::vector<std::future<Expected<SerializedModelFile>>>* memoryModels ) const
 {
     std::error_code ec;
     if ( !std::filesystem::is_directory( path, ec ) )
@@ -535,12 +693,31 @@ Expected<std::vector<std::future<Expected<void>>>> Object::serializeRecursive( c
     // the key must be unique among all children of same parent
     std::string key = std::to_string( childId ) + "_" + replaceProhibitedChars( name_ );
 
-    auto model = serializeModel_( path / pathFromUtf8( key ) );
-    if ( !model.has_value() )
-        return unexpected( model.error() );
-    if ( model.value().valid() )
-        res.push_back( std::move( model.value() ) );
-    serializeFields_( root );
+    if ( pendingModel_ )
+    {
+        // the model was not loaded, so its files are copied as is, and all fields except for base ones are taken from the scene
+        auto copied = pendingModel_->copyFiles( path / pathFromUtf8( key ) );
+        if ( !copied.has_value() )
+            return unexpected( std::move( copied.error() ) );
+        root = pendingModel_->fields;
+        root.removeMember( "Type" );
+        Object::serializeFields_( root );
+        root["Type"] = pendingModel_->fields["Type"];
+    }
+    else
+    {
+        tMemoryModels = memoryModels;
+        auto model = [&]
+        {
+            MR_FINALLY{ tMemoryModels = nullptr; };
+            return serializeModel_( path / pathFromUtf8( key ) );
+        }();
+        if ( !model.has_value() )
+            return unexpected( model.error() );
+        if ( model.value().valid() )
+            res.push_back( std::move( model.value() ) );
+        serializeFields_( root );
+    }
 
     root["Key"] = key;
 
@@ -553,7 +730,7 @@ Expected<std::vector<std::future<Expected<void>>>> Object::serializeRecursive( c
             const auto& child = children_[i];
             if ( child->isAncillary() )
                 continue; // consider ancillary_ objects as temporary, not requiring saving
-            auto sub = child->serializeRecursive( childrenPath, childrenRoot[std::to_string( i )], i );
+            auto sub = child->serializeRecursive( childrenPath, childrenRoot[std::to_string( i )], i, memoryModels );
             if ( !sub.has_value() )
                 return unexpected( sub.error() );
             for ( auto & f : sub.value() )
@@ -568,14 +745,46 @@ Expected<std::vector<std::future<Expected<void>>>> Object::serializeRecursive( c
 
 Expected<void> Object::deserializeRecursive( const std::filesystem::path& path, const Json::Value& root,
         ProgressCallback progressCb, int* objCounter )
+{
+    return deserializeRecursive_( path, root, progressCb, objCounter, nullptr );
+}
+
+Expected<void> Object::deserializeRecursiveLazy( const std::filesystem::path& path, const Json::Value& root,
+        std::shared_ptr<const void> folder, int* objCounter )
+{
+    return deserializeRecursive_( path, root, {}, objCounter, &folder );
+}
+
+Expected<void> Object::deserializeRecursive_( const std::filesystem::path& path, const Json::Value& root,
+        const ProgressCallback& progressCb, int* objCounter, const std::shared_ptr<const void>* lazyFolder )
 {
     std::string key = root["Key"].isString() ? root["Key"].asString() : root["Name"].asString();
 
-    auto res = deserializeModel_( path / pathFromUtf8( key ), progressCb );
-    if ( !res.has_value() )
-        return res;
+    if ( lazyFolder && canPostponeModel_() )
+    {
+        auto pending = std::make_shared<PendingModel>();
+        pending->typeName = typeName();
+        pending->path = path / pathFromUtf8( key );
+        pending->fields = root;
+        pending->fields.removeMember( "Children" );
+        if ( root["BoundingBox"].isObject() )
+        {
+            Box3f box;
+            deserializeFromJson( root["BoundingBox"], box );
+            pending->box = box;
+        }
+        pending->folder = *lazyFolder;
+        Object::deserializeFields_( root );
+        pendingModel_ = std::move( pending );
+    }
+    else
+    {
+        auto res = deserializeModel_( path / pathFromUtf8( key ), progressCb );
+        if ( !res.has_value() )
+            return res;
 
-    deserializeFields_( root );
+        deserializeFields_( root );
+    }
     if ( objCounter )
         ++( *objCounter );
 
@@ -628,7 +837,7 @@ Expected<void> Object::deserializeRecursive( const std::filesystem::path& path,
             if ( !childObj )
                 continue;
 
-            auto childRes = childObj->deserializeRecursive( path / pathFromUtf8( key ), child, progressCb, objCounter );
+            auto childRes = childObj->deserializeRecursive_( path / pathFromUtf8( key ), child, progressCb, objCounter, lazyFolder );
             if ( !childRes.has_value() )
                 return childRes;
             addChild( childObj );
@@ -637,6 +846,79 @@ Expected<void> Object::deserializeRecursive( const std::filesystem::path& path,
     return {};
 }
 
+Expected<void> Object::loadPendingModel( ProgressCallback progressCb )
+{
+    if ( !pendingModel_ )
+        return {};
+    const auto pending = pendingModel_; // keep it alive during loading
+    const auto& loaded = pending->load( progressCb );
+    if ( !loaded.has_value() )
+        return unexpected( loaded.error() );
+
+    // the loaded object can be shared by clones of this object, so it is cloned too (without deep copy of the model)
+    auto obj = ( *loaded )->clone();
+    // keep the fields, which could be changed since deserialization
+    obj->name_ = name_;
+    obj->xf_ = xf_;
+    obj->visibilityMask_ = visibilityMask_;
+    obj->locked_ = locked_;
+    obj->parentLocked_ = parentLocked_;
+    obj->selected_ = selected_;
+    obj->ancillary_ = ancillary_;
+    auto children = this->children();
+    for ( auto& child : children )
+    {
+        child->detachFromParent();
+        obj->addChild( child );
+    }
+    swap( *obj );
+    assert( !pendingModel_ );
+    needRedraw_ = true;
+    return {};
+}
+
+bool Object::isPendingModelLoaded() const
+{
+    return pendingModel_ && pendingModel_->isLoaded();
+}
+
+size_t Object::numPendingModels()
+{
+    return sNumPendingModels;
+}
+
+void Object::prefetchPendingModel() const
+{
+    if ( !pendingModel_ || pendingModel_->prefetchQueued.exchange( true ) )
+        return;
+    // all prefetching tasks are executed in a separate arena not to delay parallel algorithms started from the main thread
+    PrefetchQueue::instance().enqueue( [weakPending = std::weak_ptr<PendingModel>( pendingModel_ )]
+    {
+        // skip the objects that were already loaded or destroyed
+        if ( auto pending = weakPending.lock() )
+            (void)pending->load( {} );
+    } );
+}
+
+void Object::stopPrefetchingPendingModels()
+{
+    MR_TIMER
+    PrefetchQueue::instance().stopAndWait();
+}
+
+std::optional<Box3f> Object::pendingModelBox_() const
+{
+    if ( !pendingModel_ )
+        return {};
+    return pendingModel_->box;
+}
+
+void Object::warnPendingModel_() const
+{
+    if ( pendingModel_ && !pendingModel_->warned.exchange( true ) )
+        spdlog::warn( "The model of object \"{}\" is accessed before loadPendingModel call", name_ );
+}
+
 void Object::swap( Object& other )
 {
     swapBase_( other );
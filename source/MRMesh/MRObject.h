@@ -12,6 +12,7 @@
 #include <array>
 #include <future>
 #include <filesystem>
+#include <optional>
 
 namespace Json
 {
@@ -21,6 +22,15 @@ class Value;
 namespace MR
 {
 
+/// the file of object model serialized in memory instead of the folder of the scene
+struct SerializedModelFile
+{
+    /// full file name with extension, as if the model was saved in the folder by Object::serializeModel_
+    std::filesystem::path path;
+    /// the contents of the file
+    std::string data;
+};
+
 /**
  * \defgroup DataModelGroup Data Model
  * \brief This chapter represents documentation about data models
@@ -213,10 +223,13 @@ public:
     ///   models in the folder by given path and
     ///   fields in given JSON
     /// \param childId is its ordinal number within the parent
+    /// \param memoryModels if not null, the models that serializeModel_ passes to addModelSerializedToMemory_
+    ///                     are not saved in the folder, but their futures are added here
     // This would be automatically skipped in the bindings anyway because of the `Json::Value` parameter.
     // But skipping it here prevents the vector-of-futures type from being registered, which is helpful.
     // TODO: figure out how to automate this (add a flag to the parser to outright reject functions based on their parameter and return types).
-    MRMESH_API MR_BIND_IGNORE Expected<std::vector<std::future<Expected<void>>>> serializeRecursive( const std::filesystem::path& path, Json::Value& root, int childId ) const;
+    MRMESH_API MR_BIND_IGNORE Expected<std::vector<std::future<Expected<void>>>> serializeRecursive( const std::filesystem::path& path, Json::Value& root, int childId,
+        std::vector<std::future<Expected<SerializedModelFile>>>* memoryModels = nullptr ) const;
 
     /// loads subtree into this Object
     ///   models from the folder by given path and
@@ -224,6 +237,36 @@ public:
     MRMESH_API Expected<void> deserializeRecursive( const std::filesystem::path& path, const Json::Value& root,
         ProgressCallback progressCb = {}, int* objCounter = nullptr );
 
+    /// loads subtree into this Object as deserializeRecursive does, but postpones loading of the models
+    /// (meshes, point clouds, voxels) till loadPendingModel call: only the fields of base Object and the bounding box are read now
+    /// \param folder keeps the files of the models alive till all of them are loaded
+    MRMESH_API Expected<void> deserializeRecursiveLazy( const std::filesystem::path& path, const Json::Value& root,
+        std::shared_ptr<const void> folder, int* objCounter = nullptr );
+
+    /// returns true if the model of this object was not loaded yet after lazy deserialization
+    [[nodiscard]] bool hasPendingModel() const { return bool( pendingModel_ ); }
+
+    /// loads the model postponed by lazy deserialization together with all other fields of this object,
+    /// or takes it ready if it was prefetched in background; the object is swapped with the loaded one,
+    /// so the name, transformation, visibility and selection set after deserialization, signal listeners and children are kept;
+    /// does nothing if there is no pending model
+    MRMESH_API Expected<void> loadPendingModel( ProgressCallback progressCb = {} );
+
+    /// queues loading of the pending model in a background thread, so that later loadPendingModel returns quickly;
+    /// at most two threads load the models in background, and the loadings not started till stopPrefetchingPendingModels call are skipped;
+    /// repeated calls for the same model do nothing
+    MRMESH_API void prefetchPendingModel() const;
+
+    /// skips all queued loadings of pending models and waits for the running ones, after that prefetchPendingModel does nothing;
+    /// shall be called before the program exits or the libraries with model loaders are unloaded
+    MRMESH_API static void stopPrefetchingPendingModels();
+
+    /// returns true if the pending model was already loaded in background (successfully or not), so loadPendingModel returns without waiting
+    [[nodiscard]] MRMESH_API bool isPendingModelLoaded() const;
+
+    /// returns the number of pending models of all objects, which are not loaded yet after lazy deserialization
+    [[nodiscard]] MRMESH_API static size_t numPendingModels();
+
     /// swaps this object with other
     /// note: do not swap object signals, so listeners will get notifications from swapped object
     /// requires implementation of `swapBase_` and `swapSignals_` (if type has signals)
@@ -269,6 +312,14 @@ protected:
     /// path is full filename without extension
     MRMESH_API virtual Expected<std::future<Expected<void>>> serializeModel_( const std::filesystem::path& path ) const;
 
+    /// returns true if serializeModel_ is called by serializeRecursive that keeps the models in memory,
+    /// then serializeModel_ may pass the model to addModelSerializedToMemory_ instead of saving the file
+    [[nodiscard]] MRMESH_API static bool canSerializeModelToMemory_();
+
+    /// adds the future serializing the model in memory exactly as serializeModel_ saves it in the file,
+    /// only if canSerializeModelToMemory_() is true
+    MRMESH_API static void addModelSerializedToMemory_( std::future<Expected<SerializedModelFile>> model );
+
     /// Write parameters to given Json::Value,
     /// \note if you override this method, please call Base::serializeFields_(root) in the beginning
     MRMESH_API virtual void serializeFields_( Json::Value& root ) const;
@@ -280,6 +331,16 @@ protected:
     /// \note if you override this method, please call Base::deserializeFields_(root) in the beginning
     MRMESH_API virtual void deserializeFields_( const Json::Value& root );
 
+    /// returns true if the loading of the model can be postponed by lazy deserialization,
+    /// which requires that the model is the only heavy data of the object and it does not depend on other fields
+    virtual bool canPostponeModel_() const { return false; }
+
+    /// returns the bounding box saved in the scene for the object with pending model
+    MRMESH_API std::optional<Box3f> pendingModelBox_() const;
+
+    /// logs a warning (once per object) that the model is accessed before loadPendingModel call, so it is still null
+    MRMESH_API void warnPendingModel_() const;
+
     std::string name_;
     ViewportProperty<AffineXf3f> xf_;
     ViewportMask visibilityMask_ = ViewportMask::all(); // Prefer to not read directly. Use the getter, as it can be overridden.
@@ -295,6 +356,14 @@ protected:
     MRMESH_API void sendWorldXfChangedSignal_();
     // Emits `worldXfChangedSignal`, but derived classes can add additional behavior to it.
     MRMESH_API virtual void onWorldXfChanged_();
+
+private:
+    struct PendingModel;
+    std::shared_ptr<PendingModel> pendingModel_; // not null after lazy deserialization till the model is loaded
+
+    // common implementation of deserializeRecursive and deserializeRecursiveLazy (if lazyFolder is not null)
+    Expected<void> deserializeRecursive_( const std::filesystem::path& path, const Json::Value& root,
+        const ProgressCallback& progressCb, int* objCounter, const std::shared_ptr<const void>* lazyFolder );
 };
 
 template <typename T>
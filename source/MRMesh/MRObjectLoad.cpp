@@ -23,6 +23,10 @@
 #include "MRSceneSettings.h"
 #include "MRMeshLoadSettings.h"
 #include "MRZip.h"
+#include "MRObjectsAccess.h"
+#include "MRObjectSave.h"
+#include "MRCube.h"
+#include "MRGTest.h"
 #include "MRVoxels/MRDicom.h"
 #include "MRPch/MRTBB.h"
 #include "MRPch/MRFmt.h"
@@ -480,10 +484,13 @@ Expected<LoadedObject> deserializeObjectTree( const std::filesystem::path& path,
     return deserializeObjectTreeFromFolder( scenePath, progressCb );
 }
 
-Expected<LoadedObject> deserializeObjectTreeFromFolder( const std::filesystem::path& folder,
-                                                        const ProgressCallback& progressCb )
+namespace
+{
+
+// if lazyFolder is not null then the models are not loaded, and the folder is kept till all of them are loaded
+Expected<LoadedObject> deserializeObjectTreeFromFolder_( const std::filesystem::path& folder,
+                                                         const ProgressCallback& progressCb, const std::shared_ptr<const void>* lazyFolder )
 {
-    MR_TIMER;
 
     std::error_code ec;
     std::filesystem::path jsonFile;
@@ -551,7 +558,9 @@ Expected<LoadedObject> deserializeObjectTreeFromFolder( const std::filesystem::p
         };
     }
 
-    auto resDeser = res.obj->deserializeRecursive( folder, root, cb, &modelCounter );
+    auto resDeser = lazyFolder ?
+        res.obj->deserializeRecursiveLazy( folder, root, *lazyFolder, &modelCounter ) :
+        res.obj->deserializeRecursive( folder, root, cb, &modelCounter );
     if ( !resDeser.has_value() )
     {
         std::string errorStr = resDeser.error();
@@ -563,6 +572,65 @@ Expected<LoadedObject> deserializeObjectTreeFromFolder( const std::filesystem::p
     return res;
 }
 
+// returns given object and all its descendants with not loaded models in depth-first order
+std::vector<Object*> getPendingObjects( Object& root )
+{
+    std::vector<Object*> res;
+    if ( root.hasPendingModel() )
+        res.push_back( &root );
+    for ( const auto& obj : getAllObjectsInTree<Object>( root, ObjectSelectivityType::Any ) )
+        if ( obj->hasPendingModel() )
+            res.push_back( obj.get() );
+    return res;
+}
+
+} // anonymous namespace
+
+Expected<LoadedObject> deserializeObjectTreeFromFolder( const std::filesystem::path& folder,
+                                                        const ProgressCallback& progressCb )
+{
+    MR_TIMER;
+    return deserializeObjectTreeFromFolder_( folder, progressCb, nullptr );
+}
+
+Expected<LoadedObject> deserializeObjectTreeLazy( const std::filesystem::path& path, bool prefetch, const ProgressCallback& progressCb )
+{
+    MR_TIMER;
+    auto scenePath = std::make_shared<UniqueTemporaryFolder>( FolderCallback{} );
+    if ( !*scenePath )
+        return unexpected( "Cannot create temporary folder" );
+    auto res = decompressZip( path, *scenePath );
+    if ( !res.has_value() )
+        return unexpected( std::move( res.error() ) );
+    if ( !reportProgress( progressCb, 0.9f ) )
+        return unexpectedOperationCanceled();
+
+    const std::shared_ptr<const void> folder = scenePath;
+    auto loaded = deserializeObjectTreeFromFolder_( *scenePath, {}, &folder );
+    if ( loaded.has_value() && prefetch )
+        for ( auto obj : getPendingObjects( *loaded->obj ) )
+            obj->prefetchPendingModel();
+    if ( !reportProgress( progressCb, 1.0f ) )
+        return unexpectedOperationCanceled();
+    return loaded;
+}
+
+Expected<void> loadPendingModels( Object& root, const ProgressCallback& progressCb )
+{
+    MR_TIMER;
+    const auto objs = getPendingObjects( root );
+    // other threads load next models while this thread waits for the current one
+    for ( auto obj : objs )
+        obj->prefetchPendingModel();
+    for ( size_t i = 0; i < objs.size(); ++i )
+    {
+        auto res = objs[i]->loadPendingModel( subprogress( progressCb, i, objs.size() ) );
+        if ( !res.has_value() )
+            return res;
+    }
+    return {};
+}
+
 Expected<LoadedObject> deserializeObjectTree( const std::filesystem::path& path, const ProgressCallback& progressCb )
 {
     return deserializeObjectTree( path, FolderCallback{}, progressCb );
@@ -570,4 +638,62 @@ Expected<LoadedObject> deserializeObjectTree( const std::filesystem::path& path,
 
 MR_ADD_SCENE_LOADER_WITH_PRIORITY( IOFilter( "MeshInspector scene (.mru)", "*.mru" ), deserializeObjectTree, -1 )
 
+TEST( MRMesh, LazySceneLoad )
+{
+    auto scene = std::make_shared<Object>();
+    auto objMesh = std::make_shared<ObjectMesh>();
+    objMesh->setName( "Cube" );
+    objMesh->setMesh( std::make_shared<Mesh>( makeCube() ) );
+    scene->addChild( objMesh );
+    auto objPoints = std::make_shared<ObjectPoints>();
+    objPoints->setName( "Points" );
+    auto cloud = std::make_shared<PointCloud>();
+    cloud->points = objMesh->mesh()->points;
+    cloud->validPoints.resize( cloud->points.size(), true );
+    objPoints->setPointCloud( cloud );
+    objMesh->addChild( objPoints );
+
+    UniqueTemporaryFolder folder( {} );
+    const auto path = folder / "scene.mru";
+    ASSERT_TRUE( serializeObjectTree( *scene, path ).has_value() );
+
+    for ( bool prefetch : { false, true } )
+    {
+        auto loaded = deserializeObjectTreeLazy( path, prefetch );
+        ASSERT_TRUE( loaded.has_value() );
+        auto mesh = getAllObjectsInTree<ObjectMesh>( *loaded->obj, ObjectSelectivityType::Any );
+        auto points = getAllObjectsInTree<ObjectPoints>( *loaded->obj, ObjectSelectivityType::Any );
+        ASSERT_EQ( mesh.size(), 1 );
+        ASSERT_EQ( points.size(), 1 );
+        EXPECT_TRUE( mesh[0]->hasPendingModel() );
+        EXPECT_FALSE( mesh[0]->mesh() );
+        EXPECT_EQ( mesh[0]->name(), "Cube" );
+        EXPECT_EQ( mesh[0]->getWorldBox(), objMesh->getWorldBox() );
+
+        // the scene with pending models is saved without their loading
+        const auto path2 = folder / "scene2.mru";
+        ASSERT_TRUE( serializeObjectTree( *loaded->obj, path2 ).has_value() );
+
+        mesh[0]->setName( "Renamed" );
+        ASSERT_TRUE( mesh[0]->loadPendingModel().has_value() );
+        EXPECT_FALSE( mesh[0]->hasPendingModel() );
+        ASSERT_TRUE( mesh[0]->mesh() );
+        EXPECT_EQ( mesh[0]->mesh()->points, objMesh->mesh()->points );
+        EXPECT_EQ( mesh[0]->name(), "Renamed" );
+        EXPECT_EQ( mesh[0]->children().size(), 1 );
+        EXPECT_TRUE( points[0]->hasPendingModel() );
+
+        auto loaded2 = deserializeObjectTree( path2 );
+        ASSERT_TRUE( loaded2.has_value() );
+        ASSERT_TRUE( loadPendingModels( *loaded->obj ).has_value() );
+        for ( const auto & obj : { loaded->obj, loaded2->obj } )
+        {
+            auto points2 = getAllObjectsInTree<ObjectPoints>( *obj, ObjectSelectivityType::Any );
+            ASSERT_EQ( points2.size(), 1 );
+            ASSERT_TRUE( points2[0]->pointCloud() );
+            EXPECT_EQ( points2[0]->pointCloud()->points, objPoints->pointCloud()->points );
+        }
+    }
+}
+
 } //namespace MR
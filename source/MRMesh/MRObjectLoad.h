@@ -71,6 +71,19 @@ MRMESH_API Expected<LoadedObject> deserializeObjectTree( const std::filesystem::
 MRMESH_API Expected<LoadedObject> deserializeObjectTreeFromFolder( const std::filesystem::path& folder,
                                                                    const ProgressCallback& progressCb = {} );
 
+/**
+ * \brief loads objects tree from given scene file (zip/mru) postponing the loading of meshes, point clouds and voxels
+ * \details the tree, names, transformations and bounding boxes of all objects are available immediately,
+ * and the model of each object is loaded by Object::loadPendingModel (e.g. on first display of the object);
+ * the decompressed files are removed when all pending models are loaded or their objects are destroyed
+ * \param prefetch if true then all pending models are queued for loading in background threads in the order of the tree
+ */
+MRMESH_API Expected<LoadedObject> deserializeObjectTreeLazy( const std::filesystem::path& path, bool prefetch = true,
+                                                             const ProgressCallback& progressCb = {} );
+
+/// loads all pending models in given objects tree after deserializeObjectTreeLazy
+MRMESH_API Expected<void> loadPendingModels( Object& root, const ProgressCallback& progressCb = {} );
+
 
 /// returns filters for all supported file formats for all types of objects
 MRMESH_API IOFilters getAllFilters();
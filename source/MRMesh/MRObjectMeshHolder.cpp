@@ -17,6 +17,7 @@
 #include "MRDirectory.h"
 #include "MRPch/MRJson.h"
 #include "MRPch/MRAsyncLaunchType.h"
+#include <sstream>
 
 namespace MR
 {
@@ -54,27 +55,39 @@ Expected<std::future<Expected<void>>> ObjectMeshHolder::serializeModel_( const s
     if ( ancillary_ || !mesh_ )
         return {};
 
+    std::string serializeFormat = serializeFormat_ ? serializeFormat_ : defaultSerializeMeshFormat();
+    auto meshSaver = MeshSave::getMeshSaver( "*" + serializeFormat );
+    if ( meshSaver.fileSave == nullptr )
+    {
+        serializeFormat = ".ply";
+        meshSaver = MeshSave::getMeshSaver( "*" + serializeFormat );
+    }
+    auto filename = path;
+    filename += serializeFormat;
+
     SaveSettings saveSettings;
     saveSettings.saveValidOnly = false;
     saveSettings.rearrangeTriangles = false;
     if ( !vertsColorMap_.empty() )
         saveSettings.colors = &vertsColorMap_;
-    auto save = [mesh = mesh_, serializeFormat = serializeFormat_ ? serializeFormat_ : defaultSerializeMeshFormat(), path, saveSettings]()
+
+    if ( canSerializeModelToMemory_() && meshSaver.streamSave != nullptr )
     {
-        auto filename = path;
-        const auto extension = std::string( "*" ) + serializeFormat;
-        if ( auto meshSaver = MeshSave::getMeshSaver( extension ); meshSaver.fileSave != nullptr )
-        {
-            filename += serializeFormat;
-            return meshSaver.fileSave( *mesh, filename, saveSettings );
-        }
-        else
+        addModelSerializedToMemory_( std::async( getAsyncLaunchType(),
+            [mesh = mesh_, streamSave = meshSaver.streamSave, filename, saveSettings]() -> Expected<SerializedModelFile>
         {
-            filename += ".ply";
-            return MR::MeshSave::toAnySupportedFormat( *mesh, filename, saveSettings );
-        }
-    };
-    return std::async( getAsyncLaunchType(), save );
+            std::ostringstream out( std::ios::binary );
+            if ( auto res = streamSave( *mesh, out, saveSettings ); !res )
+                return unexpected( std::move( res.error() ) );
+            return SerializedModelFile{ filename, std::move( out ).str() };
+        } ) );
+        return {};
+    }
+
+    return std::async( getAsyncLaunchType(), [mesh = mesh_, fileSave = meshSaver.fileSave, filename, saveSettings]
+    {
+        return fileSave( *mesh, filename, saveSettings );
+    } );
 }
 
 void ObjectMeshHolder::serializeFields_( Json::Value& root ) const
@@ -588,7 +601,7 @@ bool ObjectMeshHolder::isMeshClosed() const
 Box3f ObjectMeshHolder::getWorldBox( ViewportId id ) const
 {
     if ( !mesh_ )
-        return {};
+        return VisualObject::getWorldBox( id ); // not empty only if the model was not loaded yet
     bool isDef = true;
     const auto worldXf = this->worldXf( id, &isDef );
     if ( isDef )
@@ -44,8 +44,13 @@ public:
 
     [[nodiscard]] virtual bool hasModel() const override { return bool( mesh_ ); }
 
+    /// returns null if the model is not loaded yet after lazy deserialization (see Object::loadPendingModel), and logs it
     const std::shared_ptr< const Mesh >& mesh() const
-    { return reinterpret_cast< const std::shared_ptr<const Mesh>& >( mesh_ ); } // reinterpret_cast to avoid making a copy of shared_ptr
+    {
+        if ( hasPendingModel() )
+            warnPendingModel_();
+        return reinterpret_cast< const std::shared_ptr<const Mesh>& >( mesh_ ); // reinterpret_cast to avoid making a copy of shared_ptr
+    }
 
     /// \return the pair ( mesh, selected triangles ) if any triangle is selected or whole mesh otherwise
     MeshPart meshPart() const { return selectedTriangles_.any() ? MeshPart{ *mesh_, &selectedTriangles_ } : *mesh_; }
@@ -268,6 +273,8 @@ protected:
 
     MRMESH_API Expected<void> deserializeModel_( const std::filesystem::path& path, ProgressCallback progressCb = {} ) override;
 
+    bool canPostponeModel_() const override { return true; }
+
     /// set all visualize properties masks
     MRMESH_API void setAllVisualizeProperties_( const AllVisualizeProperties& properties, std::size_t& pos ) override;
 
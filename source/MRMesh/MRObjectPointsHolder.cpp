@@ -12,6 +12,7 @@
 #include "MRPch/MRJson.h"
 #include "MRPch/MRTBB.h"
 #include "MRPch/MRAsyncLaunchType.h"
+#include <sstream>
 
 namespace MR
 {
@@ -163,7 +164,7 @@ void ObjectPointsHolder::setPointSize( float size )
 Box3f ObjectPointsHolder::getWorldBox( ViewportId id ) const
 {
     if ( !points_ )
-        return {};
+        return VisualObject::getWorldBox( id ); // not empty only if the model was not loaded yet
     bool isDef = true;
     const auto worldXf = this->worldXf( id, &isDef );
     if ( isDef )
@@ -256,27 +257,39 @@ Expected<std::future<Expected<void>>> ObjectPointsHolder::serializeModel_( const
     if ( points_->points.empty() ) // some formats (e.g. .ctm) require at least one point in the vector
         return std::async( getAsyncLaunchType(), []{ return Expected<void>{}; } );
 
+    std::string serializeFormat = serializeFormat_ ? serializeFormat_ : defaultSerializePointsFormat();
+    auto pointsSaver = PointsSave::getPointsSaver( "*" + serializeFormat );
+    if ( pointsSaver.fileSave == nullptr )
+    {
+        serializeFormat = ".ply";
+        pointsSaver = PointsSave::getPointsSaver( "*" + serializeFormat );
+    }
+    auto filename = path;
+    filename += serializeFormat;
+
     SaveSettings saveSettings;
     saveSettings.saveValidOnly = false;
     saveSettings.rearrangeTriangles = false;
     if ( !vertsColorMap_.empty() )
         saveSettings.colors = &vertsColorMap_;
-    auto save = [points = points_, serializeFormat = serializeFormat_ ? serializeFormat_ : defaultSerializePointsFormat(), path, saveSettings]()
+
+    if ( canSerializeModelToMemory_() && pointsSaver.streamSave != nullptr )
     {
-        auto filename = path;
-        const auto extension = std::string( "*" ) + serializeFormat;
-        if ( auto pointsSaver = PointsSave::getPointsSaver( extension ); pointsSaver.fileSave != nullptr )
-        {
-            filename += serializeFormat;
-            return pointsSaver.fileSave( *points, filename, saveSettings );
-        }
-        else
+        addModelSerializedToMemory_( std::async( getAsyncLaunchType(),
+            [points = points_, streamSave = pointsSaver.streamSave, filename, saveSettings]() -> Expected<SerializedModelFile>
         {
-            filename += ".ply";
-            return MR::PointsSave::toAnySupportedFormat( *points, filename, saveSettings );
-        }
-    };
-    return std::async( getAsyncLaunchType(), save );
+            std::ostringstream out( std::ios::binary );
+            if ( auto res = streamSave( *points, out, saveSettings ); !res )
+                return unexpected( std::move( res.error() ) );
+            return SerializedModelFile{ filename, std::move( out ).str() };
+        } ) );
+        return {};
+    }
+
+    return std::async( getAsyncLaunchType(), [points = points_, fileSave = pointsSaver.fileSave, filename, saveSettings]
+    {
+        return fileSave( *points, filename, saveSettings );
+    } );
 }
 
 Expected<void> ObjectPointsHolder::deserializeModel_( const std::filesystem::path& path, ProgressCallback progressCb )
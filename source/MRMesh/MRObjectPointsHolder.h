@@ -31,8 +31,13 @@ public:
 
     [[nodiscard]] virtual bool hasModel() const override { return bool( points_ ); }
 
+    /// returns null if the model is not loaded yet after lazy deserialization (see Object::loadPendingModel), and logs it
     const std::shared_ptr<const PointCloud>& pointCloud() const
-    { return reinterpret_cast< const std::shared_ptr<const PointCloud>& >( points_ ); } // reinterpret_cast to avoid making a copy of shared_ptr
+    {
+        if ( hasPendingModel() )
+            warnPendingModel_();
+        return reinterpret_cast< const std::shared_ptr<const PointCloud>& >( points_ ); // reinterpret_cast to avoid making a copy of shared_ptr
+    }
 
     MRMESH_API virtual std::shared_ptr<Object> clone() const override;
     MRMESH_API virtual std::shared_ptr<Object> shallowClone() const override;
@@ -157,6 +162,8 @@ protected:
 
     MRMESH_API virtual Expected<void> deserializeModel_( const std::filesystem::path& path, ProgressCallback progressCb = {} ) override;
 
+    virtual bool canPostponeModel_() const override { return true; }
+
     MRMESH_API virtual void serializeFields_( Json::Value& root ) const override;
 
     MRMESH_API virtual void deserializeFields_( const Json::Value& root ) override;
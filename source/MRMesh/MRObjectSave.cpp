@@ -203,7 +203,13 @@ Expected<void> serializeObjectTree( const Object& object, const std::filesystem:
 
     Json::Value root;
     root["FormatVersion"] = "0.0";
-    auto expectedSaveModelFutures = object.serializeRecursive( scenePath, root, 0 );
+    // the models serialized in memory are compressed directly in the archive without writing them in the folder,
+    // unless the folder is given to preCompress callback;
+    // all serialized models are kept in memory till compression, so large scenes are saved in the folder to limit memory consumption
+    constexpr size_t cMaxMemoryModelsBytes = size_t( 1 ) << 30;
+    const bool modelsInMemory = !preCompress && object.heapBytes() <= cMaxMemoryModelsBytes;
+    std::vector<std::future<Expected<SerializedModelFile>>> memoryModelFutures;
+    auto expectedSaveModelFutures = object.serializeRecursive( scenePath, root, 0, modelsInMemory ? &memoryModelFutures : nullptr );
     if ( !expectedSaveModelFutures.has_value() )
         return unexpected( expectedSaveModelFutures.error() );
     auto & saveModelFutures = expectedSaveModelFutures.value();
@@ -224,12 +230,17 @@ Expected<void> serializeObjectTree( const Object& object, const std::filesystem:
         return unexpectedOperationCanceled();
 
     // wait for all models are saved before making compressed folder
-    BitSet inProgress( saveModelFutures.size(), true );
+    const auto waitModel = [&] ( size_t i )
+    {
+        constexpr auto timeout = std::chrono::milliseconds( 200 );
+        return i < saveModelFutures.size() ? saveModelFutures[i].wait_for( timeout ) : memoryModelFutures[i - saveModelFutures.size()].wait_for( timeout );
+    };
+    BitSet inProgress( saveModelFutures.size() + memoryModelFutures.size(), true );
     while ( inProgress.any() )
     {
         for ( auto i : inProgress )
         {
-            if ( saveModelFutures[i].wait_for( std::chrono::milliseconds( 200 ) ) != std::future_status::timeout )
+            if ( waitModel( i ) != std::future_status::timeout )
                 inProgress.reset( i );
         }
         if ( !reportProgress( subprogress( progressCb, 0.1f, 0.9f ), 1.0f - (float)inProgress.count() / inProgress.size() ) )
@@ -244,10 +255,20 @@ Expected<void> serializeObjectTree( const Object& object, const std::filesystem:
             return v;
     }
 
+    std::vector<ZipMemoryFile> memoryFiles;
+    memoryFiles.reserve( memoryModelFutures.size() );
+    for ( auto & f : memoryModelFutures )
+    {
+        auto v = f.get();
+        if ( !v )
+            return unexpected( std::move( v.error() ) );
+        memoryFiles.push_back( { std::move( v->path ), std::move( v->data ) } );
+    }
+
     if ( preCompress )
         preCompress( scenePath );
 
-    return compressZip( path, scenePath, {}, nullptr, subprogress( progressCb, 0.9f, 1.0f ) );
+    return compressZipWithMemoryFiles( path, scenePath, memoryFiles, subprogress( progressCb, 0.9f, 1.0f ) );
 }
 
 Expected<void> serializeObjectTree( const Object& object, const std::filesystem::path& path, ProgressCallback progress )
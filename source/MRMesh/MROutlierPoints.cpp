@@ -5,6 +5,7 @@
 #include "MRBestFit.h"
 #include "MRPointsInBall.h"
 #include "MRPointsComponents.h"
+#include "MRPointCloudNeighbors.h"
 
 namespace MR
 {
@@ -41,6 +42,17 @@ Expected<void> OutliersDetector::prepare( const PointCloud& pointCloud, float ra
     if ( calcBadNormalCached )
         badNormalStat_ = std::vector<float>( numVerts );
 
+    // reuse neighbours attached to the cloud if they were found in the same radius
+    const auto neis = pointCloud.getNeighborsNotCreate( { .radius = radius_ } );
+    auto forEachNeighbor = [&] ( VertId v0, auto && callback )
+    {
+        if ( neis )
+            neis->forEachNeighbor( v0, callback );
+        else
+            findPointsInBall( pointCloud.getAABBTree(), { pointCloud.points[v0], sqr( radius_ ) },
+                [&] ( VertId v1, const Vector3f& ) { callback( v1 ); } );
+    };
+
     VertBitSet secondPassVerts;
     ProgressCallback subProgress = subprogress( progress, 0.f, 0.4f );
     const auto& points = pointCloud.points;
@@ -56,8 +68,7 @@ Expected<void> OutliersDetector::prepare( const PointCloud& pointCloud, float ra
             int count = 0;
             PointAccumulator plane;
             Vector3f normalSum;
-            findPointsInBall( pointCloud.getAABBTree(), { pointCloud.points[v0], sqr( radius_ ) },
-                              [&] ( VertId v1, const Vector3f& )
+            forEachNeighbor( v0, [&] ( VertId v1 )
             {
                 if ( !contains( validPoints_, v1 ) )
                     return;
@@ -106,8 +117,7 @@ Expected<void> OutliersDetector::prepare( const PointCloud& pointCloud, float ra
         const int counterDivider = std::max( lastPassVertsCount / 100, 1 );
         for ( auto v0 : *lastPassVerts )
         {
-            findPointsInBall( pointCloud.getAABBTree(), { pointCloud.points[v0], sqr( radius_ ) },
-                              [&] ( VertId v1, const Vector3f& )
+            forEachNeighbor( v0, [&] ( VertId v1 )
             {
                 if ( v0 < v1 && contains( validPoints_, v1 ) )
                 {
@@ -0,0 +1,610 @@
+#include "MRPly.h"
+#include "MRIOParsing.h"
+#include "MRParallelFor.h"
+#include "MRTimer.h"
+#include "MRPch/MRTBB.h"
+
+#include <boost/spirit/home/x3.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+namespace MR
+{
+
+namespace
+{
+
+enum class PlyType
+{
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64,
+    Unknown
+};
+
+PlyType parsePlyType( std::string_view s )
+{
+    if ( s == "char" || s == "int8" )
+        return PlyType::Int8;
+    if ( s == "uchar" || s == "uint8" )
+        return PlyType::UInt8;
+    if ( s == "short" || s == "int16" )
+        return PlyType::Int16;
+    if ( s == "ushort" || s == "uint16" )
+        return PlyType::UInt16;
+    if ( s == "int" || s == "int32" )
+        return PlyType::Int32;
+    if ( s == "uint" || s == "uint32" )
+        return PlyType::UInt32;
+    if ( s == "float" || s == "float32" )
+        return PlyType::Float32;
+    if ( s == "double" || s == "float64" )
+        return PlyType::Float64;
+    return PlyType::Unknown;
+}
+
+size_t plyTypeSize( PlyType t )
+{
+    switch ( t )
+    {
+    case PlyType::Int8:
+    case PlyType::UInt8:
+        return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:
+        return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32:
+        return 4;
+    case PlyType::Float64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+template <typename V>
+V load( const char* p )
+{
+    V v;
+    std::memcpy( &v, p, sizeof( V ) );
+    return v;
+}
+
+/// reads one binary little-endian value of given type
+double readBinary( const char* p, PlyType t )
+{
+    switch ( t )
+    {
+    case PlyType::Int8:
+        return load<std::int8_t>( p );
+    case PlyType::UInt8:
+        return load<std::uint8_t>( p );
+    case PlyType::Int16:
+        return load<std::int16_t>( p );
+    case PlyType::UInt16:
+        return load<std::uint16_t>( p );
+    case PlyType::Int32:
+        return load<std::int32_t>( p );
+    case PlyType::UInt32:
+        return load<std::uint32_t>( p );
+    case PlyType::Float32:
+        return load<float>( p );
+    case PlyType::Float64:
+        return load<double>( p );
+    default:
+        assert( false );
+        return 0;
+    }
+}
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type = PlyType::Unknown;
+    PlyType countType = PlyType::Unknown; ///< the type of list size, or Unknown for scalar property
+    size_t offset = 0; ///< the offset from row start in binary format, valid only for the properties before the first list
+
+    bool isList() const { return countType != PlyType::Unknown; }
+};
+
+struct PlyElement
+{
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> props;
+    size_t rowSize = 0; ///< the size of each row in binary format, or 0 if the element has list properties
+
+    /// returns the index of scalar property with given name, or -1 if not found
+    int findScalar( std::string_view propName ) const
+    {
+        for ( int i = 0; i < (int)props.size(); ++i )
+            if ( props[i].name == propName && !props[i].isList() )
+                return i;
+        return -1;
+    }
+
+    /// finds N scalar properties trying the groups of names in order;
+    /// returns false and fills idx with -1 if none group is found completely
+    template <size_t N>
+    bool findScalars( std::initializer_list<std::array<std::string_view, N>> groups, int ( &idx )[N] ) const
+    {
+        for ( const auto& names : groups )
+        {
+            bool found = true;
+            for ( size_t i = 0; i < N && found; ++i )
+                found = ( idx[i] = findScalar( names[i] ) ) >= 0;
+            if ( found )
+                return true;
+        }
+        for ( auto& i : idx )
+            i = -1;
+        return false;
+    }
+};
+
+enum class PlyFormat
+{
+    Ascii,
+    BinaryLittleEndian,
+    BinaryBigEndian
+};
+
+struct PlyHeader
+{
+    PlyFormat format = PlyFormat::Ascii;
+    std::vector<PlyElement> elements;
+    size_t dataStart = 0; ///< the offset of the first byte after end_header line
+};
+
+std::vector<std::string_view> splitTokens( std::string_view line )
+{
+    std::vector<std::string_view> res;
+    size_t pos = 0;
+    for ( ;; )
+    {
+        pos = line.find_first_not_of( " \t\r", pos );
+        if ( pos == std::string_view::npos )
+            break;
+        auto end = line.find_first_of( " \t\r", pos );
+        if ( end == std::string_view::npos )
+            end = line.size();
+        res.push_back( line.substr( pos, end - pos ) );
+        pos = end;
+    }
+    return res;
+}
+
+/// parses PLY header, returns nullopt if it is invalid
+std::optional<PlyHeader> parsePlyHeader( const char* data, size_t size )
+{
+    PlyHeader res;
+    bool gotFormat = false;
+    size_t pos = 0;
+    for ( int lineNo = 0; pos < size; ++lineNo )
+    {
+        const auto* nl = (const char*)std::memchr( data + pos, '\n', size - pos );
+        if ( !nl )
+            return {};
+        const std::string_view line( data + pos, nl - data - pos );
+        pos = nl - data + 1;
+        const auto tokens = splitTokens( line );
+        if ( lineNo == 0 )
+        {
+            if ( tokens.size() != 1 || tokens[0] != "ply" )
+                return {};
+            continue;
+        }
+        if ( tokens.empty() )
+            continue;
+
+        if ( tokens[0] == "format" )
+        {
+            if ( tokens.size() < 2 )
+                return {};
+            if ( tokens[1] == "ascii" )
+                res.format = PlyFormat::Ascii;
+            else if ( tokens[1] == "binary_little_endian" )
+                res.format = PlyFormat::BinaryLittleEndian;
+            else if ( tokens[1] == "binary_big_endian" )
+                res.format = PlyFormat::BinaryBigEndian;
+            else
+                return {};
+            gotFormat = true;
+        }
+        else if ( tokens[0] == "element" )
+        {
+            if ( tokens.size() < 3 )
+                return {};
+            PlyElement elem;
+            elem.name = tokens[1];
+            const auto [ptr, ec] = std::from_chars( tokens[2].data(), tokens[2].data() + tokens[2].size(), elem.count );
+            if ( ec != std::errc() )
+                return {};
+            res.elements.push_back( std::move( elem ) );
+        }
+        else if ( tokens[0] == "property" )
+        {
+            if ( res.elements.empty() )
+                return {};
+            PlyProperty prop;
+            if ( tokens.size() >= 5 && tokens[1] == "list" )
+            {
+                prop.countType = parsePlyType( tokens[2] );
+                prop.type = parsePlyType( tokens[3] );
+                prop.name = tokens[4];
+                if ( prop.countType == PlyType::Unknown )
+                    return {};
+            }
+            else if ( tokens.size() >= 3 )
+            {
+                prop.type = parsePlyType( tokens[1] );
+                prop.name = tokens[2];
+            }
+            if ( prop.type == PlyType::Unknown )
+                return {};
+            res.elements.back().props.push_back( std::move( prop ) );
+        }
+        else if ( tokens[0] == "end_header" )
+        {
+            if ( !gotFormat )
+                return {};
+            res.dataStart = pos;
+            for ( auto& elem : res.elements )
+            {
+                size_t offset = 0;
+                bool fixedSize = true;
+                for ( auto& prop : elem.props )
+                {
+                    if ( prop.isList() )
+                    {
+                        fixedSize = false;
+                        break;
+                    }
+                    prop.offset = offset;
+                    offset += plyTypeSize( prop.type );
+                }
+                elem.rowSize = fixedSize ? offset : 0;
+            }
+            return res;
+        }
+        // comment, obj_info and unknown lines are ignored
+    }
+    return {};
+}
+
+/// parses all numbers in ASCII line
+bool parseAsciiRow( const char* begin, const char* end, std::vector<double>& values )
+{
+    using namespace boost::spirit::x3;
+    values.clear();
+    return phrase_parse( begin, end, *double_, space, values ) && begin == end;
+}
+
+/// the layout of face element with single list of vertex indices
+struct FaceLayout
+{
+    int listProp = -1;
+    size_t listOffset = 0; ///< the offset of list size in binary row
+    size_t rowSize = 0;    ///< the size of binary row provided that all faces are triangles
+};
+
+std::optional<FaceLayout> findFaceLayout( const PlyElement& elem )
+{
+    FaceLayout res;
+    size_t scalarsSize = 0;
+    for ( int i = 0; i < (int)elem.props.size(); ++i )
+    {
+        const auto& prop = elem.props[i];
+        if ( !prop.isList() )
+        {
+            scalarsSize += plyTypeSize( prop.type );
+            continue;
+        }
+        if ( res.listProp >= 0 || ( prop.name != "vertex_indices" && prop.name != "vertex_index" ) )
+            return {};
+        res.listProp = i;
+        res.listOffset = scalarsSize;
+    }
+    if ( res.listProp < 0 )
+        return {};
+    const auto& list = elem.props[res.listProp];
+    res.rowSize = scalarsSize + plyTypeSize( list.countType ) + 3 * plyTypeSize( list.type );
+    return res;
+}
+
+/// the indices of vertex properties in vertex element, -1 for absent ones
+struct VertexLayout
+{
+    int pos[3];
+    int normal[3];
+    int color[3];
+    int uv[2];
+};
+
+VertexLayout findVertexLayout( const PlyElement& elem, const PlyReadSettings& settings )
+{
+    VertexLayout res;
+    elem.findScalars<3>( { { "x", "y", "z" } }, res.pos );
+    elem.findScalars<3>( { { "nx", "ny", "nz" } }, res.normal );
+    elem.findScalars<3>( { { "r", "g", "b" }, { "red", "green", "blue" } }, res.color );
+    elem.findScalars<2>( { { "u", "v" }, { "s", "t" }, { "texture_u", "texture_v" }, { "texture_s", "texture_t" } }, res.uv );
+    if ( !settings.normals )
+        res.normal[0] = -1;
+    if ( !settings.colors )
+        res.color[0] = -1;
+    if ( !settings.uvCoords )
+        res.uv[0] = -1;
+    return res;
+}
+
+/// fills the data of one vertex, given the function returning the value of vertex property by its index
+template <typename GetValue>
+void decodeVertex( PlyData& res, const VertexLayout& l, VertId v, const GetValue& get )
+{
+    res.points[v] = Vector3f( float( get( l.pos[0] ) ), float( get( l.pos[1] ) ), float( get( l.pos[2] ) ) );
+    if ( l.normal[0] >= 0 )
+        res.normals[v] = Vector3f( float( get( l.normal[0] ) ), float( get( l.normal[1] ) ), float( get( l.normal[2] ) ) );
+    if ( l.color[0] >= 0 )
+    {
+        auto toByte = [] ( double x ) { return std::uint8_t( std::clamp( x, 0.0, 255.0 ) ); };
+        res.colors[v] = Color( toByte( get( l.color[0] ) ), toByte( get( l.color[1] ) ), toByte( get( l.color[2] ) ) );
+    }
+    if ( l.uv[0] >= 0 )
+        res.uvCoords[v] = UVCoord( float( get( l.uv[0] ) ), float( get( l.uv[1] ) ) );
+}
+
+void resizeVertexData( PlyData& res, const VertexLayout& l, size_t numVerts )
+{
+    res.points.resizeNoInit( numVerts );
+    if ( l.normal[0] >= 0 )
+        res.normals.resizeNoInit( numVerts );
+    if ( l.color[0] >= 0 )
+        res.colors.resizeNoInit( numVerts );
+    if ( l.uv[0] >= 0 )
+        res.uvCoords.resizeNoInit( numVerts );
+}
+
+Expected<bool> readBinaryPly( const char* data, size_t size, const PlyHeader& header, const PlyReadSettings& settings, PlyData& res )
+{
+    const char* p = data + header.dataStart;
+    const char* const end = data + size;
+
+    const PlyElement* vertElem = nullptr;
+    const char* vertData = nullptr;
+    const PlyElement* faceElem = nullptr;
+    const char* faceData = nullptr;
+    FaceLayout faceLayout;
+    for ( const auto& elem : header.elements )
+    {
+        if ( vertElem && ( faceElem || !settings.faces ) )
+            break;
+        if ( !vertElem && elem.name == "vertex" )
+        {
+            if ( elem.rowSize == 0 )
+                return false;
+            vertElem = &elem;
+            vertData = p;
+        }
+        else if ( settings.faces && !faceElem && elem.name == "face" && elem.rowSize == 0 )
+        {
+            auto layout = findFaceLayout( elem );
+            if ( !layout )
+                return false;
+            faceLayout = *layout;
+            faceElem = &elem;
+            faceData = p;
+        }
+        const size_t rowSize = ( &elem == faceElem ) ? faceLayout.rowSize : elem.rowSize;
+        if ( rowSize == 0 )
+            return false; // unable to skip variable-size element
+        if ( elem.count > size_t( end - p ) / rowSize )
+            return false; // the data is truncated or the faces are not triangles
+        p += elem.count * rowSize;
+    }
+    if ( !vertElem )
+        return false;
+
+    const auto layout = findVertexLayout( *vertElem, settings );
+    if ( layout.pos[0] < 0 )
+        return false;
+
+    const float vertPart = faceElem ? float( vertElem->count ) / ( vertElem->count + faceElem->count ) : 1.f;
+    resizeVertexData( res, layout, vertElem->count );
+    if ( !ParallelFor( size_t( 0 ), vertElem->count, [&] ( size_t i )
+    {
+        const char* row = vertData + i * vertElem->rowSize;
+        decodeVertex( res, layout, VertId( i ), [&] ( int prop )
+        {
+            return readBinary( row + vertElem->props[prop].offset, vertElem->props[prop].type );
+        } );
+    }, subprogress( settings.callback, 0.f, vertPart ) ) )
+        return unexpectedOperationCanceled();
+
+    if ( !faceElem )
+        return true;
+
+    const auto& list = faceElem->props[faceLayout.listProp];
+    const size_t countSize = plyTypeSize( list.countType );
+    const size_t indexSize = plyTypeSize( list.type );
+    const auto numVerts = double( vertElem->count );
+    std::atomic<bool> nonTriangle{ false };
+    std::atomic<bool> badIndex{ false };
+    res.tris.resize( faceElem->count );
+    if ( !ParallelFor( size_t( 0 ), faceElem->count, [&] ( size_t i )
+    {
+        const char* row = faceData + i * faceLayout.rowSize + faceLayout.listOffset;
+        if ( readBinary( row, list.countType ) != 3 )
+        {
+            nonTriangle.store( true, std::memory_order_relaxed );
+            return;
+        }
+        row += countSize;
+        auto& t = res.tris[FaceId( i )];
+        for ( int j = 0; j < 3; ++j )
+        {
+            const auto v = readBinary( row + j * indexSize, list.type );
+            if ( !( v >= 0 && v < numVerts ) )
+            {
+                badIndex.store( true, std::memory_order_relaxed );
+                return;
+            }
+            t[j] = VertId( int( v ) );
+        }
+    }, subprogress( settings.callback, vertPart, 1.f ) ) )
+        return unexpectedOperationCanceled();
+
+    // if all list sizes at the expected positions are 3, then by induction all rows are really located there
+    if ( nonTriangle )
+    {
+        res.tris.clear();
+        return false;
+    }
+    if ( badIndex )
+        return unexpected( "PLY face references a vertex out of range" );
+    return true;
+}
+
+Expected<bool> readAsciiPly( const char* data, size_t size, const PlyHeader& header, const PlyReadSettings& settings, PlyData& res )
+{
+    if ( header.dataStart >= size )
+        return false;
+    const char* const rowsData = data + header.dataStart;
+    const auto lines = splitByLines( rowsData, size - header.dataStart );
+    const size_t numLines = lines.size() - 1;
+
+    // each row occupies exactly one line
+    const PlyElement* vertElem = nullptr;
+    size_t vertLine = 0;
+    const PlyElement* faceElem = nullptr;
+    size_t faceLine = 0;
+    size_t line = 0;
+    for ( const auto& elem : header.elements )
+    {
+        if ( vertElem && ( faceElem || !settings.faces ) )
+            break;
+        if ( !vertElem && elem.name == "vertex" )
+        {
+            vertElem = &elem;
+            vertLine = line;
+        }
+        else if ( settings.faces && !faceElem && elem.name == "face" && elem.rowSize == 0 )
+        {
+            faceElem = &elem;
+            faceLine = line;
+        }
+        if ( elem.count > numLines - line )
+            return false;
+        line += elem.count;
+    }
+    if ( !vertElem || vertElem->rowSize == 0 )
+        return false;
+
+    const auto layout = findVertexLayout( *vertElem, settings );
+    if ( layout.pos[0] < 0 )
+        return false;
+
+    std::optional<FaceLayout> faceLayout;
+    if ( faceElem )
+    {
+        faceLayout = findFaceLayout( *faceElem );
+        if ( !faceLayout )
+            return false;
+    }
+
+    tbb::enumerable_thread_specific<std::vector<double>> valuesPerThread;
+    // wrong number of values in a line means that the rows are not one per line
+    std::atomic<bool> unsupported{ false };
+    std::atomic<bool> badIndex{ false };
+
+    const float vertPart = faceElem ? float( vertElem->count ) / ( vertElem->count + faceElem->count ) : 1.f;
+    resizeVertexData( res, layout, vertElem->count );
+    const size_t numVertProps = vertElem->props.size();
+    if ( !ParallelFor( size_t( 0 ), vertElem->count, [&] ( size_t i )
+    {
+        auto& values = valuesPerThread.local();
+        const auto l = vertLine + i;
+        if ( !parseAsciiRow( rowsData + lines[l], rowsData + lines[l + 1], values ) || values.size() != numVertProps )
+        {
+            unsupported.store( true, std::memory_order_relaxed );
+            return;
+        }
+        decodeVertex( res, layout, VertId( i ), [&] ( int prop ) { return values[prop]; } );
+    }, subprogress( settings.callback, 0.f, vertPart ) ) )
+        return unexpectedOperationCanceled();
+
+    if ( !unsupported && faceElem )
+    {
+        // the position of list size among row values, and the total number of values in triangle row
+        const size_t countPos = faceLayout->listProp;
+        const size_t numFaceValues = faceElem->props.size() + 3;
+        const auto numVerts = double( vertElem->count );
+        res.tris.resize( faceElem->count );
+        if ( !ParallelFor( size_t( 0 ), faceElem->count, [&] ( size_t i )
+        {
+            auto& values = valuesPerThread.local();
+            const auto l = faceLine + i;
+            if ( !parseAsciiRow( rowsData + lines[l], rowsData + lines[l + 1], values ) || values.size() != numFaceValues || values[countPos] != 3 )
+            {
+                unsupported.store( true, std::memory_order_relaxed );
+                return;
+            }
+            auto& t = res.tris[FaceId( i )];
+            for ( int j = 0; j < 3; ++j )
+            {
+                const auto v = values[countPos + 1 + j];
+                if ( !( v >= 0 && v < numVerts ) )
+                {
+                    badIndex.store( true, std::memory_order_relaxed );
+                    return;
+                }
+                t[j] = VertId( int( v ) );
+            }
+        }, subprogress( settings.callback, vertPart, 1.f ) ) )
+            return unexpectedOperationCanceled();
+    }
+
+    if ( unsupported )
+    {
+        res = {};
+        return false;
+    }
+    if ( badIndex )
+        return unexpected( "PLY face references a vertex out of range" );
+    return true;
+}
+
+} //anonymous namespace
+
+Expected<bool> readPlyParallel( const char* data, size_t size, const PlyReadSettings& settings, PlyData& res )
+{
+    MR_TIMER
+
+    const auto header = parsePlyHeader( data, size );
+    if ( !header )
+        return false;
+
+    switch ( header->format )
+    {
+    case PlyFormat::Ascii:
+        return readAsciiPly( data, size, *header, settings, res );
+    case PlyFormat::BinaryLittleEndian:
+        return readBinaryPly( data, size, *header, settings, res );
+    default:
+        return false;
+    }
+}
+
+} //namespace MR
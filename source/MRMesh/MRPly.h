@@ -0,0 +1,42 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRExpected.h"
+#include "MRVector.h"
+#include "MRVector2.h"
+#include "MRVector3.h"
+#include "MRColor.h"
+#include "MRProgressCallback.h"
+
+namespace MR
+{
+
+/// what shall be read from PLY file by readPlyParallel
+struct PlyReadSettings
+{
+    bool normals = false;  ///< read per-vertex normals (nx, ny, nz) if they are present
+    bool colors = false;   ///< read per-vertex colors (red, green, blue) if they are present
+    bool uvCoords = false; ///< read per-vertex texture coordinates (u, v) if they are present
+    bool faces = false;    ///< read triangular faces from face element
+    ProgressCallback callback;
+};
+
+/// the data read from PLY file by readPlyParallel
+struct PlyData
+{
+    VertCoords points;
+    VertNormals normals;   ///< empty if not requested or not present in the file
+    VertColors colors;     ///< empty if not requested or not present in the file
+    VertUVCoords uvCoords; ///< empty if not requested or not present in the file
+    Triangulation tris;    ///< empty if not requested or not present in the file
+};
+
+/// reads PLY file from memory block (e.g. from memory mapped file) decoding vertex and face elements in parallel threads;
+/// only the layouts where all rows are located without sequential scanning are supported:
+/// ASCII files (one row per line) and little-endian binary files, where all elements before the needed ones have fixed size rows,
+/// and all faces are triangles;
+/// \return false if the layout of the file is not supported and it must be read by a sequential reader,
+/// true if the data was read successfully, or an error
+[[nodiscard]] MRMESH_API Expected<bool> readPlyParallel( const char* data, size_t size, const PlyReadSettings& settings, PlyData& res );
+
+} //namespace MR
@@ -1,5 +1,6 @@
 #include "MRPointCloud.h"
 #include "MRAABBTreePoints.h"
+#include "MRPointCloudNeighbors.h"
 #include "MRComputeBoundingBox.h"
 #include "MRPlane3.h"
 #include "MRBitSetParallelFor.h"
@@ -117,12 +118,23 @@ const AABBTreePoints& PointCloud::getAABBTree() const
     return AABBTreeOwner_.getOrCreate( [this]{ return AABBTreePoints( *this ); } );
 }
 
+std::shared_ptr<const PointNeighbors> PointCloud::getNeighbors( const PointNeighborsSettings& settings ) const
+{
+    return neighborsCache_.getOrCreate( settings, [this, &settings]{ return std::move( *findPointNeighbors( *this, settings ) ); } );
+}
+
+std::shared_ptr<const PointNeighbors> PointCloud::getNeighborsNotCreate( const PointNeighborsSettings& settings ) const
+{
+    return neighborsCache_.get( settings );
+}
+
 size_t PointCloud::heapBytes() const
 {
     return points.heapBytes()
         + normals.heapBytes()
         + validPoints.heapBytes()
-        + AABBTreeOwner_.heapBytes();
+        + AABBTreeOwner_.heapBytes()
+        + neighborsCache_.heapBytes();
 }
 
 void PointCloud::mirror( const Plane3f& plane )
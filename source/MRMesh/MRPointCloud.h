@@ -4,6 +4,7 @@
 #include "MRBitSet.h"
 #include "MRMeshFwd.h"
 #include "MRSharedThreadSafeOwner.h"
+#include "MRPointCloudNeighbors.h"
 #include "MRCloudPartMapping.h"
 
 namespace MR
@@ -42,6 +43,13 @@ struct PointCloud
     /// returns cached aabb-tree for this point cloud, but does not create it if it did not exist
     [[nodiscard]] const AABBTreePoints * getAABBTreeNotCreate() const { return AABBTreeOwner_.get(); }
 
+    /// returns cached neighbours of all points found with given settings, creating them if they did not exist in a thread-safe manner;
+    /// the neighbours found with other settings are kept in the cache as well, and the returned pointer remains valid after any cache invalidation
+    MRMESH_API std::shared_ptr<const PointNeighbors> getNeighbors( const PointNeighborsSettings& settings ) const;
+
+    /// returns cached neighbours of all points if they were found with given settings, but does not create them otherwise
+    [[nodiscard]] MRMESH_API std::shared_ptr<const PointNeighbors> getNeighborsNotCreate( const PointNeighborsSettings& settings ) const;
+
     /// returns the minimal bounding box containing all valid vertices (implemented via getAABBTree())
     [[nodiscard]] MRMESH_API Box3f getBoundingBox() const;
 
@@ -85,14 +93,15 @@ struct PointCloud
     /// \return points mapping: old -> new
     MRMESH_API VertBMap pack( Reorder reoder );
 
-    /// Invalidates caches (e.g. aabb-tree) after a change in point cloud
-    void invalidateCaches() { AABBTreeOwner_.reset(); }
+    /// Invalidates caches (e.g. aabb-tree, neighbours) after a change in point cloud
+    void invalidateCaches() { AABBTreeOwner_.reset(); neighborsCache_.reset(); }
 
     /// returns the amount of memory this object occupies on heap
     [[nodiscard]] MRMESH_API size_t heapBytes() const;
 
 private:
     mutable SharedThreadSafeOwner<AABBTreePoints> AABBTreeOwner_;
+    mutable PointNeighborsCache neighborsCache_;
 };
 
 } // namespace MR
@@ -13,6 +13,7 @@
 #include "MRHeap.h"
 #include "MRBuffer.h"
 #include "MRLocalTriangulations.h"
+#include "MRPointCloudNeighbors.h"
 #include <cfloat>
 
 namespace MR
@@ -22,15 +23,26 @@ std::optional<VertNormals> makeUnorientedNormals( const PointCloud& pointCloud,
 {
     MR_TIMER
 
+    // reuse neighbours attached to the cloud if they were found in the same radius
+    const auto neis = pointCloud.getNeighborsNotCreate( { .radius = radius } );
+
     VertNormals normals;
     normals.resizeNoInit( pointCloud.points.size() );
     if ( !BitSetParallelFor( pointCloud.validPoints, [&, radiusSq = sqr( radius )]( VertId vid )
     {
         PointAccumulator accum;
-        findPointsInBall( pointCloud, { pointCloud.points[vid], radiusSq }, [&]( VertId, const Vector3f& coord )
+        if ( neis )
         {
-            accum.addPoint( Vector3d( coord ) );
-        } );
+            accum.addPoint( pointCloud.points[vid] );
+            neis->forEachNeighbor( vid, [&]( VertId n ) { accum.addPoint( pointCloud.points[n] ); } );
+        }
+        else
+        {
+            findPointsInBall( pointCloud, { pointCloud.points[vid], radiusSq }, [&]( VertId, const Vector3f& coord )
+            {
+                accum.addPoint( Vector3d( coord ) );
+            } );
+        }
         auto n = Vector3f( accum.getBestPlane().n );
         if ( orient != OrientNormals::Smart )
         {
@@ -182,6 +194,16 @@ bool orientNormalsCore( const PointCloud& pointCloud, VertNormals& normals, cons
 
 bool orientNormals( const PointCloud& pointCloud, VertNormals& normals, float radius, const ProgressCallback & progress )
 {
+    // reuse neighbours attached to the cloud if they were found in the same radius
+    if ( const auto neis = pointCloud.getNeighborsNotCreate( { .radius = radius } ) )
+    {
+        return orientNormalsCore( pointCloud, normals,
+            [neis]( VertId base, auto callback )
+            {
+                neis->forEachNeighbor( base, callback );
+            }, progress );
+    }
+
     return orientNormalsCore( pointCloud, normals,
         [&, radiusSq = sqr( radius )]( VertId base, auto callback )
         {
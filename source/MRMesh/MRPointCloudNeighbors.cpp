@@ -0,0 +1,231 @@
+#include "MRPointCloudNeighbors.h"
+#include "MRPointCloud.h"
+#include "MRPointsInBall.h"
+#include "MRPointsProject.h"
+#include "MRFewSmallest.h"
+#include "MRParallelFor.h"
+#include "MRTimer.h"
+#include "MRMakeSphereMesh.h"
+#include "MRMesh.h"
+#include "MRPointCloudMakeNormals.h"
+#include "MROutlierPoints.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <cfloat>
+
+namespace MR
+{
+
+std::optional<PointNeighbors> findPointNeighbors( const PointCloud & cloud,
+    const PointNeighborsSettings & settings, const ProgressCallback & progress )
+{
+    MR_TIMER
+    assert( settings.radius > 0 || settings.numNei > 0 );
+
+    PointNeighbors res;
+    res.settings = settings;
+    const auto numPoints = cloud.points.size();
+    res.firstNei.resize( numPoints + 1 );
+    if ( numPoints == 0 )
+        return res;
+
+    cloud.getAABBTree(); // to avoid multiple calls to tree construction from parallel region
+
+    // each block of points collects the neighbours in its own vector,
+    // and the number of neighbours of point #v is stored in firstNei[v+1] for later prefix summation
+    constexpr size_t blockSize = 4096;
+    const size_t numBlocks = ( numPoints + blockSize - 1 ) / blockSize;
+    std::vector<std::vector<VertId>> blockNeis( numBlocks );
+
+    const float radiusSq = settings.radius > 0 ? sqr( settings.radius ) : FLT_MAX;
+    tbb::enumerable_thread_specific<FewSmallest<PointsProjectionResult>> perThreadFew( settings.numNei + 1 );
+
+    if ( !ParallelFor( size_t( 0 ), numBlocks, perThreadFew, [&]( size_t b, FewSmallest<PointsProjectionResult> & few )
+    {
+        auto & neis = blockNeis[b];
+        const VertId vBeg( b * blockSize );
+        const VertId vEnd( std::min( ( b + 1 ) * blockSize, numPoints ) );
+        for ( VertId v = vBeg; v < vEnd; ++v )
+        {
+            const auto sz0 = neis.size();
+            if ( cloud.validPoints.test( v ) )
+            {
+                if ( settings.numNei > 0 )
+                {
+                    few.clear();
+                    findFewClosestPoints( cloud.points[v], cloud, few, radiusSq );
+                    for ( const auto & n : few.get() )
+                        if ( n.vId != v && neis.size() < sz0 + settings.numNei )
+                            neis.push_back( n.vId );
+                }
+                else
+                {
+                    findPointsInBall( cloud, { cloud.points[v], radiusSq }, [&]( VertId n, const Vector3f & )
+                    {
+                        if ( n != v )
+                            neis.push_back( n );
+                    } );
+                }
+            }
+            res.firstNei[v + 1] = neis.size() - sz0;
+        }
+    }, subprogress( progress, 0.0f, 0.9f ), 1 ) )
+        return {};
+
+    std::vector<std::uint64_t> blockFirst( numBlocks + 1 );
+    for ( size_t b = 0; b < numBlocks; ++b )
+        blockFirst[b + 1] = blockFirst[b] + blockNeis[b].size();
+    res.neighbors.resize( blockFirst.back() );
+
+    if ( !ParallelFor( size_t( 0 ), numBlocks, [&]( size_t b )
+    {
+        auto & neis = blockNeis[b];
+        std::copy( neis.begin(), neis.end(), res.neighbors.data() + blockFirst[b] );
+        neis = {};
+
+        const VertId vBeg( b * blockSize );
+        const VertId vEnd( std::min( ( b + 1 ) * blockSize, numPoints ) );
+        auto pos = blockFirst[b];
+        for ( VertId v = vBeg; v < vEnd; ++v )
+        {
+            pos += res.firstNei[v + 1];
+            res.firstNei[v + 1] = pos;
+        }
+        assert( pos == blockFirst[b + 1] );
+    }, subprogress( progress, 0.9f, 1.0f ), 1 ) )
+        return {};
+
+    return res;
+}
+
+std::shared_ptr<const PointNeighbors> PointNeighborsCache::get( const PointNeighborsSettings& settings ) const
+{
+    std::lock_guard lock( mutex_ );
+    for ( const auto & p : all_ )
+        if ( p->settings == settings )
+            return p;
+    return {};
+}
+
+std::shared_ptr<const PointNeighbors> PointNeighborsCache::getOrCreate( const PointNeighborsSettings& settings,
+    const std::function<PointNeighbors()>& creator )
+{
+    if ( auto p = get( settings ) )
+        return p;
+    auto created = std::make_shared<const PointNeighbors>( creator() );
+    std::lock_guard lock( mutex_ );
+    // another thread could find the same neighbours meanwhile, then the first result is kept
+    for ( const auto & p : all_ )
+        if ( p->settings == settings )
+            return p;
+    all_.push_back( created );
+    return created;
+}
+
+void PointNeighborsCache::reset()
+{
+    std::lock_guard lock( mutex_ );
+    all_.clear();
+}
+
+size_t PointNeighborsCache::heapBytes() const
+{
+    std::lock_guard lock( mutex_ );
+    size_t res = MR::heapBytes( all_ );
+    for ( const auto & p : all_ )
+        res += p->heapBytes();
+    return res;
+}
+
+std::vector<std::shared_ptr<const PointNeighbors>> PointNeighborsCache::getAll_() const
+{
+    std::lock_guard lock( mutex_ );
+    return all_;
+}
+
+TEST( MRMesh, PointNeighbors )
+{
+    const auto sphere = makeUVSphere( 1, 16, 16 );
+    PointCloud pc;
+    pc.points = sphere.points;
+    pc.validPoints = sphere.topology.getValidVerts();
+
+    const float radius = 0.3f;
+    const auto neis = pc.getNeighbors( { .radius = radius } );
+    ASSERT_TRUE( neis );
+    EXPECT_EQ( neis->firstNei.size(), pc.points.size() + 1 );
+    EXPECT_EQ( pc.getNeighborsNotCreate( { .radius = radius } ), neis );
+    EXPECT_EQ( pc.getNeighborsNotCreate( { .numNei = 8 } ), nullptr );
+    for ( auto v : pc.validPoints )
+    {
+        size_t count = 0;
+        findPointsInBall( pc, { pc.points[v], sqr( radius ) }, [&]( VertId n, const Vector3f& )
+        {
+            if ( n != v )
+                ++count;
+        } );
+        EXPECT_EQ( neis->numNeighbors( v ), count );
+        neis->forEachNeighbor( v, [&]( VertId n )
+        {
+            EXPECT_LE( ( pc.points[n] - pc.points[v] ).lengthSq(), sqr( radius ) );
+        } );
+    }
+
+    // neighbours with other settings are cached separately and do not replace the first ones
+    const auto knn = pc.getNeighbors( { .numNei = 8 } );
+    for ( auto v : pc.validPoints )
+        EXPECT_EQ( knn->numNeighbors( v ), 8 );
+    EXPECT_EQ( pc.getNeighborsNotCreate( { .radius = radius } ), neis );
+    EXPECT_EQ( pc.getNeighbors( { .numNei = 8 } ), knn );
+    EXPECT_EQ( neis->settings.radius, radius );
+
+    // returned neighbours remain alive after invalidation
+    const auto copy = pc;
+    EXPECT_EQ( copy.getNeighborsNotCreate( { .numNei = 8 } ), knn );
+    pc.invalidateCaches();
+    EXPECT_EQ( pc.getNeighborsNotCreate( { .numNei = 8 } ), nullptr );
+    EXPECT_EQ( knn->settings.numNei, 8 );
+    EXPECT_EQ( knn->firstNei.size(), pc.points.size() + 1 );
+}
+
+TEST( MRMesh, PointNeighborsConsumers )
+{
+    const auto sphere = makeUVSphere( 1, 32, 32 );
+    PointCloud pc;
+    pc.points = sphere.points;
+    pc.validPoints = sphere.topology.getValidVerts();
+    // some isolated points to be found as outliers
+    for ( const auto & p : { Vector3f( 2, 0, 0 ), Vector3f( 0, 2, 0 ), Vector3f( 0, 0, 1.25f ) } )
+        pc.addPoint( p );
+
+    const float radius = 0.25f;
+    auto computeAll = [&] ( const PointCloud & cloud )
+    {
+        auto normals = makeUnorientedNormals( cloud, radius );
+        EXPECT_TRUE( normals );
+        auto oriented = *normals;
+        EXPECT_TRUE( orientNormals( cloud, oriented, radius ) );
+        OutliersDetector detector;
+        EXPECT_TRUE( detector.prepare( cloud, radius, OutlierTypeMask::All ) );
+        auto outliers = detector.find( OutlierTypeMask::All );
+        EXPECT_TRUE( outliers );
+        return std::make_tuple( std::move( *normals ), std::move( oriented ), std::move( *outliers ) );
+    };
+
+    const auto [normals0, oriented0, outliers0] = computeAll( pc );
+    EXPECT_FALSE( pc.getNeighborsNotCreate( { .radius = radius } ) );
+
+    pc.getNeighbors( { .radius = radius } );
+    const auto [normals1, oriented1, outliers1] = computeAll( pc );
+
+    // the same neighbours are visited in another order, so only tiny differences are possible
+    for ( auto v : pc.validPoints )
+    {
+        EXPECT_GT( std::abs( dot( normals0[v], normals1[v] ) ), 0.999f );
+        EXPECT_GT( dot( oriented0[v], oriented1[v] ), 0.999f );
+    }
+    EXPECT_EQ( outliers0, outliers1 );
+    EXPECT_TRUE( outliers0.test( pc.validPoints.find_last() ) );
+}
+
+} //namespace MR
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRVector.h"
+#include "MRHeapBytes.h"
+#include "MRId.h"
+#include "MRProgressCallback.h"
+#include "MRPch/MRBindingMacros.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace MR
+{
+
+/// \addtogroup PointCloudGroup
+/// \{
+
+/// parameters of neighbours search for PointNeighbors
+struct PointNeighborsSettings
+{
+    /// if positive then all points within this radius are neighbours (if numNei is zero),
+    /// or it limits the distance to neighbours (if numNei is positive)
+    float radius = 0;
+
+    /// if positive then given number of closest points (or less if radius limits them) are neighbours
+    int numNei = 0;
+
+    bool operator ==( const PointNeighborsSettings & ) const = default;
+};
+
+/// neighbours of all valid points of a cloud in compact CSR layout:
+/// neighbours of point #v (excluding v itself) are stored in neighbors[ firstNei[v] ... firstNei[v+1] )
+struct PointNeighbors
+{
+    /// the settings these neighbours were found with
+    PointNeighborsSettings settings;
+
+    /// concatenated neighbours of all points
+    std::vector<VertId> neighbors;
+
+    /// the position of first neighbour of each point in (neighbors), one element more than the number of points
+    Vector<std::uint64_t, VertId> firstNei;
+
+    /// returns the number of neighbours of given point
+    [[nodiscard]] size_t numNeighbors( VertId v ) const { return size_t( firstNei[v + 1] - firstNei[v] ); }
+
+    /// returns the pointer on the first neighbour of given point
+    [[nodiscard]] const VertId * beginNeighbors( VertId v ) const { return neighbors.data() + firstNei[v]; }
+
+    /// returns the pointer after the last neighbour of given point
+    [[nodiscard]] const VertId * endNeighbors( VertId v ) const { return neighbors.data() + firstNei[v + 1]; }
+
+    /// calls given function for each neighbour of given point
+    template <typename F>
+    void forEachNeighbor( VertId v, F && f ) const
+    {
+        for ( auto p = beginNeighbors( v ), pEnd = endNeighbors( v ); p < pEnd; ++p )
+            f( *p );
+    }
+
+    /// returns the amount of memory this object occupies on heap
+    [[nodiscard]] size_t heapBytes() const { return MR::heapBytes( neighbors ) + firstNei.heapBytes(); }
+};
+
+/// thread-safe cache of the neighbours found with different settings;
+/// the neighbours cached for some settings are never replaced, and the returned pointers keep them alive even after reset()
+class MR_BIND_IGNORE PointNeighborsCache
+{
+public:
+    PointNeighborsCache() = default;
+    PointNeighborsCache( const PointNeighborsCache& b ) : all_( b.getAll_() ) {}
+    PointNeighborsCache& operator =( const PointNeighborsCache& b )
+    {
+        auto all = b.getAll_();
+        std::lock_guard lock( mutex_ );
+        all_ = std::move( all );
+        return *this;
+    }
+
+    /// returns the neighbours cached for given settings, or null if they were not found yet
+    [[nodiscard]] MRMESH_API std::shared_ptr<const PointNeighbors> get( const PointNeighborsSettings& settings ) const;
+
+    /// returns the neighbours cached for given settings, otherwise calls (creator) and caches its result;
+    /// (creator) is called without locking, so the neighbours with different settings can be found simultaneously
+    MRMESH_API std::shared_ptr<const PointNeighbors> getOrCreate( const PointNeighborsSettings& settings,
+        const std::function<PointNeighbors()>& creator );
+
+    /// stops caching all neighbours
+    MRMESH_API void reset();
+
+    /// returns the amount of memory this object occupies on heap
+    [[nodiscard]] MRMESH_API size_t heapBytes() const;
+
+private:
+    std::vector<std::shared_ptr<const PointNeighbors>> getAll_() const;
+
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<const PointNeighbors>> all_; // one element per settings
+};
+
+/// finds neighbours of all valid points in the cloud in parallel using its AABB tree
+/// \return nullopt if progress returned false
+[[nodiscard]] MRMESH_API std::optional<PointNeighbors> findPointNeighbors( const PointCloud & cloud,
+    const PointNeighborsSettings & settings, const ProgressCallback & progress = {} );
+
+/// \}
+
+} //namespace MR
@@ -10,6 +10,7 @@
 #include "MRTimer.h"
 #include "MRBitSetParallelFor.h"
 #include "MRLocalTriangulations.h"
+#include "MRPointCloudNeighbors.h"
 #include <algorithm>
 #include <numeric>
 #include <limits>
@@ -493,7 +494,21 @@ void buildLocalTriangulation( const PointCloud& cloud, VertId v, const Settings
 
     const auto & searchCloud = settings.searchNeighbors ? *settings.searchNeighbors : cloud;
 
-    if ( settings.radius > 0 )
+    // reuse neighbours attached to the cloud if they were found with the same settings
+    const auto neis = searchCloud.getNeighborsNotCreate( settings.radius > 0
+        ? PointNeighborsSettings{ .radius = settings.radius } : PointNeighborsSettings{ .numNei = settings.numNeis } );
+    if ( neis )
+    {
+        fanData.neighbors.assign( neis->beginNeighbors( v ), neis->endNeighbors( v ) );
+        if ( settings.numNeis > 0 )
+        {
+            float maxDistSq = 0;
+            for ( auto n : fanData.neighbors )
+                maxDistSq = std::max( maxDistSq, ( searchCloud.points[n] - searchCloud.points[v] ).lengthSq() );
+            actualRadius = std::sqrt( maxDistSq );
+        }
+    }
+    else if ( settings.radius > 0 )
         findNeighborsInBall( searchCloud, v, actualRadius, fanData.neighbors );
     else
         actualRadius = std::sqrt( findNumNeighbors( searchCloud, v, settings.numNeis, fanData.neighbors, fanData.nearesetPoints ) );
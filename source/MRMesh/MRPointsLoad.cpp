@@ -11,6 +11,8 @@
 #include "MRParallelFor.h"
 #include "MRComputeBoundingBox.h"
 #include "MRBitSetParallelFor.h"
+#include "MRMappedFileRegion.h"
+#include "MRPly.h"
 
 #include <fstream>
 
@@ -30,89 +32,92 @@ Expected<PointCloud> fromText( std::istream& in, const PointsLoadSettings& setti
 {
     MR_TIMER
 
-    auto buf = readCharBuffer( in );
-    if ( !buf )
-        return unexpected( std::move( buf.error() ) );
-
-    if ( !reportProgress( settings.callback, 0.50f ) )
-        return unexpectedOperationCanceled();
-
-    const auto newlines = splitByLines( buf->data(), buf->size() );
-    const auto lineCount = newlines.size() - 1;
-
-    if ( !reportProgress( settings.callback, 0.60f ) )
-        return unexpectedOperationCanceled();
-
     PointCloud cloud;
-    cloud.points.resizeNoInit( lineCount );
-    cloud.validPoints.resize( lineCount, false );
-
-    // detect normals and colors
+    // normals and colors are detected by the first line with a point
     constexpr Vector3d cInvalidNormal( 0.f, 0.f, 0.f );
     constexpr Color cInvalidColor( 0, 0, 0, 0 );
-    Vector3d firstPoint;
+    std::optional<Vector3d> firstPoint;
     auto hasNormals = false;
     auto hasColors = false;
-    for ( auto i = 0; i < lineCount; ++i )
-    {
-        const std::string_view line( buf->data() + newlines[i], newlines[i + 1] - newlines[i + 0] );
-        if ( line.empty() || line.starts_with( '#' ) || line.starts_with( ';' ) )
-            continue;
-
-        auto normal = cInvalidNormal;
-        auto color = cInvalidColor;
-        auto result = parseTextCoordinate( line, firstPoint, &normal, &color );
-        if ( !result )
-            return unexpected( std::move( result.error() ) );
 
-        if ( settings.outXf )
-            *settings.outXf = AffineXf3f::translation( Vector3f( firstPoint ) );
+    auto res = readByLineChunks( in, [&] ( const char* data, size_t size, const ProgressCallback& chunkCb ) -> Expected<void>
+    {
+        const auto newlines = splitByLines( data, size );
+        const auto lineCount = newlines.size() - 1;
 
-        if ( normal != cInvalidNormal )
-        {
-            hasNormals = true;
-            cloud.normals.resizeNoInit( lineCount );
-        }
-        if ( settings.colors && color != cInvalidColor )
+        // returns the line without end-of-line characters
+        auto getLine = [&] ( size_t i )
         {
-            hasColors = true;
-            settings.colors->resizeNoInit( lineCount );
-        }
-
-        break;
-    }
+            std::string_view line( data + newlines[i], newlines[i + 1] - newlines[i + 0] );
+            while ( !line.empty() && ( line.back() == '\n' || line.back() == '\r' ) )
+                line.remove_suffix( 1 );
+            return line;
+        };
 
-    std::string parseError;
-    tbb::task_group_context ctx;
-    const auto keepGoing = BitSetParallelForAll( cloud.validPoints, [&] ( VertId v )
-    {
-        const std::string_view line( buf->data() + newlines[v], newlines[v + 1] - newlines[v + 0] );
-        if ( line.empty() || line.starts_with( '#' ) || line.starts_with( ';' ) )
-            return;
-
-        Vector3d point( noInit );
-        Vector3d normal( noInit );
-        Color color( noInit );
-        auto result = parseTextCoordinate( line, point, hasNormals ? &normal : nullptr, hasColors ? &color : nullptr );
-        if ( !result )
+        for ( auto i = 0; !firstPoint && i < lineCount; ++i )
         {
-            if ( ctx.cancel_group_execution() )
-                parseError = std::move( result.error() );
-            return;
+            const auto line = getLine( i );
+            if ( line.empty() || line.starts_with( '#' ) || line.starts_with( ';' ) )
+                continue;
+
+            Vector3d point;
+            auto normal = cInvalidNormal;
+            auto color = cInvalidColor;
+            auto result = parseTextCoordinate( line, point, &normal, &color );
+            if ( !result )
+                return unexpected( std::move( result.error() ) );
+
+            firstPoint = point;
+            if ( settings.outXf )
+                *settings.outXf = AffineXf3f::translation( Vector3f( point ) );
+            hasNormals = normal != cInvalidNormal;
+            hasColors = settings.colors && color != cInvalidColor;
         }
 
-        cloud.points[v] = Vector3f( settings.outXf ? point - firstPoint : point );
-        cloud.validPoints.set( v, true );
+        const auto firstId = cloud.points.size();
+        const auto endId = firstId + lineCount;
+        cloud.points.resizeNoInit( endId );
+        cloud.validPoints.resize( endId, false );
         if ( hasNormals )
-            cloud.normals[v] = Vector3f( normal );
+            cloud.normals.resizeNoInit( endId );
         if ( hasColors )
-            ( *settings.colors )[v] = color;
-    }, subprogress( settings.callback, 0.60f, 1.00f ) );
+            settings.colors->resizeNoInit( endId );
 
-    if ( !keepGoing )
-        return unexpectedOperationCanceled();
-    if ( !parseError.empty() )
-        return unexpected( std::move( parseError ) );
+        std::string parseError;
+        tbb::task_group_context ctx;
+        const auto keepGoing = BitSetParallelForAll( IdRange<VertId>{ VertId( firstId ), VertId( endId ) }, [&] ( VertId v )
+        {
+            const auto line = getLine( size_t( v ) - firstId );
+            if ( line.empty() || line.starts_with( '#' ) || line.starts_with( ';' ) )
+                return;
+
+            Vector3d point( noInit );
+            Vector3d normal( noInit );
+            Color color( noInit );
+            auto result = parseTextCoordinate( line, point, hasNormals ? &normal : nullptr, hasColors ? &color : nullptr );
+            if ( !result )
+            {
+                if ( ctx.cancel_group_execution() )
+                    parseError = std::move( result.error() );
+                return;
+            }
+
+            cloud.points[v] = Vector3f( settings.outXf ? point - *firstPoint : point );
+            cloud.validPoints.set( v, true );
+            if ( hasNormals )
+                cloud.normals[v] = Vector3f( normal );
+            if ( hasColors )
+                ( *settings.colors )[v] = color;
+        }, chunkCb );
+
+        if ( !keepGoing )
+            return unexpectedOperationCanceled();
+        if ( !parseError.empty() )
+            return unexpected( std::move( parseError ) );
+        return {};
+    }, settings.callback );
+    if ( !res )
+        return unexpected( std::move( res.error() ) );
 
     return cloud;
 }
@@ -147,69 +152,99 @@ Expected<MR::PointCloud> fromPts( std::istream& in, const PointsLoadSettings& se
     if ( numPoints == 0 )
         return unexpected( "Empty pts file" );
 
-    auto dataExp = readCharBuffer( in );
-    if ( !dataExp.has_value() )
-        return unexpected( dataExp.error() );
-
-    if ( settings.callback && !settings.callback( 0.25f ) )
-        return unexpectedOperationCanceled();
-
-    const auto& data = *dataExp;
-    auto lineOffsets = splitByLines( data.data(), data.size() );
-
-    int firstLine = 1;
-    Vector3d firstLineCoord;
-    Color firstLineColor;
-    std::string_view shitLine( data.data() + lineOffsets[firstLine], lineOffsets[firstLine + 1] - lineOffsets[firstLine] );
-    auto shiftLineRes = parsePtsCoordinate( shitLine, firstLineCoord, firstLineColor );
-    if ( !shiftLineRes.has_value() )
-        return unexpected( shiftLineRes.error() );
-
-    if ( settings.outXf )
-        *settings.outXf = AffineXf3f::translation( Vector3f( firstLineCoord ) );
-
-    if ( settings.colors )
-        settings.colors->resize( lineOffsets.size() - firstLine - 1 );
-
     PointCloud pc;
-    pc.points.resize( lineOffsets.size() - firstLine - 1 );
-
-    std::string parseError;
-    tbb::task_group_context ctx;
-    auto keepGoing = ParallelFor( pc.points, [&] ( size_t i )
+    bool skipLine = true; // the first line after the header is not read
+    std::optional<Vector3d> firstLineCoord;
+    auto res = readByLineChunks( in, [&] ( const char* data, size_t size, const ProgressCallback& chunkCb ) -> Expected<void>
     {
-        std::string_view line( data.data() + lineOffsets[firstLine + i], lineOffsets[firstLine + i + 1] - lineOffsets[firstLine + i] );
-        Vector3d tempDoubleCoord;
-        Color tempColor;
-        auto parseRes = parsePtsCoordinate( line, tempDoubleCoord, tempColor );
-        if ( !parseRes.has_value() && ctx.cancel_group_execution() )
-            parseError = std::move( parseRes.error() );
-
-        pc.points[VertId( i )] = Vector3f( tempDoubleCoord - firstLineCoord );
-        if ( settings.colors )
-            ( *settings.colors )[VertId( i )] = tempColor;
-    }, subprogress( settings.callback, 0.25f, 1.0f ) );
+        const auto lineOffsets = splitByLines( data, size );
+        const auto lineCount = lineOffsets.size() - 1;
+        size_t firstLine = 0;
+        if ( skipLine )
+        {
+            firstLine = 1;
+            skipLine = false;
+        }
+        if ( firstLine >= lineCount )
+            return {};
 
-    if ( !keepGoing )
-        return unexpectedOperationCanceled();
+        if ( !firstLineCoord )
+        {
+            Vector3d coord;
+            Color color;
+            std::string_view shiftLine( data + lineOffsets[firstLine], lineOffsets[firstLine + 1] - lineOffsets[firstLine] );
+            auto shiftLineRes = parsePtsCoordinate( shiftLine, coord, color );
+            if ( !shiftLineRes.has_value() )
+                return unexpected( shiftLineRes.error() );
+            firstLineCoord = coord;
+            if ( settings.outXf )
+                *settings.outXf = AffineXf3f::translation( Vector3f( coord ) );
+        }
+
+        const auto firstId = pc.points.size();
+        const auto count = lineCount - firstLine;
+        if ( settings.colors )
+            settings.colors->resize( firstId + count );
+        pc.points.resize( firstId + count );
 
-    if ( !parseError.empty() )
-        return unexpected( parseError );
+        std::string parseError;
+        tbb::task_group_context ctx;
+        auto keepGoing = ParallelFor( size_t( 0 ), count, [&] ( size_t i )
+        {
+            std::string_view line( data + lineOffsets[firstLine + i], lineOffsets[firstLine + i + 1] - lineOffsets[firstLine + i] );
+            Vector3d tempDoubleCoord;
+            Color tempColor;
+            auto parseRes = parsePtsCoordinate( line, tempDoubleCoord, tempColor );
+            if ( !parseRes.has_value() && ctx.cancel_group_execution() )
+                parseError = std::move( parseRes.error() );
+
+            pc.points[VertId( firstId + i )] = Vector3f( tempDoubleCoord - *firstLineCoord );
+            if ( settings.colors )
+                ( *settings.colors )[VertId( firstId + i )] = tempColor;
+        }, chunkCb );
+
+        if ( !keepGoing )
+            return unexpectedOperationCanceled();
+        if ( !parseError.empty() )
+            return unexpected( parseError );
+        return {};
+    }, settings.callback );
+    if ( !res )
+        return unexpected( std::move( res.error() ) );
 
     pc.validPoints.resize( pc.points.size(), true );
     return pc;
 }
 
-Expected<MR::PointCloud> fromPly( const std::filesystem::path& file, const PointsLoadSettings& settings )
+namespace
 {
-    std::ifstream in( file, std::ifstream::binary );
-    if ( !in )
-        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
 
-    return addFileNameInError( fromPly( in, settings ), file );
+/// loads point cloud from PLY located in memory by parallel reader;
+/// returns nullopt if the layout of the file is not supported by it, and the sequential reader must be used
+Expected<std::optional<PointCloud>> fromPlyParallel( const char* data, size_t size, const PointsLoadSettings& settings )
+{
+    PlyData ply;
+    const auto read = readPlyParallel( data, size, {
+        .normals = true,
+        .colors = settings.colors != nullptr,
+        .callback = settings.callback
+    }, ply );
+    if ( !read )
+        return unexpected( read.error() );
+    if ( !*read )
+        return std::optional<PointCloud>{};
+
+    PointCloud res;
+    res.points = std::move( ply.points );
+    res.normals = std::move( ply.normals );
+    res.validPoints.resize( res.points.size(), true );
+    if ( settings.colors && !ply.colors.empty() )
+        *settings.colors = std::move( ply.colors );
+    return res;
 }
 
-Expected<MR::PointCloud> fromPly( std::istream& in, const PointsLoadSettings& settings )
+/// loads point cloud from PLY by sequential reader supporting any layout of the file
+Expected<PointCloud> fromPlySequential( std::istream& in, const PointsLoadSettings& settings )
 {
     MR_TIMER;
 
@@ -275,6 +310,54 @@ Expected<MR::PointCloud> fromPly( std::istream& in, const PointsLoadSettings& se
     return res;
 }
 
+} //anonymous namespace
+
+Expected<MR::PointCloud> fromPly( const std::filesystem::path& file, const PointsLoadSettings& settings )
+{
+    MR_TIMER
+
+    std::error_code ec;
+    const auto fileSize = std::filesystem::file_size( file, ec );
+    if ( !ec && fileSize > 0 )
+    {
+        if ( auto region = MappedFileRegion::map( file, 0, fileSize ) )
+        {
+            auto res = fromPlyParallel( ( *region )->data(), ( *region )->size(), settings );
+            if ( !res )
+                return unexpected( res.error() + ": " + utf8string( file ) );
+            if ( *res )
+                return std::move( **res );
+        }
+    }
+
+    std::ifstream in( file, std::ifstream::binary );
+    if ( !in )
+        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+
+    return addFileNameInError( fromPlySequential( in, settings ), file );
+}
+
+Expected<MR::PointCloud> fromPly( std::istream& in, const PointsLoadSettings& settings )
+{
+    MR_TIMER
+
+    const auto posStart = in.tellg();
+    {
+        auto buf = readCharBuffer( in );
+        if ( !buf )
+            return unexpected( std::move( buf.error() ) );
+        auto res = fromPlyParallel( buf->data(), buf->size(), settings );
+        if ( !res )
+            return unexpected( std::move( res.error() ) );
+        if ( *res )
+            return std::move( **res );
+    }
+
+    in.clear();
+    in.seekg( posStart );
+    return fromPlySequential( in, settings );
+}
+
 Expected<MR::PointCloud> fromObj( const std::filesystem::path& file, const PointsLoadSettings& settings )
 {
     std::ifstream in( file, std::ifstream::binary );
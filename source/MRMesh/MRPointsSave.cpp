@@ -7,7 +7,9 @@
 #include "MRStreamOperators.h"
 #include "MRProgressReadWrite.h"
 #include "MRPch/MRFmt.h"
+#include <cstring>
 #include <fstream>
+#include <iterator>
 
 namespace MR
 {
@@ -51,26 +53,21 @@ Expected<void> toXyz( const PointCloud& points, const std::filesystem::path& fil
 Expected<void> toXyz( const PointCloud& cloud, std::ostream& out, const SaveSettings& settings )
 {
     MR_TIMER
-    const size_t totalPoints = settings.saveValidOnly ? cloud.validPoints.count() : cloud.points.size();
-    size_t numSaved = 0;
-
-    NormalXfMatrix normXf( settings.xf );
-    for ( auto v = 0_v; v < cloud.points.size(); ++v )
+    if ( !writeTextByBlocks( out, cloud.points.size(), [&] ( size_t i, std::string& text )
     {
+        const VertId v( i );
         if ( settings.saveValidOnly && !cloud.validPoints.test( v ) )
-            continue;
+            return;
         auto saveVertex = [&]( auto && p )
         {
-            out << fmt::format( "{} {} {}\n", p.x, p.y, p.z );
+            fmt::format_to( std::back_inserter( text ), "{} {} {}\n", p.x, p.y, p.z );
         };
         if ( settings.xf )
             saveVertex( applyDouble( settings.xf, cloud.points[v] ) );
         else
             saveVertex( cloud.points[v] );
-        ++numSaved;
-        if ( settings.progress && !( numSaved & 0x3FF ) && !settings.progress( float( numSaved ) / totalPoints ) )
-            return unexpectedOperationCanceled();
-    }
+    }, settings.progress ) )
+        return unexpectedOperationCanceled();
 
     if ( !out )
         return unexpected( std::string( "Stream write error" ) );
@@ -93,26 +90,22 @@ Expected<void> toXyzn( const PointCloud& cloud, std::ostream& out, const SaveSet
     MR_TIMER
     if ( !cloud.hasNormals() )
         return unexpected( std::string( "Point cloud does not have normal data" ) );
-    const size_t totalPoints = settings.saveValidOnly ? cloud.validPoints.count() : cloud.points.size();
-    size_t numSaved = 0;
-
     NormalXfMatrix normXf( settings.xf );
-    for ( auto v = 0_v; v < cloud.points.size(); ++v )
+    if ( !writeTextByBlocks( out, cloud.points.size(), [&] ( size_t i, std::string& text )
     {
+        const VertId v( i );
         if ( settings.saveValidOnly && !cloud.validPoints.test( v ) )
-            continue;
+            return;
         auto saveVertex = [&]( auto && p, auto && n )
         {
-            out << fmt::format( "{} {} {} {} {} {}\n", p.x, p.y, p.z, n.x, n.y, n.z );
+            fmt::format_to( std::back_inserter( text ), "{} {} {} {} {} {}\n", p.x, p.y, p.z, n.x, n.y, n.z );
         };
         if ( settings.xf )
             saveVertex( applyDouble( settings.xf, cloud.points[v] ), applyDouble( normXf, cloud.normals[v] ) );
         else
             saveVertex( cloud.points[v], cloud.normals[v] );
-        ++numSaved;
-        if ( settings.progress && !( numSaved & 0x3FF ) && !settings.progress( float( numSaved ) / totalPoints ) )
-            return unexpectedOperationCanceled();
-    }
+    }, settings.progress ) )
+        return unexpectedOperationCanceled();
 
     if ( !out )
         return unexpected( std::string( "Stream write error" ) );
@@ -164,37 +157,39 @@ Expected<void> toPly( const PointCloud& cloud, std::ostream& out, const SaveSett
     out << "end_header\n";
 
     static_assert( sizeof( cloud.points.front() ) == 12, "wrong size of Vector3f" );
-#pragma pack(push, 1)
-    struct PlyColor
+
+    // the ids of saved points in the order of saving
+    std::vector<VertId> savedPoints;
+    if ( settings.saveValidOnly )
     {
-        unsigned char r = 0, g = 0, b = 0;
-    };
-#pragma pack(pop)
-    static_assert( sizeof( PlyColor ) == 3, "check your padding" );
+        savedPoints.reserve( totalPoints );
+        for ( auto v : cloud.validPoints )
+            savedPoints.push_back( v );
+    }
 
     NormalXfMatrix normXf( settings.xf );
-    size_t numSaved = 0;
-    for ( auto v = 0_v; v < cloud.points.size(); ++v )
+    const size_t rowSize = 12 + ( saveNormals ? 12 : 0 ) + ( settings.colors ? 3 : 0 );
+    if ( !writeRowsByBlocks( out, totalPoints, rowSize, [&] ( size_t row, char* dst )
     {
-        if ( settings.saveValidOnly && !cloud.validPoints.test( v ) )
-            continue;
+        const VertId v = settings.saveValidOnly ? savedPoints[row] : VertId( row );
         const Vector3f p = applyFloat( settings.xf, cloud.points[v] );
-        out.write( ( const char* )&p, 12 );
+        std::memcpy( dst, &p, 12 );
+        dst += 12;
         if ( saveNormals )
         {
             const Vector3f n = applyFloat( normXf, cloud.normals[v] );
-            out.write( ( const char* )&n, 12 );
+            std::memcpy( dst, &n, 12 );
+            dst += 12;
         }
         if ( settings.colors )
         {
             const auto c = ( *settings.colors )[v];
-            PlyColor pc{ .r = c.r, .g = c.g, .b = c.b };
-            out.write( ( const char* )&pc, 3 );
+            *dst++ = char( c.r );
+            *dst++ = char( c.g );
+            *dst++ = char( c.b );
         }
-        ++numSaved;
-        if ( settings.progress && !( numSaved & 0x3FF ) && !settings.progress( float( numSaved ) / totalPoints ) )
-            return unexpectedOperationCanceled();
-    }
+    }, settings.progress ) )
+        return unexpectedOperationCanceled();
 
     if ( !out )
         return unexpected( std::string( "Error saving in PLY-format" ) );
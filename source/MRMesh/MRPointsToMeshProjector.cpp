@@ -3,12 +3,73 @@
 #include "MRAffineXf3.h"
 #include "MRMatrix3Decompose.h"
 #include "MRParallelFor.h"
+#include "MRAABBTree.h"
+#include "MRClosestPointInTriangle.h"
+#include "MRClosestPointInTriangleBatch.h"
+#include "MRBox.h"
 #include "MRTimer.h"
+#include "MRPch/MRSpdlog.h"
 #include "MRPch/MRTBB.h"
 
+#include "MRGTest.h"
+#include "MRTorus.h"
+#include <cfloat>
+#include <random>
+
 namespace MR
 {
 
+namespace
+{
+
+/// spreads lower 21 bits of given value so that there are two zero bits after each original bit
+inline std::uint64_t spreadBits3( std::uint64_t x )
+{
+    x &= 0x1fffff;
+    x = ( x | x << 32 ) & 0x1f00000000ffff;
+    x = ( x | x << 16 ) & 0x1f0000ff0000ff;
+    x = ( x | x << 8 ) & 0x100f00f00f00f00f;
+    x = ( x | x << 4 ) & 0x10c30c30c30c30c3;
+    x = ( x | x << 2 ) & 0x1249249249249249;
+    return x;
+}
+
+/// computes the closest point to given point on given mesh triangle, same as findProjection does
+inline MeshProjectionResult projectOnFace( const Mesh & mesh, const Vector3f & pt, FaceId face )
+{
+    Vector3f a, b, c;
+    mesh.getTriPoints( face, a, b, c );
+    // compute the closest point in double-precision, because float might be not enough
+    const auto [projD, baryD] = closestPointInTriangle( Vector3d( pt ), Vector3d( a ), Vector3d( b ), Vector3d( c ) );
+    const Vector3f proj( projD );
+    return
+    {
+        .proj = PointOnFace{ face, proj },
+        .mtp = MeshTriPoint{ mesh.topology.edgeWithLeft( face ), TriPointf( baryD ) },
+        .distSq = ( proj - pt ).lengthSq()
+    };
+}
+
+/// a leaf of AABB tree to be checked for all points of a tile
+struct TileCandidate
+{
+    FaceId face;
+    Box3f box;
+    float distSq = 0; ///< from the center of the tile to the box
+};
+
+/// thread-local data for processing of one tile
+struct TileData
+{
+    std::vector<TileCandidate> candidates;
+    /// the triangles of the candidates stored contiguously by four
+    std::vector<TriangleBatch4> batches;
+    /// the union of the boxes of the candidates in each batch
+    std::vector<Box3f> batchBoxes;
+};
+
+} //anonymous namespace
+
 void PointsToMeshProjector::updateMeshData( const Mesh* mesh )
 {
     mesh_ = mesh;
@@ -37,6 +98,194 @@ size_t PointsToMeshProjector::projectionsHeapBytes( size_t ) const
     return 0;
 }
 
+void BatchedPointsToMeshProjector::updateMeshData( const Mesh* mesh )
+{
+    mesh_ = mesh;
+}
+
+void BatchedPointsToMeshProjector::findProjections( std::vector<MeshProjectionResult>& result, const std::vector<Vector3f>& points, const AffineXf3f* objXf, const AffineXf3f* refObjXf, float upDistLimitSq, float loDistLimitSq )
+{
+    MR_TIMER
+    if ( !mesh_ )
+        return;
+
+    AffineXf3f xf;
+    auto simplifiedXfs = createProjectionTransforms( xf, objXf, refObjXf );
+    const auto & tree = mesh_->getAABBTree();
+    if ( simplifiedXfs.nonRigidXfTree || tree.nodes().empty() || points.size() <= tileSize )
+    {
+        // tiles require the tree and the points in the same space
+        PointsToMeshProjector projector;
+        projector.updateMeshData( mesh_ );
+        projector.findProjections( result, points, objXf, refObjXf, upDistLimitSq, loDistLimitSq );
+        return;
+    }
+
+    const auto numPoints = points.size();
+    result.resize( numPoints );
+
+    std::vector<Vector3f> pts( numPoints );
+    ParallelFor( pts, [&] ( size_t i )
+    {
+        pts[i] = simplifiedXfs.rigidXfPoint ? ( *simplifiedXfs.rigidXfPoint )( points[i] ) : points[i];
+    } );
+
+    const auto box = tbb::parallel_reduce( tbb::blocked_range<size_t>( 0, numPoints ), Box3f{},
+        [&] ( const tbb::blocked_range<size_t> & range, Box3f curr )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+            curr.include( pts[i] );
+        return curr;
+    },
+    [] ( Box3f a, const Box3f & b ) { a.include( b ); return a; } );
+
+    // sort the points along Morton curve, so consecutive points are close in space
+    constexpr float maxCoord = float( 0x1fffff );
+    const auto boxSize = box.size();
+    const Vector3f scale(
+        boxSize.x > 0 ? maxCoord / boxSize.x : 0.0f,
+        boxSize.y > 0 ? maxCoord / boxSize.y : 0.0f,
+        boxSize.z > 0 ? maxCoord / boxSize.z : 0.0f );
+    std::vector<std::pair<std::uint64_t, size_t>> order( numPoints );
+    ParallelFor( order, [&] ( size_t i )
+    {
+        const auto d = mult( pts[i] - box.min, scale );
+        order[i] = { spreadBits3( std::uint64_t( d.x ) ) | ( spreadBits3( std::uint64_t( d.y ) ) << 1 ) | ( spreadBits3( std::uint64_t( d.z ) ) << 2 ), i };
+    } );
+    tbb::parallel_sort( order.begin(), order.end() );
+
+    const size_t numTiles = ( numPoints + tileSize - 1 ) / tileSize;
+    tbb::enumerable_thread_specific<TileData> threadData;
+    ParallelFor( size_t( 0 ), numTiles, threadData, [&] ( size_t t, TileData & data )
+    {
+        auto & candidates = data.candidates;
+        const auto tBeg = t * tileSize;
+        const auto tEnd = std::min( tBeg + tileSize, numPoints );
+
+        // the closest triangle to the first point gives initial projections for all points of the tile
+        const auto & firstProj = result[order[tBeg].second] = findProjection( pts[order[tBeg].second], *mesh_, upDistLimitSq, nullptr, loDistLimitSq );
+        Box3f tileBox;
+        float maxDistSq = firstProj.distSq;
+        for ( auto i = tBeg + 1; i < tEnd; ++i )
+        {
+            const auto & pt = pts[order[i].second];
+            tileBox.include( pt );
+            auto & res = result[order[i].second];
+            res = MeshProjectionResult{};
+            res.distSq = upDistLimitSq;
+            if ( firstProj.proj.face )
+            {
+                auto candidate = projectOnFace( *mesh_, pt, firstProj.proj.face );
+                if ( candidate.distSq < upDistLimitSq )
+                    res = candidate;
+            }
+            maxDistSq = std::max( maxDistSq, res.distSq );
+        }
+        if ( !tileBox.valid() )
+            return;
+
+        // the closest triangle for each point of the tile is within maxDistSq from the tile's box
+        candidates.clear();
+        bool tooManyCandidates = false;
+        const auto tileCenter = tileBox.center();
+        constexpr int MaxStackSize = 32; // to avoid allocations
+        NodeId subtasks[MaxStackSize];
+        int stackSize = 0;
+        if ( tree[tree.rootNodeId()].box.getDistanceSq( tileBox ) < maxDistSq )
+            subtasks[stackSize++] = tree.rootNodeId();
+        while ( stackSize > 0 )
+        {
+            const auto & node = tree[subtasks[--stackSize]];
+            if ( node.leaf() )
+            {
+                if ( candidates.size() >= maxTileCandidates )
+                {
+                    tooManyCandidates = true;
+                    break;
+                }
+                candidates.push_back( { node.leafId(), node.box, node.box.getDistanceSq( tileCenter ) } );
+                continue;
+            }
+            for ( auto child : { node.l, node.r } )
+            {
+                if ( tree[child].box.getDistanceSq( tileBox ) < maxDistSq )
+                {
+                    assert( stackSize < MaxStackSize );
+                    subtasks[stackSize++] = child;
+                }
+            }
+        }
+
+        if ( tooManyCandidates )
+        {
+            // the points of the tile are too far from the mesh or from one another
+            for ( auto i = tBeg + 1; i < tEnd; ++i )
+            {
+                auto & res = result[order[i].second];
+                if ( res.distSq <= loDistLimitSq )
+                    continue;
+                auto proj = findProjection( pts[order[i].second], *mesh_, res.distSq, nullptr, loDistLimitSq );
+                if ( proj.proj.face )
+                    res = proj;
+            }
+            return;
+        }
+
+        // check closer to the tile candidates first
+        std::sort( candidates.begin(), candidates.end(), [] ( const TileCandidate & a, const TileCandidate & b ) { return a.distSq < b.distSq; } );
+        const auto numBatches = ( candidates.size() + TriangleBatch4::capacity - 1 ) / TriangleBatch4::capacity;
+        data.batches.resize( numBatches );
+        data.batchBoxes.resize( numBatches );
+        for ( size_t bi = 0; bi < numBatches; ++bi )
+        {
+            auto & batch = data.batches[bi];
+            auto & batchBox = data.batchBoxes[bi];
+            batch.clear();
+            batchBox = {};
+            for ( auto ci = bi * TriangleBatch4::capacity; ci < std::min( ( bi + 1 ) * TriangleBatch4::capacity, candidates.size() ); ++ci )
+            {
+                const auto & cand = candidates[ci];
+                Vector3f a, b, c;
+                mesh_->getTriPoints( cand.face, a, b, c );
+                batch.push( cand.face, a, b, c );
+                batchBox.include( cand.box );
+            }
+        }
+
+        for ( auto i = tBeg + 1; i < tEnd; ++i )
+        {
+            const auto & pt = pts[order[i].second];
+            auto & res = result[order[i].second];
+            if ( res.distSq <= loDistLimitSq )
+                continue;
+            for ( size_t bi = 0; bi < numBatches; ++bi )
+            {
+                if ( !( data.batchBoxes[bi].getDistanceSq( pt ) < res.distSq ) )
+                    continue;
+                const auto & batch = data.batches[bi];
+                float distSq[TriangleBatch4::capacity], minDistSq[TriangleBatch4::capacity];
+                distanceSqToTriangles( pt, batch, distSq, minDistSq );
+                for ( int l = 0; l < batch.size; ++l )
+                {
+                    // float-precision distances are only good to skip the triangles, which are surely farther than current result
+                    if ( minDistSq[l] >= res.distSq )
+                        continue;
+                    auto candidate = projectOnFace( *mesh_, pt, batch.faces[l] );
+                    if ( candidate.distSq < res.distSq )
+                        res = candidate;
+                }
+                if ( res.distSq <= loDistLimitSq )
+                    break;
+            }
+        }
+    } );
+}
+
+size_t BatchedPointsToMeshProjector::projectionsHeapBytes( size_t numProjections ) const
+{
+    return numProjections * ( sizeof( Vector3f ) + sizeof( std::pair<std::uint64_t, size_t> ) );
+}
+
 VertScalars findSignedDistances(
     const Mesh& refMesh,
     const VertCoords & testPoints, const VertBitSet * validTestPoints,
@@ -97,4 +346,74 @@ VertScalars findSignedDistances(
     return findSignedDistances( refMesh, mesh.points, &mesh.topology.getValidVerts(), params, projector );
 }
 
+TEST( MRMesh, BatchedPointsToMeshProjector )
+{
+    const auto torus = makeTorus( 1.0f, 0.3f, 256, 128 );
+    std::mt19937 gen( 0 );
+    std::uniform_real_distribution<float> distr( -1.5f, 1.5f );
+    std::vector<Vector3f> points( 20000 );
+    for ( auto & p : points )
+        p = Vector3f( distr( gen ), distr( gen ), distr( gen ) );
+    torus.getAABBTree();
+
+    // the results must be the same as of plain CPU projector
+    std::vector<MeshProjectionResult> plainRes, batchedRes;
+    PointsToMeshProjector plain;
+    plain.updateMeshData( &torus );
+    plain.findProjections( plainRes, points, nullptr, nullptr, FLT_MAX, 0.0f );
+
+    BatchedPointsToMeshProjector batched;
+    batched.updateMeshData( &torus );
+    batched.findProjections( batchedRes, points, nullptr, nullptr, FLT_MAX, 0.0f );
+
+    ASSERT_EQ( plainRes.size(), batchedRes.size() );
+    for ( size_t i = 0; i < plainRes.size(); ++i )
+    {
+        EXPECT_TRUE( batchedRes[i].proj.face.valid() );
+        EXPECT_NEAR( plainRes[i].distSq, batchedRes[i].distSq, 1e-6f );
+        // the projection is a point of the found triangle at the found distance
+        EXPECT_NEAR( ( batchedRes[i].proj.point - points[i] ).lengthSq(), batchedRes[i].distSq, 1e-5f );
+        EXPECT_NEAR( ( torus.triPoint( batchedRes[i].mtp ) - batchedRes[i].proj.point ).lengthSq(), 0.0f, 1e-10f );
+    }
+
+    // test distance limits
+    const float upDistLimitSq = 0.01f;
+    plain.findProjections( plainRes, points, nullptr, nullptr, upDistLimitSq, 0.0f );
+    batched.findProjections( batchedRes, points, nullptr, nullptr, upDistLimitSq, 0.0f );
+    for ( size_t i = 0; i < plainRes.size(); ++i )
+    {
+        EXPECT_EQ( plainRes[i].proj.face.valid(), batchedRes[i].proj.face.valid() );
+        EXPECT_NEAR( plainRes[i].distSq, batchedRes[i].distSq, 1e-6f );
+    }
+}
+
+// compares the speed of BatchedPointsToMeshProjector and PointsToMeshProjector,
+// disabled by default, run with --gtest_also_run_disabled_tests
+TEST( MRMesh, DISABLED_BatchedPointsToMeshProjectorBenchmark )
+{
+    const auto torus = makeTorus( 1.0f, 0.3f, 256, 128 );
+    std::mt19937 gen( 0 );
+    std::uniform_real_distribution<float> distr( -1.5f, 1.5f );
+    std::vector<Vector3f> points( 1000000 );
+    for ( auto & p : points )
+        p = Vector3f( distr( gen ), distr( gen ), distr( gen ) );
+    torus.getAABBTree();
+
+    std::vector<MeshProjectionResult> plainRes, batchedRes;
+    PointsToMeshProjector plain;
+    plain.updateMeshData( &torus );
+    Timer t( "plain" );
+    plain.findProjections( plainRes, points, nullptr, nullptr, FLT_MAX, 0.0f );
+    const auto plainTime = t.secondsPassed().count();
+
+    BatchedPointsToMeshProjector batched;
+    batched.updateMeshData( &torus );
+    t.restart( "batched" );
+    batched.findProjections( batchedRes, points, nullptr, nullptr, FLT_MAX, 0.0f );
+    const auto batchedTime = t.secondsPassed().count();
+    t.finish();
+    spdlog::info( "PointsToMeshProjector: {} sec, BatchedPointsToMeshProjector: {} sec", plainTime, batchedTime );
+    EXPECT_EQ( plainRes.size(), batchedRes.size() );
+}
+
 } //namespace MR
@@ -83,4 +83,30 @@ public:
     MRMESH_API virtual size_t projectionsHeapBytes( size_t numProjections ) const override;
 };
 
+/// Computes the closest point on mesh to each of given points on CPU with higher throughput than PointsToMeshProjector for big batches of points:
+/// the points are sorted along Morton curve and split on tiles of close points,
+/// each tile descends the mesh's AABB tree only once to collect candidate triangles,
+/// which are then checked for every point of the tile with the initial distance limit taken from the closest triangle of tile's first point
+class MRMESH_CLASS BatchedPointsToMeshProjector : public IPointsToMeshProjector
+{
+    const Mesh* mesh_{ nullptr };
+public:
+    /// update all data related to the referencing mesh
+    MRMESH_API virtual void updateMeshData( const Mesh* mesh ) override;
+
+    /// Computes the closest point on mesh to each of given points
+    MRMESH_API virtual void findProjections( std::vector<MeshProjectionResult>& result, const std::vector<Vector3f>& points,
+                                             const AffineXf3f* objXf, const AffineXf3f* refObjXf,
+                                             float upDistLimitSq, float loDistLimitSq ) override;
+
+    /// Returns amount of additional memory needed to compute projections
+    MRMESH_API virtual size_t projectionsHeapBytes( size_t numProjections ) const override;
+
+    /// the number of consecutive points (in Morton order) in one tile
+    static constexpr int tileSize = 32;
+
+    /// if the number of candidate triangles of a tile exceeds this value, then each point of the tile descends the tree independently
+    static constexpr int maxTileCandidates = 512;
+};
+
 }
@@ -0,0 +1,377 @@
+#include "MRPoissonDiskSampling.h"
+#include "MRPointCloud.h"
+#include "MRMesh.h"
+#include "MRBitSetParallelFor.h"
+#include "MRParallelFor.h"
+#include "MRComputeBoundingBox.h"
+#include "MRPointsProject.h"
+#include "MRBox.h"
+#include "MRTimer.h"
+#include "MRPch/MRTBB.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+
+#include "MRGTest.h"
+#include "MRTorus.h"
+#include "MRMeshToPointCloud.h"
+
+namespace MR
+{
+
+namespace
+{
+
+/// the number of bits per cell coordinate in a key
+constexpr int cCoordBits = 20;
+constexpr int cMaxCoord = ( 1 << cCoordBits ) - 1;
+
+/// the key of a cell: the parities of coordinates (phase) in the highest bits, then x, y, z coordinates;
+/// so all cells of one phase are located together in sorted order
+inline std::uint64_t cellKey( const Vector3i & c )
+{
+    const std::uint64_t phase = std::uint64_t( ( c.x & 1 ) | ( ( c.y & 1 ) << 1 ) | ( ( c.z & 1 ) << 2 ) );
+    return ( phase << ( 3 * cCoordBits ) )
+        | ( std::uint64_t( c.x ) << ( 2 * cCoordBits ) )
+        | ( std::uint64_t( c.y ) << cCoordBits )
+        | std::uint64_t( c.z );
+}
+
+inline int keyPhase( std::uint64_t key )
+{
+    return int( key >> ( 3 * cCoordBits ) );
+}
+
+inline Vector3i keyCell( std::uint64_t key )
+{
+    return {
+        int( ( key >> ( 2 * cCoordBits ) ) & cMaxCoord ),
+        int( ( key >> cCoordBits ) & cMaxCoord ),
+        int( key & cMaxCoord )
+    };
+}
+
+struct KeyPoint
+{
+    std::uint64_t key = 0;
+    VertId v;
+    auto operator <=>( const KeyPoint & ) const = default;
+};
+
+} //anonymous namespace
+
+std::optional<VertBitSet> poissonDiskSampling( const VertCoords & points, const VertBitSet & region, float radius, const ProgressCallback & cb )
+{
+    MR_TIMER
+    const auto box = computeBoundingBox( points, region );
+    if ( radius <= 0 || !box.valid() )
+        return region;
+
+    // cells must be not smaller than the radius to find all close samples in 27 neighbour cells
+    const auto boxSize = box.size();
+    const float cellSize = std::max( radius, std::max( { boxSize.x, boxSize.y, boxSize.z } ) / ( cMaxCoord - 1 ) );
+    const float invCellSize = 1 / cellSize;
+
+    std::vector<KeyPoint> keyPoints;
+    keyPoints.reserve( region.count() );
+    for ( auto v : region )
+        keyPoints.push_back( { 0, v } );
+    ParallelFor( keyPoints, [&] ( size_t i )
+    {
+        auto & kp = keyPoints[i];
+        const auto d = ( points[kp.v] - box.min ) * invCellSize;
+        kp.key = cellKey( { std::min( int( d.x ), cMaxCoord ), std::min( int( d.y ), cMaxCoord ), std::min( int( d.z ), cMaxCoord ) } );
+    } );
+    if ( !reportProgress( cb, 0.1f ) )
+        return {};
+
+    tbb::parallel_sort( keyPoints.begin(), keyPoints.end() );
+    if ( !reportProgress( cb, 0.25f ) )
+        return {};
+
+    // cell #c contains keyPoints[ cellBegin[c], cellBegin[c+1] )
+    std::vector<size_t> cellBegin;
+    std::vector<std::uint64_t> cellKeys;
+    for ( size_t i = 0; i < keyPoints.size(); ++i )
+    {
+        if ( i == 0 || keyPoints[i].key != keyPoints[i - 1].key )
+        {
+            cellBegin.push_back( i );
+            cellKeys.push_back( keyPoints[i].key );
+        }
+    }
+    const auto numCells = cellKeys.size();
+    cellBegin.push_back( keyPoints.size() );
+
+    // cells of phase #ph are [ phaseBegin[ph], phaseBegin[ph+1] )
+    std::array<size_t, 9> phaseBegin;
+    for ( int ph = 0; ph <= 8; ++ph )
+        phaseBegin[ph] = std::partition_point( cellKeys.begin(), cellKeys.end(), [ph] ( std::uint64_t key ) { return keyPhase( key ) < ph; } ) - cellKeys.begin();
+
+    // returns numCells if there is no such cell
+    auto findCell = [&] ( const Vector3i & c )
+    {
+        const auto key = cellKey( c );
+        const auto ph = keyPhase( key );
+        const auto b = cellKeys.begin() + phaseBegin[ph];
+        const auto e = cellKeys.begin() + phaseBegin[ph + 1];
+        auto it = std::lower_bound( b, e, key );
+        return ( it != e && *it == key ) ? size_t( it - cellKeys.begin() ) : numCells;
+    };
+
+    // samples of cell #c are stored in cellSamples starting from cellBegin[c]
+    std::vector<VertId> cellSamples( keyPoints.size() );
+    std::vector<int> numCellSamples( numCells, 0 );
+    const float radiusSq = sqr( radius );
+
+    // the cells of same phase are separated by at least one cell, so they do not influence one another and can be processed in parallel
+    for ( int ph = 0; ph < 8; ++ph )
+    {
+        if ( !ParallelFor( phaseBegin[ph], phaseBegin[ph + 1], [&] ( size_t c )
+        {
+            // the cell itself and neighbour cells of already processed phases
+            std::array<size_t, 27> neiCells;
+            int numNeiCells = 0;
+            const auto cell = keyCell( cellKeys[c] );
+            for ( int dz = -1; dz <= 1; ++dz )
+            for ( int dy = -1; dy <= 1; ++dy )
+            for ( int dx = -1; dx <= 1; ++dx )
+            {
+                if ( dx == 0 && dy == 0 && dz == 0 )
+                {
+                    neiCells[numNeiCells++] = c;
+                    continue;
+                }
+                const Vector3i n{ cell.x + dx, cell.y + dy, cell.z + dz };
+                if ( n.x < 0 || n.y < 0 || n.z < 0 || n.x > cMaxCoord || n.y > cMaxCoord || n.z > cMaxCoord )
+                    continue;
+                if ( keyPhase( cellKey( n ) ) > ph )
+                    continue; // not processed yet
+                if ( auto nc = findCell( n ); nc < numCells )
+                    neiCells[numNeiCells++] = nc;
+            }
+
+            for ( auto i = cellBegin[c]; i < cellBegin[c + 1]; ++i )
+            {
+                const auto v = keyPoints[i].v;
+                const auto & p = points[v];
+                bool farFromAll = true;
+                for ( int k = 0; farFromAll && k < numNeiCells; ++k )
+                {
+                    const auto nc = neiCells[k];
+                    const auto * s = cellSamples.data() + cellBegin[nc];
+                    for ( int j = 0; j < numCellSamples[nc]; ++j )
+                    {
+                        if ( distanceSq( points[s[j]], p ) < radiusSq )
+                        {
+                            farFromAll = false;
+                            break;
+                        }
+                    }
+                }
+                if ( farFromAll )
+                    cellSamples[cellBegin[c] + numCellSamples[c]++] = v;
+            }
+        }, subprogress( cb, 0.25f + 0.09f * ph, 0.34f + 0.09f * ph ), 64 ) )
+            return {};
+    }
+
+    VertBitSet res( region.size() );
+    for ( size_t c = 0; c < numCells; ++c )
+        for ( int j = 0; j < numCellSamples[c]; ++j )
+            res.set( cellSamples[cellBegin[c] + j] );
+
+    if ( !reportProgress( cb, 1.0f ) )
+        return {};
+    return res;
+}
+
+std::optional<VertBitSet> farthestPointSampling( const VertCoords & points, const VertBitSet & region, int numSamples, const ProgressCallback & cb )
+{
+    MR_TIMER
+    const auto numPoints = region.count();
+    if ( numSamples <= 0 )
+        return VertBitSet( region.size() );
+    if ( numPoints <= size_t( numSamples ) )
+        return region;
+
+    // the number of Poisson-disk samples depends mostly on the geometry and not on the density of points,
+    // so the radius is searched on a sparse subset of points to make it fast
+    const size_t subsetStep = std::max( size_t( 1 ), numPoints / ( 16 * size_t( numSamples ) ) );
+    VertBitSet subset;
+    if ( subsetStep > 1 )
+    {
+        subset.resize( region.size() );
+        size_t i = 0;
+        for ( auto v : region )
+            if ( i++ % subsetStep == 0 )
+                subset.set( v );
+    }
+    const auto & searchRegion = subsetStep > 1 ? subset : region;
+
+    // aim at slightly more samples than requested to remove the excessive ones later
+    const float targetSamples = 1.05f * numSamples;
+    const float maxSamples = 1.1f * numSamples;
+
+    // initial guess assumes the points are on a surface,
+    // where the number of samples is inversely proportional to the squared radius
+    float radius = computeBoundingBox( points, region ).diagonal() / std::sqrt( targetSamples );
+    constexpr int searchIters = 10;
+    const auto searchCb = subprogress( cb, 0.0f, 0.4f );
+    for ( int it = 0; it < searchIters; ++it )
+    {
+        auto samples = poissonDiskSampling( points, searchRegion, radius,
+            subprogress( searchCb, float( it ) / searchIters, float( it + 1 ) / searchIters ) );
+        if ( !samples )
+            return {};
+        const auto count = samples->count();
+        if ( count >= size_t( numSamples ) && count <= maxSamples )
+            break;
+        radius *= std::clamp( std::sqrt( count / targetSamples ), 0.25f, 4.0f );
+    }
+
+    // final sampling of all points, decreasing the radius if necessary
+    std::optional<VertBitSet> samples;
+    size_t count = 0;
+    constexpr int finalIters = 8;
+    for ( int it = 0; it < finalIters; ++it )
+    {
+        samples = poissonDiskSampling( points, region, radius,
+            subprogress( cb, 0.4f + 0.4f * it / finalIters, 0.4f + 0.4f * ( it + 1 ) / finalIters ) );
+        if ( !samples )
+            return {};
+        count = samples->count();
+        if ( count >= size_t( numSamples ) )
+            break;
+        radius *= std::clamp( std::sqrt( count / targetSamples ), 0.5f, 0.95f );
+    }
+
+    // the region contains too many coincident points, add any remaining ones
+    for ( auto v : region )
+    {
+        if ( count >= size_t( numSamples ) )
+            break;
+        if ( !samples->test( v ) )
+        {
+            samples->set( v );
+            ++count;
+        }
+    }
+    if ( !reportProgress( cb, 0.8f ) )
+        return {};
+    if ( count == size_t( numSamples ) )
+        return samples;
+
+    // remove excessive samples having the closest other samples
+    PointCloud sampleCloud;
+    VertMap sample2point;
+    sampleCloud.points.reserve( count );
+    sample2point.reserve( count );
+    for ( auto v : *samples )
+    {
+        sampleCloud.points.push_back( points[v] );
+        sample2point.push_back( v );
+    }
+    sampleCloud.validPoints.resize( count, true );
+
+    Vector<PointsProjectionResult, VertId> closest( count );
+    auto toRemove = count - numSamples;
+    const auto removeCb = subprogress( cb, 0.8f, 1.0f );
+    while ( toRemove > 0 )
+    {
+        sampleCloud.invalidateCaches();
+        sampleCloud.getAABBTree();
+        BitSetParallelFor( sampleCloud.validPoints, [&] ( VertId v )
+        {
+            closest[v] = findProjectionOnPoints( sampleCloud.points[v], sampleCloud, FLT_MAX, nullptr, 0, [v] ( VertId x ) { return v == x; } );
+        } );
+
+        std::vector<VertId> order;
+        order.reserve( sampleCloud.validPoints.count() );
+        for ( auto v : sampleCloud.validPoints )
+            order.push_back( v );
+        tbb::parallel_sort( order.begin(), order.end(), [&] ( VertId a, VertId b )
+        {
+            return std::tie( closest[a].distSq, a ) < std::tie( closest[b].distSq, b );
+        } );
+
+        VertBitSet removed( count );
+        for ( auto v : order )
+        {
+            if ( toRemove == 0 )
+                break;
+            // do not remove both points of a close pair in one pass
+            if ( closest[v].vId && removed.test( closest[v].vId ) )
+                continue;
+            removed.set( v );
+            --toRemove;
+        }
+        sampleCloud.validPoints -= removed;
+        if ( !reportProgress( removeCb, 1.0f - float( toRemove ) / float( count - numSamples ) ) )
+            return {};
+    }
+
+    VertBitSet res( region.size() );
+    for ( auto v : sampleCloud.validPoints )
+        res.set( sample2point[v] );
+    return res;
+}
+
+std::optional<VertBitSet> pointFarthestSampling( const PointCloud & cloud, int numSamples, const ProgressCallback & cb )
+{
+    return farthestPointSampling( cloud.points, cloud.validPoints, numSamples, cb );
+}
+
+std::optional<VertBitSet> vertsFarthestSampling( const Mesh & mesh, int numSamples, const ProgressCallback & cb )
+{
+    return farthestPointSampling( mesh.points, mesh.topology.getValidVerts(), numSamples, cb );
+}
+
+TEST( MRMesh, PoissonDiskSampling )
+{
+    const auto cloud = meshToPointCloud( makeTorus( 1.0f, 0.3f, 64, 32 ) );
+    const float radius = 0.2f;
+    const auto optSamples = poissonDiskSampling( cloud.points, cloud.validPoints, radius );
+    ASSERT_TRUE( optSamples.has_value() );
+    const auto & samples = *optSamples;
+    EXPECT_TRUE( samples.any() );
+
+    for ( auto v : cloud.validPoints )
+    {
+        float minDistSq = FLT_MAX;
+        for ( auto s : samples )
+        {
+            if ( s == v )
+                continue;
+            const auto dSq = distanceSq( cloud.points[s], cloud.points[v] );
+            minDistSq = std::min( minDistSq, dSq );
+            if ( samples.test( v ) )
+            {
+                EXPECT_GE( dSq, sqr( radius ) ); // samples are far from one another
+            }
+        }
+        if ( !samples.test( v ) )
+        {
+            EXPECT_LT( minDistSq, sqr( radius ) ); // any other point is close to some sample
+        }
+    }
+}
+
+TEST( MRMesh, FarthestPointSampling )
+{
+    const auto torus = makeTorus( 1.0f, 0.3f, 64, 32 );
+    const auto cloud = meshToPointCloud( torus );
+    for ( int numSamples : { 1, 100, 500, 1000 } )
+    {
+        const auto optSamples = pointFarthestSampling( cloud, numSamples );
+        ASSERT_TRUE( optSamples.has_value() );
+        EXPECT_EQ( optSamples->count(), numSamples );
+        EXPECT_TRUE( ( *optSamples - cloud.validPoints ).none() );
+    }
+    const auto optVerts = vertsFarthestSampling( torus, 300 );
+    ASSERT_TRUE( optVerts.has_value() );
+    EXPECT_EQ( optVerts->count(), 300 );
+}
+
+} //namespace MR
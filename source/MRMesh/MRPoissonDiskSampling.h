@@ -0,0 +1,38 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRProgressCallback.h"
+#include <optional>
+
+namespace MR
+{
+
+/// \addtogroup PointCloudGroup
+/// \{
+
+/// selects in parallel a subset of given points (samples) so that the distance between any two samples is not less than given radius,
+/// and any point from the region is closer than the radius to some sample (maximal Poisson-disk sampling);
+/// the points are bucketed in cubic cells not smaller than the radius, and the cells with the same parity of all coordinates are processed in parallel;
+/// returns std::nullopt if it was terminated by the callback
+[[nodiscard]] MRMESH_API std::optional<VertBitSet> poissonDiskSampling( const VertCoords & points, const VertBitSet & region,
+    float radius, const ProgressCallback & cb = {} );
+
+/// performs approximate farthest-point sampling of given points in parallel returning exactly numSamples points:
+/// first Poisson-disk samples are found with automatically selected radius producing slightly more than numSamples points,
+/// then the excessive samples having the closest other samples are removed;
+/// returns std::nullopt if it was terminated by the callback
+[[nodiscard]] MRMESH_API std::optional<VertBitSet> farthestPointSampling( const VertCoords & points, const VertBitSet & region,
+    int numSamples, const ProgressCallback & cb = {} );
+
+/// performs approximate farthest-point sampling of cloud points in parallel,
+/// which is much faster than pointIterativeSampling for big clouds;
+/// returns std::nullopt if it was terminated by the callback
+[[nodiscard]] MRMESH_API std::optional<VertBitSet> pointFarthestSampling( const PointCloud & cloud, int numSamples, const ProgressCallback & cb = {} );
+
+/// performs approximate farthest-point sampling of mesh vertices in parallel;
+/// returns std::nullopt if it was terminated by the callback
+[[nodiscard]] MRMESH_API std::optional<VertBitSet> vertsFarthestSampling( const Mesh & mesh, int numSamples, const ProgressCallback & cb = {} );
+
+/// \}
+
+} //namespace MR
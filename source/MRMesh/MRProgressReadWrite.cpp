@@ -1,4 +1,7 @@
 #include "MRProgressReadWrite.h"
+#include "MRParallelFor.h"
+#include "MRPch/MRTBB.h"
+#include <cstring>
 
 namespace MR
 {
@@ -51,4 +54,93 @@ bool readByBlocks( std::istream& in, char* data, size_t dataSize, ProgressCallba
     return true;
 }
 
+bool copyByBlocks( const char* src, char* dst, size_t dataSize, ProgressCallback callback /*= {}*/, size_t blockSize /*= ( size_t( 1 ) << 20 )*/ )
+{
+    const size_t numBlocks = ( dataSize + blockSize - 1 ) / blockSize;
+    return ParallelFor( size_t( 0 ), numBlocks, [&] ( size_t blockIndex )
+    {
+        const size_t begin = blockIndex * blockSize;
+        std::memcpy( dst + begin, src + begin, std::min( blockSize, dataSize - begin ) );
+    }, callback, 1 );
+}
+
+bool writeRowsByBlocks( std::ostream& out, size_t numRows, size_t rowSize, const std::function<void( size_t row, char* dst )>& encodeRow,
+    ProgressCallback callback /*= {}*/, size_t blockSize /*= ( size_t( 1 ) << 22 )*/ )
+{
+    if ( numRows == 0 || rowSize == 0 )
+        return reportProgress( callback, 1.f );
+
+    const size_t rowsPerBlock = std::max( size_t( 1 ), blockSize / rowSize );
+    const size_t numBlocks = ( numRows + rowsPerBlock - 1 ) / rowsPerBlock;
+    auto encodeBlock = [&] ( size_t blockIndex, std::vector<char>& buf )
+    {
+        const size_t begin = blockIndex * rowsPerBlock;
+        const size_t end = std::min( begin + rowsPerBlock, numRows );
+        buf.resize( ( end - begin ) * rowSize );
+        ParallelFor( begin, end, [&] ( size_t row )
+        {
+            encodeRow( row, buf.data() + ( row - begin ) * rowSize );
+        } );
+    };
+
+    // double buffering: one block is written while the next one is encoded
+    std::vector<char> bufs[2];
+    encodeBlock( 0, bufs[0] );
+    for ( size_t blockIndex = 0; blockIndex < numBlocks; ++blockIndex )
+    {
+        auto& curr = bufs[blockIndex % 2];
+        tbb::task_group group;
+        if ( blockIndex + 1 < numBlocks )
+            group.run( [&, blockIndex] { encodeBlock( blockIndex + 1, bufs[( blockIndex + 1 ) % 2] ); } );
+        out.write( curr.data(), curr.size() );
+        group.wait();
+        if ( !reportProgress( callback, float( blockIndex + 1 ) / numBlocks ) )
+            return false;
+    }
+    return true;
+}
+
+bool writeTextByBlocks( std::ostream& out, size_t numRecords, const std::function<void( size_t record, std::string& text )>& formatRecord,
+    ProgressCallback callback /*= {}*/, size_t blockSize /*= ( size_t( 1 ) << 12 )*/ )
+{
+    if ( numRecords == 0 )
+        return reportProgress( callback, 1.f );
+
+    // the number of blocks formatted in parallel before writing them
+    constexpr size_t cBlocksPerBatch = 256;
+    blockSize = std::max( blockSize, size_t( 1 ) );
+    const size_t numBlocks = ( numRecords + blockSize - 1 ) / blockSize;
+    const size_t numBatches = ( numBlocks + cBlocksPerBatch - 1 ) / cBlocksPerBatch;
+    auto formatBatch = [&] ( size_t batchIndex, std::vector<std::string>& texts )
+    {
+        const size_t firstBlock = batchIndex * cBlocksPerBatch;
+        const size_t lastBlock = std::min( firstBlock + cBlocksPerBatch, numBlocks );
+        texts.resize( lastBlock - firstBlock );
+        ParallelFor( firstBlock, lastBlock, [&] ( size_t blockIndex )
+        {
+            auto& text = texts[blockIndex - firstBlock];
+            text.clear(); // keep capacity from previous batches
+            const size_t end = std::min( ( blockIndex + 1 ) * blockSize, numRecords );
+            for ( size_t record = blockIndex * blockSize; record < end; ++record )
+                formatRecord( record, text );
+        } );
+    };
+
+    // double buffering: one batch is written while the next one is formatted
+    std::vector<std::string> bufs[2];
+    formatBatch( 0, bufs[0] );
+    for ( size_t batchIndex = 0; batchIndex < numBatches; ++batchIndex )
+    {
+        tbb::task_group group;
+        if ( batchIndex + 1 < numBatches )
+            group.run( [&, batchIndex] { formatBatch( batchIndex + 1, bufs[( batchIndex + 1 ) % 2] ); } );
+        for ( const auto& text : bufs[batchIndex % 2] )
+            out.write( text.data(), text.size() );
+        group.wait();
+        if ( !reportProgress( callback, float( batchIndex + 1 ) / numBatches ) )
+            return false;
+    }
+    return true;
+}
+
 }
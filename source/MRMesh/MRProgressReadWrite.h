@@ -3,6 +3,7 @@
 #include "MRMeshFwd.h"
 #include <ostream>
 #include <istream>
+#include <string>
 
 namespace MR
 {
@@ -22,4 +23,29 @@ MRMESH_API bool writeByBlocks( std::ostream& out, const char* data, size_t dataS
  */
 MRMESH_API bool readByBlocks( std::istream& in, char* data, size_t dataSize, ProgressCallback callback = {}, size_t blockSize = ( size_t( 1 ) << 16 ) );
 
+/**
+ * \brief copy dataSize bytes from src to dst by blocks blockSize bytes in parallel threads
+ * \details it is much faster than single memcpy for large data, e.g. from memory mapped file, where the pages are read on first access
+ * \return false if process was canceled (callback is set and return false )
+ */
+MRMESH_API bool copyByBlocks( const char* src, char* dst, size_t dataSize, ProgressCallback callback = {}, size_t blockSize = ( size_t( 1 ) << 20 ) );
+
+/**
+ * \brief write numRows rows of rowSize bytes each to out stream, where each row is produced by encodeRow( row, dst ) call
+ * \details the rows are encoded in parallel threads by blocks of about blockSize bytes,
+ * and the next block is encoded while the previous one is being written in the calling thread
+ * \return false if process was canceled (callback is set and return false )
+ */
+MRMESH_API bool writeRowsByBlocks( std::ostream& out, size_t numRows, size_t rowSize, const std::function<void( size_t row, char* dst )>& encodeRow,
+    ProgressCallback callback = {}, size_t blockSize = ( size_t( 1 ) << 22 ) );
+
+/**
+ * \brief write numRecords text records of variable length to out stream, where each record is appended to text by formatRecord( record, text ) call
+ * \details the records are formatted in parallel threads by blocks of blockSize records each (a record can produce empty text),
+ * the texts of blocks are written in the calling thread in the order of records, while the following blocks are being formatted
+ * \return false if process was canceled (callback is set and return false )
+ */
+MRMESH_API bool writeTextByBlocks( std::ostream& out, size_t numRecords, const std::function<void( size_t record, std::string& text )>& formatRecord,
+    ProgressCallback callback = {}, size_t blockSize = ( size_t( 1 ) << 12 ) );
+
 }
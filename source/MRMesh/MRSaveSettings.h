@@ -29,6 +29,10 @@ struct SaveSettings
     /// optional per-vertex uv coordinate to save with the geometry
     const VertUVCoords * uvMap = nullptr;
 
+    /// optional per-vertex normals to save with the geometry;
+    /// currently affects .ply and .mrmesh format of version 2 only
+    const VertNormals * normals = nullptr;
+
     /// optional texture to save with the geometry
     const MeshTexture * texture = nullptr;
 
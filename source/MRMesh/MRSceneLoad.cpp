@@ -3,8 +3,28 @@
 #include "MRObjectLoad.h"
 #include "MRStringConvert.h"
 #include "MRSceneRoot.h"
+#include "MRBitSet.h"
+#include "MRFinally.h"
+#include "MRTimer.h"
+#include "MRCube.h"
+#include "MRMesh.h"
+#include "MRMeshSave.h"
+#include "MRUniqueTemporaryFolder.h"
+#include "MRGTest.h"
 
 #include <MRPch/MRSpdlog.h>
+#include <MRPch/MRTBB.h>
+
+#if !defined( __EMSCRIPTEN__ ) || defined( __EMSCRIPTEN_PTHREADS__ )
+#if __has_include( <tbb/parallel_pipeline.h> )
+#include <tbb/parallel_pipeline.h>
+#else
+#include <tbb/pipeline.h>
+#endif
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
+#endif
 
 namespace
 {
@@ -127,12 +147,150 @@ private:
     std::ostringstream warningSummary_;
 };
 
+#if !defined( __EMSCRIPTEN__ ) || defined( __EMSCRIPTEN_PTHREADS__ )
+#if __has_include( <tbb/parallel_pipeline.h> )
+constexpr auto cSerialInOrderFilter = tbb::filter_mode::serial_in_order;
+constexpr auto cParallelFilter = tbb::filter_mode::parallel;
+#else
+constexpr auto cSerialInOrderFilter = tbb::filter::serial_in_order;
+constexpr auto cParallelFilter = tbb::filter::parallel;
+#endif
+#endif
+
+// loads given files in a pipeline of overlapping stages: the files are taken in order, then they are read and parsed in parallel,
+// and the results are passed to (onLoaded) in the order of the files;
+// the number of files in flight is limited by settings.maxFilesInFlight,
+// and the next file is not taken while the total size of the files being loaded with it exceeds settings.maxBytesInFlight
+void loadFilesPipelined( const std::vector<std::filesystem::path>& files, const ProgressCallback& cb, const SceneLoad::SceneLoadSettings& settings,
+    const std::function<void ( size_t index, Expected<LoadedObjects> result )>& onLoaded )
+{
+    MR_TIMER;
+    const auto count = files.size();
+#if defined( __EMSCRIPTEN__ ) && !defined( __EMSCRIPTEN_PTHREADS__ )
+    (void)settings;
+    for ( auto index = 0ull; index < count; ++index )
+    {
+        spdlog::info( "Loading file {}", utf8string( files[index] ) );
+        onLoaded( index, loadObjectFromFile( files[index], subprogress( cb, index, count ) ) );
+    }
+#else
+    std::vector<size_t> sizes( count, 0 );
+    for ( auto index = 0ull; index < count; ++index )
+    {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size( files[index], ec );
+        if ( !ec )
+            sizes[index] = size_t( size );
+    }
+
+    std::vector<Expected<LoadedObjects>> results( count );
+    std::mutex loadingMutex;
+    std::condition_variable loadingCv;
+    size_t numLoading = 0; // the number of files being loaded right now, guarded by loadingMutex
+    size_t bytesLoading = 0; // their total size, guarded by loadingMutex
+    std::atomic<size_t> numLoaded = 0;
+    std::atomic<bool> keepGoing{ true };
+    size_t nextFile = 0;
+
+    const auto callingThreadId = std::this_thread::get_id();
+    float reportedProgress = 0; // accessed only by the calling thread
+    const auto reportFrom = [&] ( float v )
+    {
+        // only the thread, which called this function, can report the progress;
+        // the files finish out of order, so the progress of a file loaded by this thread can be behind already reported value
+        if ( std::this_thread::get_id() == callingThreadId )
+        {
+            reportedProgress = std::max( reportedProgress, ( float( numLoaded ) + v ) / float( count ) );
+            if ( !reportProgress( cb, reportedProgress ) )
+                keepGoing.store( false, std::memory_order_relaxed );
+        }
+        return keepGoing.load( std::memory_order_relaxed );
+    };
+
+    const auto maxFilesInFlight = settings.maxFilesInFlight > 0 ? settings.maxFilesInFlight : size_t( tbb::this_task_arena::max_concurrency() );
+    tbb::parallel_pipeline( maxFilesInFlight,
+        tbb::make_filter<void, size_t>( cSerialInOrderFilter, [&] ( tbb::flow_control& fc ) -> size_t
+        {
+            if ( nextFile >= count )
+            {
+                fc.stop();
+                return 0;
+            }
+            const auto index = nextFile++;
+            // the budget is taken in this serial filter, so at most one thread waits for it;
+            // only the files being loaded right now are waited for, and they finish independently of this thread
+            std::unique_lock lock( loadingMutex );
+            loadingCv.wait( lock, [&]
+            {
+                return numLoading == 0 || bytesLoading + sizes[index] <= settings.maxBytesInFlight || !keepGoing.load( std::memory_order_relaxed );
+            } );
+            ++numLoading;
+            bytesLoading += sizes[index];
+            return index;
+        } ) &
+        tbb::make_filter<size_t, size_t>( cParallelFilter, [&] ( size_t index )
+        {
+            MR_FINALLY
+            {
+                {
+                    std::unique_lock lock( loadingMutex );
+                    --numLoading;
+                    bytesLoading -= sizes[index];
+                }
+                loadingCv.notify_all();
+            };
+            if ( !keepGoing.load( std::memory_order_relaxed ) )
+            {
+                results[index] = unexpectedOperationCanceled();
+                return index;
+            }
+            spdlog::info( "Loading file {}", utf8string( files[index] ) );
+            // isolation prevents this thread from taking another file while it waits for parallel parts of this file loading
+            results[index] = tbb::this_task_arena::isolate( [&]
+            {
+                return loadObjectFromFile( files[index], reportFrom );
+            } );
+            return index;
+        } ) &
+        tbb::make_filter<size_t, void>( cSerialInOrderFilter, [&] ( size_t index )
+        {
+            ++numLoaded;
+            reportFrom( 0.f );
+            onLoaded( index, std::move( results[index] ) );
+        } ) );
+#endif
+}
+
 // async loading context
 struct AsyncLoadContext
 {
     std::vector<std::filesystem::path> paths;
     std::vector<Expected<LoadedObjects>> results;
 
+    SceneLoad::FileLoadCallback fileLoadCallback;
+    BitSet loadedFiles;
+    size_t nextFileToReport = 0;
+#if !defined( __EMSCRIPTEN__ ) || defined( __EMSCRIPTEN_PTHREADS__ )
+    std::mutex fileLoadMutex;
+#endif
+
+    // saves the result of given file and passes it with all next loaded files to fileLoadCallback
+    void onFileLoaded( size_t index, Expected<LoadedObjects> result )
+    {
+        results[index] = std::move( result );
+        if ( !fileLoadCallback )
+            return;
+#if !defined( __EMSCRIPTEN__ ) || defined( __EMSCRIPTEN_PTHREADS__ )
+        std::unique_lock lock( fileLoadMutex );
+#endif
+        loadedFiles.autoResizeSet( index );
+        while ( nextFileToReport < paths.size() && loadedFiles.test( nextFileToReport ) )
+        {
+            fileLoadCallback( paths[nextFileToReport], results[nextFileToReport] );
+            ++nextFileToReport;
+        }
+    }
+
     std::atomic_size_t asyncCount{ 0 };
 
     ProgressCallback progressCallback;
@@ -174,23 +332,26 @@ struct AsyncLoadContext
 namespace MR::SceneLoad
 {
 
-SceneLoadResult fromAnySupportedFormat( const std::vector<std::filesystem::path>& files, ProgressCallback callback )
+SceneLoadResult fromAnySupportedFormat( const std::vector<std::filesystem::path>& files, ProgressCallback callback,
+    const SceneLoadSettings& settings )
 {
+    MR_TIMER;
+    auto paths = files;
+    std::erase_if( paths, [] ( auto&& path ) { return path.empty(); } );
+
     SceneConstructor constructor;
-    for ( auto index = 0ull; index < files.size(); ++index )
+    loadFilesPipelined( paths, callback, settings, [&] ( size_t index, Expected<LoadedObjects> result )
     {
-        const auto& path = files[index];
-        if ( path.empty() )
-            continue;
-
-        spdlog::info( "Loading file {}", utf8string( path ) );
-        constructor.process( path, loadObjectFromFile( path, subprogress( callback, index, files.size() ) ) );
-    }
+        if ( settings.fileLoadCallback )
+            settings.fileLoadCallback( paths[index], result );
+        constructor.process( paths[index], std::move( result ) );
+    } );
     return constructor.construct();
 }
 
 void asyncFromAnySupportedFormat( const std::vector<std::filesystem::path>& files,
-                                  SceneLoad::PostLoadCallback postLoadCallback, ProgressCallback progressCallback )
+                                  SceneLoad::PostLoadCallback postLoadCallback, ProgressCallback progressCallback,
+                                  const SceneLoadSettings& settings )
 {
     auto ctx = std::make_shared<AsyncLoadContext>();
     ctx->paths = files;
@@ -198,8 +359,10 @@ void asyncFromAnySupportedFormat( const std::vector<std::filesystem::path>& file
 
     const auto count = ctx->paths.size();
     ctx->results.resize( count, unexpected( "Uninitialized" ) );
+    ctx->fileLoadCallback = settings.fileLoadCallback;
 
-    size_t syncIndex = 0;
+    std::vector<std::filesystem::path> syncPaths;
+    std::vector<size_t> syncIndices;
     BitSet asyncBitSet( count );
     for ( auto index = 0ull; index < count; ++index )
     {
@@ -210,13 +373,20 @@ void asyncFromAnySupportedFormat( const std::vector<std::filesystem::path>& file
         }
         else
         {
-            spdlog::info( "Loading file {}", utf8string( path ) );
-            ctx->results[index] = loadObjectFromFile( path, subprogress( progressCallback, syncIndex++, count ) );
+            syncPaths.push_back( path );
+            syncIndices.push_back( index );
         }
     }
-    assert( syncIndex + asyncBitSet.count() == count );
+    assert( syncIndices.size() + asyncBitSet.count() == count );
 
-    ctx->progressCallback = subprogress( progressCallback, (float)syncIndex / (float)count, 1.00f );
+    const auto syncCount = syncIndices.size();
+    loadFilesPipelined( syncPaths, subprogress( progressCallback, 0.00f, (float)syncCount / (float)count ), settings,
+        [&] ( size_t index, Expected<LoadedObjects> result )
+    {
+        ctx->onFileLoaded( syncIndices[index], std::move( result ) );
+    } );
+
+    ctx->progressCallback = subprogress( progressCallback, (float)syncCount / (float)count, 1.00f );
     ctx->initializeProgressMap( asyncBitSet );
 
     auto postLoad = [ctx, count, postLoadCallback]
@@ -242,7 +412,7 @@ void asyncFromAnySupportedFormat( const std::vector<std::filesystem::path>& file
         spdlog::info( "Async loading file {}", utf8string( path ) );
         asyncLoader( path, [ctx, index, postLoad, callback] ( Expected<LoadedObjects> result )
         {
-            ctx->results[index] = std::move( result );
+            ctx->onFileLoaded( index, std::move( result ) );
             reportProgress( callback, 1.00f );
             if ( ctx->asyncCount.fetch_sub( 1 ) == 1 )
                 // that was the last file
@@ -251,4 +421,52 @@ void asyncFromAnySupportedFormat( const std::vector<std::filesystem::path>& file
     }
 }
 
+TEST( MRMesh, SceneLoadPipelined )
+{
+    UniqueTemporaryFolder folder( {} );
+    std::vector<std::filesystem::path> files;
+    for ( int i = 0; i < 8; ++i )
+    {
+        files.push_back( folder / ( "cube" + std::to_string( i ) + ".ply" ) );
+        ASSERT_TRUE( MeshSave::toAnySupportedFormat( makeCube( Vector3f::diagonal( float( i + 1 ) ) ), files.back() ).has_value() );
+    }
+
+    // the files are reported in their order, and the objects are added in the scene in the same order
+    for ( size_t maxBytesInFlight : { size_t( 1 ), SceneLoadSettings{}.maxBytesInFlight } )
+    {
+        std::vector<std::filesystem::path> reported;
+        SceneLoadSettings settings{ .maxFilesInFlight = 3, .maxBytesInFlight = maxBytesInFlight };
+        settings.fileLoadCallback = [&] ( const std::filesystem::path& path, const Expected<LoadedObjects>& res )
+        {
+            EXPECT_TRUE( res.has_value() );
+            reported.push_back( path );
+        };
+        auto res = fromAnySupportedFormat( files, {}, settings );
+        ASSERT_TRUE( res.scene );
+        EXPECT_TRUE( res.errorSummary.empty() );
+        EXPECT_EQ( reported, files );
+        EXPECT_EQ( res.loadedFiles, files );
+        ASSERT_EQ( res.scene->children().size(), files.size() );
+        for ( size_t i = 0; i < files.size(); ++i )
+            EXPECT_EQ( res.scene->children()[i]->name(), utf8string( files[i].stem() ) );
+    }
+
+    // after cancellation all files are still reported in order, and the files not loaded yet are canceled
+    std::vector<std::filesystem::path> reported;
+    std::optional<Expected<LoadedObjects>> lastResult;
+    SceneLoadSettings settings{ .maxFilesInFlight = 3, .maxBytesInFlight = 1 };
+    settings.fileLoadCallback = [&] ( const std::filesystem::path& path, const Expected<LoadedObjects>& res )
+    {
+        reported.push_back( path );
+        lastResult = res;
+    };
+    auto res = fromAnySupportedFormat( files, [] ( float ) { return false; }, settings );
+    EXPECT_EQ( reported, files );
+    ASSERT_TRUE( lastResult );
+    ASSERT_FALSE( lastResult->has_value() );
+    EXPECT_EQ( lastResult->error(), stringOperationCanceled() );
+    EXPECT_LT( res.loadedFiles.size(), files.size() );
+    EXPECT_FALSE( res.errorSummary.empty() );
+}
+
 } // namespace MR::SceneLoad
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MRObject.h"
+#include "MRLoadedObjects.h"
 
 namespace MR::SceneLoad
 {
@@ -22,12 +23,31 @@ struct SceneLoadResult
     std::string warningSummary;
 };
 
+/// is called for each loaded file with the objects not added in the scene yet
+using FileLoadCallback = std::function<void ( const std::filesystem::path& path, const Expected<LoadedObjects>& result )>;
+
+/// Settings of loading of several files
+struct SceneLoadSettings
+{
+    /// maximal number of files being read and parsed simultaneously, 0 means the number of threads
+    size_t maxFilesInFlight = 0;
+    /// next file is not started while the total size of the files being loaded with it exceeds this value,
+    /// which bounds the memory for file data and intermediate structures of parsers; a file of any size can be loaded alone
+    size_t maxBytesInFlight = size_t( 1 ) << 30;
+    /// if set, it is called in the order of the files as soon as a file and all previous ones are loaded,
+    /// e.g. to show loading results before the whole scene is constructed
+    FileLoadCallback fileLoadCallback;
+};
+
 /// Load scene from file
-MRMESH_API SceneLoadResult fromAnySupportedFormat( const std::vector<std::filesystem::path>& files, ProgressCallback callback = {} );
+/// the files are loaded in parallel threads, and the scene is constructed in the order of the files
+MRMESH_API SceneLoadResult fromAnySupportedFormat( const std::vector<std::filesystem::path>& files, ProgressCallback callback = {},
+    const SceneLoadSettings& settings = {} );
 
 /// Async load scene from file
 /// calls `postLoadCallback` from a working thread (or from the main thread on single-thread platforms) after all files being loaded
 using PostLoadCallback = std::function<void ( SceneLoadResult )>;
-MRMESH_API void asyncFromAnySupportedFormat( const std::vector<std::filesystem::path>& files, PostLoadCallback postLoadCallback, ProgressCallback progressCallback = {} );
+MRMESH_API void asyncFromAnySupportedFormat( const std::vector<std::filesystem::path>& files, PostLoadCallback postLoadCallback, ProgressCallback progressCallback = {},
+    const SceneLoadSettings& settings = {} );
 
 } // namespace MR::SceneLoad
@@ -365,6 +365,15 @@ void deserializeFromJson( const Json::Value& root, Vector4f& vec )
     }
 }
 
+void deserializeFromJson( const Json::Value& root, Box3f& box )
+{
+    if ( root.isObject() )
+    {
+        deserializeFromJson( root["min"], box.min );
+        deserializeFromJson( root["max"], box.max );
+    }
+}
+
 void deserializeFromJson( const Json::Value& root, Color& col )
 {
     if ( root.isObject() && root["r"].isNumeric() && root["g"].isNumeric() && root["b"].isNumeric() && root["a"].isNumeric() )
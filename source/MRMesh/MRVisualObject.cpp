@@ -194,6 +194,8 @@ void VisualObject::resetDirty() const
 
 Box3f VisualObject::getBoundingBox() const
 {
+    if ( auto box = pendingModelBox_() )
+        return *box; // the model is not loaded yet
     if ( dirty_ & DIRTY_BOUNDING_BOX )
     {
         boundingBoxCache_ = computeBoundingBox_();
@@ -359,6 +361,10 @@ MR_SUPPRESS_WARNING_POP
     // labels
     serializeToJson( Vector4f( labelsColor_.get() ), root["Colors"]["Labels"] );
 
+    // to know the box of the object without loading its model
+    if ( const auto box = getBoundingBox(); box.valid() )
+        serializeToJson( box, root["BoundingBox"] );
+
     // append base type
     root["Type"].append( VisualObject::TypeName() );
 
@@ -1,8 +1,16 @@
 #include "MRZip.h"
+#include "MRBuffer.h"
 #include "MRDirectory.h"
+#include "MRFinally.h"
+#include "MRGTest.h"
 #include "MRIOParsing.h"
+#include "MRParallelFor.h"
 #include "MRStringConvert.h"
 #include "MRTimer.h"
+#include "MRUniqueTemporaryFolder.h"
+#include "MRPch/MRTBB.h"
+
+#include <fmt/chrono.h>
 
 #if (defined(__APPLE__) && defined(__clang__)) || defined(__EMSCRIPTEN__)
 #pragma clang diagnostic push
@@ -11,13 +19,20 @@
 
 #include <zip.h>
 #include <zipconf.h>
+#include <zlib.h>
 
 #if (defined(__APPLE__) && defined(__clang__)) || defined(__EMSCRIPTEN__)
 #pragma clang diagnostic pop
 #endif
 
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <fstream>
+#include <mutex>
+#include <numeric>
 
 namespace MR
 {
@@ -91,94 +106,94 @@ private:
     ProgressData pd_;
 };
 
-/// zip-callback for reading from std::istream
-zip_int64_t istreamZipSourceCallback( void *istream, void *data, zip_uint64_t len, zip_source_cmd_t cmd )
+/// the handles of the same zip archive for parallel threads, each handle is used by one thread at a time
+class ZipPool
 {
-    if ( !istream )
-    {
-        assert( false );
-        return -1;
-    }
-
-    std::istream & is = *(std::istream*)( istream );
+public:
+    using Opener = std::function<Expected<std::unique_ptr<AutoCloseZip>>()>;
+    explicit ZipPool( Opener opener ) : opener_( std::move( opener ) ) {}
 
-    switch ( cmd )
+    /// returns a free handle or opens a new one
+    Expected<std::unique_ptr<AutoCloseZip>> acquire()
     {
-        case ZIP_SOURCE_SUPPORTS:
-            return zip_source_make_command_bitmap( ZIP_SOURCE_OPEN, ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE,
-                ZIP_SOURCE_STAT, ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, ZIP_SOURCE_SEEK, ZIP_SOURCE_TELL, ZIP_SOURCE_SUPPORTS, -1 );
-
-        case ZIP_SOURCE_SEEK:
         {
-            zip_source_args_seek argsSeek = * ((zip_source_args_seek *)data);
-            if ( argsSeek.whence == SEEK_SET && argsSeek.offset >= 0 )
-                is.seekg( argsSeek.offset );
-            else if ( argsSeek.whence == SEEK_CUR )
-                is.seekg( argsSeek.offset, std::ios_base::cur );
-            else if ( argsSeek.whence == SEEK_END && argsSeek.offset <= 0 )
-                is.seekg( argsSeek.offset, std::ios_base::end );
-            else
+            std::lock_guard lock( mutex_ );
+            if ( !free_.empty() )
             {
-                assert( false );
-                return -1;
+                auto res = std::move( free_.back() );
+                free_.pop_back();
+                return res;
             }
-            assert( !is.fail() );
-            return is.fail() ? -1 : 0;
         }
+        return opener_();
+    }
 
-        case ZIP_SOURCE_OPEN:
-            return 0;
-
-        case ZIP_SOURCE_READ:
-            is.read( (char*)data, len );
-            assert( !is.fail() );
-            return is.fail() ? 0 : len;
-
-        case ZIP_SOURCE_CLOSE:
-            return 0;
-
-        case ZIP_SOURCE_TELL:
-            return is.tellg();
-
-        case ZIP_SOURCE_STAT:
-        {
-            zip_stat_t* zipStat = (zip_stat_t*)data;
-            zip_stat_init(zipStat);
-
-            zipStat->size = getStreamSize( is );
-            zipStat->valid |= ZIP_STAT_SIZE;
-            assert( !is.fail() );
+    /// returns the handle in the pool after its use
+    void release( std::unique_ptr<AutoCloseZip> zip )
+    {
+        std::lock_guard lock( mutex_ );
+        free_.push_back( std::move( zip ) );
+    }
 
-            return sizeof(zip_stat_t);
-        }
+private:
+    Opener opener_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<AutoCloseZip>> free_;
+};
 
-        case ZIP_SOURCE_FREE:
-            return 0;
+/// a file in zip archive to be written on disk
+struct ZipFileToExtract
+{
+    zip_uint64_t index = 0;
+    std::string name;
+    std::filesystem::path path;
+    zip_uint64_t size = 0;
+};
 
-        default:
-            ;
+Expected<void> extractFile( zip_t * zip, const ZipFileToExtract& file )
+{
+    std::ofstream ofs( file.path, std::ios::binary );
+    if ( !ofs || ofs.bad() )
+        return unexpected( "Cannot create file " + utf8string( file.path ) );
+
+    zip_file_t* zfile = zip_fopen_index( zip, file.index, 0 );
+    if ( !zfile )
+        return unexpected( "Cannot open zip file " + file.name );
+    MR_FINALLY { zip_fclose( zfile ); };
+
+    // the file is read by parts to limit the memory used by all threads
+    std::vector<char> fileBuffer( std::min( file.size, zip_uint64_t( 1 ) << 24 ) );
+    zip_uint64_t bytesWritten = 0;
+    while ( bytesWritten < file.size )
+    {
+        const auto toRead = std::min( zip_uint64_t( fileBuffer.size() ), file.size - bytesWritten );
+        const auto bytesRead = zip_fread( zfile, fileBuffer.data(), toRead );
+        if ( bytesRead != (zip_int64_t)toRead )
+            return unexpected( "Cannot read file from zip " + file.name );
+        if ( !ofs.write( fileBuffer.data(), toRead ) )
+            return unexpected( "Cannot write file from zip " + utf8string( file.path ) );
+        bytesWritten += toRead;
     }
-    assert( false );
-    return -1;
+    ofs.close();
+    return {};
 }
 
-Expected<void> decompressZip_( zip_t * zip, const std::filesystem::path& targetFolder, const char * password )
+/// creates all folders of zip archive, and then extracts its files in parallel threads, each having its own handle of the archive
+Expected<void> decompressZip_( ZipPool& pool, const std::filesystem::path& targetFolder, const char * password )
 {
-    assert( zip );
-
     std::error_code ec;
     if ( !std::filesystem::is_directory( targetFolder, ec ) )
         return unexpected( "Directory does not exist " + utf8string( targetFolder ) );
 
-    if ( password )
-        zip_set_default_password( zip, password );
+    auto zip = pool.acquire();
+    if ( !zip )
+        return unexpected( std::move( zip.error() ) );
 
     zip_stat_t stats;
-    zip_file_t* zfile;
-    std::vector<char> fileBufer;
-    for ( int i = 0; i < zip_get_num_entries( zip, 0 ); ++i )
+    std::vector<ZipFileToExtract> files;
+    for ( int i = 0; i < zip_get_num_entries( **zip, 0 ); ++i )
     {
-        if ( zip_stat_index( zip, i, 0, &stats ) == -1 )
+        if ( zip_stat_index( **zip, i, 0, &stats ) == -1 )
             return unexpected( "Cannot process zip content" );
 
         std::string nameFixed = stats.name;
@@ -186,61 +201,428 @@ Expected<void> decompressZip_( zip_t * zip, const std::filesystem::path& targetF
         std::filesystem::path relativeName = pathFromUtf8( nameFixed );
         relativeName.make_preferred();
         std::filesystem::path newItemPath = targetFolder / relativeName;
-        if ( !nameFixed.empty() && nameFixed.back() == '/' )
+
+        // in some manually created zip-files there is no folder entries for files in sub-folders;
+        // so let us create directory for each file before extracting them in parallel
+        if ( !std::filesystem::exists( newItemPath.parent_path(), ec ) )
+            if ( !std::filesystem::create_directories( newItemPath.parent_path(), ec ) )
+                return unexpected( "Cannot create folder " + utf8string( newItemPath.parent_path() ) );
+
+        if ( nameFixed.empty() || nameFixed.back() != '/' )
+            files.push_back( { zip_uint64_t( i ), std::move( nameFixed ), std::move( newItemPath ), stats.size } );
+    }
+    pool.release( std::move( *zip ) );
+
+    // start from the largest files for better balance of threads
+    std::vector<size_t> order( files.size() );
+    std::iota( order.begin(), order.end(), size_t( 0 ) );
+    std::stable_sort( order.begin(), order.end(), [&] ( size_t a, size_t b ) { return files[a].size > files[b].size; } );
+
+    std::vector<Expected<void>> results( files.size() );
+    ParallelFor( size_t( 0 ), order.size(), [&] ( size_t k )
+    {
+        const auto i = order[k];
+        auto zip = pool.acquire();
+        if ( !zip )
         {
-            if ( !std::filesystem::exists( newItemPath.parent_path(), ec ) )
-                if ( !std::filesystem::create_directories( newItemPath.parent_path(), ec ) )
-                    return unexpected( "Cannot create folder " + utf8string( newItemPath.parent_path() ) );
+            results[i] = unexpected( std::move( zip.error() ) );
+            return;
         }
-        else
+        if ( password )
+            zip_set_default_password( **zip, password );
+        results[i] = extractFile( **zip, files[i] );
+        pool.release( std::move( *zip ) );
+    } );
+
+    for ( auto& res : results )
+        if ( !res )
+            return res;
+    return {};
+}
+
+/// the parts of the files are compressed independently in parallel threads and then concatenated in one deflate stream of each file
+/// (each part, except the last one, ends on byte boundary, and uses the end of previous part as the dictionary)
+constexpr size_t cDeflateBlockSize = size_t( 1 ) << 22;
+constexpr size_t cDeflateDictSize = size_t( 1 ) << 15;
+
+/// a file to be compressed in zip archive
+struct ZipFileToAdd
+{
+    std::filesystem::path path;
+    std::string archiveName;
+    size_t size = 0;
+    const std::string* data = nullptr; ///< the contents of the file in memory, then it is not read from the path
+    std::time_t modifiedTime = 0; ///< last modification time of the file stored in the archive
+};
+
+/// a part of a file compressed independently of other parts
+struct DeflateBlock
+{
+    size_t file = 0; ///< index in the vector of ZipFileToAdd
+    size_t offset = 0; ///< position of the part in the file
+    size_t size = 0;
+    bool last = false; ///< the last part of the file finishes deflate stream
+    std::vector<char> compressed;
+    uLong crc = 0;
+    std::string error;
+};
+
+void deflateBlock( const ZipFileToAdd& file, DeflateBlock& block )
+{
+    const auto dictSize = std::min( block.offset, cDeflateDictSize );
+    std::vector<char> data;
+    const Bytef* src = nullptr;
+    if ( file.data )
+        src = reinterpret_cast<const Bytef*>( file.data->data() + block.offset - dictSize );
+    else
+    {
+        data.resize( dictSize + block.size );
+        std::ifstream in( file.path, std::ios::binary );
+        in.seekg( block.offset - dictSize );
+        if ( !in.read( data.data(), data.size() ) )
         {
-            zfile = zip_fopen_index(zip,i,0);
-            if ( !zfile )
-                return unexpected( "Cannot open zip file " + nameFixed );
-
-            // in some manually created zip-files there is no folder entries for files in sub-folders;
-            // so let us create directory each time before saving a file in it
-            if ( !std::filesystem::exists( newItemPath.parent_path(), ec ) )
-                if ( !std::filesystem::create_directories( newItemPath.parent_path(), ec ) )
-                    return unexpected( "Cannot create folder " + utf8string( newItemPath.parent_path() ) );
-
-            std::ofstream ofs( newItemPath, std::ios::binary );
-            if ( !ofs || ofs.bad() )
-                return unexpected( "Cannot create file " + utf8string( newItemPath ) );
-
-            fileBufer.resize(stats.size);
-            auto bitesRead = zip_fread(zfile,(void*)fileBufer.data(),fileBufer.size());
-            if ( bitesRead != (zip_int64_t)stats.size )
-                return unexpected( "Cannot read file from zip " + nameFixed );
-
-            zip_fclose(zfile);
-            if ( !ofs.write( fileBufer.data(), fileBufer.size() ) )
-                return unexpected( "Cannot write file from zip " + utf8string( newItemPath ) );
-            ofs.close();
+            block.error = "Cannot read file " + utf8string( file.path );
+            return;
         }
+        src = reinterpret_cast<const Bytef*>( data.data() );
     }
-    return {};
+    block.crc = crc32( crc32( 0, nullptr, 0 ), src + dictSize, uInt( block.size ) );
+
+    z_stream stream{};
+    if ( deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+    {
+        block.error = "Cannot initialize deflate";
+        return;
+    }
+    MR_FINALLY { deflateEnd( &stream ); };
+    if ( dictSize > 0 && deflateSetDictionary( &stream, src, uInt( dictSize ) ) != Z_OK )
+    {
+        block.error = "Cannot set deflate dictionary";
+        return;
+    }
+
+    // deflateBound is for Z_FINISH, and the synchronization point takes at most several bytes more
+    block.compressed.resize( deflateBound( &stream, uLong( block.size ) ) + 16 );
+    stream.next_in = const_cast<Bytef*>( src + dictSize );
+    stream.avail_in = uInt( block.size );
+    stream.next_out = reinterpret_cast<Bytef*>( block.compressed.data() );
+    stream.avail_out = uInt( block.compressed.size() );
+    const auto res = deflate( &stream, block.last ? Z_FINISH : Z_SYNC_FLUSH );
+    if ( ( block.last && res != Z_STREAM_END ) || ( !block.last && ( res != Z_OK || stream.avail_in != 0 || stream.avail_out == 0 ) ) )
+    {
+        block.error = "Cannot compress file " + utf8string( file.path );
+        return;
+    }
+    block.compressed.resize( block.compressed.size() - stream.avail_out );
 }
 
-} // anonymous namespace
+template <typename T>
+void putLE( std::string& buf, T value )
+{
+    static_assert( std::is_integral_v<T> );
+    char bytes[sizeof( T )];
+    std::memcpy( bytes, &value, sizeof( T ) ); // zip format is little-endian as all supported platforms
+    buf.append( bytes, sizeof( T ) );
+}
 
-Expected<void> compressZip( const std::filesystem::path& zipFile, const std::filesystem::path& sourceFolder,
-    const std::vector<std::filesystem::path>& excludeFiles, const char * password, ProgressCallback cb )
+/// writes zip archive without encryption entry by entry in a seekable stream;
+/// the sizes and checksum of each file are written in its local header after its data
+class ZipWriter
 {
-    MR_TIMER
+public:
+    explicit ZipWriter( std::ostream& out ) : out_( out ) {}
 
-    if ( !reportProgress( cb, 0.0f ) )
-        return unexpectedOperationCanceled();
+    /// the directory is stored with current time
+    bool addDirectory( const std::string& name )
+    {
+        entries_.push_back( { .name = name, .offset = uint64_t( out_.tellp() ), .method = 0, .directory = true } );
+        setTime_( entries_.back(), std::time( nullptr ) );
+        writeLocalHeader_( entries_.back() );
+        return bool( out_ );
+    }
+
+    /// starts new file of given uncompressed size and modification time, its compressed data shall be written by writeData
+    bool beginFile( const std::string& name, uint64_t size, std::time_t modifiedTime )
+    {
+        // the margin for deflate overhead on incompressible data
+        const bool zip64 = size >= 0xF0000000ull;
+        entries_.push_back( { .name = name, .offset = uint64_t( out_.tellp() ), .size = size, .zip64Local = zip64 } );
+        setTime_( entries_.back(), modifiedTime );
+        writeLocalHeader_( entries_.back() );
+        return bool( out_ );
+    }
 
+    bool writeData( const std::vector<char>& data )
+    {
+        entries_.back().compressedSize += data.size();
+        return bool( out_.write( data.data(), data.size() ) );
+    }
+
+    /// writes the checksum and compressed size of the file in its local header
+    bool endFile( uint32_t crc )
+    {
+        auto& e = entries_.back();
+        e.crc = crc;
+        if ( !e.zip64Local && e.compressedSize >= 0xFFFFFFFFull )
+            return false;
+        const auto end = out_.tellp();
+        std::string buf;
+        putLE( buf, e.crc );
+        if ( e.zip64Local )
+        {
+            out_.seekp( e.offset + 14 );
+            out_.write( buf.data(), buf.size() );
+            buf.clear();
+            putLE( buf, e.size );
+            putLE( buf, e.compressedSize );
+            out_.seekp( e.offset + 30 + e.name.size() + 4 );
+        }
+        else
+        {
+            putLE( buf, uint32_t( e.compressedSize ) );
+            putLE( buf, uint32_t( e.size ) );
+            out_.seekp( e.offset + 14 );
+        }
+        out_.write( buf.data(), buf.size() );
+        out_.seekp( end );
+        return bool( out_ );
+    }
+
+    /// writes central directory
+    bool finish()
+    {
+        const auto cdOffset = uint64_t( out_.tellp() );
+        std::string buf;
+        for ( const auto& e : entries_ )
+        {
+            std::string extra;
+            if ( e.size >= 0xFFFFFFFFull )
+                putLE( extra, e.size );
+            if ( e.compressedSize >= 0xFFFFFFFFull )
+                putLE( extra, e.compressedSize );
+            if ( e.offset >= 0xFFFFFFFFull )
+                putLE( extra, e.offset );
+            if ( !extra.empty() )
+            {
+                std::string header;
+                putLE( header, uint16_t( 0x0001 ) );
+                putLE( header, uint16_t( extra.size() ) );
+                extra = header + extra;
+            }
+            const uint16_t version = extra.empty() && !e.zip64Local ? 20 : 45;
+            putLE( buf, uint32_t( 0x02014b50 ) );
+            putLE( buf, version ); // made by
+            putLE( buf, version ); // needed to extract
+            putLE( buf, cUtf8Flag );
+            putLE( buf, e.method );
+            putLE( buf, e.dosTime );
+            putLE( buf, e.dosDate );
+            putLE( buf, e.crc );
+            putLE( buf, uint32_t( std::min( e.compressedSize, uint64_t( 0xFFFFFFFF ) ) ) );
+            putLE( buf, uint32_t( std::min( e.size, uint64_t( 0xFFFFFFFF ) ) ) );
+            putLE( buf, uint16_t( e.name.size() ) );
+            putLE( buf, uint16_t( extra.size() ) );
+            putLE( buf, uint16_t( 0 ) ); // comment length
+            putLE( buf, uint16_t( 0 ) ); // disk number
+            putLE( buf, uint16_t( 0 ) ); // internal attributes
+            putLE( buf, uint32_t( e.directory ? 0x10 : 0 ) ); // external attributes: MS-DOS directory flag
+            putLE( buf, uint32_t( std::min( e.offset, uint64_t( 0xFFFFFFFF ) ) ) );
+            buf += e.name;
+            buf += extra;
+        }
+        const auto cdSize = uint64_t( buf.size() );
+        const auto numEntries = uint64_t( entries_.size() );
+        if ( numEntries >= 0xFFFF || cdSize >= 0xFFFFFFFFull || cdOffset >= 0xFFFFFFFFull )
+        {
+            // zip64 end of central directory record and its locator
+            const auto zip64EndOffset = cdOffset + cdSize;
+            putLE( buf, uint32_t( 0x06064b50 ) );
+            putLE( buf, uint64_t( 44 ) ); // size of the remaining record
+            putLE( buf, uint16_t( 45 ) );
+            putLE( buf, uint16_t( 45 ) );
+            putLE( buf, uint32_t( 0 ) );
+            putLE( buf, uint32_t( 0 ) );
+            putLE( buf, numEntries );
+            putLE( buf, numEntries );
+            putLE( buf, cdSize );
+            putLE( buf, cdOffset );
+
+            putLE( buf, uint32_t( 0x07064b50 ) );
+            putLE( buf, uint32_t( 0 ) );
+            putLE( buf, zip64EndOffset );
+            putLE( buf, uint32_t( 1 ) );
+        }
+        putLE( buf, uint32_t( 0x06054b50 ) );
+        putLE( buf, uint16_t( 0 ) );
+        putLE( buf, uint16_t( 0 ) );
+        putLE( buf, uint16_t( std::min( numEntries, uint64_t( 0xFFFF ) ) ) );
+        putLE( buf, uint16_t( std::min( numEntries, uint64_t( 0xFFFF ) ) ) );
+        putLE( buf, uint32_t( std::min( cdSize, uint64_t( 0xFFFFFFFF ) ) ) );
+        putLE( buf, uint32_t( std::min( cdOffset, uint64_t( 0xFFFFFFFF ) ) ) );
+        putLE( buf, uint16_t( 0 ) ); // comment length
+        return bool( out_.write( buf.data(), buf.size() ) );
+    }
+
+private:
+    static constexpr uint16_t cUtf8Flag = 0x0800;
+
+    struct Entry
+    {
+        std::string name;
+        uint64_t offset = 0;
+        uint64_t compressedSize = 0;
+        uint64_t size = 0;
+        uint32_t crc = 0;
+        uint16_t method = 8; // deflate
+        uint16_t dosTime = 0;
+        uint16_t dosDate = 0;
+        bool directory = false;
+        bool zip64Local = false; // local header has zip64 extra field with the sizes
+    };
+
+    static void setTime_( Entry& e, std::time_t time )
+    {
+        // MS-DOS date and time of the entries are local as in other zip tools
+        const auto tm = fmt::localtime( time );
+        e.dosDate = uint16_t( ( std::max( tm.tm_year + 1900 - 1980, 0 ) << 9 ) | ( ( tm.tm_mon + 1 ) << 5 ) | tm.tm_mday );
+        e.dosTime = uint16_t( ( tm.tm_hour << 11 ) | ( tm.tm_min << 5 ) | ( tm.tm_sec / 2 ) );
+    }
+
+    void writeLocalHeader_( const Entry& e )
+    {
+        std::string buf;
+        putLE( buf, uint32_t( 0x04034b50 ) );
+        putLE( buf, uint16_t( e.zip64Local ? 45 : 20 ) );
+        putLE( buf, cUtf8Flag );
+        putLE( buf, e.method );
+        putLE( buf, e.dosTime );
+        putLE( buf, e.dosDate );
+        putLE( buf, uint32_t( 0 ) ); // crc, written in endFile
+        putLE( buf, uint32_t( e.zip64Local ? 0xFFFFFFFF : 0 ) ); // compressed size
+        putLE( buf, uint32_t( e.zip64Local ? 0xFFFFFFFF : 0 ) ); // uncompressed size
+        putLE( buf, uint16_t( e.name.size() ) );
+        putLE( buf, uint16_t( e.zip64Local ? 20 : 0 ) );
+        buf += e.name;
+        if ( e.zip64Local )
+        {
+            putLE( buf, uint16_t( 0x0001 ) );
+            putLE( buf, uint16_t( 16 ) );
+            putLE( buf, uint64_t( 0 ) );
+            putLE( buf, uint64_t( 0 ) );
+        }
+        out_.write( buf.data(), buf.size() );
+    }
+
+    std::ostream& out_;
+    std::vector<Entry> entries_;
+};
+
+/// the name in the archive with folder separators in Linux style for the latest 7-zip to open archive correctly
+std::string archiveName( const std::filesystem::path& path, const std::filesystem::path& sourceFolder )
+{
+    std::error_code ec;
+    auto res = utf8string( std::filesystem::relative( path, sourceFolder, ec ) );
+    std::replace( res.begin(), res.end(), '\\', '/' );
+    return res;
+}
+
+/// compresses the files in parallel threads by independent blocks, and writes the archive while next blocks are compressed
+Expected<void> compressZipParallel_( std::ostream& out, const std::vector<std::string>& directories, const std::vector<ZipFileToAdd>& files, ProgressCallback cb )
+{
+    ZipWriter writer( out );
+    for ( const auto& dir : directories )
+        if ( !writer.addDirectory( dir ) )
+            return unexpected( "Cannot add directory " + dir + " to archive" );
+
+    std::vector<DeflateBlock> blocks;
+    size_t totalBytes = 0;
+    for ( size_t i = 0; i < files.size(); ++i )
+    {
+        const auto size = files[i].size;
+        totalBytes += size;
+        size_t offset = 0;
+        do
+        {
+            const auto blockSize = std::min( cDeflateBlockSize, size - offset );
+            blocks.push_back( { .file = i, .offset = offset, .size = blockSize, .last = offset + blockSize == size } );
+            offset += blockSize;
+        } while ( offset < size );
+    }
+
+    // the number of blocks compressed together, limiting the memory occupied by compressed data not written yet
+    const size_t batchSize = 4 * size_t( tbb::this_task_arena::max_concurrency() );
+    const auto compressBatch = [&] ( size_t first )
+    {
+        const auto last = std::min( blocks.size(), first + batchSize );
+        ParallelFor( first, last, [&] ( size_t i )
+        {
+            deflateBlock( files[blocks[i].file], blocks[i] );
+        } );
+    };
+
+    size_t writtenBytes = 0;
+    uLong fileCrc = 0;
+    compressBatch( 0 );
+    for ( size_t first = 0; first < blocks.size(); first += batchSize )
+    {
+        tbb::task_group compressTask;
+        if ( first + batchSize < blocks.size() )
+            compressTask.run( [&compressBatch, next = first + batchSize] { compressBatch( next ); } );
+
+        const auto last = std::min( blocks.size(), first + batchSize );
+        Expected<void> res;
+        for ( size_t i = first; i < last && res; ++i )
+        {
+            auto& block = blocks[i];
+            const auto& file = files[block.file];
+            if ( !block.error.empty() )
+                res = unexpected( std::move( block.error ) );
+            else if ( block.offset == 0 && !writer.beginFile( file.archiveName, file.size, file.modifiedTime ) )
+                res = unexpected( "Cannot add file " + file.archiveName + " to archive" );
+            else if ( !writer.writeData( block.compressed ) )
+                res = unexpected( "Cannot write file " + file.archiveName + " in archive" );
+            else
+            {
+                fileCrc = block.offset == 0 ? block.crc : crc32_combine( fileCrc, block.crc, z_off_t( block.size ) );
+                if ( block.last && !writer.endFile( uint32_t( fileCrc ) ) )
+                    res = unexpected( "Cannot add file " + file.archiveName + " to archive" );
+            }
+            writtenBytes += block.size;
+            block.compressed = {};
+        }
+        if ( res && !reportProgress( cb, totalBytes > 0 ? float( writtenBytes ) / float( totalBytes ) : 1.0f ) )
+            res = unexpectedOperationCanceled();
+        compressTask.wait();
+        if ( !res )
+            return res;
+    }
+
+    if ( !writer.finish() )
+        return unexpected( "Cannot write zip central directory" );
+    return {};
+}
+
+/// returns the last modification time of the file, or current time if it is unknown
+std::time_t lastWriteTime( const std::filesystem::path& path )
+{
+    std::error_code ec;
+    const auto fileTime = std::filesystem::last_write_time( path, ec );
+    if ( ec )
+        return std::time( nullptr );
+    // std::chrono::clock_cast is not available in all supported standard libraries
+    const auto sysTime = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+        fileTime - std::filesystem::file_time_type::clock::now() + std::chrono::system_clock::now() );
+    return std::chrono::system_clock::to_time_t( sysTime );
+}
+
+/// finds all directories and files in given folder to be added in zip archive
+Expected<void> collectFilesToAdd( const std::filesystem::path& sourceFolder, const std::vector<std::filesystem::path>& excludeFiles,
+    std::vector<std::string>& directories, std::vector<ZipFileToAdd>& files )
+{
     std::error_code ec;
     if ( !std::filesystem::is_directory( sourceFolder, ec ) )
         return unexpected( "Directory '" + utf8string( sourceFolder ) + "' does not exist" );
 
-    int err;
-    AutoCloseZip zip( utf8string( zipFile ).c_str(), ZIP_CREATE | ZIP_TRUNCATE, &err, subprogress( cb, 0.5f, 1.0f ) );    
-    if ( !zip )
-        return unexpected( "Cannot create zip, error code: " + std::to_string( err ) );
-
     auto goodFile = [&]( const std::filesystem::path & path )
     {
         if ( !is_regular_file( path, ec ) )
@@ -252,56 +634,88 @@ Expected<void> compressZip( const std::filesystem::path& zipFile, const std::fil
         return excluded == excludeFiles.end();
     };
 
-    // pass #1: add directories in the archive and count the files
-    int totalFiles = 0;
     for ( auto entry : DirectoryRecursive{ sourceFolder, ec } )
     {
         const auto path = entry.path();
         if ( entry.is_directory( ec ) && path != sourceFolder )
-        {
-            auto archiveDirPath = utf8string( std::filesystem::relative( path, sourceFolder, ec ) );
-            // convert folder separators in Linux style for the latest 7-zip to open archive correctly
-            std::replace( archiveDirPath.begin(), archiveDirPath.end(), '\\', '/' );
-            if ( zip_dir_add( zip, archiveDirPath.c_str(), ZIP_FL_ENC_UTF_8 ) == -1 )
-                return unexpected( "Cannot add directory " + archiveDirPath + " to archive" );
-            continue;
-        }
+            directories.push_back( archiveName( path, sourceFolder ) );
+        else if ( goodFile( path ) )
+            files.push_back( { path, archiveName( path, sourceFolder ), size_t( std::filesystem::file_size( path, ec ) ), nullptr, lastWriteTime( path ) } );
+    }
+    return {};
+}
+
+/// writes not encrypted zip-file with the files compressed in parallel threads
+Expected<void> compressZipParallel( const std::filesystem::path& zipFile, std::vector<std::string> directories,
+    const std::vector<ZipFileToAdd>& files, ProgressCallback cb )
+{
+    std::ofstream out( zipFile, std::ios::binary );
+    if ( !out )
+        return unexpected( "Cannot create zip " + utf8string( zipFile ) );
+    for ( auto& dir : directories )
+        dir += '/';
+    auto res = compressZipParallel_( out, directories, files, cb );
+    out.close();
+    if ( res && !out )
+        res = unexpected( "Cannot write zip " + utf8string( zipFile ) );
+    if ( !res )
+    {
+        std::error_code ec;
+        std::filesystem::remove( zipFile, ec );
+    }
+    return res;
+}
+
+} // anonymous namespace
+
+Expected<void> compressZip( const std::filesystem::path& zipFile, const std::filesystem::path& sourceFolder,
+    const std::vector<std::filesystem::path>& excludeFiles, const char * password, ProgressCallback cb )
+{
+    MR_TIMER
+
+    if ( !reportProgress( cb, 0.0f ) )
+        return unexpectedOperationCanceled();
+
+    std::vector<std::string> directories;
+    std::vector<ZipFileToAdd> files;
+    if ( auto res = collectFilesToAdd( sourceFolder, excludeFiles, directories, files ); !res )
+        return res;
+
+    if ( !password )
+        return compressZipParallel( zipFile, std::move( directories ), files, cb );
 
-        if ( goodFile( path ) )
-            ++totalFiles;
+    // libzip is used for encrypted archives
+    int err;
+    AutoCloseZip zip( utf8string( zipFile ).c_str(), ZIP_CREATE | ZIP_TRUNCATE, &err, subprogress( cb, 0.5f, 1.0f ) );
+    if ( !zip )
+        return unexpected( "Cannot create zip, error code: " + std::to_string( err ) );
+
+    for ( const auto& dir : directories )
+    {
+        if ( zip_dir_add( zip, dir.c_str(), ZIP_FL_ENC_UTF_8 ) == -1 )
+            return unexpected( "Cannot add directory " + dir + " to archive" );
     }
 
-    // pass #2: add files in the archive
     int compressedFiles = 0;
     auto scb = subprogress( cb, 0.0f, 0.5f );
-    for ( auto entry : DirectoryRecursive{ sourceFolder, ec } )
+    for ( const auto& file : files )
     {
-        const auto path = entry.path();
-        if ( !goodFile( path ) )
-            continue;
-
-        auto fileSource = zip_source_file( zip, utf8string( path ).c_str(), 0, 0 );
+        auto fileSource = zip_source_file( zip, utf8string( file.path ).c_str(), 0, 0 );
         if ( !fileSource )
-            return unexpected( "Cannot open file " + utf8string( path ) + " for reading" );
+            return unexpected( "Cannot open file " + utf8string( file.path ) + " for reading" );
 
-        auto archiveFilePath = utf8string( std::filesystem::relative( path, sourceFolder, ec ) );
-        // convert folder separators in Linux style for the latest 7-zip to open archive correctly
-        std::replace( archiveFilePath.begin(), archiveFilePath.end(), '\\', '/' );
-        const auto index = zip_file_add( zip, archiveFilePath.c_str(), fileSource, ZIP_FL_OVERWRITE | ZIP_FL_ENC_UTF_8 );
+        const auto index = zip_file_add( zip, file.archiveName.c_str(), fileSource, ZIP_FL_OVERWRITE | ZIP_FL_ENC_UTF_8 );
         if ( index < 0 )
         {
             zip_source_free( fileSource );
-            return unexpected( "Cannot add file " + archiveFilePath + " to archive" );
+            return unexpected( "Cannot add file " + file.archiveName + " to archive" );
         }
 
-        if ( password )
-        {
-            if ( zip_file_set_encryption( zip, index, ZIP_EM_AES_256, password ) )
-                return unexpected( "Cannot encrypt file " + archiveFilePath + " in archive" );
-        }
+        if ( zip_file_set_encryption( zip, index, ZIP_EM_AES_256, password ) )
+            return unexpected( "Cannot encrypt file " + file.archiveName + " in archive" );
 
         ++compressedFiles;
-        if ( !reportProgress( scb, std::min( float( compressedFiles ) / totalFiles, 1.0f ) ) )
+        if ( !reportProgress( scb, std::min( float( compressedFiles ) / files.size(), 1.0f ) ) )
             return unexpectedOperationCanceled();
     }
 
@@ -316,30 +730,146 @@ Expected<void> compressZip( const std::filesystem::path& zipFile, const std::fil
     return {};
 }
 
-Expected<void> decompressZip( const std::filesystem::path& zipFile, const std::filesystem::path& targetFolder, const char * password )
+Expected<void> compressZipWithMemoryFiles( const std::filesystem::path& zipFile, const std::filesystem::path& sourceFolder,
+    const std::vector<ZipMemoryFile>& memoryFiles, ProgressCallback cb )
 {
     MR_TIMER
-    int err;
-    AutoCloseZip zip( utf8string( zipFile ).c_str(), ZIP_RDONLY, &err );
-    if ( !zip )
-        return unexpected( "Cannot open zip, error code: " + std::to_string( err ) );
 
-    return decompressZip_( zip, targetFolder, password );
+    if ( !reportProgress( cb, 0.0f ) )
+        return unexpectedOperationCanceled();
+
+    std::vector<std::string> directories;
+    std::vector<ZipFileToAdd> files;
+    if ( auto res = collectFilesToAdd( sourceFolder, {}, directories, files ); !res )
+        return res;
+
+    // the files in memory are stored with current time
+    const auto now = std::time( nullptr );
+    for ( const auto& file : memoryFiles )
+        files.push_back( { file.path, archiveName( file.path, sourceFolder ), file.data.size(), &file.data, now } );
+
+    return compressZipParallel( zipFile, std::move( directories ), files, cb );
+}
+
+Expected<void> decompressZip( const std::filesystem::path& zipFile, const std::filesystem::path& targetFolder, const char * password )
+{
+    MR_TIMER
+    ZipPool pool( [&] () -> Expected<std::unique_ptr<AutoCloseZip>>
+    {
+        int err;
+        auto zip = std::make_unique<AutoCloseZip>( utf8string( zipFile ).c_str(), ZIP_RDONLY, &err );
+        if ( !*zip )
+            return unexpected( "Cannot open zip, error code: " + std::to_string( err ) );
+        return zip;
+    } );
+    return decompressZip_( pool, targetFolder, password );
 }
 
 Expected<void> decompressZip( std::istream& zipStream, const std::filesystem::path& targetFolder, const char * password )
 {
     MR_TIMER
 
-    auto zipSource = zip_source_function_create( istreamZipSourceCallback, &zipStream, nullptr );
-    if ( !zipSource )
-        return unexpected( "Cannot create zip source from stream" );
+    // each thread opens the archive from the same buffer
+    auto buf = readCharBuffer( zipStream );
+    if ( !buf )
+        return unexpected( std::move( buf.error() ) );
 
-    AutoCloseZip zip( *zipSource, ZIP_RDONLY, nullptr );
-    if ( !zip )
-        return unexpected( "Cannot open zip from source" );
+    ZipPool pool( [&] () -> Expected<std::unique_ptr<AutoCloseZip>>
+    {
+        zip_error_t err;
+        zip_error_init( &err );
+        MR_FINALLY { zip_error_fini( &err ); };
+        auto zipSource = zip_source_buffer_create( buf->data(), buf->size(), 0, &err );
+        if ( !zipSource )
+            return unexpected( "Cannot create zip source from stream" );
+
+        auto zip = std::make_unique<AutoCloseZip>( *zipSource, ZIP_RDONLY, &err );
+        if ( !*zip )
+        {
+            zip_source_free( zipSource );
+            return unexpected( "Cannot open zip from source" );
+        }
+        return zip;
+    } );
+    return decompressZip_( pool, targetFolder, password );
+}
 
-    return decompressZip_( zip, targetFolder, password );
+TEST( MRMesh, ZipCompressDecompress )
+{
+    UniqueTemporaryFolder folder( {} );
+    const auto source = folder / "source";
+    std::filesystem::create_directories( source / "sub" / "empty" );
+
+    // the big file consists of several deflate blocks
+    std::string big;
+    for ( int i = 0; big.size() < 3 * cDeflateBlockSize + 12345; ++i )
+        big += std::to_string( i * 7919 % 100003 ) + ' ';
+    const std::vector<std::pair<std::filesystem::path, std::string>> files = {
+        { source / "a.txt", "some text" },
+        { source / "empty.bin", "" },
+        { source / "sub" / "big.txt", big },
+    };
+    for ( const auto& [path, contents] : files )
+        std::ofstream( path, std::ios::binary ) << contents;
+    // the file keeps its own modification time in the archive
+    std::filesystem::last_write_time( source / "a.txt", std::filesystem::file_time_type::clock::now() - std::chrono::hours( 24 * 10 ) );
+    const auto modifiedTime = lastWriteTime( source / "a.txt" );
+
+    const auto zipFile = folder / "test.zip";
+    EXPECT_TRUE( compressZip( zipFile, source ).has_value() );
+    {
+        int err = 0;
+        AutoCloseZip zip( utf8string( zipFile ).c_str(), ZIP_RDONLY, &err );
+        ASSERT_TRUE( bool( zip ) );
+        zip_stat_t st;
+        zip_stat_init( &st );
+        ASSERT_EQ( zip_stat( zip, "a.txt", 0, &st ), 0 );
+        EXPECT_LE( std::abs( st.mtime - modifiedTime ), 2 ); // MS-DOS time has 2 seconds resolution
+    }
+
+    const auto target = folder / "target";
+    std::filesystem::create_directories( target );
+    auto res = decompressZip( zipFile, target );
+    ASSERT_TRUE( res.has_value() ) << res.error();
+    EXPECT_TRUE( std::filesystem::is_directory( target / "sub" / "empty" ) );
+    for ( const auto& [path, contents] : files )
+    {
+        std::ifstream in( target / std::filesystem::relative( path, source ), std::ios::binary );
+        std::stringstream ss;
+        ss << in.rdbuf();
+        EXPECT_EQ( ss.str(), contents );
+    }
+
+    // the files from memory are added together with the files of the folder
+    const std::vector<ZipMemoryFile> memoryFiles = {
+        { source / "sub" / "memory.txt", big },
+        { source / "memory.bin", "" },
+    };
+    const auto zipFile2 = folder / "test2.zip";
+    res = compressZipWithMemoryFiles( zipFile2, source, memoryFiles );
+    ASSERT_TRUE( res.has_value() ) << res.error();
+    const auto target2 = folder / "target2";
+    std::filesystem::create_directories( target2 );
+    res = decompressZip( zipFile2, target2 );
+    ASSERT_TRUE( res.has_value() ) << res.error();
+    EXPECT_TRUE( std::filesystem::is_regular_file( target2 / "a.txt" ) );
+    for ( const auto& file : memoryFiles )
+    {
+        std::ifstream in( target2 / std::filesystem::relative( file.path, source ), std::ios::binary );
+        std::stringstream ss;
+        ss << in.rdbuf();
+        EXPECT_EQ( ss.str(), file.data );
+    }
+    {
+        // the files from memory are stored with current time
+        int err = 0;
+        AutoCloseZip zip( utf8string( zipFile2 ).c_str(), ZIP_RDONLY, &err );
+        ASSERT_TRUE( bool( zip ) );
+        zip_stat_t st;
+        zip_stat_init( &st );
+        ASSERT_EQ( zip_stat( zip, "memory.bin", 0, &st ), 0 );
+        EXPECT_LE( std::abs( st.mtime - std::time( nullptr ) ), 60 );
+    }
 }
 
 } // namespace MR
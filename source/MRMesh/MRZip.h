@@ -4,6 +4,7 @@
 #include "MRProgressCallback.h"
 #include "MRExpected.h"
 #include <filesystem>
+#include <string>
 #include <vector>
 
 namespace MR
@@ -35,6 +36,22 @@ MRMESH_API Expected<void> decompressZip( std::istream& zipStream, const std::fil
 MRMESH_API Expected<void> compressZip( const std::filesystem::path& zipFile, const std::filesystem::path& sourceFolder, 
     const std::vector<std::filesystem::path>& excludeFiles = {}, const char * password = nullptr, ProgressCallback cb = {} );
 
+/// a file with the contents in memory to be added in zip archive
+struct ZipMemoryFile
+{
+    /// the path of the file as if it was located in the source folder
+    std::filesystem::path path;
+    std::string data;
+};
+
+/**
+ * \brief compresses given folder together with given files from memory in given zip-file without encryption,
+ *        so the files prepared in memory are not written on disk before compression
+ * \param cb an option to get progress notifications and cancel the operation
+ */
+MRMESH_API Expected<void> compressZipWithMemoryFiles( const std::filesystem::path& zipFile, const std::filesystem::path& sourceFolder,
+    const std::vector<ZipMemoryFile>& memoryFiles, ProgressCallback cb = {} );
+
 /// \}
 
 } // namespace MR
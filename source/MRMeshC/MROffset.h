@@ -18,9 +18,9 @@ typedef struct MROffsetParameters
     /// determines the method to compute distance sign
     MRSignDetectionMode signDetectionMode;
     // TODO: fwn
-    /// use FunctionVolume for voxel grid representation:
-    ///  - memory consumption is approx. (z / (2 * thread_count)) lesser
-    ///  - computation is about 2-3 times slower
+    /// compute the distances by z-slabs and convert each slab in mesh right after its computation instead of storing the whole voxel grid:
+    ///  - only one slab of 65 z-layers is stored in memory, so memory consumption is approx. (z / 65) times lesser
+    ///  - the result is identical to the one with full memory storage
     /// used only by \ref mrMcOffsetMesh and \ref mrSharpOffsetMesh functions
     bool memoryEfficient;
 } MROffsetParameters;
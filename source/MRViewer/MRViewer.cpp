@@ -902,6 +902,14 @@ void Viewer::launchEventLoop()
             if ( eventQueue_ )
                 eventQueue_->execute();
         }
+        else if ( waitingPendingModels_ )
+        {
+            // wake up periodically to draw the models as soon as they are loaded in background
+            constexpr double pendingModelsCheckPeriod = 0.1;
+            glfwWaitEventsTimeout( pendingModelsCheckPeriod );
+            if ( eventQueue_ )
+                eventQueue_->execute();
+        }
         else
         {
             glfwWaitEvents();
@@ -933,6 +941,9 @@ void Viewer::launchShut()
         viewport.shut();
     shutdownPlugins_();
 
+    // the models are not loaded in background any more, since the libraries with the loaders can be unloaded after this function
+    Object::stopPrefetchingPendingModels();
+
     // Clear plugins
     plugins.clear();
     menuPlugin_.reset();
@@ -1625,6 +1636,41 @@ void Viewer::resetRedraw_()
     resetRedrawFlagRecursive( SceneRoot::get() );
 }
 
+void Viewer::loadVisiblePendingModels_()
+{
+    waitingPendingModels_ = false;
+    // the scene is not visited at all if it was loaded without postponing the models
+    if ( Object::numPendingModels() == 0 )
+        return;
+    auto loadRecursive = [&] ( auto& self, Object& obj ) -> void
+    {
+        if ( !obj.isVisible( presentViewportsMask_ ) )
+            return;
+        if ( obj.hasPendingModel() )
+        {
+            if ( !obj.isPendingModelLoaded() )
+            {
+                // do not block the rendering thread: the object will be drawn after its model is loaded in background
+                obj.prefetchPendingModel();
+                waitingPendingModels_ = true;
+            }
+            // the model is already loaded in background, so it is taken without waiting
+            else if ( auto res = obj.loadPendingModel(); !res )
+            {
+                spdlog::error( "Cannot load the model of object \"{}\": {}", obj.name(), res.error() );
+                // hide the object not to repeat the loading in every frame
+                obj.setVisible( false );
+                return;
+            }
+        }
+        // the copy of children is taken after the loading, which moves them in the loaded object
+        const auto children = obj.children();
+        for ( const auto& child : children )
+            self( self, *child );
+    };
+    loadRecursive( loadRecursive, SceneRoot::get() );
+}
+
 void Viewer::recursiveDraw_( const Viewport& vp, const Object& obj, const AffineXf3f& parentXf, RenderModelPassMask renderType, int* numDraws ) const
 {
     if ( !obj.isVisible( vp.id ) )
@@ -1663,6 +1709,8 @@ void Viewer::draw( bool force )
 
 bool Viewer::draw_( bool force )
 {
+    // the models postponed by lazy loading are required only for drawing, the ones already prefetched are taken now
+    loadVisiblePendingModels_();
     SceneCache::invalidateAll();
     bool needSceneRedraw = needRedraw_();
     if ( !force && !needSceneRedraw )
@@ -638,6 +638,12 @@ private:
     bool needRedraw_() const;
     void resetRedraw_();
 
+    // takes the models postponed by lazy scene loading for the objects visible in present viewports if they are loaded in background,
+    // and queues the loading of others
+    void loadVisiblePendingModels_();
+    // true if some visible objects wait for their models being loaded in background
+    bool waitingPendingModels_{ false };
+
     void recursiveDraw_( const Viewport& vp, const Object& obj, const AffineXf3f& parentXf, RenderModelPassMask renderType, int* numDraws = nullptr ) const;
 
     void initGlobalBasisAxesObject_();
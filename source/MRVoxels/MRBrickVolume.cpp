@@ -0,0 +1,183 @@
+#include "MRBrickVolume.h"
+#include "MRMeshToDistanceVolume.h"
+#include "MRMarchingCubes.h"
+#include "MRMesh/MRMesh.h"
+#include "MRMesh/MRMeshDistance.h"
+#include "MRMesh/MRMeshProject.h"
+#include "MRMesh/MRIsNaN.h"
+#include "MRMesh/MRVolumeIndexer.h"
+#include "MRMesh/MRParallelFor.h"
+#include "MRMesh/MRTimer.h"
+#include "MRMesh/MRTorus.h"
+#include "MRMesh/MRGTest.h"
+#include "MRPch/MRTBB.h"
+
+namespace MR
+{
+
+size_t heapBytes( const BrickVolumeData & data )
+{
+    return data.heapBytes();
+}
+
+Expected<BrickVolume> meshToBrickDistanceVolume( const MeshPart& mp, const MeshToBrickVolumeParams& params )
+{
+    MR_TIMER
+    if ( params.dist.signMode == SignDetectionMode::OpenVDB )
+        return unexpected( "OpenVDB sign detection mode is not supported by brick volume" );
+
+    using D = BrickVolumeData;
+    BrickVolume res;
+    res.dims = params.vol.dimensions;
+    res.voxelSize = params.vol.voxelSize;
+    auto & data = res.data;
+    data.brickDims = ( res.dims + Vector3i::diagonal( D::brickMask ) ) / D::brickSize;
+    const auto numBricks = size_t( data.brickDims.x ) * data.brickDims.y * data.brickDims.z;
+    data.denseIndex.resize( numBricks, -1 );
+    data.constValue.resize( numBricks, 0.0f );
+
+    const float narrowBand = std::max( params.narrowBand, params.vol.voxelSize.length() );
+    const bool isSigned = params.dist.signMode != SignDetectionMode::Unsigned;
+
+    // prepare all trees before parallel processing
+    mp.mesh.getAABBTree();
+    if ( isSigned )
+        mp.mesh.getDipoles();
+
+    auto brickPos = [&]( size_t b )
+    {
+        const auto xy = size_t( data.brickDims.x ) * data.brickDims.y;
+        return Vector3i( int( b % data.brickDims.x ), int( b / data.brickDims.x % data.brickDims.y ), int( b / xy ) ) * D::brickSize;
+    };
+    auto voxelCenter = [&]( const Vector3f & pos )
+    {
+        return params.vol.origin + mult( params.vol.voxelSize, pos + Vector3f::diagonal( 0.5f ) );
+    };
+
+    // find the bricks intersecting the narrow band, and the sign of all other bricks
+    if ( !ParallelFor( size_t( 0 ), numBricks, [&]( size_t b )
+    {
+        const auto minPos = brickPos( b );
+        const Vector3i maxPos(
+            std::min( minPos.x + D::brickSize, res.dims.x ) - 1,
+            std::min( minPos.y + D::brickSize, res.dims.y ) - 1,
+            std::min( minPos.z + D::brickSize, res.dims.z ) - 1 );
+        const auto center = voxelCenter( 0.5f * Vector3f( minPos + maxPos ) );
+        const float halfDiag = 0.5f * mult( params.vol.voxelSize, Vector3f( maxPos - minPos ) ).length();
+        const auto proj = findProjection( center, mp, sqr( halfDiag + narrowBand ) );
+        if ( proj.proj.face )
+            data.denseIndex[b] = 0; // will be replaced with actual index below
+        else if ( isSigned && !mp.mesh.isOutside( center, params.dist.windingNumberThreshold, params.dist.windingNumberBeta ) )
+            data.constValue[b] = -narrowBand;
+        else
+            data.constValue[b] = narrowBand;
+    }, subprogress( params.vol.cb, 0.0f, 0.2f ) ) )
+        return unexpectedOperationCanceled();
+
+    std::vector<size_t> denseBricks;
+    MinMaxf constMinMax;
+    for ( size_t b = 0; b < numBricks; ++b )
+    {
+        if ( data.denseIndex[b] < 0 )
+        {
+            constMinMax.include( data.constValue[b] );
+            continue;
+        }
+        data.denseIndex[b] = int( denseBricks.size() );
+        denseBricks.push_back( b );
+    }
+    data.denseValues.resize( denseBricks.size() * D::brickVoxels );
+
+    // compute the distances in all voxels of dense bricks
+    if ( !ParallelFor( size_t( 0 ), denseBricks.size(), [&]( size_t i )
+    {
+        const auto minPos = brickPos( denseBricks[i] );
+        float * values = data.denseValues.data() + i * D::brickVoxels;
+        Vector3i pos;
+        for ( pos.z = minPos.z; pos.z < minPos.z + D::brickSize; ++pos.z )
+            for ( pos.y = minPos.y; pos.y < minPos.y + D::brickSize; ++pos.y )
+                for ( pos.x = minPos.x; pos.x < minPos.x + D::brickSize; ++pos.x, ++values )
+                {
+                    if ( pos.x >= res.dims.x || pos.y >= res.dims.y || pos.z >= res.dims.z )
+                    {
+                        *values = cQuietNan; // outside of the volume
+                        continue;
+                    }
+                    const auto dist = signedDistanceToMesh( mp, voxelCenter( Vector3f( pos ) ), params.dist );
+                    *values = dist ? *dist : cQuietNan;
+                }
+    }, subprogress( params.vol.cb, 0.2f, 1.0f ), 1 ) )
+        return unexpectedOperationCanceled();
+
+    std::tie( res.min, res.max ) = parallelMinMax( data.denseValues );
+    if ( constMinMax.valid() )
+    {
+        res.min = std::min( res.min, constMinMax.min );
+        res.max = std::max( res.max, constMinMax.max );
+    }
+    return res;
+}
+
+Expected<SimpleVolumeMinMax> brickVolumeToSimpleVolume( const BrickVolume& volume, const ProgressCallback& cb )
+{
+    MR_TIMER
+    SimpleVolumeMinMax res;
+    res.voxelSize = volume.voxelSize;
+    res.dims = volume.dims;
+    res.min = volume.min;
+    res.max = volume.max;
+    VolumeIndexer indexer( res.dims );
+    res.data.resize( indexer.size() );
+
+    if ( !ParallelFor( size_t( 0 ), indexer.size(), [&]( size_t i )
+    {
+        res.data[i] = volume.data.get( indexer.toPos( VoxelId( i ) ) );
+    }, cb ) )
+        return unexpectedOperationCanceled();
+    return res;
+}
+
+TEST( MRVoxels, BrickVolume )
+{
+    const auto torus = makeTorus( 1.0f, 0.3f, 64, 32 );
+    const float voxelSize = 0.02f;
+    const auto box = torus.computeBoundingBox().expanded( Vector3f::diagonal( 4 * voxelSize ) );
+
+    MeshToBrickVolumeParams params;
+    params.vol.origin = box.min;
+    params.vol.voxelSize = Vector3f::diagonal( voxelSize );
+    params.vol.dimensions = Vector3i( box.size() / voxelSize ) + Vector3i::diagonal( 1 );
+    params.narrowBand = 2 * voxelSize;
+    params.dist.signMode = SignDetectionMode::ProjectionNormal;
+    auto brickVolume = meshToBrickDistanceVolume( torus, params );
+    ASSERT_TRUE( brickVolume.has_value() );
+    EXPECT_LT( brickVolume->data.numDenseBricks(), brickVolume->data.denseIndex.size() / 2 );
+
+    MeshToDistanceVolumeParams denseParams;
+    denseParams.vol = params.vol;
+    denseParams.dist = params.dist;
+    auto denseVolume = meshToDistanceVolume( torus, denseParams );
+    ASSERT_TRUE( denseVolume.has_value() );
+    EXPECT_LT( brickVolume->heapBytes(), denseVolume->heapBytes() );
+
+    // the voxels in the narrow band have exact values, and all others have correct sign
+    const VolumeIndexer indexer( denseVolume->dims );
+    for ( size_t i = 0; i < indexer.size(); ++i )
+    {
+        const auto denseValue = denseVolume->data[i];
+        const auto brickValue = brickVolume->data.get( indexer.toPos( VoxelId( i ) ) );
+        if ( std::abs( denseValue ) <= params.narrowBand )
+            EXPECT_EQ( brickValue, denseValue );
+        else
+            EXPECT_EQ( brickValue < 0, denseValue < 0 );
+    }
+
+    auto brickMesh = marchingCubes( *brickVolume, { .origin = params.vol.origin, .lessInside = true } );
+    auto denseMesh = marchingCubes( *denseVolume, { .origin = params.vol.origin, .lessInside = true } );
+    ASSERT_TRUE( brickMesh.has_value() );
+    ASSERT_TRUE( denseMesh.has_value() );
+    EXPECT_EQ( brickMesh->topology.numValidFaces(), denseMesh->topology.numValidFaces() );
+    EXPECT_EQ( brickMesh->topology.numValidVerts(), denseMesh->topology.numValidVerts() );
+}
+
+} //namespace MR
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "MRVoxelsFwd.h"
+#include "MRVoxelsVolume.h"
+#include "MRDistanceVolumeParams.h"
+#include "MRMesh/MRDistanceToMeshOptions.h"
+#include "MRMesh/MRExpected.h"
+#include "MRMesh/MRHeapBytes.h"
+#include <vector>
+
+namespace MR
+{
+
+/// voxel values stored in cubic bricks of brickSize^3 voxels:
+/// only the bricks near the surface (dense bricks) keep the values of all their voxels,
+/// and every other brick keeps just one value for all its voxels
+struct BrickVolumeData
+{
+    static constexpr int brickLog = 3;
+    static constexpr int brickSize = 1 << brickLog;
+    static constexpr int brickMask = brickSize - 1;
+    static constexpr int brickVoxels = brickSize * brickSize * brickSize;
+
+    /// the number of bricks along each axis
+    Vector3i brickDims;
+
+    /// for each brick: the index of its values in (denseValues) divided on brickVoxels, or -1 if the brick is not dense
+    std::vector<int> denseIndex;
+
+    /// for each brick, which is not dense: the value of all its voxels
+    std::vector<float> constValue;
+
+    /// the values of all dense bricks one after another, the voxels are ordered by x, then by y, then by z inside each brick
+    std::vector<float> denseValues;
+
+    /// returns the linear index of the brick containing given voxel
+    [[nodiscard]] size_t brickId( const Vector3i & pos ) const
+    {
+        return size_t( pos.x >> brickLog ) + size_t( brickDims.x ) * ( size_t( pos.y >> brickLog ) + size_t( brickDims.y ) * size_t( pos.z >> brickLog ) );
+    }
+
+    /// returns the index of given voxel inside its brick
+    [[nodiscard]] static int inBrickId( const Vector3i & pos )
+    {
+        return ( pos.x & brickMask ) + ( ( pos.y & brickMask ) << brickLog ) + ( ( pos.z & brickMask ) << ( 2 * brickLog ) );
+    }
+
+    /// returns the value of given voxel
+    [[nodiscard]] float get( const Vector3i & pos ) const
+    {
+        const auto b = brickId( pos );
+        const auto d = denseIndex[b];
+        return d < 0 ? constValue[b] : denseValues[size_t( d ) * brickVoxels + inBrickId( pos )];
+    }
+
+    /// returns the number of dense bricks
+    [[nodiscard]] size_t numDenseBricks() const { return denseValues.size() / brickVoxels; }
+
+    [[nodiscard]] size_t heapBytes() const { return MR::heapBytes( denseIndex ) + MR::heapBytes( constValue ) + MR::heapBytes( denseValues ); }
+};
+
+template <>
+struct VoxelTraits<BrickVolumeData>
+{
+    using ValueType = float;
+};
+
+struct MeshToBrickVolumeParams
+{
+    DistanceVolumeParams vol;
+
+    /// the voxels not farther than this distance from the mesh get exact distance values,
+    /// the bricks completely out of this band keep one value: plus or minus narrowBand depending on the side of the mesh;
+    /// the value is increased to be not less than the diagonal of one voxel
+    float narrowBand = 0;
+
+    /// the options to compute distances in the voxels of dense bricks;
+    /// the sign of not-dense bricks is determined by the winding number of the mesh (or they are positive for SignDetectionMode::Unsigned)
+    SignedDistanceToMeshOptions dist;
+};
+
+/// makes narrow-band volume filled with (signed or unsigned) distances from Mesh with given settings,
+/// where the memory is allocated only for the bricks near the mesh surface, so fine voxel size can be used for large meshes;
+/// the result can be directly given to marchingCubes
+MRVOXELS_API Expected<BrickVolume> meshToBrickDistanceVolume( const MeshPart& mp, const MeshToBrickVolumeParams& params = {} );
+
+/// converts brick volume into simple volume
+MRVOXELS_API Expected<SimpleVolumeMinMax> brickVolumeToSimpleVolume( const BrickVolume& volume, const ProgressCallback& cb = {} );
+
+} //namespace MR
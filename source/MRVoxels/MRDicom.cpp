@@ -13,6 +13,13 @@
 #include "MRMesh/MRStringConvert.h"
 #include "MRMesh/MRTimer.h"
 #include "MRPch/MRSpdlog.h"
+#include "MRPch/MRTBB.h"
+
+#if __has_include( <tbb/parallel_pipeline.h> )
+#include <tbb/parallel_pipeline.h>
+#else
+#include <tbb/pipeline.h>
+#endif
 
 #pragma warning(push)
 #pragma warning(disable: 4515)
@@ -25,6 +32,9 @@
 #include <gdcmTagKeywords.h>
 #pragma warning(pop)
 
+#include <cstring>
+#include <thread>
+
 
 namespace MR
 {
@@ -92,11 +102,26 @@ struct DCMFileLoadResult
     AffineXf3f xf;
 };
 
+/// the result of reading one DICOM file together with its pixels decoded by GDCM but not yet converted in float values
+struct DecodedDicomFile : DCMFileLoadResult
+{
+    std::vector<char> pixels;
+    /// the dimensions of the image in the file
+    Vector3i dims;
+    ScalarType scalarType = ScalarType::Unknown;
+    unsigned pixelSize = 0;
+    float slope = 1;
+    float intercept = 0;
+    bool needInvertZ = false;
+};
+
+/// reads DICOM file and decodes its pixels;
+/// the dimensions and the voxel size of the volume are taken from the file if they are not set in (data) yet
 template <typename T>
-DCMFileLoadResult loadSingleFile( const std::filesystem::path& path, T& data, size_t offset )
+DecodedDicomFile decodeSingleFile( const std::filesystem::path& path, T& data )
 {
     MR_TIMER;
-    DCMFileLoadResult res;
+    DecodedDicomFile res;
 
     std::ifstream fstr( path, std::ifstream::binary );
     gdcm::ImageReader ir;
@@ -229,19 +254,58 @@ DCMFileLoadResult loadSingleFile( const std::filesystem::path& path, T& data, si
         if ( rescaleType != "HU" && rescaleType != "HU_MOD" )
             spdlog::warn( "DICOM is in unknown units: {}", rescaleType );
     }
-    auto scalarType = convertToScalarType( gimage.GetPixelFormat() );
-    auto caster = [k = static_cast<float>( gimage.GetSlope() ),
-                   b = static_cast<float>( gimage.GetIntercept() ),
-                   scalarType] ( const char* c ) {
-        return visitScalarType( [k, b] ( auto val ) -> float { return k * static_cast<float>( val ) + b; }, scalarType, c );
-    };
-
-    std::vector<char> cacheBuffer( gimage.GetBufferLength() );
-    if ( !gimage.GetBuffer( cacheBuffer.data() ) )
+    res.scalarType = convertToScalarType( gimage.GetPixelFormat() );
+    res.pixelSize = pixelSize;
+    res.slope = static_cast<float>( gimage.GetSlope() );
+    res.intercept = static_cast<float>( gimage.GetIntercept() );
+    res.needInvertZ = needInvertZ;
+    res.dims = Vector3i( int( dims[0] ), int( dims[1] ), dimsNum == 3 ? int( dims[2] ) : 1 );
+
+    res.pixels.resize( gimage.GetBufferLength() );
+    if ( !gimage.GetBuffer( res.pixels.data() ) )
     {
         spdlog::error( "loadSingle: cannot load data from file: {}", utf8string( path ) );
         return res;
     }
+    res.success = true;
+
+    return res;
+}
+
+/// converts given number of decoded pixels of the file in float values applying rescale slope and intercept,
+/// the type of pixels is dispatched only once for all of them;
+/// returns the range of converted values
+MinMaxf rescalePixels( const DecodedDicomFile& file, const char* src, float* dst, size_t count )
+{
+    if ( count == 0 )
+        return {};
+    if ( file.scalarType == ScalarType::Unknown )
+    {
+        std::fill( dst, dst + count, 0.0f );
+        return MinMaxf( 0.0f, 0.0f );
+    }
+    return visitScalarType( [&] ( auto firstValue )
+    {
+        using V = decltype( firstValue );
+        MinMaxf range;
+        for ( size_t i = 0; i < count; ++i )
+        {
+            V val;
+            std::memcpy( &val, src + i * file.pixelSize, sizeof( V ) );
+            const auto f = file.slope * static_cast<float>( val ) + file.intercept;
+            range.include( f );
+            dst[i] = f;
+        }
+        return range;
+    }, file.scalarType, src );
+}
+
+/// converts the pixels of decoded file in float values and puts them directly in the volume starting from given linear offset
+template <typename T>
+DCMFileLoadResult putDecodedFile( const DecodedDicomFile& file, T& data, size_t offset )
+{
+    DCMFileLoadResult res = file;
+    res.success = false;
 
     constexpr bool isSimpleVolumeInput = std::convertible_to<T, SimpleVolume>;
     if constexpr ( isSimpleVolumeInput )
@@ -251,39 +315,42 @@ DCMFileLoadResult loadSingleFile( const std::filesystem::path& path, T& data, si
             data.data.resize( fulSize );
     }
 
-    auto dimZ = dimsNum == 3 ? dims[2] : 1;
-    auto dimXY = dims[0] * dims[1];
-    auto dimXYZinv = dimZ * dimXY - dimXY;
-    for ( unsigned z = 0; z < dimZ; ++z )
+    const auto dimXY = size_t( file.dims.x ) * file.dims.y;
+    auto layerPixels = [&] ( int z )
     {
-        auto zOffset = z * dimXY;
-        auto correctZOffset = needInvertZ ? ( dimXYZinv - zOffset ) : zOffset;
+        const auto correctZ = file.needInvertZ ? file.dims.z - 1 - z : z;
+        return file.pixels.data() + correctZ * dimXY * file.pixelSize;
+    };
+    auto includeRange = [&] ( const MinMaxf& range )
+    {
+        if ( !range.valid() )
+            return;
+        res.min = std::min( res.min, range.min );
+        res.max = std::max( res.max, range.max );
+    };
 
-        float* sliceData;
-        [[maybe_unused]] SimpleVolume sliceVolume;
-        if constexpr ( isSimpleVolumeInput )
-        {
-            sliceData = data.data.data() + zOffset + offset;
-        }
-        else
+    if constexpr ( isSimpleVolumeInput )
+    {
+        // the layers of multi-frame file are converted in parallel directly in their places in the volume
+        std::vector<MinMaxf> layerRanges( file.dims.z );
+        ParallelFor( 0, file.dims.z, [&] ( int z )
         {
-            size_t buffSize = size_t( data.dims.x )*data.dims.y;
-            sliceVolume.dims = { (int)dims[0], (int)dims[1], 1 };
-            sliceVolume.data.resize( buffSize );
-            sliceVolume.voxelSize = data.voxelSize;
-            sliceData = sliceVolume.data.data();
-        }
-
-        for ( size_t i = 0; i < dimXY; ++i )
+            layerRanges[z] = rescalePixels( file, layerPixels( z ), data.data.data() + offset + z * dimXY, dimXY );
+        } );
+        for ( const auto& range : layerRanges )
+            includeRange( range );
+    }
+    else
+    {
+        // one slice buffer is reused for all layers of the file
+        SimpleVolume sliceVolume;
+        sliceVolume.dims = { file.dims.x, file.dims.y, 1 };
+        sliceVolume.data.resize( dimXY );
+        sliceVolume.voxelSize = data.voxelSize;
+        for ( int z = 0; z < file.dims.z; ++z )
         {
-            auto f = caster( &cacheBuffer[( correctZOffset + i ) * pixelSize] );
-            res.min = std::min( res.min, f );
-            res.max = std::max( res.max, f );
-            sliceData[i] = f;
-        }
+            includeRange( rescalePixels( file, layerPixels( z ), sliceVolume.data.data(), dimXY ) );
 
-        if constexpr ( !isSimpleVolumeInput )
-        {
             bool put = false;
             if constexpr ( std::convertible_to<decltype( data ), VdbVolume> )
             {
@@ -294,7 +361,7 @@ DCMFileLoadResult loadSingleFile( const std::filesystem::path& path, T& data, si
                 }
             }
             if ( !put )
-                putSimpleVolumeInDenseGrid( data.data, Vector3i{ 0, 0, int( (zOffset + offset) / dimXY ) }, sliceVolume );
+                putSimpleVolumeInDenseGrid( data.data, Vector3i{ 0, 0, int( offset / dimXY ) + z }, sliceVolume );
         }
     }
     res.success = true;
@@ -302,6 +369,15 @@ DCMFileLoadResult loadSingleFile( const std::filesystem::path& path, T& data, si
     return res;
 }
 
+template <typename T>
+DCMFileLoadResult loadSingleFile( const std::filesystem::path& path, T& data, size_t offset )
+{
+    const auto file = decodeSingleFile( path, data );
+    if ( !file.success )
+        return file;
+    return putDecodedFile( file, data, offset );
+}
+
 template <typename T>
 Expected<DicomVolumeT<T>> loadDicomFile( const std::filesystem::path& file, const ProgressCallback& cb )
 {
@@ -334,6 +410,66 @@ struct LoadSlicesResult
     std::vector<DCMFileLoadResult> slicesRes;
 };
 
+#if __has_include( <tbb/parallel_pipeline.h> )
+constexpr auto cSerialInOrderFilter = tbb::filter_mode::serial_in_order;
+constexpr auto cParallelFilter = tbb::filter_mode::parallel;
+#else
+constexpr auto cSerialInOrderFilter = tbb::filter::serial_in_order;
+constexpr auto cParallelFilter = tbb::filter::parallel;
+#endif
+
+/// loads all files except the first one in a pipeline of overlapping stages running in the arena of (maxNumThreads) threads:
+/// the files are taken in order, then they are read and decoded by GDCM in parallel,
+/// and the decoded pixels are converted in float values and put directly in the preallocated volume also in parallel;
+/// the number of files in flight is limited by twice the number of threads, which bounds the memory for decoded pixels
+/// \param getVolume returns the volume for current thread to take the dimensions from and to put the values in
+template <typename GetVolume>
+LoadSlicesResult loadSlicesPipelined( const std::vector<std::filesystem::path>& files, size_t dimXY, unsigned maxNumThreads,
+    const BitSet& presentSlices, const ProgressCallback& cb, GetVolume&& getVolume )
+{
+    MR_TIMER
+    std::vector<DCMFileLoadResult> slicesRes( files.size() - 1 );
+    std::vector<DecodedDicomFile> decodedFiles( slicesRes.size() );
+    std::atomic<int> numLoadedSlices = 0;
+    std::atomic<bool> keepGoing{ true };
+    int nextSlice = 0;
+
+    tbb::task_arena limitedArena( maxNumThreads );
+    limitedArena.execute( [&]
+    {
+        const auto callingThreadId = std::this_thread::get_id();
+        tbb::parallel_pipeline( 2 * size_t( tbb::this_task_arena::max_concurrency() ),
+            tbb::make_filter<void, int>( cSerialInOrderFilter, [&] ( tbb::flow_control& fc )
+            {
+                if ( nextSlice >= int( slicesRes.size() ) || !keepGoing.load( std::memory_order_relaxed ) )
+                {
+                    fc.stop();
+                    return 0;
+                }
+                return nextSlice++;
+            } ) &
+            tbb::make_filter<int, int>( cParallelFilter, [&] ( int i )
+            {
+                decodedFiles[i] = decodeSingleFile( files[i + 1], getVolume() );
+                return i;
+            } ) &
+            tbb::make_filter<int, void>( cParallelFilter, [&] ( int i )
+            {
+                auto& file = decodedFiles[i];
+                if ( file.success )
+                    slicesRes[i] = putDecodedFile( file, getVolume(), presentSlices.nthSetBit( i + 1 ) * dimXY );
+                else
+                    slicesRes[i] = file;
+                file = {}; // release the memory of decoded pixels
+                const int numLoaded = ++numLoadedSlices;
+                if ( std::this_thread::get_id() == callingThreadId && !reportProgress( cb, float( numLoaded ) / float( slicesRes.size() ) ) )
+                    keepGoing.store( false, std::memory_order_relaxed );
+            } ) );
+    } );
+
+    return { numLoadedSlices, !keepGoing.load( std::memory_order_relaxed ), std::move( slicesRes ) };
+}
+
 template <typename T>
 LoadSlicesResult loadSlices( const std::vector<std::filesystem::path>& files, T& data, unsigned maxNumThreads, const BitSet& presentSlices, const ProgressCallback& cb = {} );
 
@@ -341,10 +477,6 @@ template <>
 LoadSlicesResult loadSlices<VdbVolume>( const std::vector<std::filesystem::path>& files, VdbVolume& data,
                                         unsigned maxNumThreads, const BitSet& presentSlices, const ProgressCallback& cb )
 {
-    bool cancelCalled = false;
-    std::vector<DCMFileLoadResult> slicesRes( files.size() - 1 );
-    tbb::task_arena limitedArena( maxNumThreads );
-    std::atomic<int> numLoadedSlices = 0;
     const auto dimXY = size_t( data.dims.x ) * size_t( data.dims.y );
 
     // do not call `touchLeaf` for all voxels, because it does not activate touched voxels as `denseFill` do
@@ -352,45 +484,25 @@ LoadSlicesResult loadSlices<VdbVolume>( const std::vector<std::filesystem::path>
     // note that first layer is already loaded
     data.data->denseFill( toVdbBox( Box3i( Vector3i( 0, 0, 1 ), data.dims - Vector3i::diagonal( 1 ) ) ), data.min, true );
 
-    limitedArena.execute( [&]
-    {
-        tbb::enumerable_thread_specific<VolumeMinMaxAccessor> tls( VolumeMinMaxAccessor{
-            { .data = data.data->getAccessor(), .dims = data.dims, .voxelSize = data.voxelSize },
-            { data.min, data.max }
-        } );
-
-        cancelCalled = !ParallelFor( 0, int( slicesRes.size() ), tls, [&] ( int i, auto& vol )
-        {
-            slicesRes[i] = loadSingleFile( files[i + 1], vol, ( presentSlices.nthSetBit( i + 1 ) ) * dimXY );
-            ++numLoadedSlices;
-        }, subprogress( cb, 0.4f, 0.9f ), 1 );
+    tbb::enumerable_thread_specific<VolumeMinMaxAccessor> tls( VolumeMinMaxAccessor{
+        { .data = data.data->getAccessor(), .dims = data.dims, .voxelSize = data.voxelSize },
+        { data.min, data.max }
     } );
+    auto res = loadSlicesPipelined( files, dimXY, maxNumThreads, presentSlices, subprogress( cb, 0.4f, 0.9f ),
+        [&] () -> VolumeMinMaxAccessor& { return tls.local(); } );
 
     openvdb::tools::changeBackground( data.data->tree(), data.min );
 
-    return { numLoadedSlices, cancelCalled, slicesRes };
+    return res;
 }
 
 template <>
 LoadSlicesResult loadSlices<SimpleVolumeMinMax>( const std::vector<std::filesystem::path>& files, SimpleVolumeMinMax& data,
                                                  unsigned maxNumThreads, const BitSet& presentSlices, const ProgressCallback& cb )
 {
-    bool cancelCalled = false;
-    std::vector<DCMFileLoadResult> slicesRes( files.size() - 1 );
-    tbb::task_arena limitedArena( maxNumThreads );
-    std::atomic<int> numLoadedSlices = 0;
     const auto dimXY = size_t( data.dims.x ) * size_t( data.dims.y );
-
-    limitedArena.execute( [&]
-    {
-        cancelCalled = !ParallelFor( 0, int( slicesRes.size() ), [&] ( int i )
-        {
-            slicesRes[i] = loadSingleFile( files[i + 1], data, ( presentSlices.nthSetBit( i + 1 ) ) * dimXY );
-            ++numLoadedSlices;
-        }, subprogress( cb, 0.4f, 0.9f ), 1 );
-    } );
-
-    return { numLoadedSlices, cancelCalled, slicesRes };
+    return loadSlicesPipelined( files, dimXY, maxNumThreads, presentSlices, subprogress( cb, 0.4f, 0.9f ),
+        [&] () -> SimpleVolumeMinMax& { return data; } );
 }
 
 
@@ -661,25 +773,27 @@ Expected<SeriesMap,std::string> extractDCMSeries( const std::filesystem::path& p
     if ( !std::filesystem::is_directory( path, ec ) )
         return unexpected( "extractDCMSeries: path is not directory" );
 
-    int filesNum = 0;
     std::vector<std::filesystem::path> files;
     for ( auto entry : Directory{ path, ec } )
     {
         if ( entry.is_regular_file( ec ) )
-            ++filesNum;
+            files.push_back( entry.path() );
     }
 
+    // reading the tags of every file takes most of the time here, so all files are checked in parallel
+    std::vector<std::string> uids( files.size() );
+    std::vector<char> dicomFiles( files.size(), false );
+    if ( !ParallelFor( files, [&] ( size_t i )
+    {
+        dicomFiles[i] = isDicomFile( files[i], &uids[i] );
+    }, cb, 1 ) )
+        return unexpectedOperationCanceled();
+
     std::unordered_map<std::string, std::vector<std::filesystem::path>> seriesMap;
-    int fCounter = 0;
-    for ( auto entry : Directory{ path, ec } )
+    for ( size_t i = 0; i < files.size(); ++i )
     {
-        ++fCounter;
-        auto filePath = entry.path();
-        std::string uid;
-        if ( entry.is_regular_file( ec ) && isDicomFile( filePath, &uid ) )
-            seriesMap[uid].push_back( filePath );
-        if ( !reportProgress( cb, float( fCounter ) / float( filesNum ) ) )
-            return unexpectedOperationCanceled();
+        if ( dicomFiles[i] )
+            seriesMap[uids[i]].push_back( std::move( files[i] ) );
     }
 
     if ( seriesMap.empty() )
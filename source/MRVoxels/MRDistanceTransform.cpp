@@ -0,0 +1,262 @@
+#include "MRDistanceTransform.h"
+#include "MRMarchingCubes.h"
+#include "MRMesh/MRBitSet.h"
+#include "MRMesh/MRBitSetParallelFor.h"
+#include "MRMesh/MRMesh.h"
+#include "MRMesh/MRParallelFor.h"
+#include "MRMesh/MRVolumeIndexer.h"
+#include "MRMesh/MRTimer.h"
+#include "MRMesh/MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <cmath>
+#include <limits>
+
+namespace MR
+{
+
+namespace
+{
+
+constexpr float cInfDistSq = std::numeric_limits<float>::infinity();
+
+/// temporary buffers for the transform of one scanline
+struct ScanlineBuffers
+{
+    /// the values of the scanline before the transform
+    std::vector<float> f;
+    /// the indices of the parabolas forming the lower envelope
+    std::vector<int> v;
+    /// the boundaries between the parabolas of the lower envelope
+    std::vector<double> z;
+};
+
+/// replaces each value f(q) of the scanline of (n) values with given (stride) on the minimum of (x_q - x_p)^2 + f(p) over all p,
+/// where x_p = p * spacing, by computing the lower envelope of the parabolas in linear time
+void transformScanline( float* data, int n, size_t stride, float spacing, ScanlineBuffers& buf )
+{
+    auto& f = buf.f;
+    auto& v = buf.v;
+    auto& z = buf.z;
+    f.resize( n );
+    v.resize( n );
+    z.resize( n + 1 );
+    for ( int q = 0; q < n; ++q )
+        f[q] = data[q * stride];
+
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    int k = -1; // the index of the last parabola in the lower envelope
+    for ( int q = 0; q < n; ++q )
+    {
+        if ( f[q] == cInfDistSq )
+            continue;
+        const double xq = double( q ) * spacing;
+        double s = -inf;
+        // remove the parabolas which are completely above the new one
+        while ( k >= 0 )
+        {
+            const double xv = double( v[k] ) * spacing;
+            s = ( ( f[q] + xq * xq ) - ( f[v[k]] + xv * xv ) ) / ( 2 * ( xq - xv ) );
+            if ( s > z[k] )
+                break;
+            --k;
+        }
+        ++k;
+        v[k] = q;
+        z[k] = k == 0 ? -inf : s;
+        z[k + 1] = inf;
+    }
+    if ( k < 0 )
+        return; // all values in the scanline are infinite
+
+    k = 0;
+    for ( int q = 0; q < n; ++q )
+    {
+        const double xq = double( q ) * spacing;
+        while ( z[k + 1] < xq )
+            ++k;
+        const double d = xq - double( v[k] ) * spacing;
+        data[q * stride] = float( d * d + f[v[k]] );
+    }
+}
+
+/// given zeros in the voxels of the mask and infinities elsewhere, computes the squared distances to the mask by transforming all scanlines along each axis in turn
+bool transformSquaredDistances( std::vector<float>& data, const Vector3i& dims, const Vector3f& voxelSize, const ProgressCallback& cb )
+{
+    MR_TIMER
+    const size_t dimXY = size_t( dims.x ) * dims.y;
+    tbb::enumerable_thread_specific<ScanlineBuffers> buffers;
+
+    if ( !ParallelFor( size_t( 0 ), size_t( dims.y ) * dims.z, buffers, [&] ( size_t line, ScanlineBuffers& buf )
+    {
+        transformScanline( data.data() + line * dims.x, dims.x, 1, voxelSize.x, buf );
+    }, subprogress( cb, 0.0f, 0.33f ) ) )
+        return false;
+
+    // neighboring lines along y have neighboring starting voxels for better cache usage
+    if ( !ParallelFor( size_t( 0 ), size_t( dims.x ) * dims.z, buffers, [&] ( size_t line, ScanlineBuffers& buf )
+    {
+        const auto x = line % dims.x;
+        const auto z = line / dims.x;
+        transformScanline( data.data() + z * dimXY + x, dims.y, dims.x, voxelSize.y, buf );
+    }, subprogress( cb, 0.33f, 0.67f ) ) )
+        return false;
+
+    return ParallelFor( size_t( 0 ), dimXY, buffers, [&] ( size_t line, ScanlineBuffers& buf )
+    {
+        transformScanline( data.data() + line, dims.z, dimXY, voxelSize.z, buf );
+    }, subprogress( cb, 0.67f, 1.0f ) );
+}
+
+/// computes squared distances to the voxels of the mask (or to the voxels not in the mask if complement = true)
+Expected<std::vector<float>> squaredDistancesToMask( const VoxelBitSet& mask, bool complement,
+    const Vector3i& dims, const Vector3f& voxelSize, const ProgressCallback& cb )
+{
+    const VolumeIndexer indexer( dims );
+    std::vector<float> res( indexer.size() );
+    ParallelFor( res, [&] ( size_t i )
+    {
+        res[i] = mask.test( VoxelId( i ) ) != complement ? 0.0f : cInfDistSq;
+    } );
+    if ( !transformSquaredDistances( res, dims, voxelSize, cb ) )
+        return unexpectedOperationCanceled();
+    return res;
+}
+
+} //anonymous namespace
+
+Expected<SimpleVolumeMinMax> distanceTransform( const VoxelBitSet& mask, const Vector3i& dims, const Vector3f& voxelSize,
+                                                const ProgressCallback& cb )
+{
+    MR_TIMER
+    auto distSq = squaredDistancesToMask( mask, false, dims, voxelSize, subprogress( cb, 0.0f, 0.9f ) );
+    if ( !distSq )
+        return unexpected( std::move( distSq.error() ) );
+
+    SimpleVolumeMinMax res;
+    res.dims = dims;
+    res.voxelSize = voxelSize;
+    res.data = std::move( *distSq );
+    if ( !ParallelFor( res.data, [&] ( size_t i )
+    {
+        res.data[i] = std::sqrt( res.data[i] );
+    }, subprogress( cb, 0.9f, 1.0f ) ) )
+        return unexpectedOperationCanceled();
+
+    std::tie( res.min, res.max ) = parallelMinMax( res.data );
+    return res;
+}
+
+Expected<SimpleVolumeMinMax> signedDistanceTransform( const VoxelBitSet& mask, const Vector3i& dims, const Vector3f& voxelSize,
+                                                      const ProgressCallback& cb )
+{
+    MR_TIMER
+    const VolumeIndexer indexer( dims );
+    const auto numInside = mask.count();
+    if ( numInside == 0 )
+        return unexpected( "Empty mask" );
+    if ( numInside >= indexer.size() )
+        return unexpected( "The mask covers whole volume" );
+
+    auto outsideDistSq = squaredDistancesToMask( mask, false, dims, voxelSize, subprogress( cb, 0.0f, 0.45f ) );
+    if ( !outsideDistSq )
+        return unexpected( std::move( outsideDistSq.error() ) );
+    auto insideDistSq = squaredDistancesToMask( mask, true, dims, voxelSize, subprogress( cb, 0.45f, 0.9f ) );
+    if ( !insideDistSq )
+        return unexpected( std::move( insideDistSq.error() ) );
+
+    SimpleVolumeMinMax res;
+    res.dims = dims;
+    res.voxelSize = voxelSize;
+    res.data = std::move( *outsideDistSq );
+    // in each voxel at least one of the distances is zero
+    if ( !ParallelFor( res.data, [&] ( size_t i )
+    {
+        res.data[i] = std::sqrt( res.data[i] ) - std::sqrt( ( *insideDistSq )[i] );
+    }, subprogress( cb, 0.9f, 1.0f ) ) )
+        return unexpectedOperationCanceled();
+
+    std::tie( res.min, res.max ) = parallelMinMax( res.data );
+    return res;
+}
+
+Expected<SimpleVolumeMinMax> signedDistanceTransform( const SimpleVolume& volume, float isoValue, bool lessInside,
+                                                      const ProgressCallback& cb )
+{
+    MR_TIMER
+    VoxelBitSet mask( volume.data.size() );
+    BitSetParallelForAll( mask, [&] ( VoxelId v )
+    {
+        if ( lessInside ? volume.data[v] < isoValue : volume.data[v] > isoValue )
+            mask.set( v );
+    } );
+    return signedDistanceTransform( mask, volume.dims, volume.voxelSize, cb );
+}
+
+Expected<void> offsetVoxelsMask( VoxelBitSet& mask, const Vector3i& dims, const Vector3f& voxelSize, float distance,
+                                 const ProgressCallback& cb )
+{
+    MR_TIMER
+    if ( distance == 0 )
+        return {};
+
+    // expansion adds the voxels near the mask, and shrinking removes the voxels near its complement
+    const bool expand = distance > 0;
+    auto distSq = squaredDistancesToMask( mask, !expand, dims, voxelSize, cb );
+    if ( !distSq )
+        return unexpected( std::move( distSq.error() ) );
+
+    const float maxDistSq = sqr( distance );
+    mask.resize( distSq->size() );
+    BitSetParallelForAll( mask, [&] ( VoxelId v )
+    {
+        mask.set( v, ( ( *distSq )[v] <= maxDistSq ) == expand );
+    } );
+    return {};
+}
+
+TEST( MRVoxels, DistanceTransform )
+{
+    const Vector3i dims( 13, 10, 9 );
+    const Vector3f voxelSize( 0.5f, 1.0f, 1.5f );
+    const VolumeIndexer indexer( dims );
+    VoxelBitSet mask( indexer.size() );
+    for ( const auto & pos : { Vector3i( 0, 0, 0 ), Vector3i( 12, 9, 8 ), Vector3i( 6, 3, 4 ), Vector3i( 2, 8, 7 ) } )
+        mask.set( indexer.toVoxelId( pos ) );
+
+    auto dist = distanceTransform( mask, dims, voxelSize );
+    ASSERT_TRUE( dist.has_value() );
+    EXPECT_EQ( dist->min, 0.0f );
+    for ( size_t i = 0; i < indexer.size(); ++i )
+    {
+        const auto pos = indexer.toPos( VoxelId( i ) );
+        float bruteForce = FLT_MAX;
+        for ( auto m : mask )
+            bruteForce = std::min( bruteForce, mult( voxelSize, Vector3f( indexer.toPos( m ) - pos ) ).length() );
+        EXPECT_NEAR( dist->data[i], bruteForce, 1e-5f );
+    }
+
+    // ball mask gives closed surface
+    VoxelBitSet ball( indexer.size() );
+    for ( size_t i = 0; i < indexer.size(); ++i )
+        if ( ( mult( voxelSize, Vector3f( indexer.toPos( VoxelId( i ) ) - Vector3i( 6, 5, 4 ) ) ) ).length() < 3.5f )
+            ball.set( VoxelId( i ) );
+    auto signedDist = signedDistanceTransform( ball, dims, voxelSize );
+    ASSERT_TRUE( signedDist.has_value() );
+    EXPECT_LT( signedDist->min, 0.0f );
+    EXPECT_GT( signedDist->max, 0.0f );
+    auto mesh = marchingCubes( *signedDist, { .iso = 0.0f, .lessInside = true } );
+    ASSERT_TRUE( mesh.has_value() );
+    EXPECT_GT( mesh->topology.numValidFaces(), 0 );
+    EXPECT_TRUE( mesh->topology.findHoleRepresentiveEdges().empty() );
+
+    // expansion and shrinking of single voxel on one voxel size
+    VoxelBitSet single( indexer.size() );
+    single.set( indexer.toVoxelId( { 6, 5, 4 } ) );
+    ASSERT_TRUE( offsetVoxelsMask( single, dims, Vector3f::diagonal( 1 ), 1.0f ).has_value() );
+    EXPECT_EQ( single.count(), 7 );
+    ASSERT_TRUE( offsetVoxelsMask( single, dims, Vector3f::diagonal( 1 ), -1.0f ).has_value() );
+    EXPECT_EQ( single.count(), 1 );
+    EXPECT_TRUE( single.test( indexer.toVoxelId( { 6, 5, 4 } ) ) );
+}
+
+} //namespace MR
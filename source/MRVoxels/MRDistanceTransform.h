@@ -0,0 +1,35 @@
+#pragma once
+
+#include "MRVoxelsFwd.h"
+#include "MRVoxelsVolume.h"
+#include "MRMesh/MRExpected.h"
+#include "MRMesh/MRProgressCallback.h"
+
+namespace MR
+{
+
+/// computes exact Euclidean distance transform of the voxel mask by separable algorithm of Felzenszwalb and Huttenlocher:
+/// the value in each voxel is the distance from its center to the center of the nearest voxel from the mask (zero in mask voxels),
+/// the voxels can have different sizes along the axes; each of three passes along the axes is parallelized by scanlines;
+/// if the mask is empty then all values are infinite
+MRVOXELS_API Expected<SimpleVolumeMinMax> distanceTransform( const VoxelBitSet& mask, const Vector3i& dims, const Vector3f& voxelSize,
+                                                             const ProgressCallback& cb = {} );
+
+/// computes exact signed distance transform of the voxel mask: positive distances to the mask outside of it,
+/// and negative distances to the complement of the mask inside, so zero level is exactly in between mask and not-mask voxels;
+/// the result can be given directly to marchingCubes with isoValue = 0 and lessInside = true to get the surface of the mask;
+/// both the mask and its complement must be not empty
+MRVOXELS_API Expected<SimpleVolumeMinMax> signedDistanceTransform( const VoxelBitSet& mask, const Vector3i& dims, const Vector3f& voxelSize,
+                                                                   const ProgressCallback& cb = {} );
+
+/// computes exact signed distance transform of the region of the volume with values below (lessInside = true) or above given isoValue,
+/// see signedDistanceTransform for the mask
+MRVOXELS_API Expected<SimpleVolumeMinMax> signedDistanceTransform( const SimpleVolume& volume, float isoValue, bool lessInside,
+                                                                   const ProgressCallback& cb = {} );
+
+/// expands (distance > 0) or shrinks (distance < 0) the voxel mask on given Euclidean distance using exact distance transform,
+/// which takes the same time for any distance unlike expandVoxelsMask/shrinkVoxelsMask doing one voxel step at a time
+MRVOXELS_API Expected<void> offsetVoxelsMask( VoxelBitSet& mask, const Vector3i& dims, const Vector3f& voxelSize, float distance,
+                                              const ProgressCallback& cb = {} );
+
+} //namespace MR
@@ -0,0 +1,77 @@
+#include "MRMappedBuffer.h"
+#include "MRVoxelsLoad.h"
+#include "MRMarchingCubes.h"
+#include "MRVoxelFilter.h"
+#include "MRMesh/MRUniqueTemporaryFolder.h"
+#include "MRMesh/MRVolumeIndexer.h"
+#include "MRMesh/MRTriMesh.h"
+#include "MRMesh/MRGTest.h"
+#include <fstream>
+
+namespace MR
+{
+
+TEST( MRVoxels, MappedVolume )
+{
+    // uint16 volume with a sphere
+    SimpleVolume volume;
+    volume.dims = Vector3i( 31, 27, 19 );
+    volume.voxelSize = Vector3f( 0.1f, 0.2f, 0.3f );
+    const VolumeIndexer indexer( volume.dims );
+    volume.data.resize( indexer.size() );
+    std::vector<uint16_t> values( indexer.size() );
+    const auto center = 0.5f * Vector3f( volume.dims );
+    for ( size_t i = 0; i < indexer.size(); ++i )
+    {
+        const auto pos = indexer.toPos( VoxelId( i ) );
+        values[i] = uint16_t( std::clamp( 1000.0f + 100.0f * ( ( Vector3f( pos ) - center ).length() - 8.5f ), 0.0f, 65535.0f ) );
+        volume.data[i] = values[i];
+    }
+
+    // write the values after a header of odd size to test unaligned access
+    UniqueTemporaryFolder folder( {} );
+    const auto path = folder / "volume.raw";
+    const size_t headerSize = 3;
+    {
+        std::ofstream out( path, std::ios::binary );
+        out.write( "hdr", headerSize );
+        out.write( ( const char* )values.data(), values.size() * sizeof( uint16_t ) );
+    }
+
+    VoxelsLoad::RawParameters params;
+    params.dimensions = volume.dims;
+    params.voxelSize = volume.voxelSize;
+    params.scalarType = ScalarType::UInt16;
+    EXPECT_FALSE( VoxelsLoad::mapRaw<float>( path, params, headerSize ).has_value() ); // wrong type
+    EXPECT_FALSE( VoxelsLoad::mapRaw<uint16_t>( path, params, headerSize + 1 ).has_value() ); // file is too short
+    auto mapped = VoxelsLoad::mapRaw<uint16_t>( path, params, headerSize );
+    ASSERT_TRUE( mapped.has_value() );
+    EXPECT_EQ( mapped->heapBytes(), 0 );
+    ASSERT_EQ( mapped->data.size(), values.size() );
+    for ( size_t i = 0; i < values.size(); ++i )
+        EXPECT_EQ( mapped->data[i], values[i] );
+
+    const MarchingCubesParams mcParams{ .iso = 1000.5f, .lessInside = true };
+    auto mappedMesh = marchingCubesAsTriMesh( *mapped, mcParams );
+    auto simpleMesh = marchingCubesAsTriMesh( volume, mcParams );
+    ASSERT_TRUE( mappedMesh.has_value() );
+    ASSERT_TRUE( simpleMesh.has_value() );
+    EXPECT_GT( mappedMesh->tris.size(), 0 );
+    EXPECT_EQ( mappedMesh->tris, simpleMesh->tris );
+    EXPECT_EQ( mappedMesh->points, simpleMesh->points );
+
+    // filtering of mapped volume gives the same result as of the volume in memory
+    for ( auto type : { VoxelFilterType::Mean, VoxelFilterType::Median } )
+    {
+        for ( int width : { 3, 7 } )
+        {
+            auto mappedFiltered = voxelFilter( *mapped, type, width );
+            auto simpleFiltered = voxelFilter( volume, type, width );
+            ASSERT_TRUE( mappedFiltered.has_value() );
+            ASSERT_TRUE( simpleFiltered.has_value() );
+            EXPECT_TRUE( mappedFiltered->data == simpleFiltered->data );
+        }
+    }
+}
+
+} //namespace MR
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "MRVoxelsFwd.h"
+#include "MRMesh/MRMappedFileRegion.h"
+#include <cassert>
+#include <cstring>
+#include <memory>
+
+namespace MR
+{
+
+/// read-only array of the values of type T stored in a memory mapped file;
+/// all copies of the buffer share the same mapping, which is released together with the last copy
+template <typename T>
+class MappedBuffer
+{
+public:
+    MappedBuffer() = default;
+
+    /// makes the buffer of all values in given mapped region
+    explicit MappedBuffer( std::shared_ptr<const MappedFileRegion> region )
+        : region_( std::move( region ) )
+        , size_( region_ ? region_->size() / sizeof( T ) : 0 )
+    {}
+
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    /// returns i-th value, the values in the file are not necessarily aligned in memory
+    [[nodiscard]] T operator[]( size_t i ) const
+    {
+        assert( i < size_ );
+        T res;
+        std::memcpy( &res, region_->data() + i * sizeof( T ), sizeof( T ) );
+        return res;
+    }
+
+    /// the mapped region of the file
+    [[nodiscard]] const std::shared_ptr<const MappedFileRegion>& region() const { return region_; }
+
+private:
+    std::shared_ptr<const MappedFileRegion> region_;
+    size_t size_ = 0;
+};
+
+} //namespace MR
@@ -326,6 +326,26 @@ TriangulationPlan{}
 
 const std::array<OutEdge, size_t( NeighborDir::Count )> cPlusOutEdges { OutEdge::PlusX, OutEdge::PlusY, OutEdge::PlusZ };
 
+/// volumes with all values in one contiguous array, which can be processed by x-rows
+template<typename V>
+constexpr bool cContiguousVolume = std::is_same_v<V, SimpleVolume> || std::is_same_v<V, SimpleVolumeMinMax>;
+
+/// the classes of voxels relative to iso-value
+constexpr std::uint8_t cLowerVoxel = 0;
+constexpr std::uint8_t cNotLowerVoxel = 1;
+constexpr std::uint8_t cInvalidVoxel = 2;
+
+/// classifies all voxels in a row without branches
+void classifyRow( const float * row, int size, float iso, std::uint8_t * classes )
+{
+    for ( int x = 0; x < size; ++x )
+    {
+        const float v = row[x];
+        // both not-lower and not-same-or-higher can be true only if value is not-a-number (NaN)
+        classes[x] = v < iso ? cLowerVoxel : ( v >= iso ? cNotLowerVoxel : cInvalidVoxel );
+    }
+}
+
 class VolumeMesher
 {
 public:
@@ -488,8 +508,9 @@ Expected<void> VolumeMesher::addPart_( const V& part, Positioner&& positioner )
         const bool report = currentSubprogress && std::this_thread::get_id() == callingThreadId;
 
         const VoxelsVolumeAccessor<V> acc( part );
-        /// grid point of this part with integer coordinates (0,0,0) will be shifted to this position in 3D space
-        const Vector3f zeroPoint = params_.origin + mult( acc.shift() + Vector3f( 0, 0, (float)partFirstZ ), part.voxelSize );
+        /// grid point of whole volume with integer coordinates (0,0,0) will be shifted to this position in 3D space;
+        /// z-coordinate of the part is added later to get exactly the same positions independently on the splitting in parts
+        const Vector3f zeroPoint = params_.origin + mult( acc.shift(), part.voxelSize );
 
         std::optional<VoxelsVolumeCachingAccessor<V>> cache;
         if ( cachingMode == MarchingCubesParams::CachingMode::Normal )
@@ -497,10 +518,15 @@ Expected<void> VolumeMesher::addPart_( const V& part, Positioner&& positioner )
             using Parameters = typename VoxelsVolumeCachingAccessor<V>::Parameters;
             cache.emplace( acc, partIndexer, Parameters {
                 .preloadedLayerCount = 2,
+                .prefetchedLayerCount = 1,
             } );
             cache->preloadLayer( layerBegin - partFirstZ );
         }
 
+        std::vector<std::uint8_t> rowClasses;
+        if constexpr ( cContiguousVolume<V> )
+            rowClasses.resize( 3 * size_t( part.dims.x ) );
+
         VoxelLocation loc = partIndexer.toLoc( Vector3i( 0, 0, layerBegin - partFirstZ ) );
         for ( ; loc.pos.z + partFirstZ < layerEnd; ++loc.pos.z )
         {
@@ -512,56 +538,132 @@ Expected<void> VolumeMesher::addPart_( const V& part, Positioner&& positioner )
             BitSet layerInvalids( layerSize );
             BitSet layerLowerIso( layerSize );
             size_t inLayerPos = 0;
-            for ( loc.pos.y = 0; loc.pos.y < part.dims.y; ++loc.pos.y )
+            if constexpr ( cContiguousVolume<V> )
             {
-                for ( loc.pos.x = 0; loc.pos.x < part.dims.x; ++loc.pos.x, ++loc.id, ++inLayerPos )
+                // classify whole x-rows first in simple loops, which the compiler can vectorize,
+                // and skip the rows where all voxels and their +Y and +Z neighbours are on the same side of iso-surface
+                const int dimX = part.dims.x;
+                const float * layerData = part.data.data() + loc.id;
+                const bool hasNextZ = loc.pos.z + 1 < part.dims.z;
+                for ( loc.pos.y = 0; loc.pos.y < part.dims.y; ++loc.pos.y, loc.id += dimX, inLayerPos += dimX )
                 {
-                    assert( partIndexer.toVoxelId( loc.pos ) == loc.id );
                     if ( params_.cb && !keepGoing.load( std::memory_order_relaxed ) )
                         return;
+                    const float * row = layerData + inLayerPos;
+                    const bool hasNextY = loc.pos.y + 1 < part.dims.y;
+                    classifyRow( row, dimX, params_.iso, rowClasses.data() );
+                    if ( hasNextY )
+                        classifyRow( row + dimX, dimX, params_.iso, rowClasses.data() + dimX );
+                    if ( hasNextZ )
+                        classifyRow( row + layerSize, dimX, params_.iso, rowClasses.data() + 2 * dimX );
+                    const auto * cls = rowClasses.data();
+                    const auto * clsY = hasNextY ? cls + dimX : cls;
+                    const auto * clsZ = hasNextZ ? cls + 2 * dimX : cls;
+
+                    std::uint8_t diff = 0;
+                    const auto cls0 = cls[0];
+                    for ( int x = 0; x < dimX; ++x )
+                        diff |= ( cls[x] ^ cls0 ) | ( clsY[x] ^ cls0 ) | ( clsZ[x] ^ cls0 );
+                    if ( diff == 0 && cls0 != cInvalidVoxel )
+                    {
+                        if ( cls0 == cLowerVoxel )
+                            layerLowerIso.set( inLayerPos, dimX, true );
+                        continue;
+                    }
 
-                    SeparationPointSet set;
-                    bool atLeastOneOk = false;
-                    const float value = cache ? cache->get( loc ) : acc.get( loc );
-                    const bool lower = value < params_.iso;
-                    const bool notLower = value >= params_.iso;
-                    if ( !lower && !notLower ) // both not-lower and not-same-or-higher can be true only if value is not-a-number (NaN)
-                        layerInvalids.set( inLayerPos );
-                    else
+                    for ( int x = 0; x < dimX; ++x )
                     {
-                        const auto coords = zeroPoint + mult( part.voxelSize, Vector3f( loc.pos ) );
-                        layerLowerIso.set( inLayerPos, lower );
+                        const auto c = cls[x];
+                        if ( c == cInvalidVoxel )
+                        {
+                            layerInvalids.set( inLayerPos + x );
+                            continue;
+                        }
+                        if ( c == cLowerVoxel )
+                            layerLowerIso.set( inLayerPos + x );
 
+                        // the classes of +X, +Y, +Z neighbours, and the offsets to them in the data
+                        const std::uint8_t nextCls[3] =
+                        {
+                            x + 1 < dimX ? cls[x + 1] : cInvalidVoxel,
+                            hasNextY ? clsY[x] : cInvalidVoxel,
+                            hasNextZ ? clsZ[x] : cInvalidVoxel
+                        };
+                        const size_t nextOffset[3] = { 1, size_t( dimX ), layerSize };
+
+                        SeparationPointSet set;
+                        bool atLeastOneOk = false;
+                        const Vector3f coords = zeroPoint + mult( part.voxelSize, Vector3f( float( x ), float( loc.pos.y ), float( loc.pos.z + partFirstZ ) ) );
                         for ( int n = int( NeighborDir::X ); n < int( NeighborDir::Count ); ++n )
                         {
-                            auto nextLoc = partIndexer.getNeighbor( loc, cPlusOutEdges[n] );
-                            if ( !nextLoc )
+                            // both voxels are valid and on different sides of iso-surface
+                            if ( nextCls[n] != ( c ^ 1 ) )
                                 continue;
-                            const float nextValue = cache ? cache->get( nextLoc ) : acc.get( nextLoc );
-                            if ( lower )
-                            {
-                                if ( !( nextValue >= params_.iso ) )
-                                    continue; // nextValue is lower than params_.iso (same as value) or nextValue is NaN
-                            }
-                            else
-                            {
-                                if ( !( nextValue < params_.iso ) )
-                                    continue; // nextValue is same or higher than params_.iso (same as value) or nextValue is NaN
-                            }
-
                             auto nextCoords = coords;
                             nextCoords[n] += part.voxelSize[n];
-                            Vector3f pos = positioner( coords, nextCoords, value, nextValue, params_.iso );
+                            Vector3f pos = positioner( coords, nextCoords, row[x], row[x + nextOffset[n]], params_.iso );
                             set[n] = block.nextVid();
                             block.coords.push_back( pos );
                             atLeastOneOk = true;
                         }
+                        if ( atLeastOneOk )
+                            block.smap.insert( { loc.id + x + partFirstId, set } );
                     }
+                }
+            }
+            else
+            {
+                for ( loc.pos.y = 0; loc.pos.y < part.dims.y; ++loc.pos.y )
+                {
+                    for ( loc.pos.x = 0; loc.pos.x < part.dims.x; ++loc.pos.x, ++loc.id, ++inLayerPos )
+                    {
+                        assert( partIndexer.toVoxelId( loc.pos ) == loc.id );
+                        if ( params_.cb && !keepGoing.load( std::memory_order_relaxed ) )
+                            return;
+
+                        SeparationPointSet set;
+                        bool atLeastOneOk = false;
+                        const float value = cache ? cache->get( loc ) : acc.get( loc );
+                        const bool lower = value < params_.iso;
+                        const bool notLower = value >= params_.iso;
+                        if ( !lower && !notLower ) // both not-lower and not-same-or-higher can be true only if value is not-a-number (NaN)
+                            layerInvalids.set( inLayerPos );
+                        else
+                        {
+                            const auto coords = zeroPoint + mult( part.voxelSize, Vector3f( float( loc.pos.x ), float( loc.pos.y ), float( loc.pos.z + partFirstZ ) ) );
+                            layerLowerIso.set( inLayerPos, lower );
 
-                    if ( !atLeastOneOk )
-                        continue;
+                            for ( int n = int( NeighborDir::X ); n < int( NeighborDir::Count ); ++n )
+                            {
+                                auto nextLoc = partIndexer.getNeighbor( loc, cPlusOutEdges[n] );
+                                if ( !nextLoc )
+                                    continue;
+                                const float nextValue = cache ? cache->get( nextLoc ) : acc.get( nextLoc );
+                                if ( lower )
+                                {
+                                    if ( !( nextValue >= params_.iso ) )
+                                        continue; // nextValue is lower than params_.iso (same as value) or nextValue is NaN
+                                }
+                                else
+                                {
+                                    if ( !( nextValue < params_.iso ) )
+                                        continue; // nextValue is same or higher than params_.iso (same as value) or nextValue is NaN
+                                }
+
+                                auto nextCoords = coords;
+                                nextCoords[n] += part.voxelSize[n];
+                                Vector3f pos = positioner( coords, nextCoords, value, nextValue, params_.iso );
+                                set[n] = block.nextVid();
+                                block.coords.push_back( pos );
+                                atLeastOneOk = true;
+                            }
+                        }
+
+                        if ( !atLeastOneOk )
+                            continue;
 
-                    block.smap.insert( { loc.id + partFirstId, set } );
+                        block.smap.insert( { loc.id + partFirstId, set } );
+                    }
                 }
             }
             if ( layerInvalids.any() )
@@ -902,6 +1004,72 @@ Expected<Mesh> marchingCubes( const VdbVolume& volume, const MarchingCubesParams
     } );
 }
 
+Expected<TriMesh> marchingCubesAsTriMesh( const BrickVolume& volume, const MarchingCubesParams& params )
+{
+    if ( params.iso <= volume.min || params.iso >= volume.max )
+        return TriMesh{};
+    return VolumeMesher::run( volume, params );
+}
+
+Expected<Mesh> marchingCubes( const BrickVolume& volume, const MarchingCubesParams& params )
+{
+    MR_TIMER
+    auto p = params;
+    p.cb = subprogress( params.cb, 0.0f, 0.9f );
+    return marchingCubesAsTriMesh( volume, p ).and_then( [&params]( TriMesh && tm ) -> Expected<Mesh>
+    {
+        return Mesh::fromTriMesh( std::move( tm ), {}, subprogress( params.cb, 0.9f, 1.0f ) );
+    } );
+}
+
+Expected<TriMesh> marchingCubesAsTriMesh( const MappedVolume& volume, const MarchingCubesParams& params )
+{
+    return VolumeMesher::run( volume, params );
+}
+
+Expected<Mesh> marchingCubes( const MappedVolume& volume, const MarchingCubesParams& params )
+{
+    MR_TIMER
+    auto p = params;
+    p.cb = subprogress( params.cb, 0.0f, 0.9f );
+    return marchingCubesAsTriMesh( volume, p ).and_then( [&params]( TriMesh && tm ) -> Expected<Mesh>
+    {
+        return Mesh::fromTriMesh( std::move( tm ), {}, subprogress( params.cb, 0.9f, 1.0f ) );
+    } );
+}
+
+Expected<TriMesh> marchingCubesAsTriMesh( const MappedVolumeU16& volume, const MarchingCubesParams& params )
+{
+    return VolumeMesher::run( volume, params );
+}
+
+Expected<Mesh> marchingCubes( const MappedVolumeU16& volume, const MarchingCubesParams& params )
+{
+    MR_TIMER
+    auto p = params;
+    p.cb = subprogress( params.cb, 0.0f, 0.9f );
+    return marchingCubesAsTriMesh( volume, p ).and_then( [&params]( TriMesh && tm ) -> Expected<Mesh>
+    {
+        return Mesh::fromTriMesh( std::move( tm ), {}, subprogress( params.cb, 0.9f, 1.0f ) );
+    } );
+}
+
+Expected<TriMesh> marchingCubesAsTriMesh( const MappedVolumeU8& volume, const MarchingCubesParams& params )
+{
+    return VolumeMesher::run( volume, params );
+}
+
+Expected<Mesh> marchingCubes( const MappedVolumeU8& volume, const MarchingCubesParams& params )
+{
+    MR_TIMER
+    auto p = params;
+    p.cb = subprogress( params.cb, 0.0f, 0.9f );
+    return marchingCubesAsTriMesh( volume, p ).and_then( [&params]( TriMesh && tm ) -> Expected<Mesh>
+    {
+        return Mesh::fromTriMesh( std::move( tm ), {}, subprogress( params.cb, 0.9f, 1.0f ) );
+    } );
+}
+
 Expected<TriMesh> marchingCubesAsTriMesh( const FunctionVolume& volume, const MarchingCubesParams& params )
 {
     if ( !volume.data )
@@ -964,4 +1132,32 @@ TEST( MRMesh, NaN )
     EXPECT_FALSE( gTestNaN < gTestZero || gTestNaN >= gTestZero );
 }
 
+TEST( MRVoxels, MarchingCubesRows )
+{
+    // the volume with a sphere and some invalid voxels
+    SimpleVolume volume;
+    volume.dims = Vector3i( 37, 29, 23 );
+    const VolumeIndexer indexer( volume.dims );
+    volume.data.resize( indexer.size() );
+    const auto center = 0.5f * Vector3f( volume.dims );
+    for ( size_t i = 0; i < indexer.size(); ++i )
+    {
+        const auto pos = indexer.toPos( VoxelId( i ) );
+        volume.data[i] = ( i % 97 == 0 ) ? cQuietNan : ( Vector3f( pos ) - center ).length() - 9.5f;
+    }
+
+    // the same volume given by function is processed voxel by voxel
+    FunctionVolume funcVolume;
+    funcVolume.dims = volume.dims;
+    funcVolume.data = [&]( const Vector3i & pos ) { return volume.data[indexer.toVoxelId( pos )]; };
+
+    auto rowsMesh = marchingCubesAsTriMesh( volume, { .lessInside = true } );
+    auto voxelsMesh = marchingCubesAsTriMesh( funcVolume, { .lessInside = true } );
+    ASSERT_TRUE( rowsMesh.has_value() );
+    ASSERT_TRUE( voxelsMesh.has_value() );
+    EXPECT_GT( rowsMesh->tris.size(), 0 );
+    EXPECT_EQ( rowsMesh->tris, voxelsMesh->tris );
+    EXPECT_EQ( rowsMesh->points, voxelsMesh->points );
+}
+
 } //namespace MR
@@ -3,6 +3,8 @@
 #include "MRVoxelsFwd.h"
 #include "MRMesh/MRAffineXf3.h"
 #include "MRVoxelsVolume.h"
+#include "MRBrickVolume.h"
+#include "MRMappedBuffer.h"
 #include "MRMesh/MRProgressCallback.h"
 #include "MRMesh/MRSignDetectionMode.h"
 #include "MRMesh/MRExpected.h"
@@ -69,6 +71,22 @@ MRVOXELS_API Expected<TriMesh> marchingCubesAsTriMesh( const SimpleVolumeMinMax&
 MRVOXELS_API Expected<Mesh> marchingCubes( const VdbVolume& volume, const MarchingCubesParams& params = {} );
 MRVOXELS_API Expected<TriMesh> marchingCubesAsTriMesh( const VdbVolume& volume, const MarchingCubesParams& params = {} );
 
+// makes Mesh from BrickVolume with given settings using Marching Cubes algorithm
+MRVOXELS_API Expected<Mesh> marchingCubes( const BrickVolume& volume, const MarchingCubesParams& params = {} );
+MRVOXELS_API Expected<TriMesh> marchingCubesAsTriMesh( const BrickVolume& volume, const MarchingCubesParams& params = {} );
+
+// makes Mesh from MappedVolume with given settings using Marching Cubes algorithm
+MRVOXELS_API Expected<Mesh> marchingCubes( const MappedVolume& volume, const MarchingCubesParams& params = {} );
+MRVOXELS_API Expected<TriMesh> marchingCubesAsTriMesh( const MappedVolume& volume, const MarchingCubesParams& params = {} );
+
+// makes Mesh from MappedVolumeU16 with given settings using Marching Cubes algorithm
+MRVOXELS_API Expected<Mesh> marchingCubes( const MappedVolumeU16& volume, const MarchingCubesParams& params = {} );
+MRVOXELS_API Expected<TriMesh> marchingCubesAsTriMesh( const MappedVolumeU16& volume, const MarchingCubesParams& params = {} );
+
+// makes Mesh from MappedVolumeU8 with given settings using Marching Cubes algorithm
+MRVOXELS_API Expected<Mesh> marchingCubes( const MappedVolumeU8& volume, const MarchingCubesParams& params = {} );
+MRVOXELS_API Expected<TriMesh> marchingCubesAsTriMesh( const MappedVolumeU8& volume, const MarchingCubesParams& params = {} );
+
 // makes Mesh from FunctionVolume with given settings using Marching Cubes algorithm
 MRVOXELS_API Expected<Mesh> marchingCubes( const FunctionVolume& volume, const MarchingCubesParams& params = {} );
 MRVOXELS_API Expected<TriMesh> marchingCubesAsTriMesh( const FunctionVolume& volume, const MarchingCubesParams& params = {} );
@@ -5,6 +5,7 @@
 #include "MRMarchingCubes.h"
 #include "MRMeshToDistanceVolume.h"
 #include "MRMesh/MRMesh.h"
+#include "MRMesh/MRTriMesh.h"
 #include "MRMesh/MRBox.h"
 #include "MRMesh/MRTimer.h"
 #include "MRMesh/MRPolyline.h"
@@ -17,10 +18,73 @@
 #include "MRMesh/MRMeshFixer.h"
 #include "MRMesh/MRBitSetParallelFor.h"
 #include "MRMesh/MRRingIterator.h"
+#include "MRMesh/MRParallelFor.h"
+#include "MRMesh/MRTorus.h"
+#include "MRMesh/MRGTest.h"
 
 namespace MR
 {
 
+namespace
+{
+
+/// computes the distances from the mesh by z-slabs, and passes every slab in MarchingCubesByParts right after its computation,
+/// so only one slab of voxels of fixed thickness is stored in memory at any moment independently on the volume size, and every voxel is computed only once;
+/// the result is identical to marchingCubes( meshToDistanceFunctionVolume( mp, msParams ), vmParams )
+Expected<Mesh> mcOffsetMeshBySlabs( const MeshPart& mp, const MeshToDistanceVolumeParams& msParams, const MarchingCubesParams& vmParams )
+{
+    MR_TIMER
+    const auto func = meshToDistanceFunctionVolume( mp, msParams );
+    const auto dims = func.dims;
+    if ( dims.x <= 0 || dims.y <= 0 || dims.z <= 1 )
+        return marchingCubes( func, vmParams );
+
+    auto mcParams = vmParams;
+    mcParams.cb = {};
+    // thin blocks of constant thickness, and constant number of them in a slab processed in parallel,
+    // so the memory for the slab does not depend on dims.z;
+    // each slab also includes the layer shared with the next slab
+    constexpr int cLayersPerBlock = 4;
+    constexpr int cBlocksPerSlab = 16;
+    MarchingCubesByParts mesher( dims, mcParams, cLayersPerBlock );
+    const int slabLayers = cBlocksPerSlab * cLayersPerBlock + 1;
+
+    SimpleVolume slab;
+    slab.voxelSize = func.voxelSize;
+    const auto layerSize = size_t( dims.x ) * dims.y;
+    const auto sp = subprogress( vmParams.cb, 0.0f, 0.9f );
+    while ( mesher.nextZ() + 1 < dims.z )
+    {
+        const int firstZ = mesher.nextZ();
+        const int numLayers = std::min( slabLayers, dims.z - firstZ );
+        // the first layer was already computed as the last layer of previous slab
+        const int firstNewLayer = firstZ > 0 ? 1 : 0;
+        if ( firstNewLayer > 0 )
+            std::copy( slab.data.end() - layerSize, slab.data.end(), slab.data.begin() );
+        slab.dims = Vector3i( dims.x, dims.y, numLayers );
+        slab.data.resize( layerSize * numLayers );
+
+        if ( !ParallelFor( size_t( firstNewLayer ) * layerSize, slab.data.size(), [&] ( size_t i )
+        {
+            const auto xy = i % layerSize;
+            const Vector3i pos( int( xy % dims.x ), int( xy / dims.x ), firstZ + int( i / layerSize ) );
+            slab.data[i] = func.data( pos );
+        }, subprogress( sp, float( firstZ ) / dims.z, float( firstZ + numLayers - 1 ) / dims.z ) ) )
+            return unexpectedOperationCanceled();
+
+        if ( auto res = mesher.addPart( slab ); !res )
+            return unexpected( std::move( res.error() ) );
+    }
+    slab = {};
+
+    return mesher.finalize().and_then( [&vmParams]( TriMesh && tm ) -> Expected<Mesh>
+    {
+        return Mesh::fromTriMesh( std::move( tm ), {}, subprogress( vmParams.cb, 0.9f, 1.0f ) );
+    } );
+}
+
+} //anonymous namespace
+
 float suggestVoxelSize( const MeshPart & mp, float approxNumVoxels )
 {
     MR_TIMER
@@ -176,7 +240,7 @@ Expected<Mesh> mcOffsetMesh( const MeshPart& mp, float offset,
 
         if ( funcVolume )
         {
-            return marchingCubes( meshToDistanceFunctionVolume( mp, msParams ), vmParams );
+            return mcOffsetMeshBySlabs( mp, msParams, vmParams );
         }
         else
         {
@@ -367,4 +431,29 @@ Expected<Mesh> offsetPolyline( const Polyline3& polyline, float offset, const Of
     return offsetMesh( mesh, offset, p );
 }
 
+TEST( MRVoxels, McOffsetMeshBySlabs )
+{
+    const auto torus = makeTorus( 1.0f, 0.3f, 48, 24 );
+    for ( auto signMode : { SignDetectionMode::Unsigned, SignDetectionMode::ProjectionNormal } )
+    {
+        OffsetParameters params;
+        params.voxelSize = 0.03f;
+        params.signDetectionMode = signMode;
+        params.memoryEfficient = false;
+        Vector<VoxelId, FaceId> denseMap;
+        auto denseMesh = mcOffsetMesh( torus, 0.1f, params, &denseMap );
+        ASSERT_TRUE( denseMesh.has_value() );
+
+        params.memoryEfficient = true;
+        Vector<VoxelId, FaceId> slabsMap;
+        auto slabsMesh = mcOffsetMesh( torus, 0.1f, params, &slabsMap );
+        ASSERT_TRUE( slabsMesh.has_value() );
+
+        EXPECT_TRUE( denseMesh->points == slabsMesh->points );
+        EXPECT_TRUE( denseMesh->topology == slabsMesh->topology );
+        EXPECT_TRUE( denseMap == slabsMap );
+        EXPECT_GT( slabsMesh->topology.numValidFaces(), 0 );
+    }
+}
+
 }
@@ -46,9 +46,9 @@ struct OffsetParameters : BaseShellParameters
     /// providing this will disable memoryEfficient (as if memoryEfficient == false)
     std::shared_ptr<IFastWindingNumber> fwn;
 
-    /// use FunctionVolume for voxel grid representation:
-    ///  - memory consumption for voxel storage is approx. (dims.z / (2 * thread_count)) lesser
-    ///  - computations are about 15% slower (because some z-layers are computed twice)
+    /// compute the distances by z-slabs and convert each slab in mesh right after its computation instead of storing the whole voxel grid:
+    ///  - only one slab of 65 z-layers is stored in memory, so memory consumption for voxel storage is approx. (dims.z / 65) times lesser
+    ///  - the result is identical to the one with full memory storage
     /// this setting is ignored (as if memoryEfficient == false) if
     ///  a) signDetectionMode = SignDetectionMode::OpenVDB, or
     ///  b) \ref fwn is provided (CUDA computations require full memory storage)
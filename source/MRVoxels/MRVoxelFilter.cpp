@@ -2,6 +2,16 @@
 
 #include <MRVoxels/MRVoxelsVolume.h>
 #include <MRVoxels/MRVDBFloatGrid.h>
+#include <MRVoxels/MRMappedBuffer.h>
+#include <MRMesh/MRParallelFor.h>
+#include <MRMesh/MRVolumeIndexer.h>
+#include <MRMesh/MRTimer.h>
+#include <MRMesh/MRGTest.h>
+#include <MRPch/MRTBB.h>
+
+#include <array>
+#include <cfloat>
+#include <random>
 
 #pragma warning(push)
 #pragma warning(disable: 4464) //relative include path contains '..' in <tbb/parallel_for.h>
@@ -11,6 +21,275 @@
 namespace MR
 {
 
+namespace
+{
+
+/// weights of symmetric kernel of radius r of the mean filter: kernel[r + k] is the weight of the voxel at offset k
+std::vector<float> meanKernel( int r )
+{
+    return std::vector<float>( 2 * r + 1, 1.0f );
+}
+
+/// weights of Gaussian kernel with the same variance as four successive mean filters of radius r
+std::vector<float> gaussianKernel( int r )
+{
+    if ( r <= 0 )
+        return { 1.0f }; // zero variance, identity filter
+    const float sigmaSq = 4.0f * r * ( r + 1 ) / 3.0f;
+    const int radius = (int)std::ceil( 3 * std::sqrt( sigmaSq ) );
+    std::vector<float> res( 2 * radius + 1 );
+    for ( int k = -radius; k <= radius; ++k )
+        res[radius + k] = std::exp( -0.5f * k * k / sigmaSq );
+    return res;
+}
+
+/// for each of n positions along an axis, returns the inverse sum of kernel weights inside the volume
+std::vector<float> invWeightSums( const std::vector<float>& kernel, int n )
+{
+    const int r = int( kernel.size() / 2 );
+    std::vector<float> res( n );
+    for ( int i = 0; i < n; ++i )
+    {
+        float sum = 0;
+        for ( int k = std::max( -r, -i ); k <= std::min( r, n - 1 - i ); ++k )
+            sum += kernel[r + k];
+        res[i] = 1 / sum;
+    }
+    return res;
+}
+
+/// convolves the row of n consecutive values with the kernel
+void convolveRow( const float* src, float* dst, int n, const std::vector<float>& kernel, const std::vector<float>& invWeightSum )
+{
+    const int r = int( kernel.size() / 2 );
+    std::fill( dst, dst + n, 0.0f );
+    for ( int k = std::max( -r, 1 - n ); k <= std::min( r, n - 1 ); ++k )
+    {
+        const float w = kernel[r + k];
+        const int xBeg = std::max( 0, -k ), xEnd = std::min( n, n - k );
+        for ( int x = xBeg; x < xEnd; ++x )
+            dst[x] += w * src[x + k];
+    }
+    for ( int x = 0; x < n; ++x )
+        dst[x] *= invWeightSum[x];
+}
+
+/// computes in (dst) the line #i of the convolution along the axis with n lines located with given stride starting from (src),
+/// each line has (len) consecutive values
+void convolveLines( const float* src, float* dst, size_t len, size_t stride, int i, int n, const std::vector<float>& kernel, float invWeightSum )
+{
+    const int r = int( kernel.size() / 2 );
+    std::fill( dst, dst + len, 0.0f );
+    for ( int k = std::max( -r, -i ); k <= std::min( r, n - 1 - i ); ++k )
+    {
+        const float w = kernel[r + k] * invWeightSum;
+        const float* line = src + size_t( i + k ) * stride;
+        for ( size_t j = 0; j < len; ++j )
+            dst[j] += w * line[j];
+    }
+}
+
+/// returns the pointer on (n) consecutive values of the volume starting from (first) as floats,
+/// the values of not-float volumes are converted in (buf)
+template <typename V>
+const float* getValues( const V& volume, size_t first, int n, std::vector<float>& buf )
+{
+    if constexpr ( std::is_same_v<V, SimpleVolume> )
+        return volume.data.data() + first;
+    else
+    {
+        buf.resize( n );
+        for ( int i = 0; i < n; ++i )
+            buf[i] = float( volume.data[first + i] );
+        return buf.data();
+    }
+}
+
+/// returns the minimum and the maximum of all values in the volume
+template <typename V>
+std::pair<float, float> volumeMinMax( const V& volume )
+{
+    if constexpr ( std::is_same_v<V, SimpleVolume> )
+        return parallelMinMax( volume.data );
+    else
+    {
+        using T = typename V::ValueType;
+        return tbb::parallel_reduce( tbb::blocked_range<size_t>( 0, volume.data.size() ),
+            std::pair<float, float>{ FLT_MAX, -FLT_MAX },
+            [&] ( const tbb::blocked_range<size_t>& range, std::pair<float, float> curMinMax )
+        {
+            for ( size_t i = range.begin(); i < range.end(); ++i )
+            {
+                const T v = volume.data[i];
+                curMinMax.first = std::min( curMinMax.first, float( v ) );
+                curMinMax.second = std::max( curMinMax.second, float( v ) );
+            }
+            return curMinMax;
+        },
+            [] ( const std::pair<float, float>& a, const std::pair<float, float>& b )
+        {
+            return std::pair<float, float>{ std::min( a.first, b.first ), std::max( a.second, b.second ) };
+        } );
+    }
+}
+
+template <typename V>
+Expected<SimpleVolumeMinMax> filterSeparable( const V& volume, const std::vector<float>& kernel, const ProgressCallback& cb )
+{
+    MR_TIMER
+    const auto& dims = volume.dims;
+    const size_t dimXY = size_t( dims.x ) * dims.y;
+    const auto invX = invWeightSums( kernel, dims.x );
+    const auto invY = invWeightSums( kernel, dims.y );
+    const auto invZ = invWeightSums( kernel, dims.z );
+
+    SimpleVolumeMinMax res;
+    res.dims = dims;
+    res.voxelSize = volume.voxelSize;
+    res.data.resize( volume.data.size() );
+    std::vector<float> tmp( volume.data.size() );
+
+    // x- and y-passes are done for each slice independently: from volume to tmp, and then from tmp to res
+    if ( !ParallelFor( 0, dims.z, [&] ( int z )
+    {
+        std::vector<float> rowBuf;
+        float* xFiltered = tmp.data() + z * dimXY;
+        for ( int y = 0; y < dims.y; ++y )
+            convolveRow( getValues( volume, z * dimXY + y * dims.x, dims.x, rowBuf ), xFiltered + y * dims.x, dims.x, kernel, invX );
+        float* dst = res.data.data() + z * dimXY;
+        for ( int y = 0; y < dims.y; ++y )
+            convolveLines( xFiltered, dst + y * dims.x, dims.x, dims.x, y, dims.y, kernel, invY[y] );
+    }, subprogress( cb, 0.0f, 0.6f ) ) )
+        return unexpectedOperationCanceled();
+
+    // z-pass is done for each row of all slices independently: from res to tmp
+    if ( !ParallelFor( 0, dims.y, [&] ( int y )
+    {
+        for ( int z = 0; z < dims.z; ++z )
+            convolveLines( res.data.data() + y * dims.x, tmp.data() + z * dimXY + y * dims.x, dims.x, dimXY, z, dims.z, kernel, invZ[z] );
+    }, subprogress( cb, 0.6f, 1.0f ) ) )
+        return unexpectedOperationCanceled();
+
+    res.data.swap( tmp );
+    std::tie( res.min, res.max ) = parallelMinMax( res.data );
+    return res;
+}
+
+/// exact median filter for small radius, where the values of each window are partially sorted
+template <typename V>
+Expected<SimpleVolumeMinMax> filterMedianExact( const V& volume, int r, const ProgressCallback& cb )
+{
+    MR_TIMER
+    const VolumeIndexer indexer( volume.dims );
+    SimpleVolumeMinMax res;
+    res.dims = volume.dims;
+    res.voxelSize = volume.voxelSize;
+    res.data.resize( volume.data.size() );
+
+    tbb::enumerable_thread_specific<std::vector<float>> windows;
+    if ( !ParallelFor( size_t( 0 ), indexer.size(), windows, [&] ( size_t i, std::vector<float>& window )
+    {
+        const auto pos = indexer.toPos( VoxelId( i ) );
+        const auto beg = Vector3i( std::max( pos.x - r, 0 ), std::max( pos.y - r, 0 ), std::max( pos.z - r, 0 ) );
+        const auto end = Vector3i( std::min( pos.x + r + 1, volume.dims.x ), std::min( pos.y + r + 1, volume.dims.y ), std::min( pos.z + r + 1, volume.dims.z ) );
+        window.clear();
+        for ( int z = beg.z; z < end.z; ++z )
+            for ( int y = beg.y; y < end.y; ++y )
+                for ( auto id = indexer.toVoxelId( { beg.x, y, z } ), idEnd = id + ( end.x - beg.x ); id < idEnd; ++id )
+                    window.push_back( float( volume.data[id] ) );
+        const auto mid = window.begin() + window.size() / 2;
+        std::nth_element( window.begin(), mid, window.end() );
+        res.data[i] = *mid;
+    }, cb ) )
+        return unexpectedOperationCanceled();
+
+    std::tie( res.min, res.max ) = parallelMinMax( res.data );
+    return res;
+}
+
+/// two-level histogram of quantized values in the sliding window
+struct MedianHistogram
+{
+    std::vector<int> fine = std::vector<int>( 1 << 16 );
+    std::array<int, 1 << 8> coarse = {};
+    int count = 0;
+
+    void add( uint16_t q ) { ++fine[q]; ++coarse[q >> 8]; ++count; }
+    void remove( uint16_t q ) { --fine[q]; --coarse[q >> 8]; --count; }
+
+    /// returns the value with given zero-based rank in sorted order
+    uint16_t find( int rank ) const
+    {
+        int c = 0;
+        for ( ; rank >= coarse[c]; ++c )
+            rank -= coarse[c];
+        int f = c << 8;
+        for ( ; rank >= fine[f]; ++f )
+            rank -= fine[f];
+        return uint16_t( f );
+    }
+};
+
+/// median filter for large radius, where the histogram of the window is updated by sliding along x-axis
+template <typename V>
+Expected<SimpleVolumeMinMax> filterMedianHistogram( const V& volume, float min, float max, int r, const ProgressCallback& cb )
+{
+    MR_TIMER
+    const auto& dims = volume.dims;
+    const VolumeIndexer indexer( dims );
+    SimpleVolumeMinMax res;
+    res.dims = dims;
+    res.voxelSize = volume.voxelSize;
+    res.data.resize( volume.data.size() );
+
+    // integer scale keeps integer values exact if they fit in 65536 levels, otherwise all levels are used
+    const float range = max - min;
+    const float scale = range >= 1 && range <= 65535 ? std::floor( 65535 / range ) : range > 0 ? 65535 / range : 0.0f;
+    const float invScale = scale > 0 ? 1 / scale : 0.0f;
+    std::vector<uint16_t> quantized( volume.data.size() );
+    ParallelFor( quantized, [&] ( size_t i )
+    {
+        quantized[i] = uint16_t( std::clamp( std::round( ( float( volume.data[i] ) - min ) * scale ), 0.0f, 65535.0f ) );
+    } );
+
+    tbb::enumerable_thread_specific<MedianHistogram> histograms;
+    if ( !ParallelFor( size_t( 0 ), size_t( dims.y ) * dims.z, histograms, [&] ( size_t row, MedianHistogram& hist )
+    {
+        const int y = int( row % dims.y );
+        const int z = int( row / dims.y );
+        const int yBeg = std::max( y - r, 0 ), yEnd = std::min( y + r + 1, dims.y );
+        const int zBeg = std::max( z - r, 0 ), zEnd = std::min( z + r + 1, dims.z );
+        // adds or removes all voxels of the window with given x
+        auto updateColumn = [&] ( int x, auto op )
+        {
+            for ( int wz = zBeg; wz < zEnd; ++wz )
+                for ( int wy = yBeg; wy < yEnd; ++wy )
+                    ( hist.*op )( quantized[indexer.toVoxelId( { x, wy, wz } )] );
+        };
+
+        for ( int x = 0; x < std::min( r, dims.x ); ++x )
+            updateColumn( x, &MedianHistogram::add );
+        for ( int x = 0; x < dims.x; ++x )
+        {
+            if ( x + r < dims.x )
+                updateColumn( x + r, &MedianHistogram::add );
+            if ( x - r - 1 >= 0 )
+                updateColumn( x - r - 1, &MedianHistogram::remove );
+            res.data[indexer.toVoxelId( { x, y, z } )] = min + hist.find( hist.count / 2 ) * invScale;
+        }
+        // leave the histogram empty for the next row
+        for ( int x = std::max( dims.x - 1 - r, 0 ); x < dims.x; ++x )
+            updateColumn( x, &MedianHistogram::remove );
+        assert( hist.count == 0 );
+    }, cb, 1 ) )
+        return unexpectedOperationCanceled();
+
+    std::tie( res.min, res.max ) = parallelMinMax( res.data );
+    return res;
+}
+
+} //anonymous namespace
+
 
 VdbVolume voxelFilter( const VdbVolume& volume, VoxelFilterType type, int width )
 {
@@ -51,4 +330,138 @@ VdbVolume voxelFilter( const VdbVolume& volume, VoxelFilterType type, int width
     return res;
 }
 
-}
\ No newline at end of file
+namespace
+{
+
+template <typename V>
+Expected<SimpleVolumeMinMax> voxelFilterT( const V& volume, VoxelFilterType type, int width, const ProgressCallback& cb )
+{
+    MR_TIMER
+    if ( width < 1 || width % 2 == 0 )
+        return unexpected( "Filter width must be an odd number greater or equal to 1" );
+    const int r = ( width - 1 ) / 2;
+
+    switch ( type )
+    {
+        case VoxelFilterType::Median:
+            if ( r <= 2 )
+                return filterMedianExact( volume, r, cb );
+            else
+            {
+                const auto [min, max] = volumeMinMax( volume );
+                return filterMedianHistogram( volume, min, max, r, cb );
+            }
+        case VoxelFilterType::Mean:
+            return filterSeparable( volume, meanKernel( r ), cb );
+        case VoxelFilterType::Gaussian:
+            return filterSeparable( volume, gaussianKernel( r ), cb );
+        default:
+            assert( false );
+            return unexpected( "Unknown filter type" );
+    }
+}
+
+} //anonymous namespace
+
+Expected<SimpleVolumeMinMax> voxelFilter( const SimpleVolume& volume, VoxelFilterType type, int width, const ProgressCallback& cb )
+{
+    return voxelFilterT( volume, type, width, cb );
+}
+
+Expected<SimpleVolumeMinMax> voxelFilter( const MappedVolume& volume, VoxelFilterType type, int width, const ProgressCallback& cb )
+{
+    return voxelFilterT( volume, type, width, cb );
+}
+
+Expected<SimpleVolumeMinMax> voxelFilter( const MappedVolumeU16& volume, VoxelFilterType type, int width, const ProgressCallback& cb )
+{
+    return voxelFilterT( volume, type, width, cb );
+}
+
+Expected<SimpleVolumeMinMax> voxelFilter( const MappedVolumeU8& volume, VoxelFilterType type, int width, const ProgressCallback& cb )
+{
+    return voxelFilterT( volume, type, width, cb );
+}
+
+TEST( MRVoxels, VoxelFilterSimpleVolume )
+{
+    SimpleVolume volume;
+    volume.dims = Vector3i( 11, 10, 9 );
+    volume.voxelSize = Vector3f::diagonal( 1 );
+    const VolumeIndexer indexer( volume.dims );
+    volume.data.resize( indexer.size(), 5.0f );
+
+    // constant volume does not change
+    for ( auto type : { VoxelFilterType::Mean, VoxelFilterType::Gaussian, VoxelFilterType::Median } )
+    {
+        auto filtered = voxelFilter( volume, type, 5 );
+        ASSERT_TRUE( filtered.has_value() );
+        EXPECT_NEAR( filtered->min, 5.0f, 1e-5f );
+        EXPECT_NEAR( filtered->max, 5.0f, 1e-5f );
+    }
+
+    // mean of a single spike spreads it uniformly in the window
+    const auto center = indexer.toVoxelId( { 5, 5, 4 } );
+    volume.data[center] = 5.0f + 27;
+    auto mean = voxelFilter( volume, VoxelFilterType::Mean, 3 );
+    ASSERT_TRUE( mean.has_value() );
+    EXPECT_NEAR( mean->data[center], 6.0f, 1e-5f );
+    EXPECT_NEAR( mean->data[indexer.toVoxelId( { 6, 6, 5 } )], 6.0f, 1e-5f );
+    EXPECT_NEAR( mean->data[indexer.toVoxelId( { 7, 5, 4 } )], 5.0f, 1e-5f );
+
+    // both median algorithms remove the spike, and histogram one gives exact result for integer values
+    std::mt19937 gen( 0 );
+    std::uniform_int_distribution<int> dist( 0, 100 );
+    for ( auto& v : volume.data )
+        v = float( dist( gen ) );
+    for ( int width : { 3, 7 } )
+    {
+        auto median = voxelFilter( volume, VoxelFilterType::Median, width );
+        ASSERT_TRUE( median.has_value() );
+        const int r = width / 2;
+        for ( size_t i = 0; i < indexer.size(); ++i )
+        {
+            const auto pos = indexer.toPos( VoxelId( i ) );
+            std::vector<float> window;
+            for ( int z = std::max( pos.z - r, 0 ); z < std::min( pos.z + r + 1, volume.dims.z ); ++z )
+                for ( int y = std::max( pos.y - r, 0 ); y < std::min( pos.y + r + 1, volume.dims.y ); ++y )
+                    for ( int x = std::max( pos.x - r, 0 ); x < std::min( pos.x + r + 1, volume.dims.x ); ++x )
+                        window.push_back( volume.data[indexer.toVoxelId( { x, y, z } )] );
+            std::sort( window.begin(), window.end() );
+            EXPECT_EQ( median->data[i], window[window.size() / 2] );
+        }
+    }
+
+    // histogram median of values in large range is precise up to a quantization level
+    std::uniform_int_distribution<int> bigDist( 0, 5'000'000 );
+    for ( auto& v : volume.data )
+        v = float( bigDist( gen ) );
+    const auto [bigMin, bigMax] = parallelMinMax( volume.data );
+    const float level = ( bigMax - bigMin ) / 65535;
+    auto bigMedian = voxelFilter( volume, VoxelFilterType::Median, 7 );
+    ASSERT_TRUE( bigMedian.has_value() );
+    EXPECT_GT( bigMedian->max - bigMedian->min, 100 * level ); // not a constant volume
+    for ( size_t i = 0; i < indexer.size(); ++i )
+    {
+        const auto pos = indexer.toPos( VoxelId( i ) );
+        std::vector<float> window;
+        for ( int z = std::max( pos.z - 3, 0 ); z < std::min( pos.z + 4, volume.dims.z ); ++z )
+            for ( int y = std::max( pos.y - 3, 0 ); y < std::min( pos.y + 4, volume.dims.y ); ++y )
+                for ( int x = std::max( pos.x - 3, 0 ); x < std::min( pos.x + 4, volume.dims.x ); ++x )
+                    window.push_back( volume.data[indexer.toVoxelId( { x, y, z } )] );
+        std::sort( window.begin(), window.end() );
+        EXPECT_NEAR( bigMedian->data[i], window[window.size() / 2], level );
+    }
+
+    // the filters of width 1 do not change the volume
+    for ( auto type : { VoxelFilterType::Mean, VoxelFilterType::Gaussian, VoxelFilterType::Median } )
+    {
+        auto filtered = voxelFilter( volume, type, 1 );
+        ASSERT_TRUE( filtered.has_value() );
+        EXPECT_TRUE( filtered->data == volume.data );
+    }
+
+    EXPECT_FALSE( voxelFilter( volume, VoxelFilterType::Mean, 4 ).has_value() );
+}
+
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "MRVoxelsFwd.h"
+#include "MRMesh/MRExpected.h"
+#include "MRMesh/MRProgressCallback.h"
 
 
 namespace MR
@@ -18,4 +20,21 @@ enum class VoxelFilterType : int
 /// @param width Width of the filtering window, must be an odd number greater or equal to 1.
 MRVOXELS_API VdbVolume voxelFilter( const VdbVolume& volume, VoxelFilterType type, int width );
 
-}
\ No newline at end of file
+/// Performs voxels filtering of simple volume without conversion in OpenVDB grid,
+/// the voxels outside of the volume are not considered (the filtering window is clipped near the boundary).
+/// Mean and Gaussian filters are separable and computed by three passes along the axes: x- and y-passes slice by slice, and z-pass by rows,
+/// where the inner loops over consecutive voxels are vectorized;
+/// Gaussian filter has the same variance as four successive mean filters of given width (OpenVDB approximates Gaussian this way).
+/// Median filter of width 5 or less is exact, and for larger widths it is computed by sliding histogram of voxel values
+/// quantized in 65536 levels between volume's min and max, so its error is at most 1/65535 of the value range
+/// (and it is exact for integer values with the range up to 65535).
+/// @param width Width of the filtering window, must be an odd number greater or equal to 1.
+MRVOXELS_API Expected<SimpleVolumeMinMax> voxelFilter( const SimpleVolume& volume, VoxelFilterType type, int width, const ProgressCallback& cb = {} );
+
+/// Performs voxels filtering of the volume mapped from a file, see above;
+/// the values are read directly from the file, and only the filtered volume is stored in memory
+MRVOXELS_API Expected<SimpleVolumeMinMax> voxelFilter( const MappedVolume& volume, VoxelFilterType type, int width, const ProgressCallback& cb = {} );
+MRVOXELS_API Expected<SimpleVolumeMinMax> voxelFilter( const MappedVolumeU16& volume, VoxelFilterType type, int width, const ProgressCallback& cb = {} );
+MRVOXELS_API Expected<SimpleVolumeMinMax> voxelFilter( const MappedVolumeU8& volume, VoxelFilterType type, int width, const ProgressCallback& cb = {} );
+
+}
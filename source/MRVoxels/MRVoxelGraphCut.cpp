@@ -10,6 +10,7 @@
 #include "MRMesh/MRBox.h"
 #include "MRPch/MRSpdlog.h"
 #include "MRPch/MRTBB.h"
+#include "MRMesh/MRGTest.h"
 #include <parallel_hashmap/phmap.h>
 #include <array>
 #include <cfloat>
@@ -76,9 +77,11 @@ struct SeqVoxelSpan
 
 using Neighbors = std::array<SeqVoxelId, OutEdgeCount>;
 
-constexpr int power = 6;
-constexpr int numSubtasks = 1 << power;
-static_assert( numSubtasks == 64 );
+/// the region is subdivided on at most 2^maxPower subtasks processed in parallel, which are then merged pairwise
+constexpr int maxPower = 6;
+static_assert( ( 1 << maxPower ) == 64 );
+/// each subtask has at least this number of voxels, so small regions are subdivided on fewer subtasks
+constexpr size_t minSubtaskVoxels = 4096;
 
 struct ComputedFlow
 {
@@ -109,14 +112,16 @@ public:
     SeqVoxelSpan getFullSpan() const { return { SeqVoxelId{ 0 }, seq2voxel_.endId() }; }
     /// returns optimal subdivision of all region voxels on subtasks
     const std::vector<Subtask> & getSubtasks() const { return subtasks_; }
+    /// returns the number of times the subtasks are merged pairwise till the whole region (the number of subtasks is 2^power)
+    int getPower() const { return power_; }
     /// sets edge capacities among all voxel
     void setupCapacities( const SimpleVolume & densityVolume, float k, const VoxelBitSet & sourceSeeds, const VoxelBitSet & sinkSeeds );
-    /// fills neighbor-related data structures
+    /// fills neighbor-related data structures, and frees the mapping from original voxel ids no longer necessary
     void setupNeighbors();
     /// removes all references from span-voxels to out-of-span voxels
     void cutOutOfSpanNeiNeighbors( Context & context );
     /// refills neighbor data previously erased by cutOutOfSpanNeiNeighbors
-    void restoreCutNeighbor( const Context & context );
+    void restoreCutNeighbor( Context & context );
     /// constructs forest of paths reaching all voxels in the span
     void buildForest( Context & context, bool initial );
     /// performs min-cut segmentation in given span
@@ -130,7 +135,11 @@ private:
     ParallelHashMap<VoxelId, SeqVoxelId> toSeqId_;
     Vector<VoxelId, SeqVoxelId> seq2voxel_;
     std::vector<Subtask> subtasks_;
+    int power_ = 0;
 
+    /// explicit neighbors are stored since region voxels are renumbered to make subtasks spatially compact,
+    /// so SeqVoxelId of a neighbor cannot be derived from grid indexing without a hash map lookup in each access;
+    /// neighbors outside of the span of a subtask are temporary erased here (see cutOutOfSpanNeiNeighbors)
     Vector<Neighbors, SeqVoxelId> neighbors_;
 
     Vector<VoxelOutEdgeCapacity, SeqVoxelId> capacity_;
@@ -201,6 +210,8 @@ struct VoxelGraphCut::Context
     const SeqVoxelSpan span;
     Statistics stat;
     SpanVoxelBitSet cutNeis;
+    /// original neighbors of all voxels from cutNeis in the order of the bit-set
+    std::vector<Neighbors> savedNeis;
     SpanVoxelBitSet active;
     SpanVoxelBitSet unknown, tmp;
     std::vector<SeqVoxelId> orphans;
@@ -290,9 +301,13 @@ void VoxelGraphCut::resize( const VoxelBitSet & sourceSeeds, const VoxelBitSet &
         cnt0, float( 100 * cnt0 ) / size_,
         cnt, float( 100 * cnt ) / size_ );
 
+    power_ = 0;
+    while ( power_ < maxPower && ( cnt >> ( power_ + 1 ) ) >= minSubtaskVoxels )
+        ++power_;
+
     allocate_( cnt );
     fillSeq2voxel_( region );
-    subtasks_.resize( numSubtasks );
+    subtasks_.resize( size_t( 1 ) << power_ );
     makeSubtasks_();
     fillToSeqId_();
 
@@ -346,15 +361,18 @@ void VoxelGraphCut::setupNeighbors()
     {
         setupNeighbors_( s );
     } );
+    // the neighbors of cut voxels are restored from their saved copies, so the hash map is not needed during segmentation
+    toSeqId_ = {};
 }
 
-void VoxelGraphCut::restoreCutNeighbor( const Context & context )
+void VoxelGraphCut::restoreCutNeighbor( Context & context )
 {
     MR_TIMER
-    BitSetParallelFor( context.cutNeis, [&]( SpanVoxelId p )
-    {
-        setupNeighbors_( context.span.toSeqId( p ) );
-    } );
+    size_t n = 0;
+    for ( auto p : context.cutNeis )
+        neighbors_[context.span.toSeqId( p )] = context.savedNeis[n++];
+    assert( n == context.savedNeis.size() );
+    context.savedNeis = {};
 }
 
 void VoxelGraphCut::cutOutOfSpanNeiNeighbors( Context & context )
@@ -362,25 +380,28 @@ void VoxelGraphCut::cutOutOfSpanNeiNeighbors( Context & context )
     MR_TIMER
     context.cutNeis.clear();
     context.cutNeis.resize( context.span.size(), false );
+    auto outOfSpan = [&]( SeqVoxelId neis )
+    {
+        return neis && ( neis < context.span.begin || neis >= context.span.end );
+    };
     BitSetParallelForAll( context.cutNeis, [&]( SpanVoxelId p )
     {
-        const auto s = context.span.toSeqId( p );
-        auto & ns = neighbors_[s];
-        auto outOfSpan = [&]( SeqVoxelId neis )
-        {
-            return neis && ( neis < context.span.begin || neis >= context.span.end );
-        };
-        bool cut = false;
-        for ( int i = 0; i < OutEdgeCount; ++i )
-        {
-            if ( !outOfSpan( ns[i] ) )
-                continue;
-            cut = true;
-            ns[i] = {};
-        }
-        if ( cut )
+        const auto & ns = neighbors_[context.span.toSeqId( p )];
+        if ( std::any_of( ns.begin(), ns.end(), outOfSpan ) )
             context.cutNeis.set( p );
     } );
+
+    // only the voxels on the boundary of the span are cut, so they are saved sequentially
+    context.savedNeis.clear();
+    context.savedNeis.reserve( context.cutNeis.count() );
+    for ( auto p : context.cutNeis )
+    {
+        auto & ns = neighbors_[context.span.toSeqId( p )];
+        context.savedNeis.push_back( ns );
+        for ( auto & neis : ns )
+            if ( outOfSpan( neis ) )
+                neis = {};
+    }
 }
 
 void VoxelGraphCut::makeSubtasks_()
@@ -1139,43 +1160,54 @@ Expected<VoxelBitSet> segmentVolumeByGraphCut( const SimpleVolume & densityVolum
         return unexpectedOperationCanceled();
 
     auto parts = vgc.getSubtasks();
+    const int power = vgc.getPower();
+    const size_t numSubtasks = size_t( 1 ) << power;
     // parallel threads shall be able to safely modify elements in bit-sets
-    const auto voxelsPerPart = ( int( vgc.getFullSpan().end ) / ( numSubtasks * BitSet::bits_per_block ) ) * BitSet::bits_per_block;
+    const auto voxelsPerPart = ( int( vgc.getFullSpan().end ) / ( int( numSubtasks ) * BitSet::bits_per_block ) ) * BitSet::bits_per_block;
 
     auto sp = subprogress( cb, 4.0f / 16, 1.0f );
     for ( int p = 0; p <= power; ++p )
     {
-        tbb::parallel_for( tbb::blocked_range<size_t>( 0, parts.size() ), [&]( const tbb::blocked_range<size_t>& range )
+        auto processPart = [&]( size_t i, ProgressCallback partCb )
         {
-            for ( size_t i = range.begin(); i < range.end(); ++i )
+            auto & part = parts[i];
+            if ( parts.size() == numSubtasks )
             {
-                auto & part = parts[i];
-                if ( parts.size() == numSubtasks )
-                {
-                    part.span.begin = SeqVoxelId( i * voxelsPerPart );
-                    part.span.end = ( i + 1 ) < numSubtasks ? SeqVoxelId( ( i + 1 ) * voxelsPerPart ) : vgc.getFullSpan().end;
-                }
-
-                VoxelGraphCut::Context context
-                {
-                    .span = part.span,
-                    .stat = part.stat
-                };
-                if ( parts.size() > 1 )
-                    vgc.cutOutOfSpanNeiNeighbors( context );
-                vgc.buildForest( context, parts.size() == numSubtasks );
-                vgc.segment( context );
-                if ( parts.size() > 1 )
-                    vgc.restoreCutNeighbor( context );
-                part.stat = context.stat;
-                //part.stat.log( fmt::format( " after [{}, {})", part.span.begin, part.span.end ) );
+                part.span.begin = SeqVoxelId( i * voxelsPerPart );
+                part.span.end = ( i + 1 ) < numSubtasks ? SeqVoxelId( ( i + 1 ) * voxelsPerPart ) : vgc.getFullSpan().end;
             }
-        } );
+
+            VoxelGraphCut::Context context
+            {
+                .span = part.span,
+                .stat = part.stat,
+                .cb = std::move( partCb )
+            };
+            if ( parts.size() > 1 )
+                vgc.cutOutOfSpanNeiNeighbors( context );
+            vgc.buildForest( context, parts.size() == numSubtasks );
+            auto res = vgc.segment( context );
+            if ( parts.size() > 1 )
+                vgc.restoreCutNeighbor( context );
+            part.stat = context.stat;
+            //part.stat.log( fmt::format( " after [{}, {})", part.span.begin, part.span.end ) );
+            return res;
+        };
+
         if ( parts.size() <= 1 )
         {
+            // the last part with all voxels is processed in this thread, which can report progress and be canceled
+            if ( !processPart( 0, subprogress( sp, float( p ) / ( power + 1 ), 1.0f ) ) )
+                return unexpectedOperationCanceled();
             parts[0].stat.log( " final" );
             break;
         }
+
+        tbb::parallel_for( tbb::blocked_range<size_t>( 0, parts.size() ), [&]( const tbb::blocked_range<size_t>& range )
+        {
+            for ( size_t i = range.begin(); i < range.end(); ++i )
+                processPart( i, {} );
+        } );
         VoxelGraphCut::Statistics total;
         for ( size_t i = 0; 2 * i + 1 < parts.size(); ++i )
         {
@@ -1190,7 +1222,7 @@ Expected<VoxelBitSet> segmentVolumeByGraphCut( const SimpleVolume & densityVolum
         }
         total.log( fmt::format( " after {} parts", parts.size() ) );
         parts.resize( parts.size() / 2 );
-        if ( !reportProgress( cb, 1.0f / ( power + 1 ) ) )
+        if ( !reportProgress( sp, float( p + 1 ) / ( power + 1 ) ) )
             return unexpectedOperationCanceled();
     }
     //auto cflow = vgc.computeFlow();
@@ -1198,4 +1230,34 @@ Expected<VoxelBitSet> segmentVolumeByGraphCut( const SimpleVolume & densityVolum
     return vgc.getResult( sourceSeeds );
 }
 
+TEST( MRVoxels, VoxelGraphCut )
+{
+    // density steps from 0 to 1 at x = 10, and negative k makes the edges ascending the density cheap to cut;
+    // small volume is segmented in one subtask, and larger one - in several subtasks merged afterwards
+    for ( const auto & dims : { Vector3i( 20, 12, 8 ), Vector3i( 20, 64, 32 ) } )
+    {
+        SimpleVolume volume;
+        volume.dims = dims;
+        volume.voxelSize = Vector3f::diagonal( 1 );
+        const VolumeIndexer indexer( volume.dims );
+        volume.data.resize( indexer.size() );
+        VoxelBitSet sourceSeeds( indexer.size() ), sinkSeeds( indexer.size() ), expected( indexer.size() );
+        for ( size_t i = 0; i < indexer.size(); ++i )
+        {
+            const VoxelId v( i );
+            const auto pos = indexer.toPos( v );
+            volume.data[v] = pos.x < 10 ? 0.0f : 1.0f;
+            if ( pos.x < 10 )
+                expected.set( v );
+            if ( pos.x == 0 )
+                sourceSeeds.set( v );
+            if ( pos.x + 1 == volume.dims.x )
+                sinkSeeds.set( v );
+        }
+        auto res = segmentVolumeByGraphCut( volume, -10.0f, sourceSeeds, sinkSeeds );
+        ASSERT_TRUE( res.has_value() );
+        EXPECT_EQ( *res, expected );
+    }
+}
+
 } // namespace MR
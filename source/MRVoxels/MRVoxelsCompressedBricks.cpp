@@ -0,0 +1,570 @@
+#include "MRVoxelsCompressedBricks.h"
+#include "MRVDBConversions.h"
+#include "MRMesh/MRParallelFor.h"
+#include "MRMesh/MRIOParsing.h"
+#include "MRMesh/MRStringConvert.h"
+#include "MRMesh/MRVolumeIndexer.h"
+#include "MRMesh/MRUniqueTemporaryFolder.h"
+#include "MRMesh/MRTimer.h"
+#include "MRMesh/MRGTest.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace MR
+{
+
+namespace
+{
+
+constexpr char cMagic[4] = { 'M', 'R', 'B', 'V' };
+constexpr uint32_t cVersion = 1;
+constexpr int cBrickLog = 4;
+constexpr int cBrickSize = 1 << cBrickLog;
+
+struct Header
+{
+    char magic[4];
+    uint32_t version = 0;
+    Vector3i dims;
+    Vector3f voxelSize;
+    uint32_t scalarType = 0;
+    uint32_t brickLog = 0;
+};
+static_assert( sizeof( Header ) == 40 );
+
+/// the kinds of encoded bricks, the first byte of each brick
+enum BrickKind : uint8_t
+{
+    ConstantBrick = 0, ///< followed by the value of all voxels
+    DeltaBrick = 1     ///< followed by the value of the first voxel and the tokens of the differences of all next voxels
+};
+
+/// the bricks of given volume
+struct BrickGrid
+{
+    explicit BrickGrid( const Vector3i& dims )
+        : dims( dims )
+        , brickDims( ( dims + Vector3i::diagonal( cBrickSize - 1 ) ) / cBrickSize )
+    {}
+
+    [[nodiscard]] size_t size() const { return size_t( brickDims.x ) * brickDims.y * brickDims.z; }
+
+    [[nodiscard]] size_t brickId( const Vector3i& b ) const { return size_t( b.x ) + size_t( brickDims.x ) * ( size_t( b.y ) + size_t( brickDims.y ) * b.z ); }
+
+    /// the voxels of given brick: min <= pos < max
+    [[nodiscard]] Box3i brickBox( const Vector3i& b ) const
+    {
+        const auto min = b * cBrickSize;
+        return { min, Vector3i( std::min( min.x + cBrickSize, dims.x ), std::min( min.y + cBrickSize, dims.y ), std::min( min.z + cBrickSize, dims.z ) ) };
+    }
+
+    [[nodiscard]] Box3i brickBox( size_t id ) const
+    {
+        const auto xy = size_t( brickDims.x ) * brickDims.y;
+        return brickBox( Vector3i( int( id % brickDims.x ), int( id / brickDims.x % brickDims.y ), int( id / xy ) ) );
+    }
+
+    Vector3i dims;
+    Vector3i brickDims;
+};
+
+/// unsigned integer with the same bits as the stored value
+template <typename T>
+using BitsOf = std::conditional_t<sizeof( T ) == 2, uint16_t, uint32_t>;
+
+template <typename T>
+[[nodiscard]] BitsOf<T> toBits( T v ) { return std::bit_cast<BitsOf<T>>( v ); }
+
+template <typename T>
+[[nodiscard]] T fromBits( BitsOf<T> v ) { return std::bit_cast<T>( v ); }
+
+template <typename T>
+constexpr ScalarType cScalarTypeOf = std::is_same_v<T, uint16_t> ? ScalarType::UInt16 : ScalarType::Float32;
+
+void putVarUInt( std::vector<uint8_t>& out, uint64_t v )
+{
+    while ( v >= 0x80 )
+    {
+        out.push_back( uint8_t( v | 0x80 ) );
+        v >>= 7;
+    }
+    out.push_back( uint8_t( v ) );
+}
+
+[[nodiscard]] uint64_t getVarUInt( const uint8_t*& p, const uint8_t* end )
+{
+    uint64_t res = 0;
+    for ( int shift = 0; p < end && shift < 64; shift += 7 )
+    {
+        const auto byte = *p++;
+        res |= uint64_t( byte & 0x7F ) << shift;
+        if ( !( byte & 0x80 ) )
+            break;
+    }
+    return res;
+}
+
+template <typename U>
+void putRaw( std::vector<uint8_t>& out, U v )
+{
+    const auto pos = out.size();
+    out.resize( pos + sizeof( U ) );
+    std::memcpy( out.data() + pos, &v, sizeof( U ) );
+}
+
+template <typename U>
+[[nodiscard]] U getRaw( const uint8_t*& p, const uint8_t* end )
+{
+    U res{};
+    if ( p + sizeof( U ) <= end )
+        std::memcpy( &res, p, sizeof( U ) );
+    p += sizeof( U );
+    return res;
+}
+
+/// token is either a zigzag-encoded difference shifted left on one bit, or the length of zero differences run shifted left with lowest bit set
+template <typename T>
+[[nodiscard]] std::vector<uint8_t> encodeBrick( const VoxelsVolume<std::vector<T>>& volume, const VolumeIndexer& indexer, const Box3i& box )
+{
+    std::vector<uint8_t> res;
+    const auto first = toBits( volume.data[indexer.toVoxelId( box.min )] );
+    bool constant = true;
+    for ( int z = box.min.z; constant && z < box.max.z; ++z )
+        for ( int y = box.min.y; constant && y < box.max.y; ++y )
+        {
+            const auto id = size_t( indexer.toVoxelId( { box.min.x, y, z } ) );
+            for ( int x = 0; x < box.max.x - box.min.x; ++x )
+                if ( toBits( volume.data[id + x] ) != first )
+                {
+                    constant = false;
+                    break;
+                }
+        }
+    res.push_back( constant ? ConstantBrick : DeltaBrick );
+    putRaw( res, first );
+    if ( constant )
+        return res;
+
+    int64_t prev = first;
+    uint64_t zeroRun = 0;
+    auto flushZeroRun = [&]
+    {
+        if ( zeroRun > 0 )
+            putVarUInt( res, ( zeroRun << 1 ) | 1 );
+        zeroRun = 0;
+    };
+    bool firstVoxel = true;
+    for ( int z = box.min.z; z < box.max.z; ++z )
+        for ( int y = box.min.y; y < box.max.y; ++y )
+        {
+            const auto id = size_t( indexer.toVoxelId( { box.min.x, y, z } ) );
+            for ( int x = 0; x < box.max.x - box.min.x; ++x )
+            {
+                if ( firstVoxel )
+                {
+                    firstVoxel = false;
+                    continue;
+                }
+                const int64_t cur = toBits( volume.data[id + x] );
+                const int64_t d = cur - prev;
+                prev = cur;
+                if ( d == 0 )
+                {
+                    ++zeroRun;
+                    continue;
+                }
+                flushZeroRun();
+                const uint64_t zigzag = d < 0 ? ( uint64_t( -d ) << 1 ) - 1 : uint64_t( d ) << 1;
+                putVarUInt( res, zigzag << 1 );
+            }
+        }
+    flushZeroRun();
+    return res;
+}
+
+/// decodes the brick with values of type S, and writes the values inside given region in the volume of type T
+template <typename S, typename T>
+[[nodiscard]] bool decodeBrick( const uint8_t* p, const uint8_t* end, const Box3i& box,
+    VoxelsVolume<std::vector<T>>& volume, const VolumeIndexer& indexer, const Box3i& region )
+{
+    using U = BitsOf<S>;
+    if ( p >= end )
+        return false;
+    const auto kind = *p++;
+    if ( kind != ConstantBrick && kind != DeltaBrick )
+        return false;
+    int64_t cur = getRaw<U>( p, end );
+    if ( p > end )
+        return false;
+    const auto clip = box.intersection( region );
+
+    if ( kind == ConstantBrick )
+    {
+        const T value = T( fromBits<S>( U( cur ) ) );
+        for ( int z = clip.min.z; z < clip.max.z; ++z )
+            for ( int y = clip.min.y; y < clip.max.y; ++y )
+            {
+                const auto id = size_t( indexer.toVoxelId( clip.min - region.min + Vector3i( 0, y - clip.min.y, z - clip.min.z ) ) );
+                std::fill_n( volume.data.begin() + id, clip.max.x - clip.min.x, value );
+            }
+        return true;
+    }
+
+    uint64_t zeroRun = 0;
+    bool firstVoxel = true;
+    for ( int z = box.min.z; z < box.max.z; ++z )
+        for ( int y = box.min.y; y < box.max.y; ++y )
+        {
+            const bool rowInside = z >= region.min.z && z < region.max.z && y >= region.min.y && y < region.max.y;
+            const auto rowId = rowInside ? size_t( indexer.toVoxelId( Vector3i( 0, y - region.min.y, z - region.min.z ) ) ) : 0;
+            for ( int x = box.min.x; x < box.max.x; ++x )
+            {
+                if ( firstVoxel )
+                    firstVoxel = false;
+                else if ( zeroRun > 0 )
+                    --zeroRun;
+                else
+                {
+                    if ( p >= end )
+                        return false;
+                    const auto token = getVarUInt( p, end );
+                    if ( token & 1 )
+                    {
+                        zeroRun = ( token >> 1 ) - 1;
+                    }
+                    else
+                    {
+                        const auto zigzag = token >> 1;
+                        cur += ( zigzag & 1 ) ? -int64_t( ( zigzag + 1 ) >> 1 ) : int64_t( zigzag >> 1 );
+                    }
+                }
+                if ( rowInside && x >= region.min.x && x < region.max.x )
+                    volume.data[rowId + ( x - region.min.x )] = T( fromBits<S>( U( cur ) ) );
+            }
+        }
+    return true;
+}
+
+template <typename T>
+Expected<void> saveBricks( const VoxelsVolume<std::vector<T>>& volume, const std::filesystem::path& file, const ProgressCallback& callback )
+{
+    MR_TIMER
+    const BrickGrid grid( volume.dims );
+    const VolumeIndexer indexer( volume.dims );
+    if ( volume.data.size() != indexer.size() )
+        return unexpected( "Volume data size does not match its dimensions" );
+
+    std::vector<std::vector<uint8_t>> encoded( grid.size() );
+    if ( !ParallelFor( size_t( 0 ), grid.size(), [&] ( size_t b )
+    {
+        encoded[b] = encodeBrick( volume, indexer, grid.brickBox( b ) );
+    }, subprogress( callback, 0.0f, 0.8f ) ) )
+        return unexpectedOperationCanceled();
+
+    std::ofstream out( file, std::ios::binary );
+    if ( !out )
+        return unexpected( "Cannot open file for writing " + utf8string( file ) );
+
+    Header header;
+    std::memcpy( header.magic, cMagic, sizeof( cMagic ) );
+    header.version = cVersion;
+    header.dims = volume.dims;
+    header.voxelSize = volume.voxelSize;
+    header.scalarType = uint32_t( cScalarTypeOf<T> );
+    header.brickLog = cBrickLog;
+    out.write( ( const char* )&header, sizeof( header ) );
+
+    std::vector<uint64_t> brickEnds( grid.size() );
+    uint64_t end = 0;
+    for ( size_t b = 0; b < grid.size(); ++b )
+        brickEnds[b] = end += encoded[b].size();
+    out.write( ( const char* )brickEnds.data(), brickEnds.size() * sizeof( uint64_t ) );
+
+    const auto sp = subprogress( callback, 0.8f, 1.0f );
+    for ( size_t b = 0; b < grid.size(); ++b )
+    {
+        out.write( ( const char* )encoded[b].data(), encoded[b].size() );
+        if ( !reportProgress( sp, float( b ) / grid.size(), b, 1024 ) )
+            return unexpectedOperationCanceled();
+    }
+    if ( !out )
+        return unexpected( "Error writing in file " + utf8string( file ) );
+    return {};
+}
+
+Expected<Header> readHeader( std::istream& in )
+{
+    Header header;
+    if ( !in.read( ( char* )&header, sizeof( header ) ) )
+        return unexpected( "Cannot read header" );
+    if ( std::memcmp( header.magic, cMagic, sizeof( cMagic ) ) != 0 )
+        return unexpected( "Not a compressed bricks file" );
+    if ( header.version != cVersion )
+        return unexpected( "Unsupported version of compressed bricks file" );
+    if ( header.brickLog != cBrickLog )
+        return unexpected( "Unsupported brick size" );
+    if ( header.dims.x <= 0 || header.dims.y <= 0 || header.dims.z <= 0 )
+        return unexpected( "Wrong volume dimensions" );
+    // the dimensions rounded up to whole bricks and the number of voxels (of any supported type) in bytes must not overflow
+    constexpr int cMaxDim = std::numeric_limits<int>::max() - ( cBrickSize - 1 );
+    if ( header.dims.x > cMaxDim || header.dims.y > cMaxDim || header.dims.z > cMaxDim
+        || size_t( header.dims.x ) * size_t( header.dims.y ) > std::numeric_limits<size_t>::max() / sizeof( float ) / size_t( header.dims.z ) )
+        return unexpected( "Too large volume dimensions" );
+    if ( header.scalarType != uint32_t( ScalarType::UInt16 ) && header.scalarType != uint32_t( ScalarType::Float32 ) )
+        return unexpected( "Unsupported scalar type" );
+    return header;
+}
+
+/// reads the bricks with values of type S intersecting given region, and converts their values in type T
+template <typename S, typename T>
+Expected<VoxelsVolumeMinMax<std::vector<T>>> loadBricks( std::istream& in, const Header& header, Box3i region, const ProgressCallback& cb )
+{
+    MR_TIMER
+    const BrickGrid grid( header.dims );
+    // check that the file contains the whole brick table before allocating it
+    const auto tableAndDataSize = uint64_t( getStreamSize( in ) );
+    const auto tableSize = uint64_t( grid.size() ) * sizeof( uint64_t );
+    if ( !in || tableSize > tableAndDataSize )
+        return unexpected( "File is too short for brick table" );
+    std::vector<uint64_t> brickEnds( grid.size() );
+    if ( !in.read( ( char* )brickEnds.data(), tableSize ) )
+        return unexpected( "Cannot read brick table" );
+    const auto dataStart = uint64_t( in.tellg() );
+    // the size of brick data after the table, the ends of bricks are measured from dataStart;
+    // the ends must be increasing at least by the size of the smallest brick (its kind and one value) and within the data,
+    // otherwise the offsets below would point outside of the buffers, and the file would be too short for the volume
+    const auto dataSize = tableAndDataSize - tableSize;
+    constexpr uint64_t minBrickSize = 1 + sizeof( S );
+    for ( size_t b = 0; b < brickEnds.size(); ++b )
+        if ( brickEnds[b] > dataSize || brickEnds[b] < ( b > 0 ? brickEnds[b - 1] : 0 ) + minBrickSize )
+            return unexpected( "Broken brick table" );
+    auto brickBegin = [&] ( size_t b ) { return b > 0 ? brickEnds[b - 1] : uint64_t( 0 ); };
+
+    if ( !region.valid() )
+        region = Box3i( Vector3i(), header.dims );
+    region = region.intersection( Box3i( Vector3i(), header.dims ) );
+    if ( !region.valid() || region.min.x == region.max.x || region.min.y == region.max.y || region.min.z == region.max.z )
+        return unexpected( "Region does not intersect the volume" );
+
+    VoxelsVolumeMinMax<std::vector<T>> res;
+    res.dims = region.size();
+    res.voxelSize = header.voxelSize;
+    const VolumeIndexer indexer( res.dims );
+    res.data.resize( indexer.size() );
+
+    // read the rows of bricks intersecting the region, each row is stored contiguously in the file
+    const auto minBrick = region.min / cBrickSize;
+    const auto maxBrick = ( region.max - Vector3i::diagonal( 1 ) ) / cBrickSize;
+    std::vector<size_t> bricks; // ids of the bricks to decode
+    std::vector<uint64_t> brickOffsets; // the position of each brick in (data)
+    std::vector<uint8_t> data;
+    const auto readSp = subprogress( cb, 0.0f, 0.3f );
+    const int numRows = ( maxBrick.y - minBrick.y + 1 ) * ( maxBrick.z - minBrick.z + 1 );
+    int row = 0;
+    for ( int bz = minBrick.z; bz <= maxBrick.z; ++bz )
+    {
+        for ( int by = minBrick.y; by <= maxBrick.y; ++by, ++row )
+        {
+            const auto firstId = grid.brickId( { minBrick.x, by, bz } );
+            const auto lastId = grid.brickId( { maxBrick.x, by, bz } );
+            const auto begin = brickBegin( firstId );
+            const auto end = brickEnds[lastId];
+            const auto pos = data.size();
+            data.resize( pos + ( end - begin ) );
+            in.seekg( dataStart + begin );
+            if ( !in.read( ( char* )data.data() + pos, end - begin ) )
+                return unexpected( "Cannot read bricks" );
+            for ( auto b = firstId; b <= lastId; ++b )
+            {
+                bricks.push_back( b );
+                brickOffsets.push_back( pos + ( brickBegin( b ) - begin ) );
+            }
+            if ( !reportProgress( readSp, float( row ) / numRows, row, 16 ) )
+                return unexpectedOperationCanceled();
+        }
+    }
+    brickOffsets.push_back( data.size() );
+
+    std::atomic<bool> broken{ false };
+    if ( !ParallelFor( size_t( 0 ), bricks.size(), [&] ( size_t i )
+    {
+        const auto b = bricks[i];
+        const auto begin = data.data() + brickOffsets[i];
+        const auto end = data.data() + brickOffsets[i] + ( brickEnds[b] - brickBegin( b ) );
+        if ( !decodeBrick<S>( begin, end, grid.brickBox( b ), res, indexer, region ) )
+            broken = true;
+    }, subprogress( cb, 0.3f, 0.9f ) ) )
+        return unexpectedOperationCanceled();
+    if ( broken )
+        return unexpected( "Broken brick data" );
+
+    std::tie( res.min, res.max ) = parallelMinMax( res.data );
+    if ( !reportProgress( cb, 1.0f ) )
+        return unexpectedOperationCanceled();
+    return res;
+}
+
+} // anonymous namespace
+
+namespace VoxelsSave
+{
+
+Expected<void> toCompressedBricks( const SimpleVolumeU16& volume, const std::filesystem::path& file, ProgressCallback callback )
+{
+    return saveBricks( volume, file, callback );
+}
+
+Expected<void> toCompressedBricks( const SimpleVolume& volume, const std::filesystem::path& file, ProgressCallback callback )
+{
+    return saveBricks( volume, file, callback );
+}
+
+Expected<void> toCompressedBricks( const VdbVolume& vdbVolume, const std::filesystem::path& file, ProgressCallback callback )
+{
+    MR_TIMER
+    auto simpleVolume = vdbVolumeToSimpleVolume( vdbVolume, {}, subprogress( callback, 0.0f, 0.3f ) );
+    if ( !simpleVolume )
+        return unexpected( std::move( simpleVolume.error() ) );
+    return saveBricks<float>( *simpleVolume, file, subprogress( callback, 0.3f, 1.0f ) );
+}
+
+} // namespace VoxelsSave
+
+namespace VoxelsLoad
+{
+
+Expected<CompressedBricksInfo> readCompressedBricksInfo( const std::filesystem::path& file )
+{
+    std::ifstream in( file, std::ios::binary );
+    if ( !in )
+        return unexpected( "Cannot open file for reading " + utf8string( file ) );
+    return addFileNameInError( readHeader( in ), file ).transform( [] ( const Header& header )
+    {
+        return CompressedBricksInfo{ .dims = header.dims, .voxelSize = header.voxelSize, .scalarType = ScalarType( header.scalarType ) };
+    } );
+}
+
+Expected<SimpleVolumeMinMax> fromCompressedBricks( const std::filesystem::path& file, const Box3i& region, const ProgressCallback& cb )
+{
+    MR_TIMER
+    std::ifstream in( file, std::ios::binary );
+    if ( !in )
+        return unexpected( "Cannot open file for reading " + utf8string( file ) );
+    return addFileNameInError( readHeader( in ).and_then( [&] ( const Header& header )
+    {
+        if ( header.scalarType == uint32_t( ScalarType::UInt16 ) )
+            return loadBricks<uint16_t, float>( in, header, region, cb );
+        return loadBricks<float, float>( in, header, region, cb );
+    } ), file );
+}
+
+Expected<SimpleVolumeMinMaxU16> fromCompressedBricksU16( const std::filesystem::path& file, const Box3i& region, const ProgressCallback& cb )
+{
+    MR_TIMER
+    std::ifstream in( file, std::ios::binary );
+    if ( !in )
+        return unexpected( "Cannot open file for reading " + utf8string( file ) );
+    return addFileNameInError( readHeader( in ).and_then( [&] ( const Header& header ) -> Expected<SimpleVolumeMinMaxU16>
+    {
+        if ( header.scalarType != uint32_t( ScalarType::UInt16 ) )
+            return unexpected( "The file does not store uint16 values" );
+        return loadBricks<uint16_t, uint16_t>( in, header, region, cb );
+    } ), file );
+}
+
+} // namespace VoxelsLoad
+
+TEST( MRVoxels, CompressedBricks )
+{
+    // mostly empty uint16 volume with a noisy ball inside
+    SimpleVolumeU16 volume;
+    volume.dims = Vector3i( 70, 45, 37 );
+    volume.voxelSize = Vector3f( 0.5f, 0.25f, 1.0f );
+    const VolumeIndexer indexer( volume.dims );
+    volume.data.resize( indexer.size() );
+    const auto center = Vector3f( 30, 20, 18 );
+    for ( size_t i = 0; i < indexer.size(); ++i )
+    {
+        const auto pos = indexer.toPos( VoxelId( i ) );
+        const auto dist = ( Vector3f( pos ) - center ).length();
+        volume.data[i] = dist < 15 ? uint16_t( 30000 + 1000 * std::sin( float( i ) ) ) : 0;
+    }
+
+    UniqueTemporaryFolder folder( {} );
+    const auto path = folder / "volume.mrbv";
+    ASSERT_TRUE( VoxelsSave::toCompressedBricks( volume, path ).has_value() );
+    EXPECT_LT( std::filesystem::file_size( path ), volume.data.size() * sizeof( uint16_t ) / 2 );
+
+    auto info = VoxelsLoad::readCompressedBricksInfo( path );
+    ASSERT_TRUE( info.has_value() );
+    EXPECT_EQ( info->dims, volume.dims );
+    EXPECT_EQ( info->voxelSize, volume.voxelSize );
+    EXPECT_EQ( info->scalarType, ScalarType::UInt16 );
+
+    auto loaded = VoxelsLoad::fromCompressedBricksU16( path );
+    ASSERT_TRUE( loaded.has_value() );
+    EXPECT_EQ( loaded->dims, volume.dims );
+    EXPECT_TRUE( loaded->data == volume.data );
+    EXPECT_EQ( loaded->min, 0 );
+
+    // partial loading of a subregion not aligned on brick boundaries
+    const Box3i region( Vector3i( 5, 17, 3 ), Vector3i( 41, 30, 36 ) );
+    auto part = VoxelsLoad::fromCompressedBricks( path, region );
+    ASSERT_TRUE( part.has_value() );
+    ASSERT_EQ( part->dims, region.size() );
+    const VolumeIndexer partIndexer( part->dims );
+    for ( size_t i = 0; i < partIndexer.size(); ++i )
+    {
+        const auto pos = partIndexer.toPos( VoxelId( i ) );
+        ASSERT_EQ( part->data[i], float( volume.data[indexer.toVoxelId( pos + region.min )] ) );
+    }
+
+    // float values
+    SimpleVolume floatVolume;
+    floatVolume.dims = volume.dims;
+    floatVolume.voxelSize = volume.voxelSize;
+    floatVolume.data.resize( volume.data.size() );
+    for ( size_t i = 0; i < volume.data.size(); ++i )
+        floatVolume.data[i] = volume.data[i] > 0 ? std::sqrt( float( volume.data[i] ) ) : -1.0f;
+    ASSERT_TRUE( VoxelsSave::toCompressedBricks( floatVolume, path ).has_value() );
+    auto floatLoaded = VoxelsLoad::fromCompressedBricks( path );
+    ASSERT_TRUE( floatLoaded.has_value() );
+    EXPECT_TRUE( floatLoaded->data == floatVolume.data );
+    EXPECT_FALSE( VoxelsLoad::fromCompressedBricksU16( path ).has_value() );
+
+    // broken brick tables must be rejected before decoding
+    auto patchBrickEnds = [&] ( auto && patch )
+    {
+        std::fstream f( path, std::ios::in | std::ios::out | std::ios::binary );
+        uint64_t ends[2];
+        f.seekg( sizeof( Header ) );
+        f.read( ( char* )ends, sizeof( ends ) );
+        patch( ends );
+        f.seekp( sizeof( Header ) );
+        f.write( ( const char* )ends, sizeof( ends ) );
+    };
+    patchBrickEnds( [] ( uint64_t* ends ) { ends[0] = ends[1] + 1; } ); // decreasing ends
+    EXPECT_FALSE( VoxelsLoad::fromCompressedBricks( path ).has_value() );
+    patchBrickEnds( [] ( uint64_t* ends ) { ends[0] = ends[1] = uint64_t( 1 ) << 60; } ); // ends beyond the file
+    EXPECT_FALSE( VoxelsLoad::fromCompressedBricks( path ).has_value() );
+
+    // huge dimensions must be rejected before any allocation
+    auto patchDims = [&] ( const Vector3i& dims )
+    {
+        std::fstream f( path, std::ios::in | std::ios::out | std::ios::binary );
+        f.seekp( offsetof( Header, dims ) );
+        f.write( ( const char* )&dims, sizeof( dims ) );
+    };
+    patchDims( Vector3i::diagonal( std::numeric_limits<int>::max() ) ); // overflow of the number of bricks
+    EXPECT_FALSE( VoxelsLoad::fromCompressedBricks( path ).has_value() );
+    patchDims( Vector3i::diagonal( 1 << 22 ) ); // overflow of the size of voxels in bytes
+    EXPECT_FALSE( VoxelsLoad::fromCompressedBricks( path ).has_value() );
+    patchDims( Vector3i::diagonal( 100000 ) ); // brick table is longer than the file
+    EXPECT_FALSE( VoxelsLoad::fromCompressedBricks( path ).has_value() );
+}
+
+} // namespace MR
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "MRVoxelsFwd.h"
+#include "MRVoxelsVolume.h"
+#include "MRScalarConvert.h"
+#include "MRMesh/MRBox.h"
+#include "MRMesh/MRExpected.h"
+#include "MRMesh/MRProgressCallback.h"
+#include <filesystem>
+
+namespace MR
+{
+
+/// Compressed bricks format (.mrbv) stores the voxels in cubic bricks of 16^3 voxels compressed independently:
+/// a brick with all equal values keeps only one value, and every other brick keeps the differences of its consecutive values
+/// as variable-length integers with run-length encoded zero differences;
+/// the table of brick offsets in the beginning of the file allows one to load any subregion reading only the bricks intersecting it
+
+namespace VoxelsSave
+{
+
+/// \addtogroup IOGroup
+/// \{
+
+/// Save voxels in compressed bricks format (.mrbv), the bricks are compressed in parallel
+MRVOXELS_API Expected<void> toCompressedBricks( const SimpleVolumeU16& volume, const std::filesystem::path& file, ProgressCallback callback = {} );
+MRVOXELS_API Expected<void> toCompressedBricks( const SimpleVolume& volume, const std::filesystem::path& file, ProgressCallback callback = {} );
+MRVOXELS_API Expected<void> toCompressedBricks( const VdbVolume& vdbVolume, const std::filesystem::path& file, ProgressCallback callback = {} );
+
+/// \}
+
+} // namespace VoxelsSave
+
+namespace VoxelsLoad
+{
+
+/// \addtogroup VoxelsLoadGroup
+/// \{
+
+/// the parameters of the volume stored in compressed bricks file
+struct CompressedBricksInfo
+{
+    Vector3i dims;
+    Vector3f voxelSize;
+    /// either UInt16 or Float32
+    ScalarType scalarType = ScalarType::Unknown;
+};
+
+/// reads only the parameters of the volume from compressed bricks file (.mrbv)
+MRVOXELS_API Expected<CompressedBricksInfo> readCompressedBricksInfo( const std::filesystem::path& file );
+
+/// Load voxels from compressed bricks file (.mrbv), uint16 values are converted in float without scaling;
+/// \param region if valid then only the voxels with region.min <= pos < region.max are loaded, and only the bricks intersecting it are read and decompressed
+MRVOXELS_API Expected<SimpleVolumeMinMax> fromCompressedBricks( const std::filesystem::path& file, const Box3i& region = {},
+                                                                const ProgressCallback& cb = {} );
+
+/// Load voxels from compressed bricks file (.mrbv) saved with uint16 values, see fromCompressedBricks
+MRVOXELS_API Expected<SimpleVolumeMinMaxU16> fromCompressedBricksU16( const std::filesystem::path& file, const Box3i& region = {},
+                                                                      const ProgressCallback& cb = {} );
+
+/// \}
+
+} // namespace VoxelsLoad
+
+} // namespace MR
@@ -24,10 +24,16 @@ class ObjectVoxels;
 struct MRVOXELS_CLASS OpenVdbFloatGrid;
 using FloatGrid = std::shared_ptr<OpenVdbFloatGrid>;
 
+struct BrickVolumeData;
+
+template <typename T>
+class MappedBuffer;
+
 MR_CANONICAL_TYPEDEFS( (template <typename T> struct), MRVOXELS_CLASS VoxelsVolumeMinMax,
     ( SimpleVolumeMinMax, VoxelsVolumeMinMax<std::vector<float>> )
     ( SimpleVolumeMinMaxU16, VoxelsVolumeMinMax<std::vector<uint16_t>> )
     ( VdbVolume, VoxelsVolumeMinMax<FloatGrid> )
+    ( BrickVolume, VoxelsVolumeMinMax<BrickVolumeData> )
 )
 
 using VdbVolumes = std::vector<VdbVolume>;
@@ -40,6 +46,9 @@ MR_CANONICAL_TYPEDEFS( (template <typename T> struct), MRVOXELS_CLASS VoxelsVolu
     ( FunctionVolumeU8, VoxelsVolume<VoxelValueGetter<uint8_t>> )
     ( SimpleVolume, VoxelsVolume<std::vector<float>> )
     ( SimpleVolumeU16, VoxelsVolume<std::vector<uint16_t>> )
+    ( MappedVolume, VoxelsVolume<MappedBuffer<float>> )
+    ( MappedVolumeU16, VoxelsVolume<MappedBuffer<uint16_t>> )
+    ( MappedVolumeU8, VoxelsVolume<MappedBuffer<uint8_t>> )
 )
 
 namespace VoxelsLoad
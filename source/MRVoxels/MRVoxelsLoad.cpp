@@ -6,6 +6,7 @@
 #include "MRObjectVoxels.h"
 #include "MRScanHelpers.h"
 #include "MRVDBConversions.h"
+#include "MRVoxelsCompressedBricks.h"
 #include "MRMesh/MRStringConvert.h"
 #include "MRVDBFloatGrid.h"
 #include "MRMesh/MRStringConvert.h"
@@ -243,6 +244,14 @@ Expected<std::vector<VdbVolume>> vecFromGav(  const std::filesystem::path& path,
     return fromGav( path, cb ).and_then( toSingleElementVector );
 }
 
+Expected<std::vector<VdbVolume>> vecFromCompressedBricks( const std::filesystem::path& path, const ProgressCallback& cb )
+{
+    return fromCompressedBricks( path, {}, subprogress( cb, 0.0f, 0.5f ) ).and_then( [&] ( SimpleVolumeMinMax&& volume )
+    {
+        return toSingleElementVector( simpleVolumeToVdbVolume( volume, subprogress( cb, 0.5f, 1.0f ) ) );
+    } );
+}
+
 MR_FORMAT_REGISTRY_IMPL( VoxelsLoader )
 
 Expected<std::vector<VdbVolume>> fromAnySupportedFormat( const std::filesystem::path& path, const ProgressCallback& cb /*= {} */ )
@@ -314,6 +323,7 @@ MR_ON_INIT {                                                           \
 MR_ADD_VOXELS_LOADER( IOFilter( "Raw (.raw)", "*.raw" ), vecFromRaw )
 MR_ADD_VOXELS_LOADER( IOFilter( "Micro CT (.gav)", "*.gav" ), vecFromGav )
 MR_ADD_VOXELS_LOADER( IOFilter( "OpenVDB (.vdb)", "*.vdb" ), fromVdb )
+MR_ADD_VOXELS_LOADER( IOFilter( "Compressed bricks (.mrbv)", "*.mrbv" ), vecFromCompressedBricks )
 
 #ifndef MRVOXELS_NO_TIFF
 struct TiffParams
@@ -582,6 +592,52 @@ Expected<VdbVolume> fromRaw( std::istream& in, const RawParameters& params,  con
     return res;
 }
 
+namespace
+{
+
+template <typename T>
+constexpr ScalarType scalarTypeOf()
+{
+    if constexpr ( std::is_same_v<T, uint8_t> )
+        return ScalarType::UInt8;
+    else if constexpr ( std::is_same_v<T, uint16_t> )
+        return ScalarType::UInt16;
+    else if constexpr ( std::is_same_v<T, float> )
+        return ScalarType::Float32;
+    else
+        return ScalarType::Unknown;
+}
+
+} // anonymous namespace
+
+template <typename T>
+Expected<VoxelsVolume<MappedBuffer<T>>> mapRaw( const std::filesystem::path& file, const RawParameters& params, size_t payloadOffset )
+{
+    MR_TIMER
+    if ( params.dimensions.x <= 0 || params.dimensions.y <= 0 || params.dimensions.z <= 0 )
+        return unexpected( "Wrong volume dimension parameter value" );
+
+    if ( params.voxelSize.x <= 0 || params.voxelSize.y <= 0 || params.voxelSize.z <= 0 )
+        return unexpected( "Wrong voxel size parameter value" );
+
+    if ( params.scalarType != scalarTypeOf<T>() )
+        return unexpected( "Scalar type of the file does not match the type of mapped volume" );
+
+    const auto numVoxels = size_t( params.dimensions.x ) * params.dimensions.y * params.dimensions.z;
+    return MappedFileRegion::map( file, payloadOffset, numVoxels * sizeof( T ) ).transform( [&] ( std::shared_ptr<const MappedFileRegion>&& region )
+    {
+        VoxelsVolume<MappedBuffer<T>> res;
+        res.data = MappedBuffer<T>( std::move( region ) );
+        res.dims = params.dimensions;
+        res.voxelSize = params.voxelSize;
+        return res;
+    } );
+}
+
+template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<uint8_t>>> mapRaw( const std::filesystem::path& file, const RawParameters& params, size_t payloadOffset );
+template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<uint16_t>>> mapRaw( const std::filesystem::path& file, const RawParameters& params, size_t payloadOffset );
+template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<float>>> mapRaw( const std::filesystem::path& file, const RawParameters& params, size_t payloadOffset );
+
 } // namespace VoxelsLoad
 
 Expected<std::vector<std::shared_ptr<ObjectVoxels>>> makeObjectVoxelsFromFile( const std::filesystem::path& file, ProgressCallback callback /*= {} */ )
@@ -2,6 +2,7 @@
 #include "MRVoxelsFwd.h"
 #include "MRScalarConvert.h"
 #include "MRVoxelsVolume.h"
+#include "MRMappedBuffer.h"
 
 #include "MRMesh/MRIOFormatsRegistry.h"
 #include "MRMesh/MRObject.h"
@@ -52,6 +53,25 @@ MRVOXELS_API Expected<VdbVolume> fromGav( const std::filesystem::path& file, con
 /// Load voxel from Gav-stream with micro CT reconstruction
 MRVOXELS_API Expected<VdbVolume> fromGav( std::istream& in, const ProgressCallback& cb = {} );
 
+/// maps the voxels of raw file in memory instead of reading them, so the volume can be much larger than available memory:
+/// the values are read from the disk by the operating system only when they are accessed;
+/// T must correspond to params.scalarType; the file must not be modified while the volume or any of its copies exists
+/// \param payloadOffset the position of the first voxel in the file
+template <typename T>
+Expected<VoxelsVolume<MappedBuffer<T>>> mapRaw( const std::filesystem::path& file, const RawParameters& params, size_t payloadOffset = 0 );
+
+extern template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<uint8_t>>> mapRaw( const std::filesystem::path& file, const RawParameters& params, size_t payloadOffset );
+extern template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<uint16_t>>> mapRaw( const std::filesystem::path& file, const RawParameters& params, size_t payloadOffset );
+extern template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<float>>> mapRaw( const std::filesystem::path& file, const RawParameters& params, size_t payloadOffset );
+
+/// maps the voxels of uncompressed Gav-file in memory instead of reading them, see mapRaw;
+/// T must correspond to ValueType from the header of the file
+template <typename T>
+Expected<VoxelsVolume<MappedBuffer<T>>> mapGav( const std::filesystem::path& file );
+
+extern template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<uint8_t>>> mapGav( const std::filesystem::path& file );
+extern template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<uint16_t>>> mapGav( const std::filesystem::path& file );
+extern template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<float>>> mapGav( const std::filesystem::path& file );
 
 /// Detects the format from file extension and loads voxels from it
 MRVOXELS_API Expected<std::vector<VdbVolume>> fromAnySupportedFormat( const std::filesystem::path& file,
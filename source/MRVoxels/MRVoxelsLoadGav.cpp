@@ -19,7 +19,11 @@ Expected<VdbVolume> fromGav( const std::filesystem::path& file, const ProgressCa
     return addFileNameInError( fromGav( in, cb ), file );
 }
 
-Expected<VdbVolume> fromGav( std::istream& in, const ProgressCallback& cb )
+namespace
+{
+
+/// reads the header of Gav-file, after which the voxels follow in the stream
+Expected<RawParameters> readGavHeader( std::istream& in )
 {
     uint32_t headerLen = 0;
     if ( !in.read( (char*) &headerLen, sizeof( headerLen ) ) )
@@ -79,9 +83,37 @@ Expected<VdbVolume> fromGav( std::istream& in, const ProgressCallback& cb )
     if ( headerJson["Compression"].isString() )
         return unexpected( "Compressed Gav-files are not supported" );
 
-    return fromRaw( in, params, cb );
+    return params;
+}
+
+} // anonymous namespace
+
+Expected<VdbVolume> fromGav( std::istream& in, const ProgressCallback& cb )
+{
+    return readGavHeader( in ).and_then( [&] ( const RawParameters& params )
+    {
+        return fromRaw( in, params, cb );
+    } );
 }
 
+template <typename T>
+Expected<VoxelsVolume<MappedBuffer<T>>> mapGav( const std::filesystem::path& file )
+{
+    std::ifstream in( file, std::ios::binary );
+    if ( !in )
+        return unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+    auto params = addFileNameInError( readGavHeader( in ), file );
+    if ( !params )
+        return unexpected( std::move( params.error() ) );
+    const auto payloadOffset = size_t( in.tellg() );
+    in.close();
+    return mapRaw<T>( file, *params, payloadOffset );
+}
+
+template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<uint8_t>>> mapGav( const std::filesystem::path& file );
+template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<uint16_t>>> mapGav( const std::filesystem::path& file );
+template MRVOXELS_API Expected<VoxelsVolume<MappedBuffer<float>>> mapGav( const std::filesystem::path& file );
+
 } //namespace VoxelsLoad
 
 } //namespace MR
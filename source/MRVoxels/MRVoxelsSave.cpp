@@ -2,7 +2,9 @@
 #include "MROpenVDB.h"
 #include "MRObjectVoxels.h"
 #include "MRVDBConversions.h"
+#include "MRVoxelsCompressedBricks.h"
 #include "MRVDBFloatGrid.h"
+#include "MRVoxelsVolumeAccess.h"
 
 #include "MRMesh/MRImageSave.h"
 #include "MRMesh/MRStringConvert.h"
@@ -288,51 +290,34 @@ MR_ON_INIT {                                                   \
 MR_ADD_VOXELS_SAVER( IOFilter( "Raw (.raw)", "*.raw" ), toRawAutoname )
 MR_ADD_VOXELS_SAVER( IOFilter( "Micro CT (.gav)", "*.gav" ), toGav )
 MR_ADD_VOXELS_SAVER( IOFilter( "OpenVDB (.vdb)", "*.vdb" ), toVdb )
+MR_ADD_VOXELS_SAVER( IOFilter( "Compressed bricks (.mrbv)", "*.mrbv" ), toCompressedBricks )
 
-Expected<void> saveSliceToImage( const std::filesystem::path& path, const VdbVolume& vdbVolume, const SlicePlane& slicePlain, int sliceNumber, ProgressCallback callback )
+namespace
 {
-    const auto& dims = vdbVolume.dims;
-    const int textureWidth = dims[( slicePlain + 1 ) % 3];
-    const int textureHeight = dims[( slicePlain + 2 ) % 3];
-
-    std::vector<Color> texture( textureWidth * textureHeight );
-    Vector3i activeVoxel;
-    switch ( slicePlain )
-    {
-    case SlicePlane::XY:
-        if ( sliceNumber > dims.z )
-            return unexpected( "Slice number exceeds voxel object borders" );
 
-        activeVoxel = { 0, 0, sliceNumber };
-        break;
-    case SlicePlane::YZ:
-        if ( sliceNumber > dims.x )
-            return unexpected( "Slice number exceeds voxel object borders" );
+/// saves the slice of the volume with given dimensions, the value of each voxel is returned by getValue( Vector3i ) and normalized in [min, max]
+template <typename Getter>
+Expected<void> saveSliceToImageT( const std::filesystem::path& path, const Vector3i& dims, Getter&& getValue, float min, float max,
+    const SlicePlane& slicePlain, int sliceNumber, ProgressCallback callback )
+{
+    if ( slicePlain != SlicePlane::XY && slicePlain != SlicePlane::YZ && slicePlain != SlicePlane::ZX )
+        return unexpected( "Slice plain is invalid" );
+    if ( sliceNumber < 0 || sliceNumber >= dims[slicePlain] )
+        return unexpected( "Slice number exceeds voxel object borders" );
 
-        activeVoxel = { sliceNumber, 0, 0 };
-        break;
-    case SlicePlane::ZX:
-        if ( sliceNumber > dims.y )
-            return unexpected( "Slice number exceeds voxel object borders" );
+    const int textureWidth = dims[( slicePlain + 1 ) % 3];
+    const int textureHeight = dims[( slicePlain + 2 ) % 3];
 
-        activeVoxel = { 0, sliceNumber, 0 };
-        break;
-    default:
-        return unexpected( "Slice plain is invalid" );
-    }
- 
-    const auto& grid = vdbVolume.data;
-    const auto accessor = grid->getConstAccessor();
-  
+    std::vector<Color> texture( size_t( textureWidth ) * textureHeight );
     for ( int i = 0; i < int( texture.size() ); ++i )
     {
-        openvdb::Coord coord;
+        Vector3i coord;
         coord[slicePlain] = sliceNumber;
         coord[( slicePlain + 1 ) % 3] = ( i % textureWidth );
         coord[( slicePlain + 2 ) % 3] = ( i / textureWidth );
 
-        const auto val = accessor.getValue( coord );
-        const float normedValue = ( val - vdbVolume.min ) / ( vdbVolume.max - vdbVolume.min );
+        const float val = float( getValue( coord ) );
+        const float normedValue = ( val - min ) / ( max - min );
         texture[i] = Color( Vector3f::diagonal( normedValue ) );
 
         if ( !reportProgress( callback, [&]{ return float( i ) / texture.size(); }, i, 128 ) )
@@ -343,13 +328,50 @@ Expected<void> saveSliceToImage( const std::filesystem::path& path, const VdbVol
     auto saveRes = ImageSave::toAnySupportedFormat( meshTexture, path );
     if ( !saveRes.has_value() )
         return unexpected( saveRes.error() );
-    
+
     if ( callback )
         callback( 1.0f );
 
     return {};
 }
 
+template <typename T>
+Expected<void> saveMappedSliceToImage( const std::filesystem::path& path, const VoxelsVolume<MappedBuffer<T>>& volume, float min, float max,
+    const SlicePlane& slicePlain, int sliceNumber, ProgressCallback callback )
+{
+    // only the voxels of the slice are read from the file
+    const VoxelsVolumeAccessor<VoxelsVolume<MappedBuffer<T>>> accessor( volume );
+    return saveSliceToImageT( path, volume.dims, [&accessor] ( const Vector3i& pos ) { return accessor.get( pos ); },
+        min, max, slicePlain, sliceNumber, std::move( callback ) );
+}
+
+} //anonymous namespace
+
+Expected<void> saveSliceToImage( const std::filesystem::path& path, const VdbVolume& vdbVolume, const SlicePlane& slicePlain, int sliceNumber, ProgressCallback callback )
+{
+    const auto accessor = vdbVolume.data->getConstAccessor();
+    return saveSliceToImageT( path, vdbVolume.dims, [&accessor] ( const Vector3i& pos ) { return accessor.getValue( openvdb::Coord( pos.x, pos.y, pos.z ) ); },
+        vdbVolume.min, vdbVolume.max, slicePlain, sliceNumber, std::move( callback ) );
+}
+
+Expected<void> saveSliceToImage( const std::filesystem::path& path, const MappedVolume& volume, float min, float max,
+    const SlicePlane& slicePlain, int sliceNumber, ProgressCallback callback )
+{
+    return saveMappedSliceToImage( path, volume, min, max, slicePlain, sliceNumber, std::move( callback ) );
+}
+
+Expected<void> saveSliceToImage( const std::filesystem::path& path, const MappedVolumeU16& volume, float min, float max,
+    const SlicePlane& slicePlain, int sliceNumber, ProgressCallback callback )
+{
+    return saveMappedSliceToImage( path, volume, min, max, slicePlain, sliceNumber, std::move( callback ) );
+}
+
+Expected<void> saveSliceToImage( const std::filesystem::path& path, const MappedVolumeU8& volume, float min, float max,
+    const SlicePlane& slicePlain, int sliceNumber, ProgressCallback callback )
+{
+    return saveMappedSliceToImage( path, volume, min, max, slicePlain, sliceNumber, std::move( callback ) );
+}
+
 Expected<void> saveAllSlicesToImage( const VdbVolume& vdbVolume, const SavingSettings& settings )
 {
     int numSlices{ 0 };
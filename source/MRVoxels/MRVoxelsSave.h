@@ -45,6 +45,15 @@ MRVOXELS_API Expected<void> toAnySupportedFormat( const VdbVolume& vdbVolume, co
 /// save the slice by the active plane through the sliceNumber to an image file
 MRVOXELS_API Expected<void> saveSliceToImage( const std::filesystem::path& path, const VdbVolume& vdbVolume, const SlicePlane& slicePlain, int sliceNumber, ProgressCallback callback = {} );
 
+/// save the slice by the active plane through the sliceNumber of the volume mapped from a file to an image file,
+/// reading from the file only the voxels of the slice; the values in [min, max] are mapped in the shades of gray
+MRVOXELS_API Expected<void> saveSliceToImage( const std::filesystem::path& path, const MappedVolume& volume, float min, float max,
+    const SlicePlane& slicePlain, int sliceNumber, ProgressCallback callback = {} );
+MRVOXELS_API Expected<void> saveSliceToImage( const std::filesystem::path& path, const MappedVolumeU16& volume, float min, float max,
+    const SlicePlane& slicePlain, int sliceNumber, ProgressCallback callback = {} );
+MRVOXELS_API Expected<void> saveSliceToImage( const std::filesystem::path& path, const MappedVolumeU8& volume, float min, float max,
+    const SlicePlane& slicePlain, int sliceNumber, ProgressCallback callback = {} );
+
 // stores together all data for save voxel object as a group of images
 struct SavingSettings
 {
@@ -33,6 +33,22 @@ struct VoxelTraits<FloatGrid>
     using ValueType = float;
 };
 
+template <typename T>
+struct VoxelTraits<MappedBuffer<T>>
+{
+    using ValueType = T;
+};
+
+/// the values of mapped buffer are in the file, and they do not occupy heap memory
+template <typename T>
+[[nodiscard]] inline size_t heapBytes( const MappedBuffer<T> & )
+{
+    return 0;
+}
+
+/// returns the amount of memory brick volume data occupies on heap
+[[nodiscard]] MRVOXELS_API size_t heapBytes( const BrickVolumeData & data );
+
 /// represents a box in 3D space subdivided on voxels stored in T
 template <typename T>
 struct VoxelsVolume
@@ -2,6 +2,8 @@
 
 #include "MRVoxelsFwd.h"
 #include "MRVoxelsVolume.h"
+#include "MRBrickVolume.h"
+#include "MRMappedBuffer.h"
 #include "MRVDBFloatGrid.h"
 #include "MRMesh/MRVolumeIndexer.h"
 #include "MRMesh/MRIsNaN.h"
@@ -94,6 +96,68 @@ public:
     using Base::Base;
 };
 
+/// VoxelsVolumeAccessor specialization for brick volumes
+template <>
+class VoxelsVolumeAccessor<BrickVolume>
+{
+public:
+    using VolumeType = BrickVolume;
+    using ValueType = typename VolumeType::ValueType;
+    static constexpr bool cacheEffective = false; ///< the values are taken from bricks in memory, caching them does not make much sense
+
+    explicit VoxelsVolumeAccessor( const VolumeType& volume )
+        : data_( volume.data )
+    {}
+
+    ValueType get( const Vector3i& pos ) const
+    {
+        return data_.get( pos );
+    }
+
+    ValueType get( const VoxelLocation & loc ) const
+    {
+        return get( loc.pos );
+    }
+
+    /// this additional shift shall be added to integer voxel coordinates during transformation in 3D space
+    Vector3f shift() const { return Vector3f::diagonal( 0.5f ); }
+
+private:
+    const BrickVolumeData& data_;
+};
+
+/// VoxelsVolumeAccessor specialization for volumes mapped from files
+template <typename T>
+class VoxelsVolumeAccessor<VoxelsVolume<MappedBuffer<T>>>
+{
+public:
+    using VolumeType = VoxelsVolume<MappedBuffer<T>>;
+    using ValueType = typename VolumeType::ValueType;
+    static constexpr bool cacheEffective = false; ///< the values are already cached in memory by the operating system
+
+    explicit VoxelsVolumeAccessor( const VolumeType& volume )
+        : data_( volume.data )
+        , indexer_( volume.dims )
+    {}
+
+    ValueType get( const Vector3i& pos ) const
+    {
+        return data_[indexer_.toVoxelId( pos )];
+    }
+
+    ValueType get( const VoxelLocation & loc ) const
+    {
+        return data_[loc.id];
+    }
+
+    /// this additional shift shall be added to integer voxel coordinates during transformation in 3D space
+    Vector3f shift() const { return Vector3f::diagonal( 0.5f ); }
+
+private:
+    const MappedBuffer<T>& data_;
+    VolumeIndexer indexer_;
+};
+
 /// VoxelsVolumeAccessor specialization for value getters
 template <typename T>
 class VoxelsVolumeAccessor<VoxelsVolume<VoxelValueGetter<T>>>
@@ -3,12 +3,15 @@
 #include "MRVoxelsVolumeAccess.h"
 #include "MRMesh/MRParallelFor.h"
 #include "MRMesh/MRTimer.h"
+#include "MRPch/MRTBB.h"
+#include <memory>
 
 namespace MR
 {
 
 /// This accessor first loads data for given number of layers in internal cache, and then returns values from the cache.
 /// Direct access to data outside of cache is not allowed.
+/// Optionally several next layers can be computed in background tasks while the preloaded layers are consumed.
 template <typename V>
 class VoxelsVolumeCachingAccessor
 {
@@ -20,20 +23,35 @@ public:
     {
         /// amount of layers to be preloaded
         size_t preloadedLayerCount = 1;
+        /// amount of layers after preloaded ones to be computed in background tasks,
+        /// so preloadNextLayer() has to wait less or not at all;
+        /// every such layer takes the same amount of memory as one preloaded layer;
+        /// 0 means that each next layer is computed synchronously in preloadNextLayer()
+        size_t prefetchedLayerCount = 0;
     };
 
     VoxelsVolumeCachingAccessor( const VoxelsVolumeAccessor<V>& accessor, const VolumeIndexer& indexer, Parameters parameters = {} )
         : accessor_( accessor )
         , indexer_( indexer )
         , params_( std::move( parameters ) )
-        , layers_( params_.preloadedLayerCount )
-        , firstLayerVoxelId_( params_.preloadedLayerCount )
+        , layers_( params_.preloadedLayerCount + params_.prefetchedLayerCount )
+        , firstLayerVoxelId_( layers_.size() )
+        , loadingTasks_( std::make_unique<tbb::task_group[]>( layers_.size() ) )
     {
         assert( params_.preloadedLayerCount > 0 );
         for ( auto & l : layers_ )
             l.resize( indexer_.sizeXY() );
     }
 
+    VoxelsVolumeCachingAccessor( const VoxelsVolumeCachingAccessor & ) = delete;
+    VoxelsVolumeCachingAccessor & operator =( const VoxelsVolumeCachingAccessor & ) = delete;
+
+    /// waits for the completion of all background tasks
+    ~VoxelsVolumeCachingAccessor()
+    {
+        waitAll_();
+    }
+
     /// get current layer
     [[nodiscard]] int currentLayer() const
     {
@@ -44,12 +62,14 @@ public:
     void preloadLayer( int z )
     {
         assert( 0 <= z && z < indexer_.dims().z );
+        waitAll_();
         z_ = z;
+        firstSlot_ = 0;
         for ( auto layerIndex = 0; layerIndex < layers_.size(); ++layerIndex )
         {
             if ( indexer_.dims().z <= z_ + layerIndex )
                 break;
-            preloadLayer_( layerIndex );
+            loadLayer_( layerIndex, layerIndex >= params_.preloadedLayerCount );
         }
     }
 
@@ -57,23 +77,24 @@ public:
     void preloadNextLayer()
     {
         z_ += 1;
-        for ( auto i = 0; i + 1 < layers_.size(); ++i )
-        {
-            std::swap( layers_[i], layers_[i + 1] );
-            firstLayerVoxelId_[i] = firstLayerVoxelId_[i + 1];
-        }
-        if ( z_ + params_.preloadedLayerCount - 1 < indexer_.dims().z )
-            preloadLayer_( params_.preloadedLayerCount - 1 );
+        // the slot of the released layer becomes the slot of the last layer
+        firstSlot_ = ( firstSlot_ + 1 ) % layers_.size();
+        const auto lastLayerIndex = layers_.size() - 1;
+        if ( z_ + lastLayerIndex < indexer_.dims().z )
+            loadLayer_( lastLayerIndex, params_.prefetchedLayerCount > 0 );
+        // all previous preloaded layers were already awaited
+        loadingTasks_[slot_( params_.preloadedLayerCount - 1 )].wait();
     }
 
     /// get voxel volume data
     ValueType get( const VoxelLocation & loc ) const
     {
         const auto layerIndex = loc.pos.z - z_;
-        assert( 0 <= layerIndex && layerIndex < layers_.size() );
-        assert( loc.id >= firstLayerVoxelId_[layerIndex] );
-        assert( loc.id < firstLayerVoxelId_[layerIndex] + indexer_.sizeXY() );
-        return layers_[layerIndex][loc.id - firstLayerVoxelId_[layerIndex]];
+        assert( 0 <= layerIndex && layerIndex < params_.preloadedLayerCount );
+        const auto slot = slot_( layerIndex );
+        assert( loc.id >= firstLayerVoxelId_[slot] );
+        assert( loc.id < firstLayerVoxelId_[slot] + indexer_.sizeXY() );
+        return layers_[slot][loc.id - firstLayerVoxelId_[slot]];
     }
 
 private:
@@ -82,15 +103,32 @@ private:
         return indexer_.toVoxelId( { pos.x, pos.y, 0 } );
     }
 
-    void preloadLayer_( size_t layerIndex )
+    /// the index in layers_ where given layer (counting from current one) is stored
+    [[nodiscard]] size_t slot_( size_t layerIndex ) const
+    {
+        return ( firstSlot_ + layerIndex ) % layers_.size();
+    }
+
+    /// fills given layer (counting from current one) either immediately or in a background task
+    void loadLayer_( size_t layerIndex, bool inBackground )
     {
-        MR_TIMER
         assert( layerIndex < layers_.size() );
-        auto& layer = layers_[layerIndex];
+        const auto slot = slot_( layerIndex );
         const auto z = z_ + (int)layerIndex;
+        assert( 0 <= z && z < indexer_.dims().z );
+        firstLayerVoxelId_[slot] = indexer_.toVoxelId( Vector3i{ 0, 0, z } );
+        // the task keeps the pointer to the data, since layers_ are not reallocated
+        ValueType * layer = layers_[slot].data();
+        if ( inBackground )
+            loadingTasks_[slot].run( [this, layer, z] { fillLayer_( layer, z ); } );
+        else
+            fillLayer_( layer, z );
+    }
+
+    void fillLayer_( ValueType * layer, int z ) const
+    {
+        MR_TIMER
         const auto& dims = indexer_.dims();
-        assert( 0 <= z && z < dims.z );
-        firstLayerVoxelId_[layerIndex] = indexer_.toVoxelId( Vector3i{ 0, 0, z } );
         ParallelFor( 0, dims.y, [&]( int y )
         {
             auto accessor = accessor_; // only for OpenVDB accessor, which is not thread-safe
@@ -101,6 +139,12 @@ private:
         } );
     }
 
+    void waitAll_()
+    {
+        for ( size_t i = 0; i < layers_.size(); ++i )
+            loadingTasks_[i].wait();
+    }
+
 private:
     const VoxelsVolumeAccessor<V>& accessor_;
     VolumeIndexer indexer_;
@@ -109,7 +153,10 @@ private:
     int z_ = -1;
     std::vector<std::vector<ValueType>> layers_;
     std::vector<VoxelId> firstLayerVoxelId_;
+    /// the position in layers_ of current layer
+    size_t firstSlot_ = 0;
+    /// one task group per element in layers_ to wait for the filling of particular layer
+    std::unique_ptr<tbb::task_group[]> loadingTasks_;
 };
 
 } // namespace MR
-